@@ -0,0 +1,387 @@
+/**
+ * @file reputation_bench.cpp
+ * @brief microbenchmarks of the simulation hot path, run from the project
+ * root so that ./payoffMatrix, ./strategy and ./norm are found:
+ *
+ *   ./build/reputation_bench --benchmark_filter=Step
+ *
+ * Every benchmark reports items/s and allocs/item, the number of calls of
+ * operator new per processed item. The benchmarks of the engine take
+ * (population, norm id) as arguments.
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Action.hpp"
+#include "CompiledPayoffMatrix.hpp"
+#include "Evolution.hpp"
+#include "GameKernel.hpp"
+#include "LockstepReplicas.hpp"
+#include "Norm.hpp"
+#include "PayoffCache.hpp"
+#include "PayoffMatrix.hpp"
+#include "Player.hpp"
+#include "RandomStream.hpp"
+#include "Strategy.hpp"
+
+namespace {
+std::atomic<size_t> allocNum{0};
+}
+
+void* operator new(size_t size) {
+  allocNum.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace {
+const std::string PAYOFF_MATRIX_CONFIG = "payoffMatrix_longterm_no_norm_error";
+
+/**
+ * @brief count the allocations of the timed loop and report the counters
+ */
+class AllocScope {
+ private:
+  benchmark::State& state;
+  size_t begin;
+
+ public:
+  explicit AllocScope(benchmark::State& state)
+      : state(state), begin(allocNum.load()) {}
+  ~AllocScope() {
+    size_t allocs = allocNum.load() - this->begin;
+    this->state.SetItemsProcessed(this->state.iterations());
+    this->state.counters["allocs/item"] = benchmark::Counter(
+        static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+  }
+};
+
+std::vector<Action> getActions() { return {Action("C", 0), Action("D", 1)}; }
+
+PayoffMatrix loadPayoffMatrix(int normId) {
+  PayoffMatrix payoffMatrix("./payoffMatrix/" + PAYOFF_MATRIX_CONFIG +
+                            "/PayoffMatrix" + std::to_string(normId) + ".csv");
+  payoffMatrix.updateVar("b", 4);
+  payoffMatrix.updateVar("beta", 3);
+  payoffMatrix.updateVar("c", 1);
+  payoffMatrix.updateVar("gamma", 1);
+  payoffMatrix.updateVar("p", 1);
+  return payoffMatrix;
+}
+
+Player loadPlayer(std::string const& name,
+                  std::vector<Strategy> const& strategies) {
+  Player player(name, 0, getActions());
+  player.setStrategies(strategies);
+  player.loadStrategy("./strategy");
+  player.setStrategy(strategies[0].getName());
+  return player;
+}
+
+Evolution makeEvolution(benchmark::State& state) {
+  return Evolution(state.range(0), 1, 4, 3, 1, 1, 0.0001, state.range(1), 1,
+                   PAYOFF_MATRIX_CONFIG, 1);
+}
+
+/** @brief (population, norm id) */
+void engineArgs(benchmark::internal::Benchmark* bench) {
+  for (int population : {160, 1600, 16000}) {
+    for (int normId : {0, 5, 10, 15}) {
+      bench->Args({population, normId});
+    }
+  }
+}
+
+void normArgs(benchmark::internal::Benchmark* bench) {
+  for (int normId : {0, 5, 10, 15}) {
+    bench->Arg(normId);
+  }
+}
+}  // namespace
+
+static void BM_PlayerDonateStr(benchmark::State& state) {
+  Player donor = loadPlayer("donor", loadPayoffMatrix(10).getRowStrategies());
+  donor.setStrategy("DISC");
+  const std::string inputs[2] = {"0", "1"};
+  int i = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(donor.donate(inputs[i++ & 1]));
+  }
+}
+BENCHMARK(BM_PlayerDonateStr);
+
+static void BM_PlayerDonate(benchmark::State& state) {
+  Player donor = loadPlayer("donor", loadPayoffMatrix(10).getRowStrategies());
+  int i = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(donor.donate(i & 3, (i >> 2) & 1));
+    i++;
+  }
+}
+BENCHMARK(BM_PlayerDonate);
+
+static void BM_PlayerRewardStr(benchmark::State& state) {
+  Player recipient =
+      loadPlayer("recipient", loadPayoffMatrix(10).getColStrategies());
+  recipient.setStrategy("SR");
+  const std::string inputs[2] = {"C", "D"};
+  int i = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(recipient.reward(inputs[i++ & 1]));
+  }
+}
+BENCHMARK(BM_PlayerRewardStr);
+
+static void BM_PlayerReward(benchmark::State& state) {
+  Player recipient =
+      loadPlayer("recipient", loadPayoffMatrix(10).getColStrategies());
+  int i = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(recipient.reward(i & 3, (i >> 2) & 1));
+    i++;
+  }
+}
+BENCHMARK(BM_PlayerReward);
+
+/** @brief the reputation value with an assessment error of 0.01 */
+static void BM_NormGetReputationValue(benchmark::State& state) {
+  std::vector<Action> actions = getActions();
+  Norm norm("./norm/norm" + std::to_string(state.range(0)) + ".csv", actions,
+            actions);
+  int i = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(norm.getReputation(
+        actions[i & 1], actions[(i >> 1) & 1], (i >> 2) & 1, 0.01));
+    i++;
+  }
+}
+BENCHMARK(BM_NormGetReputationValue)->Apply(normArgs);
+
+static void BM_NormGetReputation(benchmark::State& state) {
+  std::vector<Action> actions = getActions();
+  Norm norm("./norm/norm" + std::to_string(state.range(0)) + ".csv", actions,
+            actions);
+  int i = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        norm.getReputationId(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+    i++;
+  }
+}
+BENCHMARK(BM_NormGetReputation)->Apply(normArgs);
+
+static void BM_EvalPayoffMatrix(benchmark::State& state) {
+  PayoffMatrix payoffMatrix = loadPayoffMatrix(state.range(0));
+  int i = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    payoffMatrix.updateVar("p", (i++ & 1) ? 1.0 : 0.0);
+    benchmark::DoNotOptimize(payoffMatrix.evalPayoffMatrix());
+  }
+}
+BENCHMARK(BM_EvalPayoffMatrix)->Apply(normArgs);
+
+static void BM_CompiledPayoffMatrixEval(benchmark::State& state) {
+  CompiledPayoffMatrix payoffMatrix =
+      loadPayoffMatrix(state.range(0)).compile();
+  const int pVarId = payoffMatrix.getVarId("p");
+  int i = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    payoffMatrix.setVar(pVarId, 1, (i++ & 1) ? 1.0 : 0.0);
+    payoffMatrix.eval();
+    benchmark::DoNotOptimize(payoffMatrix.getPayoffData());
+  }
+}
+BENCHMARK(BM_CompiledPayoffMatrixEval)->Apply(normArgs);
+
+static void BM_GetAvgPayoff(benchmark::State& state) {
+  Evolution evolution = makeEvolution(state);
+  const Population& individuals = evolution.getIndividuals();
+  const std::vector<Strategy>& donorStrategies = evolution.getDonorStrategies();
+  const std::vector<Strategy>& recipientStrategies =
+      evolution.getRecipientStrategies();
+  int i = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(getAvgPayoff(
+        donorStrategies[i & 3], recipientStrategies[(i >> 2) & 3],
+        evolution.getPayoffMatrix(), individuals.getDonorComposition(),
+        individuals.getRecipientComposition(), evolution.getPopulation()));
+    i++;
+  }
+}
+BENCHMARK(BM_GetAvgPayoff)->Apply(engineArgs);
+
+/** @brief one switch of an individual and the two reads of an imitation by
+ * the GameKernel Kernel, the unrolled 4x4 against the dynamic one */
+template <class Kernel>
+static void BM_PayoffCacheGetAvgPayoff(benchmark::State& state) {
+  Evolution evolution = makeEvolution(state);
+  const Population& individuals = evolution.getIndividuals();
+  PayoffCache payoffCache(4, 4, 2, evolution.getPopulation());
+  payoffCache.setPayoffs(0, evolution.getPayoffMatrix());
+  payoffCache.setPayoffs(1, evolution.getPayoffMatrix());
+  payoffCache.setCounts(individuals.getDonorComposition(),
+                        individuals.getRecipientComposition());
+  int i = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    payoffCache.moveDonor(i & 3, (i + 1) & 3);
+    payoffCache.moveRecipient((i >> 2) & 3, ((i >> 2) + 1) & 3);
+    benchmark::DoNotOptimize(
+        payoffCache.getAvgPayoff<Kernel>(i & 1, i & 3, (i >> 2) & 3));
+    benchmark::DoNotOptimize(payoffCache.getAvgPayoff<Kernel>(
+        i & 1, (i + 1) & 3, ((i >> 2) + 1) & 3));
+    i++;
+  }
+}
+BENCHMARK_TEMPLATE(BM_PayoffCacheGetAvgPayoff, GameKernel<4, 4>)
+    ->Apply(engineArgs);
+BENCHMARK_TEMPLATE(BM_PayoffCacheGetAvgPayoff,
+                   GameKernel<DYNAMIC_STRATEGY_NUM, DYNAMIC_STRATEGY_NUM>)
+    ->Apply(engineArgs);
+
+static void BM_Fermi(benchmark::State& state) {
+  double payoff = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    payoff += 0.001;
+    benchmark::DoNotOptimize(fermi(payoff, 1.0, 1.0));
+  }
+}
+BENCHMARK(BM_Fermi);
+
+static void BM_PrintStatistics(benchmark::State& state) {
+  Evolution evolution = makeEvolution(state);
+  AllocScope scope(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(printStatistics(
+        evolution.getIndividuals(), evolution.getDonorStrategies(),
+        evolution.getRecipientStrategies(), evolution.getPopulation(), 0,
+        false, evolution.getCoopActionId(), 0,
+        evolution.getCoopRateStream()));
+  }
+}
+BENCHMARK(BM_PrintStatistics)->Apply(engineArgs);
+
+static void BM_FillStatisticsRow(benchmark::State& state) {
+  Evolution evolution = makeEvolution(state);
+  std::vector<uint32_t> row(evolution.getLogColumnNames().size());
+  AllocScope scope(state);
+  for (auto _ : state) {
+    fillStatisticsRow(evolution.getIndividuals(),
+                      evolution.getDonorStrategies(),
+                      evolution.getRecipientStrategies(), 0,
+                      evolution.getCoopActionId(), 0,
+                      evolution.getCoopRateStream(), row);
+    benchmark::DoNotOptimize(row.data());
+  }
+}
+BENCHMARK(BM_FillStatisticsRow)->Apply(engineArgs);
+
+/** @brief one step of func() without the log */
+static void BM_Step(benchmark::State& state) {
+  Evolution evolution = makeEvolution(state);
+  AllocScope scope(state);
+  for (auto _ : state) {
+    evolution.step();
+  }
+}
+BENCHMARK(BM_Step)->Apply(engineArgs);
+
+/** @brief 4096 steps of func() in one call of steps(), which picks
+ * the GameKernel once, the steps counter is the steps per second (compare
+ * with BM_Step) */
+static void BM_Steps(benchmark::State& state) {
+  const int call_step_num = 4096;
+  Evolution evolution = makeEvolution(state);
+  int64_t step_num = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    evolution.steps(call_step_num);
+    step_num += call_step_num;
+  }
+  state.counters["steps"] =
+      benchmark::Counter(static_cast<double>(step_num),
+                         benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Steps)->Apply(engineArgs);
+
+/** @brief the calls of func() with --updateMode skip, of at most population
+ * steps, the steps counter is the steps per second */
+static void BM_SkipSteps(benchmark::State& state) {
+  Evolution evolution = makeEvolution(state);
+  int64_t step_num = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    step_num += evolution.skipSteps(state.range(0));
+  }
+  state.counters["steps"] =
+      benchmark::Counter(static_cast<double>(step_num),
+                         benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_SkipSteps)->Apply(engineArgs);
+
+/** @brief one batch of func() with --updateMode batch on all the threads,
+ * the steps counter is the steps per second */
+static void BM_StepBatch(benchmark::State& state) {
+  Evolution evolution = makeEvolution(state);
+  int64_t step_num = 0;
+  AllocScope scope(state);
+  for (auto _ : state) {
+    evolution.stepBatch();
+    step_num += evolution.getBatchStepNum();
+  }
+  state.counters["steps"] =
+      benchmark::Counter(static_cast<double>(step_num),
+                         benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_StepBatch)->Apply(engineArgs)->UseRealTime();
+
+/** @brief one step of the LANE_NUM replicas of LockstepReplicas, the steps
+ * counter is the replica steps per second (compare with BM_Step) */
+static void lockstepStep(benchmark::State& state, bool simd) {
+  LockstepReplicas replicas(state.range(0), 1, 4, 3, 1, 1, 0.0001,
+                            state.range(1), 1, PAYOFF_MATRIX_CONFIG, 1);
+  replicas.setSimd(simd);
+  AllocScope scope(state);
+  for (auto _ : state) {
+    replicas.step();
+  }
+  state.counters["steps"] = benchmark::Counter(
+      static_cast<double>(replicas.getStepNum() * LockstepReplicas::LANE_NUM),
+      benchmark::Counter::kIsRate);
+}
+
+/** @brief the AVX2 stages if the CPU has AVX2 */
+static void BM_LockstepStep(benchmark::State& state) {
+  lockstepStep(state, true);
+}
+BENCHMARK(BM_LockstepStep)->Apply(engineArgs);
+
+/** @brief the loops over the lanes */
+static void BM_LockstepStepLoops(benchmark::State& state) {
+  lockstepStep(state, false);
+}
+BENCHMARK(BM_LockstepStepLoops)->Apply(engineArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,104 @@
+/**
+ * @file BinaryLog.hpp
+ * @brief the column-oriented binary trajectory log, the compact alternative of
+ * the csv log written by func()
+ *
+ * file layout (little endian):
+ * 1. header: magic "REPLOG01", uint32 version, uint32 columnNum, uint32
+ * rowsPerChunk, uint32 reserved, float64 population, then for each column:
+ * uint8 type, uint16 name length, name bytes. The column names are the same
+ * as the csv header.
+ * 2. chunks: uint32 magic "CHNK", uint32 rowNum, uint64 first step, rowNum
+ * uint64 steps, then for each column but the first rowNum 4-byte values stored
+ * contiguously. The first column is the step, it is stored only in the uint64
+ * steps so that it does not wrap in long runs.
+ * 3. index: for each chunk uint64 offset, uint64 first step, uint32 rowNum,
+ * then uint64 chunkNum, uint64 index offset and magic "REPLOGIX". A file
+ * without index (killed writer) is read by scanning the chunks.
+ *
+ */
+
+#ifndef BINARYLOG_HPP
+#define BINARYLOG_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief the type of the 4-byte values of a column
+ */
+enum class BinaryLogColumnType : uint8_t {
+  UINT32 = 0,  //< raw unsigned integer, such as the step (the first column)
+  COUNT = 1,   //< uint32 number of individuals, its value in csv is count / population
+  FLOAT32 = 2  //< float32, such as the cooperation rate
+};
+
+struct BinaryLogChunkIndex {
+  uint64_t offset;     //< the file offset of the chunk header
+  uint64_t firstStep;  //< the step of the first row in the chunk
+  uint32_t rowNum;
+};
+
+class BinaryLogWriter {
+ private:
+  std::ofstream file;
+  std::vector<std::string> columnNames;
+  std::vector<BinaryLogColumnType> columnTypes;
+  uint32_t rowsPerChunk;
+  std::vector<uint32_t> chunkBuffer;  //< column-major, [column * rowsPerChunk + row]
+  std::vector<uint64_t> stepBuffer;   //< the steps of the rows in the chunk
+  uint32_t chunkRowNum;
+  uint64_t chunkFirstStep;
+  std::vector<BinaryLogChunkIndex> index;
+  bool closed;
+
+  void flushChunk();
+
+ public:
+  BinaryLogWriter(std::string const& path,
+                  std::vector<std::string> const& columnNames,
+                  std::vector<BinaryLogColumnType> const& columnTypes,
+                  double population, uint32_t rowsPerChunk = 4096);
+  BinaryLogWriter(std::string const& path, uint64_t offset);
+  ~BinaryLogWriter();
+
+  void writeRow(uint64_t step, const uint32_t* values);
+  void flush();
+  uint64_t getOffset();
+  void close();
+
+  static uint32_t encodeFloat(float value);
+  static float decodeFloat(uint32_t value);
+};
+
+class BinaryLogReader {
+ private:
+  std::ifstream file;
+  std::vector<std::string> columnNames;
+  std::vector<BinaryLogColumnType> columnTypes;
+  uint32_t rowsPerChunk;
+  double population;
+  std::vector<BinaryLogChunkIndex> index;
+
+  void loadIndex();
+
+ public:
+  explicit BinaryLogReader(std::string const& path);
+  ~BinaryLogReader();
+
+  const std::vector<std::string>& getColumnNames() const { return this->columnNames; }
+  const std::vector<BinaryLogColumnType>& getColumnTypes() const { return this->columnTypes; }
+  uint32_t getRowsPerChunk() const { return this->rowsPerChunk; }
+  double getPopulation() const { return this->population; }
+  const std::vector<BinaryLogChunkIndex>& getIndex() const { return this->index; }
+
+  void readRows(uint64_t stepBegin, uint64_t stepEnd,
+                std::function<void(uint64_t step, const uint32_t* row)> const& callback);
+  std::string formatCsvHeader() const;
+  std::string formatCsvRow(uint64_t step, const uint32_t* row) const;
+};
+
+#endif  // !BINARYLOG_HPP
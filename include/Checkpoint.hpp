@@ -0,0 +1,57 @@
+/**
+ * @file Checkpoint.hpp
+ * @brief the binary snapshot of a running agent-mode run, written
+ * periodically (--checkpointSteps) and on SIGINT/SIGTERM, and continued by
+ * --resume bit-exactly, appending to the same log
+ *
+ * file layout (little endian): magic "REPCKPT1", uint32 version, uint64 step,
+ * uint64 generation, string params ("name=value" lines), string logPath,
+ * uint64 logOffset, uint32 population, uint8 reputation bit num, uint8
+ * donor strategy ids[population], uint8 recipient strategy ids[population],
+ * uint64 reputation bits[(population * bit num + 63) / 64], the donor and
+ * recipient composition counts (uint32 num, int32 counts[num]), int32 good
+ * reputation number, the random streams (uint32 num, then uint64 stream id
+ * and uint64 position each), the string of the LogReducer state, and the end
+ * magic "REPCKEND". A string is a uint32 length and its bytes. The version is
+ * 1, a file of any other version is rejected.
+ *
+ * The file is written to path + ".tmp", synced to the disk and renamed, so a
+ * checkpoint is never seen half written, even after a crash. The reader
+ * checks every size against the length of the file before allocating.
+ *
+ */
+
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct CheckpointStream {
+  uint64_t streamId;
+  uint64_t position;  //< RandomStream::getPosition()
+};
+
+struct Checkpoint {
+  uint64_t step = 0;        //< the steps done
+  uint64_t generation = 0;  //< the generations (or batches) done by the synchronous (or batch) update
+  std::string params;       //< the arguments of the run to resume it, "name=value" per line
+  std::string logPath;
+  uint64_t logOffset = 0;   //< the size of the log when the checkpoint is written
+  int population = 0;
+  std::vector<uint8_t> donorStrategyIds;
+  std::vector<uint8_t> recipientStrategyIds;
+  int reputationBitNum = 1;  //< the bits of a reputation id in reputationBits, Population::getReputationBitNum()
+  std::vector<uint64_t> reputationBits;
+  std::vector<int> donorCounts;      //< the donor composition, checked when the population is restored
+  std::vector<int> recipientCounts;  //< the recipient composition
+  int goodReputationNum = 0;
+  std::vector<CheckpointStream> streams;
+  std::string reducerState;  //< LogReducer::saveState(), empty without a summary
+};
+
+void writeCheckpoint(std::string const& path, Checkpoint const& checkpoint);
+Checkpoint readCheckpoint(std::string const& path);
+
+#endif  // !CHECKPOINT_HPP
@@ -0,0 +1,83 @@
+#ifndef COMPILEDPAYOFFMATRIX_HPP
+#define COMPILEDPAYOFFMATRIX_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PayoffMatrix.hpp"
+#include "Strategy.hpp"
+
+namespace mu {
+class Parser;
+}
+
+/**
+ * @brief the reusable evaluator of a PayoffMatrix, created by
+ * PayoffMatrix::compile()
+ *
+ * Every cell expression is parsed once and bound to a value slot per
+ * (player, var), so re-evaluation only runs the muParser bytecode of the cells
+ * that depend on the vars changed since the last eval(). Vars are addressed by
+ * the integer id returned by getVarId(), so the hot loop does no string
+ * handling and no heap allocation.
+ *
+ * player 0 is the row player (donor) and player 1 is the column player
+ * (recipient), the same as the vars_for_donor / vars_for_receiver of
+ * PayoffMatrix::evalPayoffMatrix.
+ */
+class CompiledPayoffMatrix {
+ private:
+  int rowNum;
+  int colNum;
+  int playerNum;
+  int varNum;
+  std::vector<std::string> varNames;  //< var id -> var name
+  std::vector<Strategy> rowStrategies;
+  std::vector<Strategy> colStrategies;
+  std::unique_ptr<double[]> varValues;  //< [player * varNum + varId], the parsers are bound to these addresses
+  std::vector<std::unique_ptr<mu::Parser>> parsers;  //< one parser per cell, [(row * colNum + col) * playerNum + player]
+  std::vector<double> payoff;  //< evaluated payoffs, same layout as parsers
+  std::vector<std::vector<int>> dependentCells;  //< [player * varNum + varId] -> the cells using this var
+  std::vector<uint8_t> dirtyFlags;  //< whether the cell is already in dirtyCells
+  std::vector<int> dirtyCells;  //< cells to re-evaluate, reserved to the cell number so it never reallocates
+
+  void markDirty(int player, int varId);
+
+ public:
+  explicit CompiledPayoffMatrix(const PayoffMatrix& payoffMatrix);
+  CompiledPayoffMatrix(CompiledPayoffMatrix&& other) noexcept;
+  CompiledPayoffMatrix& operator=(CompiledPayoffMatrix&& other) noexcept;
+  CompiledPayoffMatrix(const CompiledPayoffMatrix&) = delete;
+  CompiledPayoffMatrix& operator=(const CompiledPayoffMatrix&) = delete;
+  ~CompiledPayoffMatrix();
+
+  int getVarId(const std::string& varName) const;
+  std::string getVarName(int varId) const { return this->varNames.at(varId); }
+  double getVarValue(int varId, int player) const {
+    return this->varValues[player * this->varNum + varId];
+  }
+
+  void setVar(int varId, double varValue);
+  void setVar(int varId, int player, double varValue);
+
+  void eval();
+
+  /** @brief the payoff of the player in cell (row, col), valid after eval() */
+  double getPayoff(int row, int col, int player) const {
+    return this->payoff[(row * this->colNum + col) * this->playerNum + player];
+  }
+  const double* getPayoffData() const { return this->payoff.data(); }
+  std::vector<std::vector<std::vector<double>>> getPayoffMatrix() const;
+
+  int getRowNum() const { return this->rowNum; }
+  int getColNum() const { return this->colNum; }
+  int getPlayerNum() const { return this->playerNum; }
+  int getVarNum() const { return this->varNum; }
+
+  const std::vector<Strategy>& getRowStrategies() const { return this->rowStrategies; }
+  const std::vector<Strategy>& getColStrategies() const { return this->colStrategies; }
+};
+
+#endif  // !COMPILEDPAYOFFMATRIX_HPP
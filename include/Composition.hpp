@@ -0,0 +1,41 @@
+#ifndef COMPOSITION_HPP
+#define COMPOSITION_HPP
+
+#include <vector>
+
+/**
+ * @brief the composition of the population, indexed by a dense class id such
+ * as Strategy::getId().
+ *
+ * It always keeps the number of individuals of each class. If trackMembers is
+ * set, it also keeps the individual ids of each class in an unordered list,
+ * which supports O(1) insertion and swap-remove.
+ */
+class Composition {
+ private:
+  std::vector<int> counts;  //< class id -> number of individuals
+  bool trackMembers;
+  std::vector<std::vector<int>> members;  //< class id -> individual ids (unordered), only if trackMembers
+  std::vector<int> memberPos;  //< individual id -> position in members[class id], only if trackMembers
+
+  void insertMember(int individualId, int classId);
+  void eraseMember(int individualId, int classId);
+
+ public:
+  Composition();
+  Composition(int classNum, int population, bool trackMembers = false);
+  ~Composition();
+
+  void add(int individualId, int classId);
+  void remove(int individualId, int classId);
+  void move(int individualId, int fromClassId, int toClassId);
+  void addCount(int classId, int count);
+
+  int getCount(int classId) const { return this->counts[classId]; }
+  const std::vector<int>& getCounts() const { return this->counts; }
+  int getClassNum() const { return this->counts.size(); }
+  bool isTrackMembers() const { return this->trackMembers; }
+  const std::vector<int>& getMembers(int classId) const;
+};
+
+#endif  // !COMPOSITION_HPP
@@ -0,0 +1,22 @@
+/**
+ * @file CsvTable.hpp
+ * @brief the cells of the small csv files of the game (payoff matrices,
+ * strategies and norms), read by the LineReader of fast-cpp-csv-parser and
+ * split on the delimiter. The cells are kept as strings, the parsers of
+ * PayoffMatrix, Player and Norm interpret them.
+ *
+ */
+
+#ifndef CSVTABLE_HPP
+#define CSVTABLE_HPP
+
+#include <string>
+#include <vector>
+
+typedef std::vector<std::vector<std::string>> CsvTable;  //< row -> cells
+
+std::vector<std::string> splitCsvLine(std::string const& line,
+                                      char delimiter = ',');
+CsvTable readCsvTable(std::string const& path, char delimiter = ',');
+
+#endif  // !CSVTABLE_HPP
@@ -0,0 +1,202 @@
+/**
+ * @file Evolution.hpp
+ * @brief the evolution engine of func() in main.cpp: the initial population,
+ * one step of imitation, mutation and game (or one synchronous generation of
+ * them, or the steps up to the next change of the state without visiting the
+ * others, or a batch of them done concurrently), and the statistics of the
+ * log.
+ * They are in the library so that the tests and reputation_bench can use
+ * them.
+ *
+ */
+
+#ifndef EVOLUTION_HPP
+#define EVOLUTION_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Action.hpp"
+#include "BinaryLog.hpp"
+#include "Checkpoint.hpp"
+#include "CompiledPayoffMatrix.hpp"
+#include "Composition.hpp"
+#include "InteractionGraph.hpp"
+#include "PayoffCache.hpp"
+#include "Norm.hpp"
+#include "Player.hpp"
+#include "Population.hpp"
+#include "RandomStream.hpp"
+#include "Strategy.hpp"
+
+double fermi(double payoff_current, double payoff_new, double s);
+double getCoopRate(const Population& individuals, int coop_action_id);
+double getSampledCoopRate(const Population& individuals, int coop_action_id,
+                          int game_times, RandomStream& gen);
+double getAvgPayoff(const Strategy& donorStrategy,
+                    const Strategy& recipientStrategy,
+                    const CompiledPayoffMatrix& payoffMatrix,
+                    const Composition& donorComposition,
+                    const Composition& recipientComposition, int population);
+std::string printStatistics(const Population& individuals,
+                            const std::vector<Strategy>& donorStrategies,
+                            const std::vector<Strategy>& recipientStrategies,
+                            int population, int step, bool print,
+                            int coop_action_id, int coop_rate_samples,
+                            RandomStream& gen);
+void fillStatisticsRow(const Population& individuals,
+                       const std::vector<Strategy>& donorStrategies,
+                       const std::vector<Strategy>& recipientStrategies,
+                       int step, int coop_action_id, int coop_rate_samples,
+                       RandomStream& gen, std::vector<uint32_t>& row);
+std::string printFrequencyStatistics(
+    const std::vector<double>& pairFrequencies,
+    const std::vector<Strategy>& donorStrategies,
+    const std::vector<Strategy>& recipientStrategies, int step,
+    double goodReputationFrequency, double coopRate);
+void fillFrequencyStatisticsRow(
+    const std::vector<double>& pairFrequencies,
+    const std::vector<Strategy>& donorStrategies,
+    const std::vector<Strategy>& recipientStrategies, int step, int population,
+    double goodReputationFrequency, double coopRate,
+    std::vector<uint32_t>& row);
+std::vector<std::string> getLogColumnNames(
+    const std::vector<Strategy>& donorStrategies,
+    const std::vector<Strategy>& recipientStrategies);
+std::vector<BinaryLogColumnType> getLogColumnTypes(int columnNum);
+
+/**
+ * @brief one run of the evolution, the payoff matrix, strategies and norm are
+ * loaded from ./payoffMatrix, ./strategy and ./norm. The population is
+ * well-mixed, or structured by an InteractionGraph: the role model and the
+ * co-player are then neighbors and the payoff is the average over the
+ * neighbors
+ */
+class Evolution {
+ private:
+  int population;
+  double s;
+  double mu;
+  int normId;
+  bool isShortterm;  //< the donor's p follows the good reputation distribution
+  std::vector<Action> donorActions;
+  std::vector<Action> recipientActions;
+  std::vector<Strategy> donorStrategies;
+  std::vector<Strategy> recipientStrategies;
+  CompiledPayoffMatrix payoffMatrix;
+  int pVarId;
+  Norm norm;
+  Population individuals;
+  const InteractionGraph* graph;  //< nullptr if well-mixed, owned by the caller
+  int coopActionId;
+  int strategyPairNum;
+  RandomStream genInit;
+  RandomStream genSelection;
+  RandomStream genDecision;
+  RandomStream genCoopRate;
+  RandomStream genSync;
+
+  // the synchronous update of stepGeneration() and the batches of stepBatch()
+  uint64_t generation;                 //< the generations (or batches) so far
+  std::vector<double> classPayoffs;    //< pair * #reputations + reputation id -> the average payoff in the snapshot
+  std::vector<int> nextPairIds;        //< the second buffer of the strategy pairs
+  std::vector<int> nextReputationIds;  //< the second buffer of the reputations
+
+  // the evaluated payoff matrix and the average payoffs of the classes
+  PayoffCache payoffCache;
+  int payoffCacheGoodNum;                 //< the good reputation number of the payoffs of payoffCache, -1 if not set
+  std::vector<double> individualPayoffs;  //< i -> the local payoff in the snapshot of stepGeneration() of a structured population
+
+  // the rejection-free update of skipSteps() of a binary norm, a class is pair * 2 + reputation id
+  int classWordNum;                   //< the words of the member bits of one class
+  std::vector<uint64_t> classBits;    //< class * classWordNum + i / 64 -> bit i % 64 is set if individual i is in the class, empty until skipSteps()
+  std::vector<int> classBlockCounts;  //< class * #blocks + block -> the members in the CLASS_BLOCK_WORDS words of the block
+  std::vector<int> eventClassIds;     //< the classes with members at the last rate computation
+  std::vector<double> eventPayoffs;   //< k -> the average payoff of eventClassIds[k]
+  std::vector<double> eventRates;     //< k -> the probability that a step of a focal of eventClassIds[k] changes the state
+  std::vector<double> eventWeights;   //< the weights of a choice of an event
+
+  // the concurrent events of stepBatch()
+  std::vector<int> batchIndividuals;      //< event * 3 + {0, 1, 2} -> the focal, the role model and the co-player
+  std::vector<uint64_t> batchPositions;   //< event -> the position of genSync of the rest of the event, at a block
+  std::vector<int> batchPendingIds;       //< the events not done in the previous rounds, in order
+  std::vector<uint8_t> batchDone;         //< k -> whether batchPendingIds[k] is done in the round
+  std::vector<std::atomic<int>> batchOwners;  //< i -> the first pending event of individual i in the round, INT_MAX if none
+
+  void updatePayoffCache();
+  void setStrategies(int i, int donorStrategyId, int recipientStrategyId);
+  void setReputationId(int i, int reputationId);
+  void playGame(int donorI, int recipientJ);
+  double getLocalPayoff(int i) const;
+  void fillClassPayoffs();
+  template <class Kernel>
+  void stepWith();
+  int getClassId(int i) const {
+    return (this->individuals.getDonorStrategyId(i) *
+                this->recipientStrategies.size() +
+            this->individuals.getRecipientStrategyId(i)) * 2 +
+           this->individuals.getReputationId(i);
+  }
+  void fillClassBits();
+  void moveClass(int i, int fromClassId, int toClassId);
+  int getClassMember(int classId, int rank) const;
+
+ public:
+  static const int SYNC_BLOCK_NUM = 4;  //< the Philox blocks of one individual in one phase of a generation
+  static const int CLASS_BLOCK_WORDS = 64;  //< the words of a block of classBlockCounts
+  static const int RATE_PAIRS_PER_STEP = 2;  //< the class pairs of a rate computation of skipSteps() that cost as much as one step()
+  static const int BATCH_DIVISOR = 64;  //< the steps of a batch of stepBatch() are population / BATCH_DIVISOR
+
+  static CompiledPayoffMatrix loadPayoffMatrix(
+      std::string const& payoffMatrixConfigName, int normId, double b,
+      double beta, double c, double gamma, double p0);
+  static Norm loadNorm(int normId, std::vector<Action> const& donorActions,
+                       std::vector<Action> const& recipientActions);
+  static Player loadPlayer(std::string const& name,
+                           std::vector<Action> const& actions,
+                           std::vector<Strategy> const& strategies);
+  static void initIndividuals(Population& individuals,
+                              int recipientStrategyNum, int strategyPairNum,
+                              double p0, RandomStream& genInit);
+
+  Evolution(int population, double s, double b, double beta, double c,
+            double gamma, double mu, int normId, double p0,
+            std::string const& payoffMatrixConfigName, uint64_t seed,
+            int replica = 0, const InteractionGraph* graph = nullptr);
+  ~Evolution();
+
+  void step();
+  void steps(int stepNum);
+  void stepGeneration();
+  int skipSteps(int maxStepNum);
+  void stepBatch();
+
+  void saveCheckpoint(Checkpoint& checkpoint) const;
+  void loadCheckpoint(Checkpoint const& checkpoint);
+
+  bool isAbsorbed() const;
+  void getObservables(std::vector<double>& values) const;
+
+  int getPopulation() const { return this->population; }
+  int getNormId() const { return this->normId; }
+  int getCoopActionId() const { return this->coopActionId; }
+  int getStrategyPairNum() const { return this->strategyPairNum; }
+  uint64_t getGeneration() const { return this->generation; }
+  int getBatchStepNum() const { return std::max(1, this->population / BATCH_DIVISOR); }
+  const std::vector<Strategy>& getDonorStrategies() const { return this->donorStrategies; }
+  const std::vector<Strategy>& getRecipientStrategies() const { return this->recipientStrategies; }
+  const CompiledPayoffMatrix& getPayoffMatrix() const { return this->payoffMatrix; }
+  const Norm& getNorm() const { return this->norm; }
+  const InteractionGraph* getGraph() const { return this->graph; }
+  const Population& getIndividuals() const { return this->individuals; }
+  Population& getIndividuals() { return this->individuals; }
+  RandomStream& getCoopRateStream() { return this->genCoopRate; }
+
+  std::vector<std::string> getLogColumnNames() const;
+  std::vector<BinaryLogColumnType> getLogColumnTypes() const;
+};
+
+#endif  // !EVOLUTION_HPP
@@ -0,0 +1,129 @@
+/**
+ * @file GameKernel.hpp
+ * @brief the loops of the average payoff over an evaluated matrix, with the
+ * numbers of donor and recipient strategies known at compile time.
+ *
+ * The evaluated matrix is the dense ((d * #R + r) * PLAYER_NUM + player)
+ * array of CompiledPayoffMatrix::getPayoffData() and
+ * PayoffCache::getPayoffs(). GameKernel<DONOR_NUM, RECIPIENT_NUM> has the
+ * trip counts and the strides as constants, so the loops are fully unrolled;
+ * a size of DYNAMIC_STRATEGY_NUM takes the number given at run time instead.
+ * The sums run in the same order for every instantiation, so all of them
+ * return the same bits. getGameKernel() picks the instantiation of a game from
+ * getRowNum()/getColNum() of its matrix, falling back to the dynamic one, as
+ * a GameKernelVariant. It is picked once per run, and the loops of the run
+ * are instantiated for it by std::visit, so the calls of the kernel are
+ * inlined into them:
+ *
+ *   std::visit([&](auto kernel) { loop<decltype(kernel)>(); }, variant);
+ */
+
+#ifndef GAME_KERNEL_HPP
+#define GAME_KERNEL_HPP
+
+#include <variant>
+
+/** @brief the size of a GameKernel given at run time */
+const int DYNAMIC_STRATEGY_NUM = 0;
+
+template <int DONOR_NUM, int RECIPIENT_NUM, int PLAYER_NUM = 2>
+struct GameKernel {
+  static_assert(DONOR_NUM >= 0 && RECIPIENT_NUM >= 0 && PLAYER_NUM == 2,
+                "a game of a donor and a recipient");
+
+  static int getDonorNum(int donorNum) {
+    return DONOR_NUM != DYNAMIC_STRATEGY_NUM ? DONOR_NUM : donorNum;
+  }
+  static int getRecipientNum(int recipientNum) {
+    return RECIPIENT_NUM != DYNAMIC_STRATEGY_NUM ? RECIPIENT_NUM : recipientNum;
+  }
+
+  /**
+   * @brief half the payoff of a donor of donorId summed over the recipients
+   *
+   * @param payoffs the evaluated matrix of one reputation
+   * @param recipientCounts r -> the number of recipients
+   * @param donorId
+   * @param recipientNum the number of recipient strategies of a dynamic
+   * RECIPIENT_NUM
+   * @return double
+   */
+  static double getDonorTerm(const double* payoffs, const int* recipientCounts,
+                             int donorId, int recipientNum) {
+    const int recipient_num = getRecipientNum(recipientNum);
+    const double* row = payoffs + donorId * recipient_num * PLAYER_NUM;
+    double eval_donor = 0;
+    for (int j = 0; j < recipient_num; j++) {
+      eval_donor += row[j * PLAYER_NUM] * recipientCounts[j] * 0.5;
+    }
+    return eval_donor;
+  }
+
+  /**
+   * @brief half the payoff of a recipient of recipientId summed over the
+   * donors
+   *
+   * @param payoffs the evaluated matrix of one reputation
+   * @param donorCounts d -> the number of donors
+   * @param recipientId
+   * @param donorNum the number of donor strategies of a dynamic DONOR_NUM
+   * @param recipientNum the number of recipient strategies of a dynamic
+   * RECIPIENT_NUM
+   * @return double
+   */
+  static double getRecipientTerm(const double* payoffs, const int* donorCounts,
+                                 int recipientId, int donorNum,
+                                 int recipientNum) {
+    const int donor_num = getDonorNum(donorNum);
+    const int recipient_num = getRecipientNum(recipientNum);
+    const double* col = payoffs + recipientId * PLAYER_NUM + 1;
+    double eval_recipient = 0;
+    for (int j = 0; j < donor_num; j++) {
+      eval_recipient +=
+          col[j * recipient_num * PLAYER_NUM] * donorCounts[j] * 0.5;
+    }
+    return eval_recipient;
+  }
+
+  /**
+   * @brief the average payoff of an individual of (donorId, recipientId)
+   * against the rest of a well-mixed population, see getAvgPayoff
+   *
+   * @param payoffs the evaluated matrix of one reputation
+   * @param donorCounts
+   * @param recipientCounts
+   * @param donorId
+   * @param recipientId
+   * @param donorNum
+   * @param recipientNum
+   * @param population
+   * @return double
+   */
+  static double getAvgPayoff(const double* payoffs, const int* donorCounts,
+                             const int* recipientCounts, int donorId,
+                             int recipientId, int donorNum, int recipientNum,
+                             int population) {
+    const int recipient_num = getRecipientNum(recipientNum);
+    const double* same =
+        payoffs + (donorId * recipient_num + recipientId) * PLAYER_NUM;
+    double eval_same = (same[0] + same[1]) / 2;
+    return (1.0 / (population - 1)) *
+           (getDonorTerm(payoffs, recipientCounts, donorId, recipientNum) +
+            getRecipientTerm(payoffs, donorCounts, recipientId, donorNum,
+                             recipientNum) -
+            eval_same);
+  }
+};
+
+/** @brief the GameKernel instantiations of getGameKernel() */
+typedef std::variant<
+    GameKernel<1, 1>, GameKernel<1, 2>, GameKernel<1, 3>, GameKernel<1, 4>,
+    GameKernel<2, 1>, GameKernel<2, 2>, GameKernel<2, 3>, GameKernel<2, 4>,
+    GameKernel<3, 1>, GameKernel<3, 2>, GameKernel<3, 3>, GameKernel<3, 4>,
+    GameKernel<4, 1>, GameKernel<4, 2>, GameKernel<4, 3>, GameKernel<4, 4>,
+    GameKernel<DYNAMIC_STRATEGY_NUM, DYNAMIC_STRATEGY_NUM>>
+    GameKernelVariant;
+
+GameKernelVariant getGameKernel(int donorStrategyNum, int recipientStrategyNum);
+
+#endif  // !GAME_KERNEL_HPP
@@ -0,0 +1,91 @@
+/**
+ * @file GameSpec.hpp
+ * @brief the game files of a working directory, parsed once and validated,
+ * shared read-only by all the runs of the process (the TBB workers and the
+ * sweep jobs):
+ * - payoffMatrix/<config>/PayoffMatrix<normId>.csv of every config directory,
+ * - norm/norm<normId>.csv,
+ * - strategy/<role>/<strategy>.csv of the donor and recipient roles.
+ *
+ * The cells of the files are kept by their path relative to the root. The
+ * payoff matrices are parsed once, the runs copy them to assign their vars,
+ * and the norms and the strategy tables of the players are built from the
+ * cells without reading a file. Every payoff matrix is compiled with its
+ * players (row strategies for the donor, column strategies for the
+ * recipient) and every norm with the actions C and D when loaded, so a
+ * broken file stops the process before the first run.
+ *
+ * The optional binary cache (--gameCache) stores the cells with the size and
+ * modification time of every file. It is used if the files are unchanged,
+ * and rewritten otherwise. Layout (little endian): magic "REPGAME1", uint32
+ * version, uint32 file number, then per file the string path, uint64 size,
+ * int64 modification time, uint32 row number and per row uint32 cell number
+ * and the cell strings, and the end magic "REPGMEND". A string is a uint32
+ * length and its bytes.
+ *
+ */
+
+#ifndef GAMESPEC_HPP
+#define GAMESPEC_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Action.hpp"
+#include "CsvTable.hpp"
+#include "Norm.hpp"
+#include "PayoffMatrix.hpp"
+#include "Player.hpp"
+#include "Strategy.hpp"
+
+struct GameFile {
+  std::string path;  //< relative to the root, "/" separated
+  uint64_t size = 0;
+  int64_t modifiedTime = 0;  //< std::filesystem::last_write_time() ticks
+  CsvTable table;
+};
+
+class GameSpec {
+ private:
+  std::string root;
+  std::map<std::string, GameFile> files;             //< relative path -> file
+  std::map<std::string, PayoffMatrix> payoffMatrices;  //< relative path -> the parsed payoff matrix, vars unassigned
+
+  static std::vector<GameFile> listFiles(std::string const& root);
+  static bool readCache(std::string const& cachePath,
+                        std::vector<GameFile>& files);
+  static void writeCache(std::string const& cachePath,
+                         std::map<std::string, GameFile> const& files);
+
+  const CsvTable& getTable(std::string const& path) const;
+  void validate();
+
+ public:
+  GameSpec(std::string const& root, std::string const& cachePath = "");
+  ~GameSpec();
+
+  static std::string getPayoffMatrixPath(std::string const& configName,
+                                         int normId);
+  static std::string getNormPath(int normId);
+
+  PayoffMatrix getPayoffMatrix(std::string const& configName,
+                               int normId) const;
+  Norm getNorm(int normId, std::vector<Action> const& donorActions,
+               std::vector<Action> const& recipientActions) const;
+  Player getPlayer(std::string const& role, std::vector<Action> const& actions,
+                   std::vector<Strategy> const& strategies) const;
+
+  const std::string& getRoot() const { return this->root; }
+  int getFileNum() const { return this->files.size(); }
+  bool hasFile(std::string const& path) const {
+    return this->files.count(path) > 0;
+  }
+
+  static std::shared_ptr<const GameSpec> getDefault();
+  static void setDefault(std::shared_ptr<const GameSpec> spec);
+};
+
+#endif  // !GAMESPEC_HPP
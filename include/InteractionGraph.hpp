@@ -0,0 +1,79 @@
+/**
+ * @file InteractionGraph.hpp
+ * @brief the undirected interaction graph of a structured population, the
+ * role model and the co-player of an individual are its neighbors and its
+ * payoff is the average over its neighbors (see Evolution)
+ *
+ * The graph is stored as compressed sparse rows: the neighbors of node i are
+ * neighbors[offsets[i], offsets[i + 1]), sorted, without self-loops and
+ * multi-edges. A node costs 8 bytes and an edge 8 bytes (4 per direction), so
+ * 10^7 nodes of degree 4 take about 240 MB, and sampling a neighbor is one
+ * random number and two reads.
+ *
+ * spec of --graph:
+ *
+ *   lattice            the periodic square lattice (von Neumann, degree 4),
+ *                      the node number must be a square
+ *   regular:k          random k-regular graph (configuration model, the few
+ *                      self-loops and multi-edges of the pairing are dropped)
+ *   smallworld:k:beta  Watts-Strogatz, the ring of degree k (even) whose edges
+ *                      are rewired with probability beta
+ *   scalefree:m        Barabasi-Albert, every new node attaches to m nodes
+ *                      with probability proportional to their degree
+ *   file:path          an edge list "u v" per line (# comments), the nodes
+ *                      are 0 to the node number - 1
+ *
+ */
+
+#ifndef INTERACTION_GRAPH_HPP
+#define INTERACTION_GRAPH_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "RandomStream.hpp"
+
+class InteractionGraph {
+ private:
+  std::string spec;
+  int nodeNum;
+  std::vector<int64_t> offsets;  //< nodeNum + 1 offsets into neighbors
+  std::vector<int32_t> neighbors;
+
+ public:
+  typedef std::pair<int32_t, int32_t> Edge;
+
+  InteractionGraph(std::string const& spec, int nodeNum,
+                   std::vector<Edge> edges);
+  ~InteractionGraph();
+
+  static InteractionGraph create(std::string const& spec, int nodeNum,
+                                 RandomStream& gen);
+  static InteractionGraph lattice(int nodeNum);
+  static InteractionGraph randomRegular(int nodeNum, int degree,
+                                        RandomStream& gen);
+  static InteractionGraph smallWorld(int nodeNum, int degree, double beta,
+                                     RandomStream& gen);
+  static InteractionGraph scaleFree(int nodeNum, int m, RandomStream& gen);
+  static InteractionGraph fromEdgeList(std::string const& path, int nodeNum);
+
+  std::string const& getSpec() const { return this->spec; }
+  int getNodeNum() const { return this->nodeNum; }
+  int64_t getEdgeNum() const { return this->neighbors.size() / 2; }
+  int getDegree(int i) const {
+    return static_cast<int>(this->offsets[i + 1] - this->offsets[i]);
+  }
+  int getMinDegree() const;
+  /** @brief the k-th neighbor of node i, k in [0, getDegree(i)) */
+  int getNeighbor(int i, int k) const {
+    return this->neighbors[this->offsets[i] + k];
+  }
+  /** @brief a uniform random neighbor of node i, its degree must be > 0 */
+  int sampleNeighbor(int i, RandomStream& gen) const {
+    return this->neighbors[this->offsets[i] + gen.nextInt(this->getDegree(i))];
+  }
+};
+
+#endif  // !INTERACTION_GRAPH_HPP
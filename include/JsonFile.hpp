@@ -6,7 +6,10 @@
 
 void pretty_print(std::ostream& os, boost::json::value const& jv,
                   std::string* indent = nullptr);
-std::string logJson(std::string const& json_dir_path, boost::json::value const& jv);
+std::string logJson(std::string const& json_dir_path, boost::json::value const& jv,
+                    std::string const& log_file_ext = ".csv");
+void updateLogJson(std::string const& log_file_path, boost::json::value const& jv,
+                   std::string const& log_file_ext = ".csv");
 std::string genTimeStr();
 
 #endif // !JSONFILE_HPP
\ No newline at end of file
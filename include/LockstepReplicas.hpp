@@ -0,0 +1,175 @@
+/**
+ * @file LockstepReplicas.hpp
+ * @brief LANE_NUM replicas of the same run of Evolution (the same params,
+ * replicas firstReplica, firstReplica + 1, ...) advanced together, one step
+ * of every replica at a time, for the error bars of a point of a sweep.
+ *
+ * The replicas are the lanes of the loops of a step: the state of individual
+ * i of lane l is at i * LANE_NUM + l and every count is at class * LANE_NUM +
+ * l, so each stage of the step (the Philox blocks, the draws of the
+ * individuals, the gathers of their classes, the payoffs and the updates of
+ * the counts) is one loop over the lanes without dependencies between them.
+ * The donor's action, the recipient's action and the norm are one table of
+ * (donor pair, recipient class) -> the class of the recipient after the game.
+ * The lanes start as copies of one Population built from the players of the
+ * config, each filled by Evolution::initIndividuals().
+ *
+ * Under shortterm the evaluated matrix of a good number is kept in slot
+ * good % min(population + 1, PAYOFF_TABLE_NUM), so the memory is bounded;
+ * a lane whose slot was just refilled by another lane of the same step
+ * evaluates into a scratch slot of its own. The imitation u < fermi() is
+ * decided for all the lanes by a polynomial exp, and the lanes too close to
+ * the bound to trust it take the exact fermi(), so the decisions are those
+ * of fermi().
+ *
+ * Each stage has a loop over the lanes and, on x86-64 with GCC or Clang
+ * (LOCKSTEP_REPLICAS_AVX2), an AVX2 version with intrinsics: the 10 Philox
+ * rounds of the 8 lanes on _mm256_mul_epu32, the multiply-shifts of the
+ * draws, the gathers of the classes and of the payoff tables
+ * (_mm256_i32gather_epi32 / _pd) and the exp of the imitation of 4 lanes at
+ * a time. They are compiled for AVX2 whatever the flags of the build and
+ * taken if the CPU has AVX2 (hasSimd(), a runtime check); setSimd(false)
+ * takes the loops, which give the same steps. The table offsets, the
+ * rejections and the scatters of the updates and of the game (one element
+ * per lane, AVX2 has no scatter) stay scalar in both.
+ *
+ * Per replica step at population 1000 on one core (-O3, Evolution::step()
+ * 183 ns): the AVX2 stages take 66 ns (2.8x) under shortterm and 64 ns (3.0x)
+ * under longterm, the loops 108 ns and 106 ns. With ENABLE_NATIVE_ARCH the
+ * compiler vectorizes part of the loops (71 ns and 81 ns) and the AVX2
+ * stages take 61 ns and 64 ns. The gain stays far from LANE_NUM-fold as the
+ * scattered updates and the branches of the payoff tables are per lane.
+ * Only binary norms are supported, a class holds one bit of reputation.
+ *
+ * A lane is the process of Evolution::step() with its own random numbers: a
+ * step of lane l takes the Philox blocks 2 * step and 2 * step + 1 of the
+ * stream (seed, normId, firstReplica + l, LOCKSTEP), one 32-bit number for
+ * each of the focal, the role model and the co-player, 64 bits for the
+ * mutation and for the imitation (or the mutant pair) and one bit for the
+ * roles. The rare rejections of the integers are drawn again from the
+ * SELECTION stream of the lane. The initial populations are those of
+ * Evolution for the replicas firstReplica + l, so the lanes have the law of
+ * the scalar replicas, not their numbers. --updateMode lockstep runs the
+ * replicas of a sweep point in blocks of LANE_NUM.
+ */
+
+#ifndef LOCKSTEP_REPLICAS_HPP
+#define LOCKSTEP_REPLICAS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CompiledPayoffMatrix.hpp"
+#include "Norm.hpp"
+#include "Population.hpp"
+#include "RandomStream.hpp"
+#include "Strategy.hpp"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+// the stages of LockstepReplicas::step() have AVX2 versions, taken if the CPU
+// has AVX2
+#define LOCKSTEP_REPLICAS_AVX2
+#endif
+
+class LockstepReplicas {
+ public:
+  static const int LANE_NUM = 8;  //< the replicas of a step, 8 ints or twice 4 doubles of AVX2
+  static const int PAYOFF_TABLE_NUM = 1024;  //< the evaluated matrices kept at most, one per good number
+
+ private:
+  int population;
+  double s;
+  double mu;
+  int normId;
+  int firstReplica;
+  bool isShortterm;  //< the donor's p follows the good reputation distribution
+  std::vector<Strategy> donorStrategies;
+  std::vector<Strategy> recipientStrategies;
+  CompiledPayoffMatrix payoffMatrix;
+  int pVarId;
+  Norm norm;
+  int strategyPairNum;
+  int classNum;  //< pair * 2 + reputation id
+  int tableSize;  //< the doubles of one evaluated matrix of both reputations
+  Philox4x32::Key key;
+  uint32_t streamIds[2][LANE_NUM];  //< the low and high words of the LOCKSTEP stream of each lane
+  uint64_t stepNum;                 //< the steps of every lane so far
+  bool simd;                        //< the AVX2 stages instead of the loops
+
+  std::vector<uint8_t> classIds;         //< i * LANE_NUM + lane -> the class of individual i, then 3 bytes of padding
+  std::vector<int> classCounts;          //< class * LANE_NUM + lane -> the individuals of the class
+  std::vector<int> donorCounts;          //< donor strategy * LANE_NUM + lane
+  std::vector<int> recipientCounts;      //< recipient strategy * LANE_NUM + lane
+  std::vector<int> goodNums;             //< lane -> the good individuals
+  std::vector<int> pairDonorIds;         //< pair -> the donor strategy id, without a division in the step
+  std::vector<int> pairRecipientIds;     //< pair -> the recipient strategy id
+  std::vector<uint8_t> gameTable;        //< donor pair * #classes + recipient class -> the class of the recipient after the game
+  std::vector<double> payoffTables;      //< slot * tableSize + ((rep * #D + d) * #R + r) * 2 + player -> the evaluated matrices, then a slot per lane
+  std::vector<int> payoffTableGoodNums;  //< slot -> the good number of its matrix (0 in longterm), -1 if not evaluated
+  std::vector<RandomStream> genRejections;  //< lane -> the draws again of the rejected integers
+  std::vector<Population> lanes;         //< lane -> the population of the last syncLane(), copies of one template
+
+  /** @brief the draws and the classes of one step of every lane, passed from stage to stage */
+  struct LaneStep {
+    uint32_t words[2][4][LANE_NUM];  //< the two Philox blocks of the step
+    int focal[LANE_NUM];
+    int rolemodel[LANE_NUM];
+    int coplayer[LANE_NUM];
+    int focalClass[LANE_NUM];
+    int rolemodelClass[LANE_NUM];
+    int tableOffsets[LANE_NUM];      //< the evaluated matrix of the lane in payoffTables
+    double payoffs[2][LANE_NUM];     //< the average payoffs of the focal and of the role model
+    int nextClass[LANE_NUM];         //< the class of the focal after the update
+  };
+
+  void evalPayoffTable(int goodNum, double* table);
+  int getPayoffTableOffset(int goodNum, int lane, const int* laneOffsets);
+
+  // the stages of step(), loops over the lanes
+  void drawIndividuals(LaneStep& lanes);
+  void redrawRejected(const LaneStep& lanes, int (&drawn)[3][LANE_NUM]);
+  void setTableOffsets(LaneStep& lanes);
+  void evalPayoffs(LaneStep& lanes);
+  void chooseNextClasses(LaneStep& lanes);
+  bool imitatesExactly(const LaneStep& lanes, int lane) const;
+  void redrawRejectedMutants(LaneStep& lanes);
+  void updateLanes(const LaneStep& lanes);
+#ifdef LOCKSTEP_REPLICAS_AVX2
+  // the same stages with AVX2 intrinsics
+  void drawIndividualsAvx2(LaneStep& lanes);
+  void evalPayoffsAvx2(LaneStep& lanes);
+  void chooseNextClassesAvx2(LaneStep& lanes);
+#endif
+
+ public:
+  LockstepReplicas(int population, double s, double b, double beta, double c,
+                   double gamma, double mu, int normId, double p0,
+                   std::string const& payoffMatrixConfigName, uint64_t seed,
+                   int firstReplica = 0);
+  ~LockstepReplicas();
+
+  void step();
+  static bool hasSimd();
+  void setSimd(bool simd);
+  bool isSimd() const { return this->simd; }
+
+  int getPopulation() const { return this->population; }
+  uint64_t getStepNum() const { return this->stepNum; }
+  int getGoodReputationNum(int lane) const { return this->goodNums[lane]; }
+  /** @brief the individuals of lane with the strategy pair and reputation */
+  int getClassCount(int lane, int pairId, int reputationId) const {
+    return this->classCounts[(pairId * 2 + reputationId) * LANE_NUM + lane];
+  }
+  int getStrategyPairId(int lane, int i) const {
+    return this->classIds[i * LANE_NUM + lane] >> 1;
+  }
+  int getReputationId(int lane, int i) const {
+    return this->classIds[i * LANE_NUM + lane] & 1;
+  }
+  const Population& syncLane(int lane);
+  const std::vector<Strategy>& getDonorStrategies() const { return this->donorStrategies; }
+  const std::vector<Strategy>& getRecipientStrategies() const { return this->recipientStrategies; }
+};
+
+#endif  // !LOCKSTEP_REPLICAS_HPP
@@ -0,0 +1,82 @@
+/**
+ * @file LogReducer.hpp
+ * @brief the streaming reducers of the rows of the log, so that a run can
+ * write a small summary next to (or instead of) its trajectory. Every column
+ * after the step is reduced to
+ * - the mean and variance (Welford) of the rows of the tail window, the rows
+ * with step >= tailFrom,
+ * - the rows at log-spaced steps, logPointsPerDecade per decade of steps
+ * (the first row at or after each of 10^(j / logPointsPerDecade)), and the
+ * row of step 0,
+ * - optionally the min and max in buckets of bucketWidth steps, for plots.
+ *
+ * The values are those of the log: count / population of a COUNT column,
+ * the float of a FLOAT32 column, or the numbers of a csv line. The summary is
+ * a column-oriented json, log/<name>.summary.json, e.g.
+ * pandas.DataFrame(json["logSampled"]).
+ *
+ */
+
+#ifndef LOG_REDUCER_HPP
+#define LOG_REDUCER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/json.hpp>
+
+#include "BinaryLog.hpp"
+
+class LogReducer {
+ private:
+  std::vector<std::string> columnNames;  //< the first column is the step
+  std::vector<BinaryLogColumnType> columnTypes;
+  double population;
+  int valueNum;  //< the columns after the step
+  uint64_t tailFrom;
+  int logPointsPerDecade;  //< 0 if no rows are sampled
+  uint64_t bucketWidth;    //< 0 if no buckets
+  std::vector<double> values;  //< the decoded row, step first
+
+  uint64_t rowNum;
+  uint64_t lastStep;
+  // the tail window
+  uint64_t tailRowNum;
+  std::vector<double> tailMeans;
+  std::vector<double> tailM2s;  //< the sums of the squared differences from the mean
+  // the log-spaced rows
+  int sampleIndex;  //< j of the next sample step 10^(j / logPointsPerDecade), -1 for step 0
+  uint64_t nextSampleStep;
+  std::vector<double> sampledRows;  //< step and values of every sampled row
+  // the buckets
+  std::vector<uint64_t> bucketFirstSteps;
+  std::vector<double> bucketMins;  //< bucket * valueNum + column
+  std::vector<double> bucketMaxs;
+
+  void advanceSampleStep();
+
+ public:
+  LogReducer(std::vector<std::string> const& columnNames,
+             std::vector<BinaryLogColumnType> const& columnTypes,
+             double population, uint64_t tailFrom, int logPointsPerDecade,
+             uint64_t bucketWidth);
+  ~LogReducer();
+
+  void add(const double* row);
+  void addRow(const uint32_t* row);
+  void addCsvLine(std::string const& line);
+
+  uint64_t getRowNum() const { return this->rowNum; }
+  uint64_t getTailRowNum() const { return this->tailRowNum; }
+  double getTailMean(int column) const { return this->tailMeans[column]; }
+  double getTailVariance(int column) const;
+
+  boost::json::value toJson() const;
+  void write(std::string const& path) const;
+
+  void saveState(std::string& state) const;
+  void loadState(std::string const& state);
+};
+
+#endif  // !LOG_REDUCER_HPP
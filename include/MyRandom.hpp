@@ -16,6 +16,8 @@
 #include <random>
 #include <chrono>
 
+#include "RandomStream.hpp"
+
 /**
  * @brief this class is used to define the most used random number generator.
  * Including the global seed and the random number generator.
@@ -27,12 +29,11 @@
 class MyRandom
 {
 private:
-    std::mt19937 gen;  //< double Random number generator
-    std::uniform_real_distribution<double> prob_dis{0, 1}; //< probability distribution
     const unsigned seed; //< global seed
+    RandomStream gen;  //< the OTHER stream of the seed
     MyRandom(
         unsigned seed = std::chrono::system_clock::now().time_since_epoch().count()
-    ) : seed(seed), gen(seed) {} // generate random numbers with time-based seed
+    ) : seed(seed), gen(RandomStream::derive(seed, 0, 0, RandomPurpose::OTHER)) {} // generate random numbers with time-based seed
     MyRandom(MyRandom const&) = delete; // prohibit copy constructor
     MyRandom& operator=(MyRandom const&) = delete; // prohibit copy assignment
 public:
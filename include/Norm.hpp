@@ -1,27 +1,50 @@
 #ifndef NORM_HPP
 #define NORM_HPP
 
-#include <unordered_map>
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <random>
 
 #include "Action.hpp"
+#include "CsvTable.hpp"
+#include "RandomStream.hpp"
 
 class Norm
 {
 private:
-    std::unordered_map<std::string, double> normFunc; //< update reputation using discrete function
     std::vector<std::vector<std::string>> normTableStr; //< Update the reputation using discrete function
-    std::mt19937 gen;  //< double Random number generator
+    std::vector<Action> donorActions; //< action id of the donor action names in the norm table
+    std::vector<Action> recipientActions; //< action id of the recipient action names in the norm table
+    std::vector<double> reputationValues{0.0, 1.0}; //< reputation id -> reputation value, 0, 1 and the levels of the table in increasing order
+    int inputRowNum = 0; //< the order of the norm: the donor action, the recipient action, the recipient's reputation
+    std::vector<uint8_t> normTable; //< [(donor action id * recipientActions.size() + recipient action id) * #reputations + recipient reputation id] -> reputation id, generated from normTableStr
+    RandomStream gen;  //< random number generator, see setRandomStream()
+
+    void generateNormTable();
 public:
     Norm(/* args */);
     Norm(std::string csvPath);
+    Norm(std::string csvPath, std::vector<Action> const& donorActions, std::vector<Action> const& recipientActions);
+    Norm(CsvTable const& table, std::vector<Action> const& donorActions, std::vector<Action> const& recipientActions);
     ~Norm();
     void loadNormFunc(std::string csvPath);
+    void loadNormTable(CsvTable const& table);
     std::vector<std::vector<std::string>> getNormTableStr() const { return this->normTableStr; }
-    double getReputation(Action const& donorAction, Action const& recipientAction, double const reputation_error_p=0.0);
+    double getReputation(Action const& donorAction, Action const& recipientAction, int recipientReputationId, double const reputation_error_p=0.0);
+    /** allocation-free look-up of the new reputation id of a recipient of recipientReputationId, only available if the actions are given to the constructor */
+    int getReputationId(int donorActionId, int recipientActionId, int recipientReputationId) const {
+        return this->normTable[(donorActionId * this->recipientActions.size() + recipientActionId) *
+                                   this->reputationValues.size() + recipientReputationId];
+    }
+    int getReputationId(double reputation) const;
+    double getReputationValue(int reputationId) const { return this->reputationValues[reputationId]; }
+    int getReputationNum() const { return this->reputationValues.size(); }
+    int getOrder() const { return this->inputRowNum; }
+    const std::vector<uint8_t>& getNormTable() const { return this->normTable; }
     double getProbability();
+    void setRandomStream(RandomStream const& gen) { this->gen = gen; }
 
 };
 
-#endif // !NORM_HPP
\ No newline at end of file
+#endif // !NORM_HPP
@@ -0,0 +1,106 @@
+#ifndef PAYOFF_CACHE_HPP
+#define PAYOFF_CACHE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "CompiledPayoffMatrix.hpp"
+#include "Composition.hpp"
+#include "GameKernel.hpp"
+
+/**
+ * @brief the average payoffs of all (reputation, donor strategy, recipient
+ * strategy) classes of a well-mixed population, the same values as
+ * getAvgPayoff.
+ *
+ * The average payoff is a dense matrix-vector product of the evaluated matrix
+ * and the strategy counts: the donor term of (rep, d) is the row d of the
+ * donor payoffs times the recipient counts, and the recipient term of (rep,
+ * r) is the column r of the recipient payoffs times the donor counts. When one
+ * individual switches, only its counts change (O(1)) and the terms depending
+ * on them are marked stale (O(#strategies)). A stale term is recomputed on
+ * the next read by the GameKernel of the game, in the order of getAvgPayoff, so the cached values are exact
+ * and a resumed run does not depend on the history of the cache. The reads
+ * take the GameKernel as a template argument, the caller visits getKernel()
+ * once for its whole loop. The payoffs
+ * of a reputation are replaced only when the variables of the matrix change.
+ */
+class PayoffCache {
+ private:
+  int donorStrategyNum;
+  int recipientStrategyNum;
+  int reputationNum;
+  int population;
+  GameKernelVariant kernel;             //< the loops unrolled for the numbers of strategies
+  std::vector<double> payoffs;          //< ((rep * #D + d) * #R + r) * 2 + player -> the evaluated matrix
+  std::vector<int> donorCounts;         //< d -> the number of donors
+  std::vector<int> recipientCounts;     //< r -> the number of recipients
+  std::vector<double> donorTerms;       //< rep * #D + d -> the half payoff summed over the recipients
+  std::vector<double> recipientTerms;   //< rep * #R + r -> the half payoff summed over the donors
+  std::vector<uint8_t> donorStale;      //< rep * #D + d -> whether donorTerms is to be recomputed
+  std::vector<uint8_t> recipientStale;  //< rep * #R + r -> whether recipientTerms is to be recomputed
+
+  double getPayoff(int rep, int d, int r, int player) const {
+    return this->payoffs[((rep * this->donorStrategyNum + d) *
+                              this->recipientStrategyNum + r) * 2 + player];
+  }
+
+ public:
+  PayoffCache();
+  PayoffCache(int donorStrategyNum, int recipientStrategyNum,
+              int reputationNum, int population);
+  ~PayoffCache();
+
+  void setPayoffs(int rep, const CompiledPayoffMatrix& payoffMatrix);
+  void setCounts(const Composition& donorComposition,
+                 const Composition& recipientComposition);
+  void moveDonor(int fromId, int toId);
+  void moveRecipient(int fromId, int toId);
+
+  template <class Kernel>
+  double getAvgPayoff(int rep, int donorId, int recipientId);
+  /** @brief the GameKernel of the numbers of strategies, for getAvgPayoff */
+  const GameKernelVariant& getKernel() const { return this->kernel; }
+  /** @brief the evaluated matrix of a reputation, (d * #R + r) * 2 + player */
+  const double* getPayoffs(int rep) const {
+    return this->payoffs.data() +
+           rep * this->donorStrategyNum * this->recipientStrategyNum * 2;
+  }
+};
+
+/**
+ * @brief the average payoff of the individuals of a class, bit-identical to
+ * getAvgPayoff with the matrix evaluated for the reputation. It costs O(1),
+ * O(#strategies) per stale term
+ *
+ * @tparam Kernel the alternative of getKernel()
+ * @param rep
+ * @param donorId
+ * @param recipientId
+ * @return double
+ */
+template <class Kernel>
+inline double PayoffCache::getAvgPayoff(int rep, int donorId, int recipientId) {
+  const int donor_term = rep * this->donorStrategyNum + donorId;
+  if (this->donorStale[donor_term]) {
+    this->donorTerms[donor_term] = Kernel::getDonorTerm(
+        this->getPayoffs(rep), this->recipientCounts.data(), donorId,
+        this->recipientStrategyNum);
+    this->donorStale[donor_term] = 0;
+  }
+  const int recipient_term = rep * this->recipientStrategyNum + recipientId;
+  if (this->recipientStale[recipient_term]) {
+    this->recipientTerms[recipient_term] = Kernel::getRecipientTerm(
+        this->getPayoffs(rep), this->donorCounts.data(), recipientId,
+        this->donorStrategyNum, this->recipientStrategyNum);
+    this->recipientStale[recipient_term] = 0;
+  }
+  double eval_same = (this->getPayoff(rep, donorId, recipientId, 0) +
+                      this->getPayoff(rep, donorId, recipientId, 1)) /
+                     2;
+  return (1.0 / (this->population - 1)) *
+         (this->donorTerms[donor_term] + this->recipientTerms[recipient_term] -
+          eval_same);
+}
+
+#endif  // !PAYOFF_CACHE_HPP
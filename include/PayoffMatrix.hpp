@@ -5,8 +5,11 @@
 #include <set>
 #include <string>
 #include <map>
+#include "CsvTable.hpp"
 #include "Strategy.hpp"
 
+class CompiledPayoffMatrix;
+
 class PayoffMatrix {
  private:
   std::vector<std::vector<std::vector<std::string>>> payoffMatrixStr;//< payoff matrix, the 3 d game is two three-dimensional (as a two-dimensional matrix of each element was all players involved in earnings list), three people
@@ -21,6 +24,7 @@ class PayoffMatrix {
  public:
   PayoffMatrix();
   PayoffMatrix(std::string csvPath);
+  PayoffMatrix(CsvTable const& table);
   ~PayoffMatrix();
 
   std::vector<double> getPayoff(const Strategy& strategyA,const Strategy& strategyB) const;
@@ -38,6 +42,7 @@ class PayoffMatrix {
 
   std::vector<std::vector<std::vector<double>>> evalPayoffMatrix();
   std::vector<std::vector<std::vector<double>>> evalPayoffMatrix( std::map<std::string, double> const & vars_for_donor, std::map<std::string, double> const & vars_for_receiver);
+  CompiledPayoffMatrix compile() const;
 
   int getRowNum() const { return this->rowNum; }
 
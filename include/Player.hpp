@@ -5,13 +5,16 @@
 #include <string>
 #include <unordered_map>
 // 有序集合类型
+#include <cstdint>
 #include <iostream>
 #include <random>
 #include <set>
 #include <vector>
 
 #include "Action.hpp"
+#include "CsvTable.hpp"
 #include "PayoffMatrix.hpp"
+#include "RandomStream.hpp"
 
 class Player {
   /**Using the characteristics of static variable to maintain the public
@@ -25,13 +28,15 @@ class Player {
   std::vector<Action> actions;
   std::vector<double> actionPossibility; //< random action probability (mixed strategy)
 
-  std::mt19937 gen; //< double random number generator
+  RandomStream gen; //< random number generator, see setRandomStream()
 
   std::map<std::string, std::vector<std::vector<std::string>>>
       strategyTables; //< action function table of each strategy
   std::unordered_map<std::string, Action>
       strategyFunc;  //<
                      // Action function of each policy. key consists of the key of the strategyTables and all inputs. value is the action name
+  std::vector<std::string> inputNames; //< input id -> input value, the input row of the strategy tables
+  std::vector<uint8_t> actionTable; //< [strategy id * inputNames.size() + input id] -> action id, generated with strategyFunc
   Strategy strategy; //< current strategy
 
   std::vector<Strategy> strategies;
@@ -40,6 +45,8 @@ class Player {
 
   std::map<std::string, double> vars;
 
+  void generateActionTable();
+
  public:
   Player(const Player &other);
   Player(std::string name, int score, std::vector<Action> actions);
@@ -51,6 +58,22 @@ class Player {
 
   Action reward(std::string const &donorActionName, double action_error_p = 0);
 
+  /** allocation-free look-up of the action id by strategy id and input id,
+   * the input id comes from getInputId() */
+  int donate(int strategyId, int recipientReputationInputId) const {
+    return this->actionTable[strategyId * this->inputNames.size() +
+                             recipientReputationInputId];
+  }
+  int reward(int strategyId, int donorActionInputId) const {
+    return this->actionTable[strategyId * this->inputNames.size() +
+                             donorActionInputId];
+  }
+  int getInputId(const std::string &input) const;
+  std::vector<std::string> getInputNames() const { return this->inputNames; }
+  const std::vector<uint8_t> &getActionTable() const {
+    return this->actionTable;
+  }
+
   /** according to the query to the income of the delta value, update the
    * score*/
   void updateScore(double delta) {
@@ -72,6 +95,7 @@ class Player {
     return this->actionPossibility;
   }
   Strategy getStrategy() const { return this->strategy; }
+  int getStrategyId() const { return this->strategy.getId(); }
   void setStrategy(const Strategy &strategy) { this->strategy = strategy; }
   void setStrategy(const std::string &strategyName);
 
@@ -141,6 +165,7 @@ class Player {
   }
 
   void loadStrategy(const std::string &strategyPath);
+  void loadStrategyTables(const std::map<std::string, CsvTable> &tables);
   std::map<std::string, std::vector<std::vector<std::string>>>
   getStrategyTables() const {
     return this->strategyTables;
@@ -158,6 +183,7 @@ class Player {
   // to throw out a probability of 0 and 1
   double getProbability();
   int getRandomInt(int start, int end);
+  void setRandomStream(RandomStream const& gen) { this->gen = gen; }
 
   double getDeltaScore() const { return this->deltaScore; }
 };
@@ -0,0 +1,145 @@
+#ifndef POPULATION_HPP
+#define POPULATION_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "Composition.hpp"
+#include "Norm.hpp"
+#include "Player.hpp"
+#include "Statistics.hpp"
+
+/**
+ * @brief the whole population stored as struct of arrays.
+ *
+ * Each individual is one donor strategy id, one recipient strategy id and the
+ * bits of its reputation id (a few bytes in total), instead of two Player
+ * objects. The action tables of the strategies and the norm table are copied
+ * once from the template players and the norm, and shared by all individuals.
+ *
+ * The reputation ids are those of the norm, one of its getReputationNum()
+ * levels in increasing order of value, packed in getReputationBitNum() bits
+ * (1 for a binary norm, 2, 4 or 8 for more levels) so that none straddles a
+ * word.
+ * The words of the bits are atomic, so that the threads of the batch update
+ * write distinct individuals of the same word (storeReputationId); a copy of
+ * the population copies their values.
+ * The donor strategies only tell good from bad: a level of at least 0.5 is
+ * the input "1" of the donor table, a lower one the input "0". The good
+ * reputations are those of the top level (1 for a binary norm).
+ */
+class Population {
+ private:
+  int size;
+  std::vector<uint8_t> donorStrategyIds;      //< individual id -> donor strategy id
+  std::vector<uint8_t> recipientStrategyIds;  //< individual id -> recipient strategy id
+  int reputationNum;                          //< the levels of the norm
+  int reputationBitShift;                     //< log2 of the bits of a reputation id
+  uint64_t reputationMask;                    //< the lowest 1 << reputationBitShift bits
+  std::vector<std::atomic<uint64_t>> reputationBits;  //< the bits from i << reputationBitShift are the reputation id of individual i
+
+  // shared tables
+  std::vector<uint8_t> donorActionTable;      //< Player::getActionTable() of the donor template
+  int donorInputNum;
+  std::vector<uint8_t> recipientActionTable;  //< Player::getActionTable() of the recipient template
+  int recipientInputNum;
+  std::vector<uint8_t> normTable;             //< Norm::getNormTable()
+  int recipientActionNum;
+  std::vector<int> donorInputOfReputation;    //< reputation id -> input id of the donor table
+  std::vector<int> recipientInputOfAction;    //< donor action id -> input id of the recipient table
+
+  Composition donorComposition;
+  Composition recipientComposition;
+  Statistics statistics;
+
+  /** @brief flip the bits diff of the reputation id of individual i, a load and a store without a concurrent writer */
+  void flipReputationBits(int i, uint64_t diff) {
+    const uint64_t bit = static_cast<uint64_t>(i) << this->reputationBitShift;
+    std::atomic<uint64_t>& word = this->reputationBits[bit >> 6];
+    word.store(word.load(std::memory_order_relaxed) ^ (diff << (bit & 63)),
+               std::memory_order_relaxed);
+  }
+
+ public:
+  Population();
+  Population(int size, const Player& donorTemplate,
+             const Player& recipientTemplate, const Norm& norm);
+  Population(const Population& other);
+  Population(Population&& other) = default;
+  Population& operator=(const Population& other);
+  Population& operator=(Population&& other) = default;
+  ~Population();
+
+  int getSize() const { return this->size; }
+
+  int getDonorStrategyId(int i) const { return this->donorStrategyIds[i]; }
+  int getRecipientStrategyId(int i) const { return this->recipientStrategyIds[i]; }
+  // a relaxed load: storeReputationId may flip other bits of the word
+  int getReputationId(int i) const {
+    const uint64_t bit = static_cast<uint64_t>(i) << this->reputationBitShift;
+    return (this->reputationBits[bit >> 6].load(std::memory_order_relaxed) >>
+            (bit & 63)) & this->reputationMask;
+  }
+  int getReputationNum() const { return this->reputationNum; }
+  int getReputationBitNum() const { return 1 << this->reputationBitShift; }
+
+  void initIndividual(int i, int donorStrategyId, int recipientStrategyId,
+                      int reputationId);
+  void swapStrategies(int i, int j);
+  void swapReputations(int i, int j);
+  void setStrategies(int i, int donorStrategyId, int recipientStrategyId);
+  void setReputationId(int i, int reputationId);
+
+  // the writes of concurrent threads on distinct individuals: only the
+  // arrays, the counts of the changes are added by addTripleCounts
+  void storeStrategies(int i, int donorStrategyId, int recipientStrategyId) {
+    this->donorStrategyIds[i] = donorStrategyId;
+    this->recipientStrategyIds[i] = recipientStrategyId;
+  }
+  /** @brief an atomic flip of the changed bits, the word is shared with other individuals */
+  void storeReputationId(int i, int reputationId) {
+    const uint64_t diff = this->getReputationId(i) ^ reputationId;
+    if (diff != 0) {
+      const uint64_t bit = static_cast<uint64_t>(i) << this->reputationBitShift;
+      this->reputationBits[bit >> 6].fetch_xor(diff << (bit & 63),
+                                               std::memory_order_relaxed);
+    }
+  }
+  void addTripleCounts(const std::vector<int>& counts);
+
+  /** @brief the action id of the donor strategy facing the reputation */
+  int getDonorAction(int donorStrategyId, int reputationId) const {
+    return this->donorActionTable[donorStrategyId * this->donorInputNum +
+                                  this->donorInputOfReputation[reputationId]];
+  }
+  /** @brief the action id of the recipient strategy after the donor's action */
+  int getRecipientAction(int recipientStrategyId, int donorActionId) const {
+    return this->recipientActionTable[recipientStrategyId * this->recipientInputNum +
+                                      this->recipientInputOfAction[donorActionId]];
+  }
+  /** @brief the action id of donor i when it meets recipient j */
+  int donate(int i, int j) const {
+    return this->getDonorAction(this->donorStrategyIds[i], this->getReputationId(j));
+  }
+  /** @brief the action id of recipient j after the donor's action */
+  int reward(int j, int donorActionId) const {
+    return this->getRecipientAction(this->recipientStrategyIds[j], donorActionId);
+  }
+  /** @brief the new reputation id of a recipient of recipientReputationId, Norm::getReputationId */
+  int assess(int donorActionId, int recipientActionId, int recipientReputationId) const {
+    return this->normTable[(donorActionId * this->recipientActionNum + recipientActionId) *
+                               this->reputationNum + recipientReputationId];
+  }
+  int playGame(int donorI, int recipientJ);
+
+  const Composition& getDonorComposition() const { return this->donorComposition; }
+  const Composition& getRecipientComposition() const { return this->recipientComposition; }
+  const Statistics& getStatistics() const { return this->statistics; }
+  /** @brief the individuals of the top reputation level */
+  int getGoodReputationNum() const {
+    return this->statistics.getReputationCount(this->reputationNum - 1);
+  }
+};
+
+#endif  // !POPULATION_HPP
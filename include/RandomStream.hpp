@@ -0,0 +1,162 @@
+/**
+ * @file RandomStream.hpp
+ * @brief the counter-based random number generator (Philox4x32-10) of the
+ * simulation
+ *
+ * One global seed (--seed) is the Philox key, and every stream is addressed
+ * by (run id, replica, purpose) which is put in the high half of the counter.
+ * The n-th number of a stream is a pure function of (seed, stream, n), so a
+ * run gives the same result whichever thread executes it and however the
+ * other runs are scheduled. Numbers are generated BLOCK_NUM Philox blocks at a
+ * time into a small buffer.
+ *
+ */
+
+#ifndef RANDOMSTREAM_HPP
+#define RANDOMSTREAM_HPP
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+/**
+ * @brief the Philox4x32-10 bijection of Salmon et al. (2011), Parallel random
+ * numbers: as easy as 1, 2, 3
+ */
+struct Philox4x32 {
+  typedef std::array<uint32_t, 4> Counter;
+  typedef std::array<uint32_t, 2> Key;
+
+  static constexpr uint32_t M0 = 0xD2511F53;
+  static constexpr uint32_t M1 = 0xCD9E8D57;
+  static constexpr uint32_t W0 = 0x9E3779B9;
+  static constexpr uint32_t W1 = 0xBB67AE85;
+
+  static Counter generate(Counter counter, Key key);
+
+  /**
+   * @brief generate() of LANE_NUM counters of the same key at once, word w of
+   * lane l is counters[w][l]. The lanes are independent, so the loops are
+   * vectorized by the compiler
+   */
+  template <int LANE_NUM>
+  static void generateLanes(uint32_t (&counters)[4][LANE_NUM], Key key) {
+    for (int round = 0; round < 10; round++) {
+      for (int l = 0; l < LANE_NUM; l++) {
+        uint64_t product0 = static_cast<uint64_t>(M0) * counters[0][l];
+        uint64_t product1 = static_cast<uint64_t>(M1) * counters[2][l];
+        uint32_t next1 = static_cast<uint32_t>(product1);
+        uint32_t next3 = static_cast<uint32_t>(product0);
+        counters[0][l] = static_cast<uint32_t>(product1 >> 32) ^
+                         counters[1][l] ^ key[0];
+        counters[2][l] = static_cast<uint32_t>(product0 >> 32) ^
+                         counters[3][l] ^ key[1];
+        counters[1][l] = next1;
+        counters[3][l] = next3;
+      }
+      key[0] += W0;
+      key[1] += W1;
+    }
+  }
+};
+
+/**
+ * @brief what the random numbers of a stream are used for, each purpose of a
+ * run has its own stream so that e.g. changing the log options does not
+ * change the trajectory
+ */
+enum class RandomPurpose : uint16_t {
+  INIT = 0,        //< initial shuffle of strategies and reputations
+  SELECTION = 1,   //< focal player, role model and co-player
+  DECISION = 2,    //< mutation, imitation and the roles in the game
+  COOP_RATE = 3,   //< sampled cooperation rate of the log
+  PLAYER = 4,      //< Player::gen
+  NORM = 5,        //< Norm::gen
+  OTHER = 6,
+  SYNC = 7,        //< the per-individual (per-event) blocks of Evolution::stepGeneration (stepBatch)
+  GRAPH = 8,       //< the random interaction graph
+  LOCKSTEP = 9     //< the per-step blocks of a lane of LockstepReplicas
+};
+
+class RandomStream {
+ public:
+  typedef uint32_t result_type;  //< UniformRandomBitGenerator, usable by <random> distributions
+
+  static const int BLOCK_NUM = 16;  //< the Philox blocks generated at a time
+
+ private:
+  Philox4x32::Key key;
+  uint64_t streamId;
+  uint64_t blockId;  //< the next block to generate
+  std::array<uint32_t, BLOCK_NUM * 4> buffer;
+  int bufferPos;  //< the next unused number in buffer
+  int bufferEnd;  //< the numbers generated by refill(), 4 per block
+
+  void refill();
+
+ public:
+  RandomStream();
+  RandomStream(uint64_t seed, uint64_t streamId);
+
+  static RandomStream derive(uint64_t seed, uint32_t runId, uint16_t replica,
+                             RandomPurpose purpose);
+  static uint64_t getStreamId(uint32_t runId, uint16_t replica,
+                              RandomPurpose purpose);
+
+  static uint64_t getDefaultSeed();
+  static void setDefaultSeed(uint64_t seed);
+  static RandomStream newDefaultStream(RandomPurpose purpose);
+
+  const Philox4x32::Key& getKey() const { return this->key; }
+
+  void seek(uint64_t blockId, int blockNum = BLOCK_NUM);
+  void setPosition(uint64_t position);
+
+  /** @brief the number of 32-bit values consumed, the position of the stream */
+  uint64_t getPosition() const {
+    return this->blockId * 4 - (this->bufferEnd - this->bufferPos);
+  }
+  uint64_t getStreamId() const { return this->streamId; }
+
+  uint32_t nextUInt32() {
+    if (this->bufferPos == this->bufferEnd) {
+      this->refill();
+    }
+    return this->buffer[this->bufferPos++];
+  }
+
+  uint64_t nextUInt64() {
+    uint64_t hi = this->nextUInt32();
+    return (hi << 32) | this->nextUInt32();
+  }
+
+  /** @brief uniform double in [0, 1) with 53 random bits */
+  double nextDouble() {
+    return (this->nextUInt64() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  /**
+   * @brief unbiased uniform integer in [0, n) by Lemire's multiply-shift
+   * rejection, n must be in [1, 2^32)
+   */
+  uint32_t nextInt(uint32_t n) {
+    uint64_t m = static_cast<uint64_t>(this->nextUInt32()) * n;
+    uint32_t low = static_cast<uint32_t>(m);
+    if (low < n) {
+      uint32_t threshold = (0u - n) % n;
+      while (low < threshold) {
+        m = static_cast<uint64_t>(this->nextUInt32()) * n;
+        low = static_cast<uint32_t>(m);
+      }
+    }
+    return static_cast<uint32_t>(m >> 32);
+  }
+
+  result_type operator()() { return this->nextUInt32(); }
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+};
+
+#endif  // !RANDOMSTREAM_HPP
@@ -0,0 +1,93 @@
+/**
+ * @file RareMutation.hpp
+ * @brief the limit of small mu of Evolution: a mutant either fixes or goes
+ * extinct before the next mutation, so the population moves between the
+ * homogeneous states of the strategy pairs. The embedded Markov chain between
+ * them (16 states for the 4x4 games) is built from the fixation probabilities
+ * of the fermi process, computed analytically from getAvgPayoff, and its
+ * stationary distribution gives the long-run strategy abundances, good
+ * reputation and cooperation in milliseconds.
+ *
+ * The reputations change much faster than the strategies, so every
+ * individual is assumed to be good with the stationary probability of its
+ * reputation chain given the current composition (every individual is the
+ * recipient of a random other donor, see ReplicatorDynamics), and its payoff
+ * is the expectation over its reputation. Under some norms the reputations in
+ * a homogeneous population never change (e.g. DISC-SR under norm 8 keeps good
+ * and bad), then they are set by the mutants that arise and mostly go extinct
+ * while the pair is resident: the good reputation of such a pair is the fixed
+ * point of the reputation changes caused by the mutant donors, weighted by the
+ * expected time the mutants of each pair stay in the population.
+ *
+ */
+
+#ifndef RARE_MUTATION_HPP
+#define RARE_MUTATION_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Action.hpp"
+#include "CompiledPayoffMatrix.hpp"
+#include "Composition.hpp"
+#include "Norm.hpp"
+#include "Population.hpp"
+#include "Strategy.hpp"
+
+class RareMutation {
+ private:
+  int population;
+  double s;
+  double p0;
+  int normId;
+  bool isShortterm;  //< the donor's p follows the good reputation frequency
+  std::vector<Action> donorActions;
+  std::vector<Action> recipientActions;
+  std::vector<Strategy> donorStrategies;
+  std::vector<Strategy> recipientStrategies;
+  std::vector<CompiledPayoffMatrix> payoffMatrices;  //< reputation id -> the payoff matrix with the recipient's p of the reputation
+  int pVarId;
+  Norm norm;
+  Population tables;  //< no individuals, only the action and norm tables
+  int coopActionId;
+  int donorStrategyNum;
+  int recipientStrategyNum;
+  int strategyPairNum;
+
+  std::vector<double> fixationProbabilities;      //< resident pair * #pairs + mutant pair
+  std::vector<double> stationaryDistribution;     //< pair -> the fraction of time in the homogeneous state
+  std::vector<double> homogeneousGoodReputation;  //< pair -> the good reputation frequency of the homogeneous state
+
+  void getReputationRates(int donorStrategyId, int recipientStrategyId,
+                          double& toGood, double& toBad) const;
+  double getGoodReputationProbability(int pair,
+                                      const Composition& donorComposition,
+                                      double inherited) const;
+  double computeFixation(int resident, int mutant, double& mutantTime);
+  void solveStationaryDistribution();
+
+ public:
+  RareMutation(int population, double s, double b, double beta, double c,
+               double gamma, int normId, double p0,
+               std::string const& payoffMatrixConfigName);
+  ~RareMutation();
+
+  int getNormId() const { return this->normId; }
+  const std::vector<Strategy>& getDonorStrategies() const { return this->donorStrategies; }
+  const std::vector<Strategy>& getRecipientStrategies() const { return this->recipientStrategies; }
+  /** @brief the probability that one mutant of pair mutant takes over the homogeneous population of pair resident */
+  double getFixationProbability(int resident, int mutant) const {
+    return this->fixationProbabilities[resident * this->strategyPairNum + mutant];
+  }
+  const std::vector<double>& getStationaryDistribution() const { return this->stationaryDistribution; }
+  const std::vector<double>& getHomogeneousGoodReputation() const { return this->homogeneousGoodReputation; }
+
+  double getGoodReputationFrequency() const;
+  double getCoopRate() const;
+
+  std::string printStatistics(int step) const;
+  void fillStatisticsRow(int step, std::vector<uint32_t>& row) const;
+};
+
+#endif  // !RARE_MUTATION_HPP
@@ -0,0 +1,108 @@
+/**
+ * @file ReplicatorDynamics.hpp
+ * @brief the deterministic mean-field limit (population -> infinity) of
+ * Evolution, integrated by an adaptive Runge-Kutta method (Dormand-Prince
+ * 5(4)). It reads the same payoff matrices, strategies and norms, so the 16
+ * norms are solved in milliseconds instead of a full stochastic run each.
+ *
+ * The state is the fraction y[a][rho] of the individuals with the strategy pair
+ * a = (donor strategy, recipient strategy) and the reputation rho. The
+ * reputation is tracked per pair because the payoff of an individual depends
+ * on its own reputation and the reputation is correlated with the strategy.
+ * The time unit is one generation, population steps of Evolution, so the step
+ * of the log is time * population.
+ *
+ * - imitation: the focal c copies the pair a of a role model with the fermi
+ *   probability and keeps its reputation, with probability mu it moves to one
+ *   of the other pairs instead
+ * - reputation: every individual is the recipient of a game once per
+ *   generation, against a donor of the current donor strategy distribution,
+ *   and the norm assigns its new reputation
+ *
+ */
+
+#ifndef REPLICATOR_DYNAMICS_HPP
+#define REPLICATOR_DYNAMICS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Action.hpp"
+#include "CompiledPayoffMatrix.hpp"
+#include "Norm.hpp"
+#include "Population.hpp"
+#include "Strategy.hpp"
+
+class ReplicatorDynamics {
+ private:
+  double s;
+  double mu;
+  int normId;
+  bool isShortterm;  //< the donor's p follows the good reputation frequency
+  std::vector<Action> donorActions;
+  std::vector<Action> recipientActions;
+  std::vector<Strategy> donorStrategies;
+  std::vector<Strategy> recipientStrategies;
+  CompiledPayoffMatrix payoffMatrix;
+  int pVarId;
+  Norm norm;
+  Population tables;  //< no individuals, only the action and norm tables
+  int coopActionId;
+  int donorStrategyNum;
+  int recipientStrategyNum;
+  int strategyPairNum;
+  int reputationNum;
+
+  std::vector<double> state;  //< y[pair * reputationNum + reputation id]
+  std::vector<double> dydt;   //< the derivative at state, reused by the next step (FSAL)
+  double time;
+  double prevTime;  //< the time of prevState
+  double stepSize;  //< the proposal of the next step of the integrator
+  double rtol;
+  double atol;
+  int rkStepNum;  //< the accepted steps so far
+
+  // the workspace of derivative() and rkStep()
+  std::vector<double> payoff;  //< the average payoff of each class
+  std::vector<double> weight;  //< exp(s * payoff) up to a common factor
+  std::vector<double> donorFreq;
+  std::vector<double> recipientFreq;
+  std::vector<double> k[7];
+  std::vector<double> trial;
+  std::vector<double> trialDydt;
+  std::vector<double> prevState;  //< the state before the last accepted step
+  std::vector<double> prevDydt;
+
+  void derivative(const std::vector<double>& y, std::vector<double>& res);
+  bool rkStep();
+
+ public:
+  ReplicatorDynamics(double s, double b, double beta, double c, double gamma,
+                     double mu, int normId, double p0,
+                     std::string const& payoffMatrixConfigName,
+                     double rtol = 1e-6, double atol = 1e-9);
+  ~ReplicatorDynamics();
+
+  void advanceTo(double t);
+  void interpolate(double t, std::vector<double>& res) const;
+
+  double getTime() const { return this->time; }
+  int getRkStepNum() const { return this->rkStepNum; }
+  int getNormId() const { return this->normId; }
+  const std::vector<Strategy>& getDonorStrategies() const { return this->donorStrategies; }
+  const std::vector<Strategy>& getRecipientStrategies() const { return this->recipientStrategies; }
+  const std::vector<double>& getState() const { return this->state; }
+
+  double getPairFrequency(const std::vector<double>& y, int donorStrategyId,
+                          int recipientStrategyId) const;
+  std::vector<double> getPairFrequencies(const std::vector<double>& y) const;
+  double getGoodReputationFrequency(const std::vector<double>& y) const;
+  double getCoopRate(const std::vector<double>& y) const;
+
+  std::string printStatistics(const std::vector<double>& y, int step) const;
+  void fillStatisticsRow(const std::vector<double>& y, int step,
+                         int population, std::vector<uint32_t>& row) const;
+};
+
+#endif  // !REPLICATOR_DYNAMICS_HPP
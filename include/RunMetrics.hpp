@@ -0,0 +1,205 @@
+/**
+ * @file RunMetrics.hpp
+ * @brief the live metrics of the runs of the process, replacing the progress
+ * bars. Every run registers a RunMetrics in the MetricsRegistry and is its
+ * only writer: the steps done, the bytes written to its log and the
+ * cooperation rate of its last log row are relaxed atomic stores to its own
+ * cache line, so the hot loop never takes a lock or shares a line with
+ * another run.
+ *
+ * The MetricsReporter thread samples the registry every interval and renders
+ * - the terminal: a redrawn line per running run on a TTY, a line of the
+ * totals every NON_TTY_PERIOD seconds otherwise,
+ * - a json status file, rewritten atomically (tmp + rename),
+ * - a Prometheus text endpoint on 127.0.0.1:port (any GET, e.g. /metrics).
+ * The steps/sec of a run is measured between two samples.
+ *
+ * A run holds a RunMetricsGuard over its metrics: a run that leaves it still
+ * RUNNING (an exception) is FAILED, then the metrics are released. The
+ * registry drops a released run after the sample that holds its final state,
+ * and the reporter keeps only the count of the dropped runs by state, so a
+ * long sweep does not grow the samples.
+ *
+ */
+
+#ifndef RUN_METRICS_HPP
+#define RUN_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/json.hpp>
+
+enum class RunState : int { RUNNING = 0, DONE = 1, STOPPED = 2, FAILED = 3 };
+const int RUN_STATE_NUM = 4;
+
+/** @brief the number of runs by RunState */
+using RunStateNums = std::array<int, RUN_STATE_NUM>;
+
+class alignas(64) RunMetrics {
+ private:
+  std::string name;  //< the name of the log of the run
+  int normId;
+  int replica;
+  uint64_t stepNum;
+  std::chrono::steady_clock::time_point startTime;
+  uint64_t startStep;  //< the step of the checkpoint of a resumed run
+
+  std::atomic<uint64_t> stepsDone;
+  std::atomic<uint64_t> logBytes;
+  std::atomic<double> coopRate;  //< NaN before the first log row
+  std::atomic<int> state;
+  std::atomic<bool> released;  //< the run does not write any more
+
+ public:
+  RunMetrics(std::string const& name, int normId, int replica,
+             uint64_t stepNum, uint64_t startStep);
+  ~RunMetrics();
+
+  // the writes of the run, relaxed: the reporter only needs eventual values
+  void setStepsDone(uint64_t steps) {
+    this->stepsDone.store(steps, std::memory_order_relaxed);
+  }
+  void addLogBytes(uint64_t bytes) {
+    this->logBytes.store(
+        this->logBytes.load(std::memory_order_relaxed) + bytes,
+        std::memory_order_relaxed);
+  }
+  void setCoopRate(double coopRate) {
+    this->coopRate.store(coopRate, std::memory_order_relaxed);
+  }
+  void setState(RunState state) {
+    this->state.store(static_cast<int>(state), std::memory_order_relaxed);
+  }
+  // the last write of the run, it publishes the final values to the registry
+  void release() { this->released.store(true, std::memory_order_release); }
+
+  const std::string& getName() const { return this->name; }
+  int getNormId() const { return this->normId; }
+  int getReplica() const { return this->replica; }
+  uint64_t getStepNum() const { return this->stepNum; }
+  uint64_t getStartStep() const { return this->startStep; }
+  std::chrono::steady_clock::time_point getStartTime() const {
+    return this->startTime;
+  }
+  uint64_t getStepsDone() const {
+    return this->stepsDone.load(std::memory_order_relaxed);
+  }
+  uint64_t getLogBytes() const {
+    return this->logBytes.load(std::memory_order_relaxed);
+  }
+  double getCoopRate() const {
+    return this->coopRate.load(std::memory_order_relaxed);
+  }
+  RunState getState() const {
+    return static_cast<RunState>(this->state.load(std::memory_order_relaxed));
+  }
+  bool isReleased() const {
+    return this->released.load(std::memory_order_acquire);
+  }
+};
+
+/** @brief the values of a run at one sample of the reporter */
+struct RunSample {
+  std::string name;
+  int normId = 0;
+  int replica = 0;
+  uint64_t stepNum = 0;
+  uint64_t stepsDone = 0;
+  uint64_t logBytes = 0;
+  double coopRate = NAN;
+  RunState state = RunState::RUNNING;
+  double stepsPerSec = 0;  //< since the previous sample, or the start of the run
+  bool isLast = false;  //< the run is released and dropped from the registry
+};
+
+class MetricsRegistry {
+ private:
+  mutable std::mutex mtx;  //< only for add() and sample(), once per run and per interval
+  std::vector<std::unique_ptr<RunMetrics>> runs;
+
+ public:
+  MetricsRegistry();
+  ~MetricsRegistry();
+
+  RunMetrics* add(std::string const& name, int normId, int replica,
+                  uint64_t stepNum, uint64_t startStep = 0);
+  std::vector<RunSample> sample();
+};
+
+/**
+ * @brief the end of the metrics of a run, on every way out of its scope
+ *
+ */
+class RunMetricsGuard {
+ private:
+  RunMetrics* metrics;
+
+ public:
+  explicit RunMetricsGuard(RunMetrics* metrics) : metrics(metrics) {}
+  RunMetricsGuard(RunMetricsGuard const&) = delete;
+  RunMetricsGuard& operator=(RunMetricsGuard const&) = delete;
+  ~RunMetricsGuard() {
+    if (this->metrics->getState() == RunState::RUNNING) {
+      this->metrics->setState(RunState::FAILED);
+    }
+    this->metrics->release();
+  }
+};
+
+class MetricsReporter {
+ private:
+  MetricsRegistry& registry;
+  double interval;  //< seconds between two samples
+  bool terminal;
+  std::string jsonPath;  //< empty for none
+  int port;              //< 0 for none
+
+  bool isTty;
+  int listenFd;             //< the socket of the endpoint, -1 for none
+  int terminalLineNum;      //< the lines drawn last time on a TTY
+  std::chrono::steady_clock::time_point lastTerminalTime;
+  std::map<std::string, std::pair<uint64_t, double>>
+      previous;  //< run name -> steps done and seconds at the previous sample
+  std::chrono::steady_clock::time_point startTime;
+  std::vector<RunSample> samples;  //< the last sample
+  RunStateNums droppedStateNums;   //< the runs dropped from the registry
+
+  std::mutex mtx;
+  std::condition_variable stopCondition;
+  bool stopRequested;
+  std::thread thread;
+
+  void run();
+  void update();
+  void renderTerminal(bool isFinal);
+  void writeJson() const;
+  void serve(int timeoutMs);
+
+ public:
+  static const int NON_TTY_PERIOD = 30;  //< seconds between the lines without a TTY
+
+  static boost::json::value toJson(
+      std::vector<RunSample> const& samples,
+      RunStateNums const& droppedStateNums = RunStateNums{});
+  static std::string toPrometheus(std::vector<RunSample> const& samples);
+
+  MetricsReporter(MetricsRegistry& registry, double interval, bool terminal,
+                  std::string const& jsonPath = "", int port = 0);
+  ~MetricsReporter();
+
+  void start();
+  void stop();
+};
+
+#endif  // !RUN_METRICS_HPP
@@ -0,0 +1,55 @@
+/**
+ * @file Stationarity.hpp
+ * @brief the online stationarity test of the logged observables of a run
+ * (the strategy pair frequencies, good reputation and cooperation rate), used
+ * to stop a run with mu > 0 once its tail is long enough.
+ *
+ * The observations are averaged in batches of batchSize (MSER-5 for the
+ * default 5). The warm-up of every observable is the truncation of MSER: the
+ * d <= n / 2 that minimizes the variance of the mean of the batches d to
+ * n - 1, sum((x_i - mean_d)^2) / (n - d)^2. The run is stationary when, for
+ * every observable, d < n / 2 and the 95% half width of the mean of the tail,
+ * by 10 non-overlapping batch means, is below the tolerance. The test runs whenever the batches grow by 10%, so the cost is
+ * O(1) amortized per observation.
+ *
+ */
+
+#ifndef STATIONARITY_HPP
+#define STATIONARITY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class StationarityDetector {
+ private:
+  int observableNum;
+  double tolerance;
+  int batchSize;
+  int minBatchNum;                               //< the fewest batches in the tail to test
+  std::vector<double> batchSums;                 //< observable -> the sum of the current batch
+  int batchFill;                                 //< the observations in the current batch
+  uint64_t batchFirstStep;                       //< the step of the first observation of the current batch
+  std::vector<std::vector<double>> batchMeans;   //< observable -> the means of the full batches
+  std::vector<uint64_t> batchFirstSteps;         //< batch -> the step of its first observation
+  size_t nextTestBatchNum;
+  int truncationBatch;                           //< the warm-up in batches, -1 if not stationary yet
+
+ public:
+  static const int TAIL_BATCH_NUM = 10;  //< the batch means of the half width
+
+  static int mserTruncation(const std::vector<double>& means);
+  static double getHalfWidth(const std::vector<double>& means, int from);
+
+  StationarityDetector(int observableNum, double tolerance, int batchSize = 5,
+                       int minBatchNum = 20);
+  ~StationarityDetector();
+
+  bool add(uint64_t step, const double* values);
+
+  bool isStationary() const { return this->truncationBatch >= 0; }
+  int getObservableNum() const { return this->observableNum; }
+  uint64_t getTruncationStep() const;
+};
+
+#endif  // !STATIONARITY_HPP
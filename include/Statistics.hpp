@@ -0,0 +1,61 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include <vector>
+
+/**
+ * @brief the statistics of the population updated incrementally on each
+ * strategy change and reputation flip.
+ *
+ * It counts the individuals of every (donor strategy id, recipient strategy
+ * id, reputation id) triple, together with the strategy pair counts and the
+ * reputation counts, so a log row costs O(#strategy pairs) whatever the
+ * population size is.
+ */
+class Statistics {
+ private:
+  int donorStrategyNum;
+  int recipientStrategyNum;
+  int reputationNum;
+  std::vector<int> tripleCounts;  //< [(donor strategy id * recipientStrategyNum + recipient strategy id) * reputationNum + reputation id]
+  std::vector<int> pairCounts;  //< [donor strategy id * recipientStrategyNum + recipient strategy id]
+  std::vector<int> reputationCounts;  //< [reputation id]
+
+ public:
+  Statistics();
+  Statistics(int donorStrategyNum, int recipientStrategyNum, int reputationNum);
+  ~Statistics();
+
+  void add(int donorStrategyId, int recipientStrategyId, int reputationId);
+  void remove(int donorStrategyId, int recipientStrategyId, int reputationId);
+  void addCount(int donorStrategyId, int recipientStrategyId, int reputationId,
+                int count);
+  void move(int donorStrategyId, int recipientStrategyId, int reputationId,
+            int newDonorStrategyId, int newRecipientStrategyId,
+            int newReputationId) {
+    this->remove(donorStrategyId, recipientStrategyId, reputationId);
+    this->add(newDonorStrategyId, newRecipientStrategyId, newReputationId);
+  }
+
+  int getTripleCount(int donorStrategyId, int recipientStrategyId,
+                     int reputationId) const {
+    return this->tripleCounts[(donorStrategyId * this->recipientStrategyNum +
+                               recipientStrategyId) *
+                                  this->reputationNum +
+                              reputationId];
+  }
+  int getPairCount(int donorStrategyId, int recipientStrategyId) const {
+    return this->pairCounts[donorStrategyId * this->recipientStrategyNum +
+                            recipientStrategyId];
+  }
+  int getReputationCount(int reputationId) const {
+    return this->reputationCounts[reputationId];
+  }
+  const std::vector<int>& getTripleCounts() const { return this->tripleCounts; }
+
+  int getDonorStrategyNum() const { return this->donorStrategyNum; }
+  int getRecipientStrategyNum() const { return this->recipientStrategyNum; }
+  int getReputationNum() const { return this->reputationNum; }
+};
+
+#endif  // !STATISTICS_HPP
@@ -0,0 +1,81 @@
+/**
+ * @file Sweep.hpp
+ * @brief the parameter sweep of --sweep, expand a grid or list spec into jobs
+ * of (norm, params, replica, seed)
+ *
+ * grid spec (any file not ending with .csv), the cartesian product of all the
+ * lines is taken, a value is a list "v1,v2,..." or an inclusive range
+ * "start:step:end":
+ *
+ *   # comment
+ *   normId = 0:1:15
+ *   b = 2,4,6
+ *   p0 = 0:0.25:1
+ *   replica = 0:1:9
+ *
+ * list spec (*.csv), the header is the keys and every row is one point.
+ *
+ * keys: normId, stepNum, population, s, b, beta, c, gamma, mu, p0,
+ * payoffMatrix, replica. The keys missing from the spec keep
+ * the values of the command line flags.
+ *
+ */
+
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+struct SweepJob {
+  int normId = 0;
+  int stepNum = 0;
+  int population = 0;
+  double s = 0;
+  double b = 0;
+  double beta = 0;
+  double c = 0;
+  double gamma = 0;
+  double mu = 0;
+  double p0 = 0;
+  std::string payoffMatrix;
+  int replica = 0;
+  uint64_t seed = 0;  //< derived from the global seed and the key
+  std::string key;    //< the canonical text of the params and the replica, identifies the job in the manifest
+  double cost = 0;    //< the estimated running time, long jobs are started first
+};
+
+void setSweepJobParam(SweepJob& job, std::string const& name,
+                      std::string const& value);
+std::string getSweepJobKey(SweepJob const& job);
+uint64_t getSweepJobSeed(SweepJob const& job, uint64_t seed);
+
+std::vector<SweepJob> expandSweepSpec(std::string const& specPath,
+                                      SweepJob const& defaultJob,
+                                      uint64_t seed);
+std::vector<int> getSweepOrder(std::vector<SweepJob> const& jobs);
+
+/**
+ * @brief the file of the keys of the completed jobs, one per line, so an
+ * interrupted sweep is resumed by skipping them
+ */
+class SweepManifest {
+ private:
+  std::string path;
+  std::set<std::string> doneKeys;
+  mutable std::mutex mtx;
+
+ public:
+  explicit SweepManifest(std::string const& path);
+
+  bool isDone(std::string const& key) const {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return this->doneKeys.count(key) > 0;
+  }
+  void markDone(std::string const& key);
+};
+
+#endif  // !SWEEP_HPP
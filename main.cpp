@@ -40,17 +40,6 @@
  *
  */
 
-#define CREATE_BAR(n)                                                   \
-  ProgressBar bar##n {                                                  \
-    option::BarWidth{50}, option::Start{" ["}, option::Fill{"*"},       \
-        option::Lead{"*"}, option::Remainder{"-"}, option::End{"]"},    \
-        option::PrefixText{"Progress: " + std::to_string(n) + " "},     \
-        option::ShowElapsedTime{true}, option::ShowRemainingTime{true}, \
-        option::FontStyles {                                            \
-      std::vector<FontStyle> { FontStyle::bold }                        \
-    }                                                                   \
-  }
-
 #include <cmath>
 #include <iostream>
 // 导入字典类型
@@ -58,267 +47,239 @@
 #include <fmt/ranges.h>
 #include <gflags/gflags.h>
 
+#include <algorithm>
+#include <atomic>
+#include <csignal>
 #include <chrono>
 #include <climits>
 #include <filesystem>
 #include <fstream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
 // #include <execution>
 // #include <tbb/task.h>
+#include <tbb/blocked_range.h>
 #include <tbb/parallel_for.h>
 #include <tbb/task_arena.h>
 
 #include <boost/json.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
-#include <indicators/cursor_control.hpp>
-#include <indicators/dynamic_progress.hpp>
-#include <indicators/progress_bar.hpp>
 #include <numeric>
 
-#include "Action.hpp"
+#include "BinaryLog.hpp"
+#include "Checkpoint.hpp"
+#include "Evolution.hpp"
+#include "GameSpec.hpp"
+#include "InteractionGraph.hpp"
 #include "JsonFile.hpp"
-#include "Norm.hpp"
-#include "PayoffMatrix.hpp"
-#include "Player.hpp"
+#include "LockstepReplicas.hpp"
+#include "LogReducer.hpp"
+#include "Population.hpp"
+#include "RandomStream.hpp"
+#include "RareMutation.hpp"
+#include "ReplicatorDynamics.hpp"
+#include "RunMetrics.hpp"
 #include "Strategy.hpp"
+#include "Stationarity.hpp"
+#include "Sweep.hpp"
 
 #define REPUTATION_STR "reputation"
 
 using namespace std;
-using namespace indicators;
 using namespace std::chrono;
 using namespace boost;
 
-/**
- * @brief fermi function, which is used to calculate the probability of transition of strategy
- *
- * @param payoff_current the payoff of the current strategy
- * @param payoff_new the payoff of the new strategy
- * @param s the sensitivity of the fermi function if s is large, the probability of transition is small
- * @return double
- */
-double fermi(double payoff_current, double payoff_new, double s) {
-  double res = 1 / (1 + exp((payoff_current - payoff_new) * s));
-  return res;
-}
-
-/**
- * @brief Get the Coop Rate object,
- * we randomly select two people from the population to play the game. Because
- * there are identity differences between the two people, it is ordered, and
- * there are A_n^2 = n * (n - 1) possible
- *
- * Among all these possible extractions, the number of times the *donor*
- * cooperate is used as the numerator
- *
- * so the cooperation rate is possibleCoopNum / (n * (n - 1))
- *
- * This only reflects the probability of the donor to make a donation, and does
- * not reflect the probability of the recipient to give feedback
- *
- * @param strategyPair2Num
- * @param population
- * @return double
- */
-double getCoopRate(
-    const unordered_map<string, set<int>>& strategyName2donorId,
-    const unordered_map<string, set<int>>& strategyName2recipientId,
-    const int population,
-    const unordered_map<string, set<int>>& reputation2Id, vector<Player>& donors, vector<Player>& recipients) {
-  double temp_sum = 0;
-  const int n = population;
-  int good_rep_num = reputation2Id.at("1").size();
-
-  // for (auto& [do_stg_name, donor_id_set] : strategyName2donorId) {
-  //   if (do_stg_name == "C") {
-  //     temp_sum += donor_id_set.size() * (n - 1);
-  //   } else if (do_stg_name == "D") {
-  //     // do nothing
-  //   } else if (do_stg_name == "DISC") {
-  //     // record the number of people with reputation 1 in disc
-  //     int good_rep_in_disc = 0;
-  //     for (const auto& id: donor_id_set) {
-  //       if (recipients[id].getVarValue(REPUTATION_STR) == 1.0) {
-  //         good_rep_in_disc++;
-  //       }
-  //     }
-  //     // the good rep in disc will not encounter themselves, so they cooperate with good_rep_num - 1 people. The bad rep in disc encountering good_rep_num people will cooperate.
-  //     temp_sum += good_rep_in_disc * (good_rep_num - 1) + (donor_id_set.size() - good_rep_in_disc) * good_rep_num;
-  //   } else if (do_stg_name == "ADISC") {
-  //     // record the number of people with reputation 0 in disc
-  //     // TODO: ADISC / adisc
-  //     int bad_rep_in_ndisc = 0;
-  //     for (const auto& id: donor_id_set) {
-  //       if (recipients[id].getVarValue(REPUTATION_STR) == 0.0) {
-  //         bad_rep_in_ndisc++;
-  //       }
-  //     }
-  //     temp_sum += bad_rep_in_ndisc * (n - good_rep_num - 1) + (donor_id_set.size() - bad_rep_in_ndisc) * (n - good_rep_num);
-  //   } else {
-  //     cerr << "not support strategy name: " << do_stg_name << endl;
-  //     throw "not support strategy name";
-  //   }
-  // }
-  // double res = temp_sum / (n * (n - 1));
-  // assert(res >= 0 && res <= 1);
-
-  // play the game for coop_game_times times, and count the number of times the donor cooperates
-  // TODO: there are some not good random number generator rand(), it should be replaced by the c++11 random number generator
-  int game_times = 1000;
-  int coop_times = 0;
-  for(int i = 0; i < game_times; i++) {
-    int donor_id = rand() % n;
-    int recipient_id = rand() % n;
-    while(donor_id == recipient_id) {
-      recipient_id = rand() % n;
-    }
-    Action const &donor_action = donors.at(donor_id).donate(to_string((int)recipients.at(recipient_id).getVarValue(REPUTATION_STR)), 0.0);
-    Action const &recipient_action = recipients.at(recipient_id).reward(donor_action.getName(), 0.0);
-    if (recipient_action.getName() == "C" && donor_action.getName() == "C") {
-      coop_times++;
-    }
-  }
-  double res = static_cast<double>(coop_times) / game_times;
-  return res;
-}
+// set by SIGINT and SIGTERM, the running runs write a checkpoint and stop
+std::atomic<bool> stop_requested{false};
 
-/**
- * @brief Get the Avg Payoff object
- *
- * @param donorStrategy
- * @param recipientStrategy
- * @param payoff_matrix
- * @param strategyName2donorId
- * @param strategyName2recipientId
- * @param population
- * @return double
- */
-double getAvgPayoff(
-    const Strategy& donorStrategy, const Strategy& recipientStrategy,
-    const PayoffMatrix& payoffMatrix,
-    const unordered_map<string, set<int>>& strategyName2donorId,
-    const unordered_map<string, set<int>>& strategyName2recipientId,
-    int population) {
-  double eval_donor = 0;
-  double eval_recipient = 0;
-  vector<double> players_payoff =
-      payoffMatrix.getPayoff(donorStrategy, recipientStrategy);
-  double eval_same =
-      accumulate(players_payoff.begin(), players_payoff.end(), 0.0) / 2;
-  for (int j = 0; j < 4; j++) {
-    Strategy d_stra = payoffMatrix.getRowStrategies()[j];
-    Strategy r_stra = payoffMatrix.getColStrategies()[j];
-    eval_donor += payoffMatrix.getPayoff(donorStrategy, r_stra)[0] *
-                  strategyName2recipientId.at(r_stra.getName()).size() * 0.5;
-    eval_recipient += payoffMatrix.getPayoff(d_stra, recipientStrategy)[1] *
-                      strategyName2donorId.at(d_stra.getName()).size() * 0.5;
-  }
-  return (1.0 / (population - 1)) * (eval_donor + eval_recipient - eval_same);
-}
+void handleStopSignal(int signal) { stop_requested.store(true); }
 
 /**
- * @brief Counting the number of people in each policy pair can generate log rows:
- * statistics: C-NR, C-SR, C-AR, C-UR, DISC-NR, DISC-SR, DISC-AR, DISC-UR,
- * step, C-NR, C-SR, C-AR, C-UR, DISC-NR, DISC-SR, DISC-AR, DISC-UR, ADISC-NR,
- * ADISC-SR, ADISC-AR, ADISC-UR, D-NR, D-SR, D-AR, D-UR, C, DISC, ADISC, D, NR,
- * SR, AR, UR, cr
- * 
- * @param donors 
- * @param recipients 
- * @param donorStrategies 
- * @param recipientStrategies 
- * @param strategyName2DonorId 
- * @param strategyName2RecipientId 
- * @param population 
- * @param step 
- * @param print 
- * @param good_rep_num 
- * @return string 
+ * @brief the outputs of one run: the rows of its log (csv or binary) and the
+ * summary of them (LogReducer.hpp). The bytes written and the cooperation
+ * rate of the last row go to the metrics of the run
  */
-string printStatistics(
-    vector<Player>& donors, vector<Player>& recipients,
-    const vector<Strategy>& donorStrategies,
-    const vector<Strategy>& recipientStrategies,
-    const unordered_map<string, set<int>>& strategyName2DonorId,
-    const unordered_map<string, set<int>>& strategyName2RecipientId,
-    int population, int step, bool print, int good_rep_num) {
-  double population_double = static_cast<double>(population);
-  // unordered_map<string, int> strategyPair2Num;
-  unordered_map<string, int> strategyPair2Num;
-  string key_str;
-  unordered_map<string, set<int>> reputation2Id;
-  for (int i = 0; i < population; i++) {
-    const Player& donor = donors[i];
-    const Player& recipient = recipients[i];
-    key_str =
-        donor.getStrategy().getName() + "-" + recipient.getStrategy().getName();
-    strategyPair2Num[key_str]++;
-
-    if (recipient.getVarValue(REPUTATION_STR) == 1.0) {
-      reputation2Id["1"].insert(i);
-    } else if (recipient.getVarValue(REPUTATION_STR) == 0.0) {
-      reputation2Id["0"].insert(i);
+class RunOutput {
+ private:
+  bool isBinary;
+  string summaryPath;
+  RunMetrics* metrics;
+  // only one of them is opened, none without the trajectory
+  std::unique_ptr<fmt::ostream> out;
+  std::unique_ptr<BinaryLogWriter> binaryOut;
+  string logFilePath;  //< of out
+  std::unique_ptr<LogReducer> reducer;
+  vector<uint32_t> row;  //< the row of the binary log, the last column is the cooperation rate
+
+ public:
+  /**
+   * @brief open the log, or continue it at the offset of a checkpoint
+   *
+   * @param log_file_path
+   * @param summary_path
+   * @param is_binary_log
+   * @param has_trajectory whether the rows are written to the log
+   * @param has_summary whether the rows are reduced to the summary
+   * @param column_names
+   * @param column_types
+   * @param population
+   * @param step_num
+   * @param summary_tail
+   * @param summary_log_points
+   * @param summary_buckets
+   * @param resume the checkpoint to continue, nullptr for a new log
+   * @param metrics
+   */
+  RunOutput(string const& log_file_path, string const& summary_path,
+            bool is_binary_log, bool has_trajectory, bool has_summary,
+            vector<string> const& column_names,
+            vector<BinaryLogColumnType> const& column_types, int population,
+            int step_num, double summary_tail, int summary_log_points,
+            int summary_buckets, const Checkpoint* resume, RunMetrics* metrics)
+      : isBinary(is_binary_log),
+        summaryPath(summary_path),
+        metrics(metrics),
+        logFilePath(log_file_path),
+        row(column_names.size()) {
+    if (!has_trajectory) {
+      // only the summary
+    } else if (resume != nullptr) {
+      if (is_binary_log) {
+        this->binaryOut.reset(
+            new BinaryLogWriter(log_file_path, resume->logOffset));
+      } else {
+        filesystem::resize_file(log_file_path, resume->logOffset);
+        this->out.reset(new fmt::ostream(fmt::output_file(
+            log_file_path, fmt::file::WRONLY | fmt::file::APPEND)));
+      }
+    } else if (is_binary_log) {
+      this->binaryOut.reset(new BinaryLogWriter(log_file_path, column_names,
+                                                column_types, population));
     } else {
-      cerr << "reputation value error: "
-           << recipient.getVarValue(REPUTATION_STR) << endl;
-      throw "reputation value error";
+      this->out.reset(new fmt::ostream(fmt::output_file(log_file_path)));
+      string line = column_names[0];
+      for (size_t col = 1; col < column_names.size(); col++) {
+        line += "," + column_names[col];
+      }
+      this->out->print("{}\n", line);
+    }
+    if (has_summary) {
+      this->reducer.reset(new LogReducer(
+          column_names, column_types, population,
+          static_cast<uint64_t>(std::ceil(step_num * (1 - summary_tail))),
+          summary_log_points,
+          summary_buckets > 0
+              ? (step_num + summary_buckets - 1) / summary_buckets
+              : 0));
+      if (resume != nullptr) {
+        this->reducer->loadState(resume->reducerState);
+      }
     }
   }
-  assert(reputation2Id["1"].size() == good_rep_num);
-  assert(reputation2Id["1"].size() + reputation2Id["0"].size() == population);
 
-  string logLine = to_string(step);
+  vector<uint32_t>& getRow() { return this->row; }
 
-  if (print) {
-    fmt::print("strategyPair2Num: {}\n", strategyPair2Num);
-    for (Strategy donorS : donorStrategies) {
-      for (Strategy recipientS : recipientStrategies) {
-        key_str = donorS.getName() + "-" + recipientS.getName();
-        fmt::print("{0}: {1}, ", key_str,
-                   strategyPair2Num[key_str] / population_double);
-      }
+  /** @brief the row of getRow() to the log and the summary */
+  void writeRow(int log_step_id) {
+    if (this->binaryOut) {
+      this->binaryOut->writeRow(log_step_id, this->row.data());
+      this->metrics->addLogBytes(this->row.size() * sizeof(uint32_t));
     }
-    fmt::print("\n");
-    for (Strategy donorS : donorStrategies) {
-      key_str = donorS.getName();
-      fmt::print("{0}: {1}, ", key_str,
-                 strategyName2DonorId.at(key_str).size() / population_double);
+    if (this->reducer) {
+      this->reducer->addRow(this->row.data());
     }
-    fmt::print("\n");
-    for (Strategy recipientS : recipientStrategies) {
-      key_str = recipientS.getName();
-      fmt::print(
-          "{0}: {1}, ", key_str,
-          strategyName2RecipientId.at(key_str).size() / population_double);
+    this->metrics->setCoopRate(BinaryLogWriter::decodeFloat(this->row.back()));
+  }
+
+  /** @brief the line of the csv to the log and the summary */
+  void writeLine(string const& line) {
+    if (this->out) {
+      this->out->print("{}\n", line);
+      this->metrics->addLogBytes(line.size() + 1);
     }
-  } else {
-    for (Strategy donorS : donorStrategies) {
-      for (Strategy recipientS : recipientStrategies) {
-        key_str = donorS.getName() + "-" + recipientS.getName();
-        logLine +=
-            "," + to_string(strategyPair2Num[key_str] / population_double);
-      }
+    if (this->reducer) {
+      this->reducer->addCsvLine(line);
+    }
+    this->metrics->setCoopRate(
+        std::strtod(line.c_str() + line.rfind(',') + 1, nullptr));
+  }
+
+  /** @brief the row of the statistics of a population at log_step_id */
+  void writeStatistics(const Population& individuals,
+                       vector<Strategy> const& donor_strategies,
+                       vector<Strategy> const& recipient_strategies,
+                       int log_step_id, int coop_action_id,
+                       int coop_rate_samples, RandomStream& gen_coop_rate) {
+    if (this->isBinary) {
+      fillStatisticsRow(individuals, donor_strategies, recipient_strategies,
+                        log_step_id, coop_action_id, coop_rate_samples,
+                        gen_coop_rate, this->row);
+      this->writeRow(log_step_id);
+    } else {
+      this->writeLine(printStatistics(
+          individuals, donor_strategies, recipient_strategies,
+          individuals.getSize(), log_step_id, false, coop_action_id,
+          coop_rate_samples, gen_coop_rate));
+    }
+  }
+
+  void writeSummary() {
+    if (this->reducer) {
+      this->reducer->write(this->summaryPath);
     }
-    for (Strategy donorS : donorStrategies) {
-      key_str = donorS.getName();
-      logLine += "," + to_string(strategyName2DonorId.at(key_str).size() /
-                                 population_double);
+  }
+
+  /**
+   * @brief flush the log for a checkpoint
+   *
+   * @return uint64_t the size of the log, the offset to continue from
+   */
+  uint64_t flush() {
+    if (this->binaryOut) {
+      this->binaryOut->flush();
+      return this->binaryOut->getOffset();
     }
-    for (Strategy recipientS : recipientStrategies) {
-      key_str = recipientS.getName();
-      logLine += "," + to_string(strategyName2RecipientId.at(key_str).size() /
-                                 population_double);
+    if (this->out) {
+      this->out->flush();
+      return filesystem::file_size(this->logFilePath);
     }
+    return 0;
+  }
 
-    logLine += "," + to_string(reputation2Id["1"].size() / population_double);
-    double coop_rate =
-        getCoopRate(strategyName2DonorId, strategyName2RecipientId, population,
-                    reputation2Id, donors, recipients);
-    logLine += "," + to_string(coop_rate);
+  void saveReducerState(string& state) const {
+    if (this->reducer) {
+      this->reducer->saveState(state);
+    }
   }
-  return logLine;
+};
+
+/**
+ * @brief the json of a run, the model parameters and the other arguments
+ *
+ * @return json::value
+ */
+json::value getRunJson(int step_num, int population, double s, double b,
+                       double beta, double c, double gamma, double mu,
+                       int norm_id, double p0,
+                       string const& payoff_matrix_config_name,
+                       json::object const& other) {
+  return {{"stepNum", step_num},
+          {"population", population},
+          {"s", s},
+          {"b", b},
+          {"beta", beta},
+          {"c", c},
+          {"gamma", gamma},
+          {"mu", mu},
+          {"normId", norm_id},
+          {"p0", p0},
+          {"payoffMatrix", payoff_matrix_config_name},
+          // not model parameters
+          {"other", other}};
 }
 
 /**
@@ -333,150 +294,128 @@ string printStatistics(
  * @param gamma
  * @param mu
  * @param normId
- * @param update_step_num
  * @param p0
  * @param payoff_matrix_config_name
- * @param bar
- * @param turn_up_progress_bar
- * @param dynamic_bar
- * @param turn_up_dynamic_bar
- * @param dynamic_bar_id
+ * @param metrics_registry the run registers its live metrics (RunMetrics.hpp)
+ * there, nullptr for none
  * @param log_step
+ * @param coop_rate_samples the number of sampled games per log row for the
+ * cooperation rate, 0 means exact
+ * @param log_format "csv" or "binary", see BinaryLog.hpp
+ * @param seed the global seed, the random streams of the run are derived from
+ * (seed, norm_id, replica), see RandomStream.hpp
+ * @param replica
+ * @param mode "agent" (Evolution), "replicator" (ReplicatorDynamics, the
+ * deterministic mean-field limit, population only scales the steps of the log)
+ * or "rare" (RareMutation, the long-run averages of the limit of small mu, one
+ * row at step_num)
+ * @param update_mode of the agent mode, "async" (Evolution::step, one focal
+ * per step), "sync" (Evolution::stepGeneration, every individual at once in
+ * parallel, one generation is population steps and a row is written every
+ * max(1, log_step / population) generations), "skip" (Evolution::skipSteps,
+ * the process of async without visiting the steps that change nothing,
+ * well-mixed only) or "batch" (Evolution::stepBatch, the steps of async in
+ * batches of population / 64 done in parallel against the payoffs of the
+ * start of the batch, rows like sync with batches for generations,
+ * well-mixed only)
+ * @param graph the interaction graph of the agent mode, nullptr if
+ * well-mixed, shared by the runs
+ * @param graph_seed the seed the graph was generated from, recorded for
+ * --resume
+ * @param checkpoint_steps the agent mode writes a checkpoint (Checkpoint.hpp)
+ * next to the log every checkpoint_steps steps, 0 means only on SIGINT and
+ * SIGTERM. The checkpoint is removed when the run completes
+ * @param resume the checkpoint to continue, the other arguments must be the
+ * params of its json, nullptr to start a new run
+ * @param stop_on_absorption the agent mode stops at the first row of the log
+ * where Evolution::isAbsorbed()
+ * @param stationarity_tolerance the agent mode stops at the first row of the
+ * log where the logged frequencies are stationary (Stationarity.hpp) with a
+ * 95% half width below it, 0 to disable. The test starts again from the
+ * resumed step after --resume
+ * @param log_output "full" writes every row of the log, "summary" only the
+ * summary of the rows (LogReducer.hpp) to log/<name>.summary.json, "both"
+ * both
+ * @param summary_tail the tail window of the summary is the last
+ * summary_tail of step_num
+ * @param summary_log_points the log-spaced rows of the summary per decade of
+ * steps, 0 for none
+ * @param summary_buckets the number of min/max buckets of the summary over
+ * step_num, 0 for none
+ * @return true if the run completed (or stopped early), false if it stopped
+ * at a checkpoint
  */
-void func(int step_num, int population, double s, double b, double beta, double c,
-          double gamma, double mu, int norm_id, int update_step_num, double p0,
-          string payoff_matrix_config_name, ProgressBar* bar = nullptr,
-          bool turn_up_progress_bar = false,
-          DynamicProgress<ProgressBar>* dynamic_bar = nullptr,
-          bool turn_up_dynamic_bar = false, int dynamic_bar_id = 0,
-          int log_step = 1) {
-  string norm_name = "norm" + to_string(norm_id);
-
-  PayoffMatrix payoff_matrix("./payoffMatrix/" + payoff_matrix_config_name +
-                            "/" + "PayoffMatrix" + to_string(norm_id) + ".csv");
-
-  // assign vars
-  payoff_matrix.updateVar("b", b);
-  payoff_matrix.updateVar("beta", beta);
-  payoff_matrix.updateVar("c", c);
-  payoff_matrix.updateVar("gamma", gamma);
-  payoff_matrix.updateVar("p", p0);
-
-  payoff_matrix.evalPayoffMatrix();  // TODO: remove this line
-
-  // initialize two players
-  vector<Action> donor_actions;
-  donor_actions.push_back(Action("C", 0));
-  donor_actions.push_back(Action("D", 1));
-  // Player donor_temp("donor", 0, donor_actions);
-  Player donor_temp("donor", 0, donor_actions);
-  vector<Strategy> donor_strategies = payoff_matrix.getRowStrategies();
-  donor_temp.setStrategies(donor_strategies);
-  donor_temp.loadStrategy("./strategy");
-  // fmt::print("donor_strategies: {}\n", donor_temp.getStrategyTables());
-  donor_temp.setStrategy("C");
-
-  vector<Action> recipient_actions;
-  recipient_actions.push_back(Action("C", 0));
-  recipient_actions.push_back(Action("D", 1));
-  Player recipient_temp("recipient", 0, recipient_actions);
-  vector<Strategy> recipient_strategies = payoff_matrix.getColStrategies();
-  recipient_temp.setStrategies(recipient_strategies);
-
-  recipient_temp.loadStrategy("./strategy");
-  // fmt::print("recipient_strategies: {}\n",
-  // recipient_temp.getStrategyTables());
-  recipient_temp.setStrategy("NR");
-
-  // initialize recipient_temp's reputation
-  recipient_temp.addVar(REPUTATION_STR, 1);
-  // fmt::print("recipient_temp vars: {}\n", recipient_temp.getVars());
-
-  // load norm
-  string norm_path = "./norm/" + norm_name + ".csv";
-  Norm norm(norm_path);
-  // fmt::print("norm: {}\n", norm.getNormTableStr());
-
-  // the two players are used as templates to generate population players
-  vector<Player> donors;
-  vector<Player> recipients;
-  // time seed
-  unsigned seed_don = chrono::system_clock::now().time_since_epoch().count();
-  default_random_engine gen_don(seed_don);
-  uniform_int_distribution<int> dis_don(0, donor_strategies.size() - 1);
-
-  unsigned seed_rec =
-      chrono::system_clock::now().time_since_epoch().count() + 1;
-  default_random_engine gen_rec(seed_rec);
-  uniform_int_distribution<int> dis_rec(0, recipient_strategies.size() - 1);
-
-  unsigned seed_reputation =
-      chrono::system_clock::now().time_since_epoch().count() + 2;
-  default_random_engine gen_reputation(seed_reputation);
-  uniform_int_distribution<int> dis_reputation(0, 1);
-
-  unsigned seed_probability =
-      chrono::system_clock::now().time_since_epoch().count() + 3;
-  std::mt19937 gen_probability(seed_probability);
-  uniform_real_distribution<double> dis_probability(0, 1);
-
-  // record the strategy distribution of the population
-  unordered_map<string, set<int>> strategy_name2donor_id;
-  unordered_map<string, set<int>> strategy_name2recipient_id;
-  // judge if population can be divided by donor_strategies.size()
-  assert(population % donor_strategies.size() == 0);
-
-  // reputation init vector
-  int good_rep_num = static_cast<int>(population * p0);
-  int bad_rep_num = population - good_rep_num;
-  vector<int> reputation_value(bad_rep_num, 0);
-  vector<int> good_rep_value(good_rep_num, 1);
-  assert(reputation_value.size() + good_rep_value.size() == population);
-
-  reputation_value.insert(reputation_value.end(), good_rep_value.begin(),
-                          good_rep_value.end());
-  random_shuffle(reputation_value.begin(), reputation_value.end());
-
-  // strategy init vector, each strategy pair has the same number of players
-  vector<int> donor_stra_id;
-  vector<int> recipient_stra_id;
-  for (int i = 0; i < donor_strategies.size(); i++) {
-    donor_stra_id.insert(
-        donor_stra_id.end(),
-        population / static_cast<double>(donor_strategies.size()), i);
-    for (int j = 0; j < recipient_strategies.size(); j++) {
-      recipient_stra_id.insert(
-          recipient_stra_id.end(),
-          (population / static_cast<double>(donor_strategies.size())) /
-              static_cast<double>(recipient_strategies.size()),
-          j);
-    }
-  }
-  assert(donor_stra_id.size() == population &&
-         recipient_stra_id.size() == population);
-  vector<pair<int, int>> stra_id_pairs;
-  for (int i = 0; i < donor_stra_id.size(); i++) {
-    stra_id_pairs.push_back(make_pair(donor_stra_id[i], recipient_stra_id[i]));
-  }
-  random_shuffle(stra_id_pairs.begin(), stra_id_pairs.end());
-
-  // initialize population players that have different strategies, and each
-  // strategy has the same number of players
-  for (int i = 0; i < population; i++) {
-    Player temp_donor(donor_temp);
-    Player temp_recipient(recipient_temp);
-
-    auto [donor_stra_i, recipient_stra_i] = stra_id_pairs[i];
-
-    temp_donor.setStrategy(donor_strategies[donor_stra_i]);
-    strategy_name2donor_id[temp_donor.getStrategy().getName()].insert(i);
-    donors.push_back(temp_donor);
-
-    temp_recipient.setStrategy(recipient_strategies[recipient_stra_i]);
-    temp_recipient.updateVar(REPUTATION_STR, reputation_value[i]);
-
-    strategy_name2recipient_id[temp_recipient.getStrategy().getName()].insert(i);
-    recipients.push_back(temp_recipient);
+bool func(int step_num, int population, double s, double b, double beta, double c,
+          double gamma, double mu, int norm_id, double p0,
+          string payoff_matrix_config_name,
+          MetricsRegistry* metrics_registry = nullptr, int log_step = 1, int coop_rate_samples = 0,
+          string log_format = "csv", uint64_t seed = 0, int replica = 0,
+          string mode = "agent", string update_mode = "async",
+          const InteractionGraph* graph = nullptr, uint64_t graph_seed = 0,
+          int checkpoint_steps = 0, const Checkpoint* resume = nullptr,
+          bool stop_on_absorption = false, double stationarity_tolerance = 0,
+          string log_output = "full", double summary_tail = 0.5,
+          int summary_log_points = 20, int summary_buckets = 0) {
+  bool is_binary_log = false;
+  if (log_format == "binary") {
+    is_binary_log = true;
+  } else if (log_format != "csv") {
+    cerr << "log_format error: " << log_format << endl;
+    throw "log_format error";
+  }
+  if (mode != "agent" && mode != "replicator" && mode != "rare") {
+    cerr << "mode error: " << mode << endl;
+    throw "mode error";
+  }
+  if (resume != nullptr && mode != "agent") {
+    cerr << "only the agent mode can be resumed: " << mode << endl;
+    throw "only the agent mode can be resumed";
+  }
+  if (log_output != "full" && log_output != "summary" &&
+      log_output != "both") {
+    cerr << "log_output error: " << log_output << endl;
+    throw "log_output error";
+  }
+  const bool has_trajectory = log_output != "summary";
+  const bool has_summary = log_output != "full";
+  if (update_mode != "async" && update_mode != "sync" &&
+      update_mode != "skip" && update_mode != "batch") {
+    cerr << "update_mode error: " << update_mode << endl;
+    throw "update_mode error";
+  }
+  const bool is_replicator = mode == "replicator";
+  const bool is_rare = mode == "rare";
+  if (graph != nullptr && mode != "agent") {
+    cerr << "graph needs mode agent: " << mode << endl;
+    throw "graph needs mode agent";
+  }
+  if (graph != nullptr && (update_mode == "skip" || update_mode == "batch")) {
+    cerr << "update_mode " << update_mode
+         << " needs a well-mixed population: " << graph->getSpec() << endl;
+    throw "update_mode needs a well-mixed population";
+  }
+  // only one of them is created
+  std::unique_ptr<Evolution> evolution;
+  std::unique_ptr<ReplicatorDynamics> replicator;
+  std::unique_ptr<RareMutation> rare;
+  vector<Strategy> donor_strategies;
+  vector<Strategy> recipient_strategies;
+  if (is_replicator) {
+    replicator.reset(new ReplicatorDynamics(s, b, beta, c, gamma, mu, norm_id,
+                                            p0, payoff_matrix_config_name));
+    donor_strategies = replicator->getDonorStrategies();
+    recipient_strategies = replicator->getRecipientStrategies();
+  } else if (is_rare) {
+    rare.reset(new RareMutation(population, s, b, beta, c, gamma, norm_id, p0,
+                                payoff_matrix_config_name));
+    donor_strategies = rare->getDonorStrategies();
+    recipient_strategies = rare->getRecipientStrategies();
+  } else {
+    evolution.reset(new Evolution(population, s, b, beta, c, gamma, mu,
+                                  norm_id, p0, payoff_matrix_config_name, seed,
+                                  replica, graph));
+    donor_strategies = evolution->getDonorStrategies();
+    recipient_strategies = evolution->getRecipientStrategies();
   }
 
   // log
@@ -486,219 +425,489 @@ void func(int step_num, int population, double s, double b, double beta, double
     filesystem::create_directory(log_dir);
   }
 
-  const json::value jv = {{"stepNum", step_num},
-                          {"population", population},
-                          {"s", s},
-                          {"b", b},
-                          {"beta", beta},
-                          {"c", c},
-                          {"gamma", gamma},
-                          {"mu", mu},
-                          {"normId", norm_id},
-                          {"p0", p0},
-                          {"payoffMatrix", payoff_matrix_config_name},
-                          // not model parameters
-                          {"other",
-                           {
-                               {"updateStepNum", update_step_num},
-                               {"logStep", log_step},
-                           }}};
-
-  string log_file_path = logJson(log_dir, jv);
-
-  auto out = fmt::output_file(log_file_path);
+  const json::value jv = getRunJson(
+      step_num, population, s, b, beta, c, gamma, mu, norm_id, p0,
+      payoff_matrix_config_name,
+      {
+          {"logStep", log_step},
+          {"coopRateSamples", coop_rate_samples},
+          {"logFormat", log_format},
+          {"seed", seed},
+          {"replica", replica},
+          {"mode", mode},
+          {"updateMode", update_mode},
+          {"graph", graph != nullptr ? graph->getSpec() : string("")},
+          {"graphSeed", graph_seed},
+          {"checkpointSteps", checkpoint_steps},
+          {"stopOnAbsorption", stop_on_absorption},
+          {"stationarityTolerance", stationarity_tolerance},
+          {"logOutput", log_output},
+          {"summaryTail", summary_tail},
+          {"summaryLogPoints", summary_log_points},
+          {"summaryBuckets", summary_buckets},
+      });
+
+  // the arguments of the run, saved in the checkpoints to resume it
+  const string run_params = fmt::format(
+      "stepNum={}\npopulation={}\ns={}\nb={}\nbeta={}\nc={}\ngamma={}\nmu={}\n"
+      "normId={}\np0={}\npayoffMatrix={}\nlogStep={}\ncoopRateSamples={}\n"
+      "logFormat={}\nseed={}\nreplica={}\nmode={}\nupdateMode={}\ngraph={}\n"
+      "graphSeed={}\ncheckpointSteps={}\n"
+      "stopOnAbsorption={}\nstationarityTolerance={}\nlogOutput={}\n"
+      "summaryTail={}\nsummaryLogPoints={}\nsummaryBuckets={}\n",
+      step_num, population, s, b, beta, c, gamma, mu, norm_id, p0,
+      payoff_matrix_config_name, log_step, coop_rate_samples, log_format, seed,
+      replica, mode, update_mode,
+      graph != nullptr ? graph->getSpec() : string(""), graph_seed,
+      checkpoint_steps, stop_on_absorption ? 1 : 0, stationarity_tolerance,
+      log_output, summary_tail, summary_log_points, summary_buckets);
+
+  // a resumed run appends to the log of its checkpoint. Without the
+  // trajectory the json points to the summary
+  const string log_file_ext =
+      !has_trajectory ? ".summary.json" : is_binary_log ? ".rlog" : ".csv";
+  string log_file_path = resume != nullptr
+                             ? resume->logPath
+                             : logJson(log_dir, jv, log_file_ext);
+  const string log_file_stem =
+      log_file_path.substr(0, log_file_path.size() - log_file_ext.size());
+  string checkpoint_path = log_file_stem + ".ckpt";
+  string summary_path = log_file_stem + ".summary.json";
+
+  // the live metrics, written only by this run. Without a registry nobody
+  // reads them
+  const int start_step = resume != nullptr ? resume->step : 0;
+  RunMetrics unregistered_metrics("", norm_id, replica, step_num, start_step);
+  RunMetrics* metrics =
+      metrics_registry != nullptr
+          ? metrics_registry->add(
+                filesystem::path(log_file_stem).filename().string(), norm_id,
+                replica, step_num, start_step)
+          : &unregistered_metrics;
+  // FAILED if an exception leaves the run still RUNNING, then released
+  RunMetricsGuard metrics_guard(metrics);
+
   // generate header
-  string line = "step";
-  for (Strategy donor_s : donor_strategies) {
-    for (Strategy recipient_s : recipient_strategies) {
-      line += "," + donor_s.getName() + "-" + recipient_s.getName();
+  vector<string> column_names =
+      getLogColumnNames(donor_strategies, recipient_strategies);
+  vector<BinaryLogColumnType> column_types =
+      getLogColumnTypes(column_names.size());
+
+  RunOutput output(log_file_path, summary_path, is_binary_log, has_trajectory,
+                   has_summary, column_names, column_types, population,
+                   step_num, summary_tail, summary_log_points, summary_buckets,
+                   resume, metrics);
+  auto writeLog = [&](int log_step_id) {
+    output.writeStatistics(evolution->getIndividuals(), donor_strategies,
+                           recipient_strategies, log_step_id,
+                           evolution->getCoopActionId(), coop_rate_samples,
+                           evolution->getCoopRateStream());
+  };
+  // the state of the mean-field solver at the steps of the log, the step is
+  // time * population
+  vector<double> replicator_state;
+  auto writeReplicatorLog = [&](int log_step_id) {
+    double t = static_cast<double>(log_step_id) / population;
+    replicator->advanceTo(t);
+    replicator->interpolate(t, replicator_state);
+    if (is_binary_log) {
+      replicator->fillStatisticsRow(replicator_state, log_step_id, population,
+                                    output.getRow());
+      output.writeRow(log_step_id);
+    } else {
+      output.writeLine(
+          replicator->printStatistics(replicator_state, log_step_id));
     }
+  };
+
+  if (is_rare) {
+    // one row of the long-run averages (the stationary distribution of the
+    // embedded chain) at the last step
+    if (is_binary_log) {
+      rare->fillStatisticsRow(step_num, output.getRow());
+      output.writeRow(step_num);
+    } else {
+      output.writeLine(rare->printStatistics(step_num));
+    }
+    output.writeSummary();
+    metrics->setStepsDone(step_num);
+    metrics->setState(RunState::DONE);
+    return true;
   }
-  for (Strategy donor_s : donor_strategies) {
-    line += "," + donor_s.getName();
-  }
-  for (Strategy recipient_s : recipient_strategies) {
-    line += "," + recipient_s.getName();
-  }
-  line += ",good_rep,cr";
 
-  out.print("{}\n", line);
+  if (is_replicator) {
+    // the same rows as the agent mode, without visiting every step
+    writeReplicatorLog(0);
+    for (int step = 0; step < step_num; step += log_step) {
+      writeReplicatorLog(step + 1);
+      metrics->setStepsDone(std::min(step + log_step, step_num));
+    }
+    output.writeSummary();
+    metrics->setState(RunState::DONE);
+    return true;
+  }
 
-  string log_line =
-      printStatistics(donors, recipients, donor_strategies, recipient_strategies,
-                      strategy_name2donor_id, strategy_name2recipient_id,
-                      population, 0, false, good_rep_num);
-  out.print("{}\n", log_line);
+  // the checkpoint after done_step steps, the log is flushed first so that
+  // its size is the offset to continue from
+  auto writeRunCheckpoint = [&](uint64_t done_step) {
+    Checkpoint checkpoint;
+    evolution->saveCheckpoint(checkpoint);
+    checkpoint.step = done_step;
+    checkpoint.params = run_params;
+    checkpoint.logPath = log_file_path;
+    checkpoint.logOffset = output.flush();
+    output.saveReducerState(checkpoint.reducerState);
+    writeCheckpoint(checkpoint_path, checkpoint);
+  };
+
+  // the early termination, tested at the rows of the log
+  std::unique_ptr<StationarityDetector> stationarity;
+  if (stationarity_tolerance > 0) {
+    stationarity.reset(new StationarityDetector(
+        evolution->getStrategyPairNum() + 2, stationarity_tolerance));
+  }
+  vector<double> observables;
+  string termination_reason = "completed";
+  uint64_t termination_step = step_num;
+  auto isTerminated = [&](uint64_t log_step_id) {
+    if (stop_on_absorption && evolution->isAbsorbed()) {
+      termination_reason = "absorbed";
+      termination_step = log_step_id;
+      return true;
+    }
+    if (stationarity) {
+      evolution->getObservables(observables);
+      if (stationarity->add(log_step_id, observables.data())) {
+        termination_reason = "stationary";
+        termination_step = log_step_id;
+        return true;
+      }
+    }
+    return false;
+  };
+  // the run is over, the reason is recorded in its json
+  auto finishRun = [&]() {
+    json::value result = jv;
+    json::object termination;
+    termination["reason"] = termination_reason;
+    termination["step"] = termination_step;
+    if (termination_reason == "stationary") {
+      termination["warmupEndStep"] = stationarity->getTruncationStep();
+    }
+    result.as_object()["termination"] = termination;
+    updateLogJson(log_file_path, result, log_file_ext);
+    output.writeSummary();
+    filesystem::remove(checkpoint_path);
+    metrics->setState(RunState::DONE);
+  };
+
+  bool terminated = false;
+  if (resume != nullptr) {
+    evolution->loadCheckpoint(*resume);
+  } else {
+    writeLog(0);
+    terminated = isTerminated(0);
+  }
 
-  uniform_int_distribution<int> dis(0, population - 1);
-  for (int step = 0; step < step_num; step++) {
-    // update progress bar
-    if (turn_up_progress_bar) {
-      // (*bar).set_progress((double)step / step_num * 100);
-      // only update once when the progress bar increases by 1%
-      if (step % (step_num / 100) == 0) {
-        (*bar).tick();
+  if (update_mode == "sync" || update_mode == "batch") {
+    // a generation of sync is population steps, one of batch (a batch) is
+    // getBatchStepNum() steps, the run ends at the last whole generation
+    // within step_num so that no row is past it
+    const bool is_sync = update_mode == "sync";
+    const int unit_steps =
+        is_sync ? population : evolution->getBatchStepNum();
+    const int generation_num = step_num / unit_steps;
+    const int log_generation = std::max(1, log_step / unit_steps);
+    const int checkpoint_generation =
+        checkpoint_steps > 0 ? std::max(1, checkpoint_steps / unit_steps) : 0;
+    const int start_generation = evolution->getGeneration();
+    for (int generation = start_generation;
+         generation < generation_num && !terminated; generation++) {
+      if (stop_requested.load(std::memory_order_relaxed)) {
+        writeRunCheckpoint(static_cast<uint64_t>(generation) * unit_steps);
+        metrics->setState(RunState::STOPPED);
+        return false;
       }
-    } else if (turn_up_dynamic_bar) {
-      if (step % (step_num / 100) == 0) {
-        (*dynamic_bar)[dynamic_bar_id].tick();
+      if (checkpoint_generation > 0 && generation > start_generation &&
+          generation % checkpoint_generation == 0) {
+        writeRunCheckpoint(static_cast<uint64_t>(generation) * unit_steps);
       }
-    }
 
-    // // record the strategy change of the population to update
-    // strategyName2donorId and strategyName2recipientId unordered_map<int,
-    // pair<string, string>> donor2StrateChange; unordered_map<int, pair<string,
-    // string>> recipientId2StrateChange;
-
-    // The random number of 0-population is extracted
-    int focal_i = dis(gen_don);
-    int rolemodel_i = dis(gen_rec);
-    // to prevent the same person from being  drawn
-    while (focal_i == rolemodel_i) {
-      focal_i = dis(gen_don);
-      rolemodel_i = dis(gen_rec);
-    }
-
-    // mutation probability to explore other strategies randomly
-    double p = dis_probability(gen_probability);
-    assert(p >= 0 && p <= 1);
-    // there is a probability of mu to explore other strategies randomly
-    if (p < mu) {
-      // update the focul's strategy
-      int randId_d = 0;
-      int randId_r = 0;
-      do {
-        randId_d = donors[focal_i].getRandomInt(0, donor_strategies.size() - 1);
-        randId_r =
-            recipients[focal_i].getRandomInt(0, recipient_strategies.size() - 1);
-      } while (randId_d == donors[focal_i].getStrategy().getId() &&
-               randId_r == recipients[focal_i].getStrategy().getId());
-
-      strategy_name2donor_id[donors[focal_i].getStrategy().getName()].erase(
-          focal_i);
-      donors[focal_i].setStrategy(donor_strategies[randId_d]);
-      strategy_name2donor_id[donor_strategies[randId_d].getName()].insert(focal_i);
-
-      strategy_name2recipient_id[recipients[focal_i].getStrategy().getName()]
-          .erase(focal_i);
-      recipients[focal_i].setStrategy(recipient_strategies[randId_r]);
-      strategy_name2recipient_id[recipient_strategies[randId_r].getName()].insert(
-          focal_i);
-    } else {
-      Strategy rolemodel_donorStrategy = donors[rolemodel_i].getStrategy();
-      Strategy rolemodel_recipientStrategy =
-          recipients[rolemodel_i].getStrategy();
-
-      // if payoff_matrix_config_name == "payoffMatrix_shortterm", then eval the
-      // whole payoff_matrix according to the current reputation distribution
-      map<string, double> vars_for_recipient = {
-          {"p", recipients[rolemodel_i].getVarValue(REPUTATION_STR)}};
-      if (payoff_matrix_config_name == "payoffMatrix_shortterm") {
-        payoff_matrix.updateVar("p",
-                               static_cast<double>(good_rep_num) / population);
-        payoff_matrix.evalPayoffMatrix({}, vars_for_recipient);
-      } else if (payoff_matrix_config_name ==
-                 "payoffMatrix_longterm_no_norm_error") {
-        payoff_matrix.evalPayoffMatrix({}, vars_for_recipient);
+      if (is_sync) {
+        evolution->stepGeneration();
       } else {
-        cerr << "payoff_matrix_config_name error: "
-             << payoff_matrix_config_name << endl;
-             throw "payoff_matrix_config_name error";
+        evolution->stepBatch();
       }
+      metrics->setStepsDone(static_cast<uint64_t>(generation + 1) *
+                            unit_steps);
 
-      double rolemodel_payoff = getAvgPayoff(
-          rolemodel_donorStrategy, rolemodel_recipientStrategy, payoff_matrix,
-          strategy_name2donor_id, strategy_name2recipient_id, population);
-
-      Strategy focul_donorStrategy = donors[focal_i].getStrategy();
-      Strategy focul_recipientStrategy = recipients[focal_i].getStrategy();
-
-      // TODO: optimize?
-      vars_for_recipient = {
-          {"p", recipients[focal_i].getVarValue(REPUTATION_STR)}};
-      if (payoff_matrix_config_name == "payoffMatrix_shortterm") {
-        payoff_matrix.updateVar("p",
-                               static_cast<double>(good_rep_num) / population);
-        payoff_matrix.evalPayoffMatrix({}, vars_for_recipient);
-      } else if (payoff_matrix_config_name ==
-                 "payoffMatrix_longterm_no_norm_error") {
-        payoff_matrix.evalPayoffMatrix({}, vars_for_recipient);
-      } else {
-        cerr << "payoff_matrix_config_name error: "
-             << payoff_matrix_config_name << endl;
-             throw "payoff_matrix_config_name error";
+      if (generation % log_generation == 0) {
+        writeLog((generation + 1) * unit_steps);
+        terminated = isTerminated(static_cast<uint64_t>(generation + 1) *
+                                  unit_steps);
+      }
+    }
+    if (termination_reason == "completed") {
+      termination_step = static_cast<uint64_t>(generation_num) * unit_steps;
+    }
+    finishRun();
+    return true;
+  }
+
+  int next_checkpoint_step =
+      checkpoint_steps > 0
+          ? (start_step / checkpoint_steps + 1) * checkpoint_steps
+          : INT_MAX;
+  if (update_mode == "skip") {
+    // the same rows and checkpoints as async: every call of skipSteps ends at
+    // the next of them
+    int step = start_step;
+    while (step < step_num && !terminated) {
+      if (stop_requested.load(std::memory_order_relaxed)) {
+        writeRunCheckpoint(step);
+        metrics->setState(RunState::STOPPED);
+        return false;
       }
+      if (step == next_checkpoint_step) {
+        writeRunCheckpoint(step);
+        next_checkpoint_step += checkpoint_steps;
+      }
+
+      // the next row of async, written after step t with t % log_step == 0
+      // as the row of step t + 1
+      const int next_log_step = (step + log_step - 1) / log_step * log_step + 1;
+      step += evolution->skipSteps(
+          std::min({next_log_step, next_checkpoint_step, step_num}) - step);
+      metrics->setStepsDone(step);
 
-      double focul_payoff = getAvgPayoff(
-          focul_donorStrategy, focul_recipientStrategy, payoff_matrix,
-          strategy_name2donor_id, strategy_name2recipient_id, population);
-
-      // fermi
-      if (dis_probability(gen_probability) <
-          fermi(focul_payoff, rolemodel_payoff, s)) {
-        strategy_name2donor_id[donors[focal_i].getStrategy().getName()].erase(
-            focal_i);
-        donors[focal_i].setStrategy(rolemodel_donorStrategy);
-        strategy_name2donor_id[rolemodel_donorStrategy.getName()].insert(focal_i);
-
-        strategy_name2recipient_id[recipients[focal_i].getStrategy().getName()]
-            .erase(focal_i);
-        recipients[focal_i].setStrategy(rolemodel_recipientStrategy);
-        strategy_name2recipient_id[rolemodel_recipientStrategy.getName()].insert(
-            focal_i);
+      if (step == next_log_step) {
+        writeLog(step);
+        terminated = isTerminated(step);
       }
     }
+    finishRun();
+    return true;
+  }
+  // the steps up to the next row, checkpoint or stop check run in one call of
+  // steps(), which picks the game kernel once for all of them
+  const int stop_check_steps = 4096;
+  int step = start_step;
+  while (step < step_num && !terminated) {
+    if (stop_requested.load(std::memory_order_relaxed)) {
+      writeRunCheckpoint(step);
+      metrics->setState(RunState::STOPPED);
+      return false;
+    }
+    if (step == next_checkpoint_step) {
+      writeRunCheckpoint(step);
+      next_checkpoint_step += checkpoint_steps;
+    }
+
+    // a row is generated after step t with t % log_step == 0, as the row of
+    // step t + 1
+    const int next_log_step = (step + log_step - 1) / log_step * log_step + 1;
+    const int end_step = std::min({next_log_step, next_checkpoint_step,
+                                   step_num, step + stop_check_steps});
+    evolution->steps(end_step - step);
+    step = end_step;
+    metrics->setStepsDone(step);
 
-    // focal player play the game with a random select neighbor k using the new
-    // strategy
-    int k = dis(gen_don);
-    while (k == focal_i) {
-      k = dis(gen_don);
+    if (step == next_log_step) {
+      // generate log
+      writeLog(step);
+      terminated = isTerminated(step);
     }
+  }
+  finishRun();
+  return true;
+}
 
-    // The position in the game is randomly selected between focal_i and k
-    // 1. focal_i as donor and k as recipient
-    // 2. k as donor and focal_i as recipient
-    double random_p = dis_probability(gen_probability);
-    assert(random_p >= 0 && random_p <= 1);
-    Player* donor;
-    Player* recipient;
-    if (random_p > 0.5) {
-      donor = &donors[focal_i];
-      recipient = &recipients[k];
+/**
+ * @brief the async process of the agent mode for replicas of one block of
+ * LockstepReplicas, advanced together (update mode "lockstep"). The block of
+ * replica r starts at LANE_NUM * (r / LANE_NUM), so the rows of a replica do
+ * not depend on the other replicas run with it. Every replica of replicas is
+ * logged as a run of func, the other lanes of the block are only simulated.
+ * The lanes have no checkpoints: a stopped block starts again
+ *
+ * @param step_num
+ * @param population
+ * @param s
+ * @param b
+ * @param beta
+ * @param c
+ * @param gamma
+ * @param mu
+ * @param norm_id
+ * @param p0
+ * @param payoff_matrix_config_name
+ * @param metrics_registry
+ * @param log_step
+ * @param coop_rate_samples
+ * @param log_format
+ * @param seed the seed of the block, the streams of a lane are derived from
+ * (seed, norm_id, replica)
+ * @param replicas the replicas to log, in one block
+ * @param log_output
+ * @param summary_tail
+ * @param summary_log_points
+ * @param summary_buckets
+ * @return true if the runs completed, false if they were stopped
+ */
+bool funcLockstep(int step_num, int population, double s, double b,
+                  double beta, double c, double gamma, double mu, int norm_id,
+                  double p0, string payoff_matrix_config_name,
+                  MetricsRegistry* metrics_registry, int log_step,
+                  int coop_rate_samples, string log_format, uint64_t seed,
+                  vector<int> const& replicas, string log_output,
+                  double summary_tail, int summary_log_points,
+                  int summary_buckets) {
+  const int lane_num = LockstepReplicas::LANE_NUM;
+  if (log_format != "csv" && log_format != "binary") {
+    cerr << "log_format error: " << log_format << endl;
+    throw "log_format error";
+  }
+  if (log_output != "full" && log_output != "summary" &&
+      log_output != "both") {
+    cerr << "log_output error: " << log_output << endl;
+    throw "log_output error";
+  }
+  const int first_replica =
+      replicas.empty() ? 0 : replicas[0] / lane_num * lane_num;
+  for (int replica : replicas) {
+    if (replica < 0 || replica / lane_num * lane_num != first_replica) {
+      cerr << "replicas out of the block of " << first_replica << ": "
+           << replica << endl;
+      throw "replicas out of one block";
+    }
+  }
+  const bool is_binary_log = log_format == "binary";
+  const bool has_trajectory = log_output != "summary";
+  const bool has_summary = log_output != "full";
+  LockstepReplicas lockstep(population, s, b, beta, c, gamma, mu, norm_id, p0,
+                            payoff_matrix_config_name, seed, first_replica);
+  const vector<Strategy>& donor_strategies = lockstep.getDonorStrategies();
+  const vector<Strategy>& recipient_strategies =
+      lockstep.getRecipientStrategies();
+  const int coop_action_id = 0;  // "C"
+
+  string log_dir = "./log";
+  if (!filesystem::exists(log_dir)) {
+    filesystem::create_directory(log_dir);
+  }
+  vector<string> column_names =
+      getLogColumnNames(donor_strategies, recipient_strategies);
+  vector<BinaryLogColumnType> column_types =
+      getLogColumnTypes(column_names.size());
+  const string log_file_ext =
+      !has_trajectory ? ".summary.json" : is_binary_log ? ".rlog" : ".csv";
+
+  // a run of func per logged replica
+  vector<json::value> jvs;
+  vector<string> log_file_paths;
+  vector<std::unique_ptr<RunMetrics>> unregistered_metrics;
+  vector<RunMetrics*> metrics;
+  vector<std::unique_ptr<RunMetricsGuard>> metrics_guards;
+  vector<std::unique_ptr<RunOutput>> outputs;
+  vector<RandomStream> gen_coop_rates;
+  for (int replica : replicas) {
+    jvs.push_back(getRunJson(
+        step_num, population, s, b, beta, c, gamma, mu, norm_id, p0,
+        payoff_matrix_config_name,
+        {
+            {"logStep", log_step},
+            {"coopRateSamples", coop_rate_samples},
+            {"logFormat", log_format},
+            {"seed", seed},
+            {"replica", replica},
+            {"mode", "agent"},
+            {"updateMode", "lockstep"},
+            {"graph", ""},
+            {"graphSeed", 0},
+            {"checkpointSteps", 0},
+            {"stopOnAbsorption", false},
+            {"stationarityTolerance", 0},
+            {"logOutput", log_output},
+            {"summaryTail", summary_tail},
+            {"summaryLogPoints", summary_log_points},
+            {"summaryBuckets", summary_buckets},
+        }));
+    log_file_paths.push_back(logJson(log_dir, jvs.back(), log_file_ext));
+    const string log_file_stem = log_file_paths.back().substr(
+        0, log_file_paths.back().size() - log_file_ext.size());
+    if (metrics_registry != nullptr) {
+      metrics.push_back(metrics_registry->add(
+          filesystem::path(log_file_stem).filename().string(), norm_id,
+          replica, step_num));
     } else {
-      donor = &donors[k];
-      recipient = &recipients[focal_i];
-    }
-
-    double reputation = recipient->getVarValue(REPUTATION_STR);
-    Action donor_action = donor->donate(to_string((int)reputation), 0.0);
-    Action recipient_action = recipient->reward(donor_action.getName(), 0.0);
-    double new_reputation =
-        norm.getReputation(donor_action, recipient_action, 0.0);
-    recipient->updateVar(REPUTATION_STR, new_reputation);
-    if (reputation != new_reputation) {
-      if (reputation == 0.0) {
-        // good -> bad
-        good_rep_num++;
-      } else if (reputation == 1.0) {
-        // bad -> good
-        good_rep_num--;
-      } else {
-        cerr << "reputation value error: " << reputation << endl;
-        throw "reputation value error";
-      }
+      unregistered_metrics.emplace_back(
+          new RunMetrics("", norm_id, replica, step_num, 0));
+      metrics.push_back(unregistered_metrics.back().get());
+    }
+    metrics_guards.emplace_back(new RunMetricsGuard(metrics.back()));
+    outputs.emplace_back(new RunOutput(
+        log_file_paths.back(), log_file_stem + ".summary.json", is_binary_log,
+        has_trajectory, has_summary, column_names, column_types, population,
+        step_num, summary_tail, summary_log_points, summary_buckets, nullptr,
+        metrics.back()));
+    gen_coop_rates.push_back(RandomStream::derive(seed, norm_id, replica,
+                                                  RandomPurpose::COOP_RATE));
+  }
+  auto writeLogs = [&](int log_step_id) {
+    for (size_t k = 0; k < replicas.size(); k++) {
+      outputs[k]->writeStatistics(
+          lockstep.syncLane(replicas[k] - first_replica), donor_strategies,
+          recipient_strategies, log_step_id, coop_action_id,
+          coop_rate_samples, gen_coop_rates[k]);
     }
+  };
 
+  writeLogs(0);
+  for (int step = 0; step < step_num; step++) {
+    if (stop_requested.load(std::memory_order_relaxed)) {
+      for (RunMetrics* lane_metrics : metrics) {
+        lane_metrics->setState(RunState::STOPPED);
+      }
+      return false;
+    }
+    lockstep.step();
+    for (RunMetrics* lane_metrics : metrics) {
+      lane_metrics->setStepsDone(step + 1);
+    }
     if (step % log_step == 0) {
-      // generate log
-      out.print("{}\n",
-                printStatistics(donors, recipients, donor_strategies,
-                                recipient_strategies, strategy_name2donor_id,
-                                strategy_name2recipient_id, population, step + 1,
-                                false, good_rep_num));
+      writeLogs(step + 1);
     }
   }
+  for (size_t k = 0; k < replicas.size(); k++) {
+    json::value result = jvs[k];
+    json::object termination;
+    termination["reason"] = "completed";
+    termination["step"] = step_num;
+    result.as_object()["termination"] = termination;
+    updateLogJson(log_file_paths[k], result, log_file_ext);
+    outputs[k]->writeSummary();
+    metrics[k]->setState(RunState::DONE);
+  }
+  return true;
+}
+
+/**
+ * @brief the "name=value" lines of the params of a checkpoint
+ *
+ * @param checkpoint
+ * @return map<string, string>
+ */
+map<string, string> getCheckpointParams(Checkpoint const& checkpoint) {
+  map<string, string> params;
+  std::istringstream lines(checkpoint.params);
+  string line;
+  while (std::getline(lines, line)) {
+    size_t pos = line.find('=');
+    if (pos != string::npos) {
+      params[line.substr(0, pos)] = line.substr(pos + 1);
+    }
+  }
+  return params;
 }
 
 DEFINE_int32(stepNum, 1000, "the number of steps");
@@ -710,15 +919,351 @@ DEFINE_double(c, 1, "the parameter of payoff matrix");
 DEFINE_double(gamma, 1, "the parameter of payoff matrix");
 DEFINE_double(mu, 0.0001, "the probability of mutation");
 // DEFINE_int32(normId, 10, "the id of norm");
-DEFINE_int32(updateStepNum, 1, "the number of steps to update strategy");
 DEFINE_double(p0, 1, "the probability of good reputation");
 DEFINE_int32(logStep, 1, "the number of steps to log");
+DEFINE_int32(coopRateSamples, 0,
+             "the number of sampled games to estimate the cooperation rate, 0 "
+             "means the exact cooperation rate");
+DEFINE_string(logFormat, "csv",
+              "the format of the log file, csv or binary (read it by "
+              "reputation_effects_dump)");
+DEFINE_uint64(seed, 0,
+              "the global seed of all random streams, 0 means a time-based "
+              "seed, the seed used is recorded in the json file");
+DEFINE_string(mode, "agent",
+              "agent: the stochastic simulation of the population, "
+              "replicator: the deterministic mean-field equations solved by "
+              "an adaptive Runge-Kutta method, the same log, "
+              "rare: the stationary distribution of the embedded chain of the "
+              "limit of small mu, one log row of the long-run averages");
+DEFINE_string(updateMode, "async",
+              "the update of the agent mode, async: one focal individual per "
+              "step, sync: every individual per generation (population steps) "
+              "against a snapshot of the population, computed in parallel, "
+              "skip: the process of async without visiting the steps that do "
+              "not change the population (rejection-free), well-mixed only, "
+              "batch: the steps of async in batches of population / 64 done "
+              "in parallel against the payoffs of the start of the batch, "
+              "well-mixed only, lockstep: the async process of 8 replicas "
+              "advanced together in vectorized loops (LockstepReplicas), "
+              "replicas 0 to 7 of every norm or the replicas of a sweep, "
+              "well-mixed only, no checkpoints or early stops");
+DEFINE_string(graph, "",
+              "the interaction graph of the agent mode, empty means "
+              "well-mixed: lattice, regular:k, smallworld:k:beta, scalefree:m "
+              "or file:path of an edge list (see InteractionGraph.hpp), one "
+              "graph of --population nodes shared by all runs");
+DEFINE_int32(checkpointSteps, 0,
+             "the agent mode writes a checkpoint next to the log every "
+             "checkpointSteps steps (and on SIGINT or SIGTERM), 0 means only "
+             "on the signals");
+DEFINE_string(resume, "",
+              "continue the runs of a checkpoint (log/*.ckpt) or of all the "
+              "checkpoints of a directory, appending to their logs, the "
+              "params are those of the checkpoints");
+DEFINE_bool(stopOnAbsorption, false,
+            "the agent mode stops when the population is absorbed: mu = 0, "
+            "one strategy pair and the reputations fixed under the norm");
+DEFINE_double(stationarityTolerance, 0,
+              "the agent mode stops when the logged frequencies are "
+              "stationary (MSER-5 warm-up in the first half, 95% batch means "
+              "half width below it, see Stationarity.hpp), 0 disables");
+DEFINE_string(logOutput, "full",
+              "full: every logStep row in the log, summary: only the summary "
+              "of the rows in log/<name>.summary.json (tail mean and "
+              "variance, log-spaced rows, min/max buckets, see "
+              "LogReducer.hpp), both: the log and the summary");
+DEFINE_double(summaryTail, 0.5,
+              "the mean and variance of the summary are over the rows of the "
+              "last summaryTail of stepNum");
+DEFINE_int32(summaryLogPoints, 20,
+             "the log-spaced rows of the summary per decade of steps, 0 for "
+             "none");
+DEFINE_int32(summaryBuckets, 0,
+             "the min and max of every column of the summary in "
+             "summaryBuckets equal intervals of stepNum, 0 for none");
+DEFINE_string(gameCache, "",
+              "the binary cache of the payoff matrix, norm and strategy csv "
+              "files (see GameSpec.hpp), rewritten if the files changed, "
+              "empty for none");
+DEFINE_bool(progress, true,
+            "render the progress of the runs to the terminal, a line per "
+            "running run on a TTY, a line of the totals every 30s otherwise");
+DEFINE_double(metricsInterval, 1,
+              "the seconds between two samples of the run metrics (steps "
+              "done, steps/sec, log bytes, cooperation rate)");
+DEFINE_string(metricsFile, "",
+              "the json status file of the run metrics, rewritten every "
+              "metricsInterval, empty for none");
+DEFINE_int32(metricsPort, 0,
+             "serve the run metrics as Prometheus text on "
+             "127.0.0.1:metricsPort, 0 for none");
 DEFINE_int32(threads, 11, "the number of threads");
 DEFINE_string(payoff_matrix_config_name, "payoffMatrix_longterm_no_norm_error",
               "the name of payoff matrix config");
 // the [start_norm_id, end_norm_id) will be simulated
 DEFINE_int32(start_norm_id, 0, "the start norm id");
 DEFINE_int32(end_norm_id, 16, "the end norm id");
+DEFINE_string(sweep, "",
+              "the sweep spec file (grid, or list if *.csv, see Sweep.hpp), "
+              "its jobs replace the [start_norm_id, end_norm_id) runs");
+
+/**
+ * @brief run the jobs of a sweep by funcLockstep: the jobs that only differ in
+ * the replica and whose replicas are in the same block of LANE_NUM are one
+ * run of the block, with the seed of the job of the first replica of the
+ * block. The blocks are taken in the longest-first order of their jobs
+ *
+ * @param jobs
+ * @param order the jobs to run, longest first
+ * @param seed the global seed
+ * @param manifest
+ * @param arena
+ * @param metrics_registry
+ */
+void runSweepLockstep(vector<SweepJob> const& jobs, vector<int> const& order,
+                      uint64_t seed, SweepManifest& manifest,
+                      tbb::task_arena& arena,
+                      MetricsRegistry* metrics_registry) {
+  const int lane_num = LockstepReplicas::LANE_NUM;
+  vector<SweepJob> blocks;      //< the job of the first replica of the block
+  vector<vector<int>> block_jobs;  //< block -> the jobs to run
+  map<string, int> block_ids;   //< the key of the first job -> block
+  for (int job_id : order) {
+    SweepJob block = jobs[job_id];
+    block.replica = block.replica / lane_num * lane_num;
+    block.key = getSweepJobKey(block);
+    auto it = block_ids.find(block.key);
+    if (it == block_ids.end()) {
+      block.seed = getSweepJobSeed(block, seed);
+      block_ids[block.key] = blocks.size();
+      blocks.push_back(block);
+      block_jobs.push_back({job_id});
+    } else {
+      block_jobs[it->second].push_back(job_id);
+    }
+  }
+  cout << "lockstep: " << blocks.size() << " blocks" << endl;
+
+  std::atomic<int> next_block{0};
+  std::atomic<int> done_job_num{0};
+  std::mutex print_mtx;
+  arena.execute([&]() {
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, blocks.size(), 1),
+        [&](tbb::blocked_range<int> const& range) {
+          for (int i = range.begin(); i != range.end(); i++) {
+            const int block_id = next_block++;
+            const SweepJob& block = blocks[block_id];
+            vector<int> replicas;
+            for (int job_id : block_jobs[block_id]) {
+              replicas.push_back(jobs[job_id].replica);
+            }
+            bool completed = funcLockstep(
+                block.stepNum, block.population, block.s, block.b, block.beta,
+                block.c, block.gamma, block.mu, block.normId, block.p0,
+                block.payoffMatrix, metrics_registry, FLAGS_logStep,
+                FLAGS_coopRateSamples, FLAGS_logFormat, block.seed, replicas,
+                FLAGS_logOutput, FLAGS_summaryTail, FLAGS_summaryLogPoints,
+                FLAGS_summaryBuckets);
+            if (!completed) {
+              continue;
+            }
+            std::lock_guard<std::mutex> lock(print_mtx);
+            for (int job_id : block_jobs[block_id]) {
+              manifest.markDone(jobs[job_id].key);
+              cout << "[" << ++done_job_num << "/" << order.size() << "] "
+                   << jobs[job_id].key << endl;
+            }
+          }
+        },
+        tbb::simple_partitioner());
+  });
+}
+
+/**
+ * @brief run the jobs of the sweep spec which are not in the manifest
+ * (spec_path + ".done"), every worker of the arena takes the longest job
+ * left
+ *
+ * @param spec_path
+ * @param seed the global seed
+ * @param arena
+ * @param graph the interaction graph of all jobs, nullptr if well-mixed
+ * @param metrics_registry
+ */
+void runSweep(string const& spec_path, uint64_t seed, tbb::task_arena& arena,
+              const InteractionGraph* graph,
+              MetricsRegistry* metrics_registry) {
+  SweepJob default_job;
+  default_job.normId = FLAGS_start_norm_id;
+  default_job.stepNum = FLAGS_stepNum;
+  default_job.population = FLAGS_population;
+  default_job.s = FLAGS_s;
+  default_job.b = FLAGS_b;
+  default_job.beta = FLAGS_beta;
+  default_job.c = FLAGS_c;
+  default_job.gamma = FLAGS_gamma;
+  default_job.mu = FLAGS_mu;
+  default_job.p0 = FLAGS_p0;
+  default_job.payoffMatrix = FLAGS_payoff_matrix_config_name;
+  vector<SweepJob> jobs = expandSweepSpec(spec_path, default_job, seed);
+
+  SweepManifest manifest(spec_path + ".done");
+  vector<int> order;
+  for (int job_id : getSweepOrder(jobs)) {
+    if (jobs[job_id].population < 2) {
+      cerr << "population must be at least 2: " << jobs[job_id].key << endl;
+      throw "population must be at least 2";
+    }
+    if (graph != nullptr && jobs[job_id].population != graph->getNodeNum()) {
+      cerr << "population must be the node number of the graph: "
+           << jobs[job_id].key << endl;
+      throw "population must be the node number of the graph";
+    }
+    if (!manifest.isDone(jobs[job_id].key)) {
+      order.push_back(job_id);
+    }
+  }
+  cout << "sweep: " << jobs.size() << " jobs, "
+       << jobs.size() - order.size() << " done before" << endl;
+  if (FLAGS_updateMode == "lockstep") {
+    runSweepLockstep(jobs, order, seed, manifest, arena, metrics_registry);
+    return;
+  }
+
+  // the jobs stopped by a signal continue from their checkpoints in ./log
+  map<string, string> checkpoint_paths;  //< job key + seed -> checkpoint
+  if (filesystem::is_directory("./log")) {
+    for (const filesystem::directory_entry& entry :
+         filesystem::directory_iterator("./log")) {
+      if (entry.path().extension() != ".ckpt") {
+        continue;
+      }
+      map<string, string> params =
+          getCheckpointParams(readCheckpoint(entry.path().string()));
+      SweepJob job;
+      for (const char* name :
+           {"normId", "stepNum", "population", "s", "b", "beta", "c", "gamma",
+            "mu", "p0", "payoffMatrix", "replica"}) {
+        setSweepJobParam(job, name, params[name]);
+      }
+      checkpoint_paths[getSweepJobKey(job) + "," + params["seed"]] =
+          entry.path().string();
+    }
+  }
+
+  // the iterations are distributed by work stealing, but each of them claims
+  // the next job of the longest-first order, so long jobs never wait behind
+  // short ones
+  std::atomic<int> next_job{0};
+  std::atomic<int> done_job_num{0};
+  std::mutex print_mtx;
+  arena.execute([&]() {
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, order.size(), 1),
+        [&](tbb::blocked_range<int> const& range) {
+          for (int i = range.begin(); i != range.end(); i++) {
+            const SweepJob& job = jobs[order[next_job++]];
+            auto it = checkpoint_paths.find(job.key + "," +
+                                            std::to_string(job.seed));
+            std::unique_ptr<Checkpoint> checkpoint;
+            if (it != checkpoint_paths.end()) {
+              checkpoint.reset(new Checkpoint(readCheckpoint(it->second)));
+            }
+            bool completed =
+                func(job.stepNum, job.population, job.s, job.b, job.beta,
+                     job.c, job.gamma, job.mu, job.normId, job.p0,
+                     job.payoffMatrix, metrics_registry,
+                     FLAGS_logStep, FLAGS_coopRateSamples, FLAGS_logFormat,
+                     job.seed, job.replica, FLAGS_mode, FLAGS_updateMode,
+                     graph, seed, FLAGS_checkpointSteps, checkpoint.get(),
+                     FLAGS_stopOnAbsorption, FLAGS_stationarityTolerance,
+                     FLAGS_logOutput, FLAGS_summaryTail, FLAGS_summaryLogPoints,
+                     FLAGS_summaryBuckets);
+            if (!completed) {
+              continue;
+            }
+            manifest.markDone(job.key);
+            std::lock_guard<std::mutex> lock(print_mtx);
+            cout << "[" << ++done_job_num << "/" << order.size() << "] "
+                 << job.key << endl;
+          }
+        },
+        tbb::simple_partitioner());
+  });
+}
+
+/**
+ * @brief continue the runs of the checkpoints in parallel, resume_path is a
+ * checkpoint or a directory whose *.ckpt files are all resumed. The graphs
+ * are generated again from their specs and seeds, once per distinct graph
+ *
+ * @param resume_path
+ * @param arena
+ * @param metrics_registry
+ */
+void runResume(string const& resume_path, tbb::task_arena& arena,
+               MetricsRegistry* metrics_registry) {
+  vector<string> paths;
+  if (filesystem::is_directory(resume_path)) {
+    for (const filesystem::directory_entry& entry :
+         filesystem::directory_iterator(resume_path)) {
+      if (entry.path().extension() == ".ckpt") {
+        paths.push_back(entry.path().string());
+      }
+    }
+    std::sort(paths.begin(), paths.end());
+  } else {
+    paths.push_back(resume_path);
+  }
+
+  vector<Checkpoint> checkpoints;
+  vector<map<string, string>> params;
+  map<string, std::unique_ptr<InteractionGraph>> graphs;
+  for (string const& path : paths) {
+    checkpoints.push_back(readCheckpoint(path));
+    map<string, string> param = getCheckpointParams(checkpoints.back());
+    string graph_key = param["graph"] + "|" + param["graphSeed"] + "|" +
+                       param["population"];
+    if (!param["graph"].empty() && graphs.count(graph_key) == 0) {
+      RandomStream gen_graph = RandomStream::derive(
+          std::stoull(param["graphSeed"]), 0, 0, RandomPurpose::GRAPH);
+      graphs[graph_key].reset(new InteractionGraph(InteractionGraph::create(
+          param["graph"], std::stoi(param["population"]), gen_graph)));
+    }
+    params.push_back(param);
+    cout << "resume: " << path << " at step " << checkpoints.back().step
+         << endl;
+  }
+
+  arena.execute([&]() {
+    tbb::parallel_for(0, static_cast<int>(paths.size()), [&](int i) {
+      map<string, string>& param = params[i];
+      string graph_key = param["graph"] + "|" + param["graphSeed"] + "|" +
+                         param["population"];
+      const InteractionGraph* graph =
+          param["graph"].empty() ? nullptr : graphs[graph_key].get();
+      func(std::stoi(param["stepNum"]), std::stoi(param["population"]),
+           std::stod(param["s"]), std::stod(param["b"]),
+           std::stod(param["beta"]), std::stod(param["c"]),
+           std::stod(param["gamma"]), std::stod(param["mu"]),
+           std::stoi(param["normId"]), std::stod(param["p0"]),
+           param["payoffMatrix"], metrics_registry,
+           std::stoi(param["logStep"]),
+           std::stoi(param["coopRateSamples"]), param["logFormat"],
+           std::stoull(param["seed"]), std::stoi(param["replica"]),
+           param["mode"], param["updateMode"], graph,
+           std::stoull(param["graphSeed"]),
+           std::stoi(param["checkpointSteps"]), &checkpoints[i],
+           param["stopOnAbsorption"] == "1",
+           std::stod(param["stationarityTolerance"]), param["logOutput"],
+           std::stod(param["summaryTail"]),
+           std::stoi(param["summaryLogPoints"]),
+           std::stoi(param["summaryBuckets"]));
+    });
+  });
+}
 
 int main(int argc, char** argv) {
   gflags::SetUsageMessage(
@@ -738,70 +1283,134 @@ int main(int argc, char** argv) {
 
   // record the running time
   system_clock::time_point start = chrono::system_clock::now();
-  // conform the number of threads is 1 <= threads <= 16
-  if (FLAGS_threads < 1 || FLAGS_threads > 16) {
-    cerr << "threads must be 1 <= threads <= 16" << endl;
+  if (FLAGS_threads < 1) {
+    cerr << "threads must be >= 1" << endl;
     return 0;
   }
   tbb::task_arena arena(FLAGS_threads);
+  // the lanes of lockstep have no checkpoints and no early stops
+  if (FLAGS_updateMode == "lockstep" &&
+      (FLAGS_mode != "agent" || !FLAGS_graph.empty() ||
+       FLAGS_checkpointSteps > 0 || !FLAGS_resume.empty() ||
+       FLAGS_stopOnAbsorption || FLAGS_stationarityTolerance > 0)) {
+    cerr << "updateMode lockstep needs mode agent, a well-mixed population "
+            "and no checkpointSteps, resume, stopOnAbsorption or "
+            "stationarityTolerance"
+         << endl;
+    return 0;
+  }
 
-  // the macro can help to create multiple progress bars quickly
-  CREATE_BAR(0);
-  CREATE_BAR(1);
-  CREATE_BAR(2);
-  CREATE_BAR(3);
-  CREATE_BAR(4);
-  CREATE_BAR(5);
-  CREATE_BAR(6);
-  CREATE_BAR(7);
-  CREATE_BAR(8);
-  CREATE_BAR(9);
-  CREATE_BAR(10);
-  CREATE_BAR(11);
-  CREATE_BAR(12);
-  CREATE_BAR(13);
-  CREATE_BAR(14);
-  CREATE_BAR(15);
-  DynamicProgress<ProgressBar> bars(bar0, bar1, bar2, bar3, bar4, bar5, bar6,
-                                    bar7, bar8, bar9, bar10, bar11, bar12,
-                                    bar13, bar14, bar15);
-
-  // Because the same number of strategy pairs is set during initialization,
-  // population must be a multiple of 16 (4 * 4)
-  if (FLAGS_population % 16 != 0) {
-    cerr << "population must be a multiple of 16" << endl;
+  // every run derives its streams from the same seed, so the result does not
+  // depend on the number of threads
+  uint64_t seed = FLAGS_seed;
+  if (seed == 0) {
+    seed = system_clock::now().time_since_epoch().count();
+  }
+  RandomStream::setDefaultSeed(seed);
+  cout << "seed: " << seed << endl;
+
+  // the game files are parsed and validated once, before any run, and shared
+  // by all of them
+  std::shared_ptr<const GameSpec> game_spec =
+      std::make_shared<const GameSpec>(".", FLAGS_gameCache);
+  GameSpec::setDefault(game_spec);
+  cout << "game files: " << game_spec->getFileNum() << endl;
+
+  // the runs stop at the next step and write a checkpoint
+  std::signal(SIGINT, handleStopSignal);
+  std::signal(SIGTERM, handleStopSignal);
+
+  // the runs register their metrics, the reporter thread renders them
+  MetricsRegistry metrics_registry;
+  MetricsReporter reporter(metrics_registry, FLAGS_metricsInterval,
+                           FLAGS_progress, FLAGS_metricsFile,
+                           FLAGS_metricsPort);
+  reporter.start();
+
+  if (!FLAGS_resume.empty()) {
+    runResume(FLAGS_resume, arena, &metrics_registry);
+    reporter.stop();
+    if (stop_requested.load()) {
+      cout << "\nstopped, continue with --resume ./log" << endl;
+    }
+    system_clock::time_point end = system_clock::now();
+    cout << "\ntime: "
+         << duration_cast<microseconds>(end - start).count() / 1e6 << "s"
+         << endl;
     return 0;
   }
 
-  show_console_cursor(false);
+  // the graph is generated once from the global seed, so all the runs (norms)
+  // are compared on the same graph
+  std::unique_ptr<InteractionGraph> graph;
+  if (!FLAGS_graph.empty()) {
+    RandomStream gen_graph =
+        RandomStream::derive(seed, 0, 0, RandomPurpose::GRAPH);
+    graph.reset(new InteractionGraph(
+        InteractionGraph::create(FLAGS_graph, FLAGS_population, gen_graph)));
+    cout << "graph: " << graph->getSpec() << ", " << graph->getNodeNum()
+         << " nodes, " << graph->getEdgeNum() << " edges" << endl;
+  }
 
-  // // for debug
-  // CREATE_BAR(100);
-  // ProgressBar *bar100_ptr = &bar100;
-  // func(stepNum, population, s, b, beta, c, gamma, mu, normId, updateStepNum,
-  // p0, bar100_ptr, true);
-  // // func(stepNum, population, s, b, beta, c, gamma, mu, normId,
-  // updateStepNum);
+  if (!FLAGS_sweep.empty()) {
+    runSweep(FLAGS_sweep, seed, arena, graph.get(), &metrics_registry);
+    reporter.stop();
+    if (stop_requested.load()) {
+      cout << "\nstopped, run the same sweep again to continue" << endl;
+    }
+    system_clock::time_point end = system_clock::now();
+    cout << "\ntime: "
+         << duration_cast<microseconds>(end - start).count() / 1e6 << "s"
+         << endl;
+    return 0;
+  }
+
+  // the average payoff is over the population - 1 others
+  if (FLAGS_population < 2) {
+    cerr << "population must be at least 2" << endl;
+    return 0;
+  }
 
   // multithread
-  arena.execute([&]() {
-    // int start = 1000000;
-    // int end = 1000012;
-    // tbb::parallel_for(start, end, [&](int stepNum) {
-    //   func(stepNum, population, s, b, beta, c, gamma, mu, normId,
-    //   updateStepNum,
-    //        p0, nullptr, false, &bars, true, stepNum - start);
-    // });
-
-    tbb::parallel_for(FLAGS_start_norm_id, FLAGS_end_norm_id, [&](int normId) {
-      func(FLAGS_stepNum, FLAGS_population, FLAGS_s, FLAGS_b, FLAGS_beta,
-           FLAGS_c, FLAGS_gamma, FLAGS_mu, normId, FLAGS_updateStepNum,
-           FLAGS_p0, FLAGS_payoff_matrix_config_name, nullptr, false, &bars,
-           true, normId, FLAGS_logStep);
+  if (FLAGS_updateMode == "lockstep") {
+    // the first block of replicas of every norm
+    vector<int> replicas(LockstepReplicas::LANE_NUM);
+    std::iota(replicas.begin(), replicas.end(), 0);
+    arena.execute([&]() {
+      tbb::parallel_for(FLAGS_start_norm_id, FLAGS_end_norm_id, [&](int normId) {
+        funcLockstep(FLAGS_stepNum, FLAGS_population, FLAGS_s, FLAGS_b,
+                     FLAGS_beta, FLAGS_c, FLAGS_gamma, FLAGS_mu, normId,
+                     FLAGS_p0, FLAGS_payoff_matrix_config_name,
+                     &metrics_registry, FLAGS_logStep, FLAGS_coopRateSamples,
+                     FLAGS_logFormat, seed, replicas, FLAGS_logOutput,
+                     FLAGS_summaryTail, FLAGS_summaryLogPoints,
+                     FLAGS_summaryBuckets);
+      });
     });
-  });
+  } else {
+    arena.execute([&]() {
+      tbb::parallel_for(FLAGS_start_norm_id, FLAGS_end_norm_id, [&](int normId) {
+        func(FLAGS_stepNum, FLAGS_population, FLAGS_s, FLAGS_b, FLAGS_beta,
+             FLAGS_c, FLAGS_gamma, FLAGS_mu, normId, FLAGS_p0,
+             FLAGS_payoff_matrix_config_name, &metrics_registry,
+             FLAGS_logStep, FLAGS_coopRateSamples,
+             FLAGS_logFormat, seed, 0, FLAGS_mode, FLAGS_updateMode,
+             graph.get(), seed, FLAGS_checkpointSteps, nullptr,
+             FLAGS_stopOnAbsorption, FLAGS_stationarityTolerance,
+             FLAGS_logOutput, FLAGS_summaryTail, FLAGS_summaryLogPoints,
+             FLAGS_summaryBuckets);
+      });
+    });
+  }
 
-  show_console_cursor(true);
+  reporter.stop();
+  if (stop_requested.load()) {
+    // the lockstep blocks have no checkpoints
+    cout << (FLAGS_updateMode == "lockstep"
+                 ? "\nstopped"
+                 : "\nstopped, continue with --resume ./log")
+         << endl;
+  }
   system_clock::time_point end = system_clock::now();
   cout << "\ntime: " << duration_cast<microseconds>(end - start).count() / 1e6
        << "s" << endl;
@@ -0,0 +1,387 @@
+#include "BinaryLog.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+const char HEADER_MAGIC[8] = {'R', 'E', 'P', 'L', 'O', 'G', '0', '1'};
+const char INDEX_MAGIC[8] = {'R', 'E', 'P', 'L', 'O', 'G', 'I', 'X'};
+const uint32_t CHUNK_MAGIC = 0x4b4e4843;  // "CHNK"
+const uint32_t VERSION = 2;
+
+template <typename T>
+void writeValue(std::ofstream& file, T value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::ifstream& file, T& value) {
+  file.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return file.gcount() == sizeof(T);
+}
+}  // namespace
+
+/**
+ * @brief create the file and write the header
+ *
+ * @param path
+ * @param columnNames the same names as the csv header, the first column is
+ * the step
+ * @param columnTypes
+ * @param population the denominator of the COUNT columns in csv
+ * @param rowsPerChunk the number of rows buffered before a chunk is written
+ */
+BinaryLogWriter::BinaryLogWriter(
+    std::string const& path, std::vector<std::string> const& columnNames,
+    std::vector<BinaryLogColumnType> const& columnTypes, double population,
+    uint32_t rowsPerChunk)
+    : file(path, std::ios::binary | std::ios::trunc),
+      columnNames(columnNames),
+      columnTypes(columnTypes),
+      rowsPerChunk(rowsPerChunk),
+      chunkBuffer(columnNames.size() * rowsPerChunk, 0),
+      stepBuffer(rowsPerChunk, 0),
+      chunkRowNum(0),
+      chunkFirstStep(0),
+      closed(false) {
+  if (!this->file) {
+    std::cerr << "can not open the binary log: " << path << std::endl;
+    throw "can not open the binary log";
+  }
+  if (columnNames.empty() || columnNames.size() != columnTypes.size() ||
+      rowsPerChunk == 0) {
+    std::cerr << "column names and column types do not match" << std::endl;
+    throw "column names and column types do not match";
+  }
+  this->file.write(HEADER_MAGIC, sizeof(HEADER_MAGIC));
+  writeValue<uint32_t>(this->file, VERSION);
+  writeValue<uint32_t>(this->file, columnNames.size());
+  writeValue<uint32_t>(this->file, rowsPerChunk);
+  writeValue<uint32_t>(this->file, 0);
+  writeValue<double>(this->file, population);
+  for (size_t col = 0; col < columnNames.size(); col++) {
+    writeValue<uint8_t>(this->file, static_cast<uint8_t>(columnTypes[col]));
+    writeValue<uint16_t>(this->file, columnNames[col].size());
+    this->file.write(columnNames[col].data(), columnNames[col].size());
+  }
+}
+
+/**
+ * @brief reopen the log of a resumed run, the file is truncated to offset (the
+ * end of the last chunk written before the checkpoint, see getOffset()) and
+ * the next rows are appended after it
+ *
+ * @param path
+ * @param offset
+ */
+BinaryLogWriter::BinaryLogWriter(std::string const& path, uint64_t offset)
+    : chunkRowNum(0), chunkFirstStep(0), closed(false) {
+  if (!std::filesystem::exists(path) ||
+      std::filesystem::file_size(path) < offset) {
+    std::cerr << "can not resume the binary log: " << path << std::endl;
+    throw "can not resume the binary log";
+  }
+  std::filesystem::resize_file(path, offset);
+  {
+    // without the index, the reader scans the chunks
+    BinaryLogReader reader(path);
+    this->columnNames = reader.getColumnNames();
+    this->columnTypes = reader.getColumnTypes();
+    this->rowsPerChunk = reader.getRowsPerChunk();
+    this->index = reader.getIndex();
+  }
+  this->chunkBuffer.assign(this->columnNames.size() * this->rowsPerChunk, 0);
+  this->stepBuffer.assign(this->rowsPerChunk, 0);
+  this->file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+  if (!this->file) {
+    std::cerr << "can not open the binary log: " << path << std::endl;
+    throw "can not open the binary log";
+  }
+  this->file.seekp(offset);
+}
+
+BinaryLogWriter::~BinaryLogWriter() { this->close(); }
+
+/**
+ * @brief append one row, the chunk is written when it is full
+ *
+ * @param step the step of the row, written instead of the first column
+ * @param values columnNum 4-byte values, FLOAT32 columns are encoded by
+ * encodeFloat(), values[0] is not read
+ */
+void BinaryLogWriter::writeRow(uint64_t step, const uint32_t* values) {
+  if (this->chunkRowNum == 0) {
+    this->chunkFirstStep = step;
+  }
+  this->stepBuffer[this->chunkRowNum] = step;
+  for (size_t col = 1; col < this->columnNames.size(); col++) {
+    this->chunkBuffer[col * this->rowsPerChunk + this->chunkRowNum] =
+        values[col];
+  }
+  this->chunkRowNum++;
+  if (this->chunkRowNum == this->rowsPerChunk) {
+    this->flushChunk();
+  }
+}
+
+void BinaryLogWriter::flushChunk() {
+  if (this->chunkRowNum == 0) {
+    return;
+  }
+  BinaryLogChunkIndex entry;
+  entry.offset = static_cast<uint64_t>(this->file.tellp());
+  entry.firstStep = this->chunkFirstStep;
+  entry.rowNum = this->chunkRowNum;
+  this->index.push_back(entry);
+
+  writeValue<uint32_t>(this->file, CHUNK_MAGIC);
+  writeValue<uint32_t>(this->file, this->chunkRowNum);
+  writeValue<uint64_t>(this->file, this->chunkFirstStep);
+  this->file.write(reinterpret_cast<const char*>(this->stepBuffer.data()),
+                   this->chunkRowNum * sizeof(uint64_t));
+  for (size_t col = 1; col < this->columnNames.size(); col++) {
+    this->file.write(reinterpret_cast<const char*>(
+                         &this->chunkBuffer[col * this->rowsPerChunk]),
+                     this->chunkRowNum * sizeof(uint32_t));
+  }
+  // a killed process still leaves the complete chunks on disk
+  this->file.flush();
+  this->chunkRowNum = 0;
+}
+
+/**
+ * @brief write the rows buffered so far as a (possibly short) chunk
+ *
+ */
+void BinaryLogWriter::flush() { this->flushChunk(); }
+
+/**
+ * @brief the size of the file after the last chunk, call flush() first to
+ * include the buffered rows
+ *
+ * @return uint64_t
+ */
+uint64_t BinaryLogWriter::getOffset() {
+  return static_cast<uint64_t>(this->file.tellp());
+}
+
+/**
+ * @brief write the last chunk and the index, called by the destructor
+ *
+ */
+void BinaryLogWriter::close() {
+  if (this->closed) {
+    return;
+  }
+  this->flushChunk();
+  uint64_t indexOffset = static_cast<uint64_t>(this->file.tellp());
+  for (BinaryLogChunkIndex const& entry : this->index) {
+    writeValue<uint64_t>(this->file, entry.offset);
+    writeValue<uint64_t>(this->file, entry.firstStep);
+    writeValue<uint32_t>(this->file, entry.rowNum);
+  }
+  writeValue<uint64_t>(this->file, this->index.size());
+  writeValue<uint64_t>(this->file, indexOffset);
+  this->file.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  this->file.close();
+  this->closed = true;
+}
+
+uint32_t BinaryLogWriter::encodeFloat(float value) {
+  uint32_t res;
+  std::memcpy(&res, &value, sizeof(res));
+  return res;
+}
+
+float BinaryLogWriter::decodeFloat(uint32_t value) {
+  float res;
+  std::memcpy(&res, &value, sizeof(res));
+  return res;
+}
+
+/**
+ * @brief open the file, read the header and the chunk index
+ *
+ * @param path
+ */
+BinaryLogReader::BinaryLogReader(std::string const& path)
+    : file(path, std::ios::binary) {
+  if (!this->file) {
+    std::cerr << "can not open the binary log: " << path << std::endl;
+    throw "can not open the binary log";
+  }
+  char magic[8];
+  this->file.read(magic, sizeof(magic));
+  uint32_t version = 0;
+  uint32_t columnNum = 0;
+  uint32_t reserved = 0;
+  if (this->file.gcount() != sizeof(magic) ||
+      std::memcmp(magic, HEADER_MAGIC, sizeof(magic)) != 0 ||
+      !readValue(this->file, version) || version != VERSION ||
+      !readValue(this->file, columnNum) || columnNum == 0 ||
+      !readValue(this->file, this->rowsPerChunk) ||
+      !readValue(this->file, reserved) ||
+      !readValue(this->file, this->population)) {
+    std::cerr << "not a binary log: " << path << std::endl;
+    throw "not a binary log";
+  }
+  for (uint32_t col = 0; col < columnNum; col++) {
+    uint8_t type;
+    uint16_t nameLen;
+    if (!readValue(this->file, type) || !readValue(this->file, nameLen)) {
+      std::cerr << "broken binary log header: " << path << std::endl;
+      throw "broken binary log header";
+    }
+    std::string name(nameLen, '\0');
+    this->file.read(&name[0], nameLen);
+    this->columnTypes.push_back(static_cast<BinaryLogColumnType>(type));
+    this->columnNames.push_back(name);
+  }
+  this->loadIndex();
+}
+
+BinaryLogReader::~BinaryLogReader() {}
+
+/**
+ * @brief read the index at the end of the file, or rebuild it by scanning the
+ * chunks if the writer did not close the file
+ *
+ */
+void BinaryLogReader::loadIndex() {
+  uint64_t dataBegin = static_cast<uint64_t>(this->file.tellg());
+  this->file.seekg(0, std::ios::end);
+  uint64_t fileSize = static_cast<uint64_t>(this->file.tellg());
+  const uint64_t footerSize = 2 * sizeof(uint64_t) + sizeof(INDEX_MAGIC);
+  if (fileSize >= dataBegin + footerSize) {
+    uint64_t chunkNum = 0;
+    uint64_t indexOffset = 0;
+    char magic[8];
+    this->file.seekg(fileSize - footerSize);
+    readValue(this->file, chunkNum);
+    readValue(this->file, indexOffset);
+    this->file.read(magic, sizeof(magic));
+    if (std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) == 0) {
+      this->file.seekg(indexOffset);
+      for (uint64_t i = 0; i < chunkNum; i++) {
+        BinaryLogChunkIndex entry;
+        readValue(this->file, entry.offset);
+        readValue(this->file, entry.firstStep);
+        readValue(this->file, entry.rowNum);
+        this->index.push_back(entry);
+      }
+      return;
+    }
+  }
+  // no index, scan the chunks and drop the last incomplete one
+  const uint64_t chunkHeaderSize = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+  uint64_t offset = dataBegin;
+  while (offset + chunkHeaderSize <= fileSize) {
+    uint32_t chunkMagic = 0;
+    BinaryLogChunkIndex entry;
+    entry.offset = offset;
+    this->file.clear();
+    this->file.seekg(offset);
+    readValue(this->file, chunkMagic);
+    readValue(this->file, entry.rowNum);
+    readValue(this->file, entry.firstStep);
+    uint64_t chunkSize =
+        chunkHeaderSize +
+        static_cast<uint64_t>(entry.rowNum) *
+            (sizeof(uint64_t) +
+             (this->columnNames.size() - 1) * sizeof(uint32_t));
+    if (chunkMagic != CHUNK_MAGIC || offset + chunkSize > fileSize) {
+      break;
+    }
+    this->index.push_back(entry);
+    offset += chunkSize;
+  }
+  this->file.clear();
+}
+
+/**
+ * @brief call the callback for each row whose step is in [stepBegin, stepEnd),
+ * only the chunks overlapping the range are read
+ *
+ * @param stepBegin
+ * @param stepEnd
+ * @param callback receives the step and the columnNum values of one row,
+ * row[0] is the step truncated to 32 bits
+ */
+void BinaryLogReader::readRows(
+    uint64_t stepBegin, uint64_t stepEnd,
+    std::function<void(uint64_t step, const uint32_t* row)> const& callback) {
+  // the first chunk which may contain stepBegin
+  auto it = std::upper_bound(this->index.begin(), this->index.end(), stepBegin,
+                             [](uint64_t step, BinaryLogChunkIndex const& e) {
+                               return step < e.firstStep;
+                             });
+  if (it != this->index.begin()) {
+    it--;
+  }
+  size_t columnNum = this->columnNames.size();
+  std::vector<uint64_t> steps;
+  std::vector<uint32_t> chunk;
+  std::vector<uint32_t> row(columnNum);
+  for (; it != this->index.end() && it->firstStep < stepEnd; it++) {
+    steps.resize(it->rowNum);
+    chunk.resize((columnNum - 1) * it->rowNum);
+    this->file.clear();
+    this->file.seekg(it->offset + 2 * sizeof(uint32_t) + sizeof(uint64_t));
+    this->file.read(reinterpret_cast<char*>(steps.data()),
+                    steps.size() * sizeof(uint64_t));
+    this->file.read(reinterpret_cast<char*>(chunk.data()),
+                    chunk.size() * sizeof(uint32_t));
+    for (uint32_t r = 0; r < it->rowNum; r++) {
+      uint64_t step = steps[r];
+      if (step < stepBegin || step >= stepEnd) {
+        continue;
+      }
+      row[0] = static_cast<uint32_t>(step);
+      for (size_t col = 1; col < columnNum; col++) {
+        row[col] = chunk[(col - 1) * it->rowNum + r];
+      }
+      callback(step, row.data());
+    }
+  }
+}
+
+std::string BinaryLogReader::formatCsvHeader() const {
+  std::string line;
+  for (size_t col = 0; col < this->columnNames.size(); col++) {
+    if (col > 0) {
+      line += ",";
+    }
+    line += this->columnNames[col];
+  }
+  return line;
+}
+
+/**
+ * @brief format the row in the same way as printStatistics
+ *
+ * @param step the step of the row, printed as the first column
+ * @param row
+ * @return std::string
+ */
+std::string BinaryLogReader::formatCsvRow(uint64_t step,
+                                          const uint32_t* row) const {
+  std::string line = std::to_string(step);
+  for (size_t col = 1; col < this->columnNames.size(); col++) {
+    line += ",";
+    switch (this->columnTypes[col]) {
+      case BinaryLogColumnType::UINT32:
+        line += std::to_string(row[col]);
+        break;
+      case BinaryLogColumnType::COUNT:
+        line += std::to_string(row[col] / this->population);
+        break;
+      case BinaryLogColumnType::FLOAT32:
+        line += std::to_string(
+            static_cast<double>(BinaryLogWriter::decodeFloat(row[col])));
+        break;
+    }
+  }
+  return line;
+}
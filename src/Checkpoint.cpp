@@ -0,0 +1,228 @@
+#include "Checkpoint.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+const char HEADER_MAGIC[8] = {'R', 'E', 'P', 'C', 'K', 'P', 'T', '1'};
+const char END_MAGIC[8] = {'R', 'E', 'P', 'C', 'K', 'E', 'N', 'D'};
+const uint32_t VERSION = 1;
+
+template <typename T>
+void writeValue(std::ofstream& file, T value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void writeArray(std::ofstream& file, std::vector<T> const& values) {
+  file.write(reinterpret_cast<const char*>(values.data()),
+             values.size() * sizeof(T));
+}
+
+void writeString(std::ofstream& file, std::string const& value) {
+  writeValue<uint32_t>(file, value.size());
+  file.write(value.data(), value.size());
+}
+
+/**
+ * @brief flush a file or a directory to the disk
+ *
+ * @param path
+ * @return true if it succeeded
+ */
+bool syncPath(std::string const& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool synced = ::fsync(fd) == 0;
+  ::close(fd);
+  return synced;
+}
+
+/**
+ * @brief a reader that checks every size read from the file against the
+ * bytes left, so a broken checkpoint fails before a large allocation
+ */
+class CheckpointReader {
+ private:
+  std::ifstream& file;
+  std::string const& path;
+  uint64_t fileSize;
+
+ public:
+  CheckpointReader(std::ifstream& file, std::string const& path)
+      : file(file), path(path) {
+    this->file.seekg(0, std::ios::end);
+    this->fileSize = static_cast<uint64_t>(this->file.tellg());
+    this->file.seekg(0);
+  }
+
+  /** @brief throw unless size more bytes follow the read position */
+  void require(uint64_t size) {
+    const std::streamoff pos = this->file.tellg();
+    if (!this->file || pos < 0 ||
+        size > this->fileSize - static_cast<uint64_t>(pos)) {
+      std::cerr << "broken checkpoint: " << this->path << std::endl;
+      throw "broken checkpoint";
+    }
+  }
+
+  template <typename T>
+  void readValue(T& value) {
+    this->file.read(reinterpret_cast<char*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  void readArray(std::vector<T>& values, uint64_t size) {
+    this->require(size * sizeof(T));
+    values.resize(size);
+    this->file.read(reinterpret_cast<char*>(values.data()), size * sizeof(T));
+  }
+
+  void readString(std::string& value) {
+    uint32_t size = 0;
+    this->readValue(size);
+    this->require(size);
+    value.resize(size);
+    this->file.read(&value[0], size);
+  }
+};
+}  // namespace
+
+/**
+ * @brief write the checkpoint atomically, to path + ".tmp" first and then
+ * renamed to path
+ *
+ * @param path
+ * @param checkpoint
+ */
+void writeCheckpoint(std::string const& path, Checkpoint const& checkpoint) {
+  const std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      std::cerr << "can not write the checkpoint: " << tmpPath << std::endl;
+      throw "can not write the checkpoint";
+    }
+    file.write(HEADER_MAGIC, sizeof(HEADER_MAGIC));
+    writeValue<uint32_t>(file, VERSION);
+    writeValue<uint64_t>(file, checkpoint.step);
+    writeValue<uint64_t>(file, checkpoint.generation);
+    writeString(file, checkpoint.params);
+    writeString(file, checkpoint.logPath);
+    writeValue<uint64_t>(file, checkpoint.logOffset);
+    writeValue<uint32_t>(file, checkpoint.population);
+    writeValue<uint8_t>(file, checkpoint.reputationBitNum);
+    writeArray(file, checkpoint.donorStrategyIds);
+    writeArray(file, checkpoint.recipientStrategyIds);
+    writeArray(file, checkpoint.reputationBits);
+    for (const std::vector<int>* counts :
+         {&checkpoint.donorCounts, &checkpoint.recipientCounts}) {
+      writeValue<uint32_t>(file, counts->size());
+      for (int count : *counts) {
+        writeValue<int32_t>(file, count);
+      }
+    }
+    writeValue<int32_t>(file, checkpoint.goodReputationNum);
+    writeValue<uint32_t>(file, checkpoint.streams.size());
+    for (CheckpointStream const& stream : checkpoint.streams) {
+      writeValue<uint64_t>(file, stream.streamId);
+      writeValue<uint64_t>(file, stream.position);
+    }
+    writeString(file, checkpoint.reducerState);
+    file.write(END_MAGIC, sizeof(END_MAGIC));
+    file.close();
+    if (!file) {
+      std::cerr << "can not write the checkpoint: " << tmpPath << std::endl;
+      throw "can not write the checkpoint";
+    }
+  }
+  // the data is on the disk before the rename, and the rename before the
+  // old checkpoint is gone, so a crash leaves one of the two complete
+  if (!syncPath(tmpPath)) {
+    std::cerr << "can not sync the checkpoint: " << tmpPath << std::endl;
+    throw "can not sync the checkpoint";
+  }
+  std::filesystem::rename(tmpPath, path);
+  std::filesystem::path dir = std::filesystem::path(path).parent_path();
+  syncPath(dir.empty() ? "." : dir.string());
+}
+
+/**
+ * @brief read a checkpoint of writeCheckpoint(), a file of another format
+ * version is rejected
+ *
+ * @param path
+ * @return Checkpoint
+ */
+Checkpoint readCheckpoint(std::string const& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "can not open the checkpoint: " << path << std::endl;
+    throw "can not open the checkpoint";
+  }
+  CheckpointReader reader(file, path);
+  Checkpoint checkpoint;
+  char magic[8] = {};
+  uint32_t version = 0;
+  file.read(magic, sizeof(magic));
+  reader.readValue(version);
+  if (!file || std::memcmp(magic, HEADER_MAGIC, sizeof(magic)) != 0 ||
+      version != VERSION) {
+    std::cerr << "not a checkpoint: " << path << std::endl;
+    throw "not a checkpoint";
+  }
+  reader.readValue(checkpoint.step);
+  reader.readValue(checkpoint.generation);
+  reader.readString(checkpoint.params);
+  reader.readString(checkpoint.logPath);
+  reader.readValue(checkpoint.logOffset);
+  uint32_t population = 0;
+  reader.readValue(population);
+  checkpoint.population = population;
+  uint8_t reputationBitNum = 0;
+  reader.readValue(reputationBitNum);
+  if (reputationBitNum == 0 || reputationBitNum > 8 ||
+      (reputationBitNum & (reputationBitNum - 1)) != 0) {
+    std::cerr << "broken checkpoint: " << path << std::endl;
+    throw "broken checkpoint";
+  }
+  checkpoint.reputationBitNum = reputationBitNum;
+  reader.readArray(checkpoint.donorStrategyIds, population);
+  reader.readArray(checkpoint.recipientStrategyIds, population);
+  reader.readArray(checkpoint.reputationBits,
+                   (uint64_t(population) * reputationBitNum + 63) / 64);
+  for (std::vector<int>* counts :
+       {&checkpoint.donorCounts, &checkpoint.recipientCounts}) {
+    std::vector<int32_t> values;
+    uint32_t num = 0;
+    reader.readValue(num);
+    reader.readArray(values, num);
+    counts->assign(values.begin(), values.end());
+  }
+  int32_t goodReputationNum = 0;
+  reader.readValue(goodReputationNum);
+  checkpoint.goodReputationNum = goodReputationNum;
+  uint32_t streamNum = 0;
+  reader.readValue(streamNum);
+  reader.require(uint64_t(streamNum) * 2 * sizeof(uint64_t));
+  for (uint32_t i = 0; i < streamNum; i++) {
+    CheckpointStream stream;
+    reader.readValue(stream.streamId);
+    reader.readValue(stream.position);
+    checkpoint.streams.push_back(stream);
+  }
+  reader.readString(checkpoint.reducerState);
+  file.read(magic, sizeof(magic));
+  if (!file || std::memcmp(magic, END_MAGIC, sizeof(magic)) != 0) {
+    std::cerr << "broken checkpoint: " << path << std::endl;
+    throw "broken checkpoint";
+  }
+  return checkpoint;
+}
@@ -0,0 +1,168 @@
+#include "CompiledPayoffMatrix.hpp"
+
+#include <muParser.h>
+
+#include <iostream>
+
+/**
+ * @brief parse every expression of payoffMatrix.getPayoffMatrixStr() once, and
+ * bind the vars of each player to their own value slots. The slots start
+ * from payoffMatrix.getVars(), so the first eval() gives the same result as
+ * payoffMatrix.evalPayoffMatrix()
+ *
+ * @param payoffMatrix
+ */
+CompiledPayoffMatrix::CompiledPayoffMatrix(const PayoffMatrix& payoffMatrix)
+    : rowNum(payoffMatrix.getRowNum()),
+      colNum(payoffMatrix.getColNum()),
+      playerNum(payoffMatrix.getPlayerNum()),
+      rowStrategies(payoffMatrix.getRowStrategies()),
+      colStrategies(payoffMatrix.getColStrategies()) {
+  std::map<std::string, double> vars = payoffMatrix.getVars();
+  this->varNum = vars.size();
+  for (auto it = vars.begin(); it != vars.end(); it++) {
+    this->varNames.push_back(it->first);
+  }
+  this->varValues.reset(new double[this->playerNum * this->varNum]);
+  for (int player = 0; player < this->playerNum; player++) {
+    int varId = 0;
+    for (auto it = vars.begin(); it != vars.end(); it++, varId++) {
+      this->varValues[player * this->varNum + varId] = it->second;
+    }
+  }
+
+  int cellNum = this->rowNum * this->colNum * this->playerNum;
+  this->payoff = std::vector<double>(cellNum, 0);
+  this->dependentCells =
+      std::vector<std::vector<int>>(this->playerNum * this->varNum);
+  this->dirtyFlags = std::vector<uint8_t>(cellNum, 0);
+  this->dirtyCells.reserve(cellNum);
+
+  std::vector<std::vector<std::vector<std::string>>> payoffMatrixStr =
+      payoffMatrix.getPayoffMatrixStr();
+  for (int row = 0; row < this->rowNum; row++) {
+    for (int col = 0; col < this->colNum; col++) {
+      for (int player = 0; player < this->playerNum; player++) {
+        int cell = (row * this->colNum + col) * this->playerNum + player;
+        std::unique_ptr<mu::Parser> parser(new mu::Parser());
+        try {
+          for (int varId = 0; varId < this->varNum; varId++) {
+            parser->DefineVar(
+                this->varNames[varId],
+                &this->varValues[player * this->varNum + varId]);
+          }
+          parser->SetExpr(payoffMatrixStr[row][col][player]);
+          // record which vars the cell depends on
+          for (auto const& usedVar : parser->GetUsedVar()) {
+            int varId = this->getVarId(usedVar.first);
+            this->dependentCells[player * this->varNum + varId].push_back(cell);
+          }
+        } catch (mu::Parser::exception_type& e) {
+          std::cerr << "payoff expression error: "
+                    << payoffMatrixStr[row][col][player] << ", " << e.GetMsg()
+                    << std::endl;
+          throw "payoff expression error";
+        }
+        this->parsers.push_back(std::move(parser));
+        // every cell is evaluated in the first eval()
+        this->dirtyFlags[cell] = 1;
+        this->dirtyCells.push_back(cell);
+      }
+    }
+  }
+}
+
+CompiledPayoffMatrix::CompiledPayoffMatrix(
+    CompiledPayoffMatrix&& other) noexcept = default;
+CompiledPayoffMatrix& CompiledPayoffMatrix::operator=(
+    CompiledPayoffMatrix&& other) noexcept = default;
+CompiledPayoffMatrix::~CompiledPayoffMatrix() {}
+
+/**
+ * @brief return the id of the var, or -1 if the payoff matrix has no such var
+ *
+ * @param varName
+ * @return int
+ */
+int CompiledPayoffMatrix::getVarId(const std::string& varName) const {
+  for (int varId = 0; varId < this->varNum; varId++) {
+    if (this->varNames[varId] == varName) {
+      return varId;
+    }
+  }
+  return -1;
+}
+
+void CompiledPayoffMatrix::markDirty(int player, int varId) {
+  for (int cell : this->dependentCells[player * this->varNum + varId]) {
+    if (!this->dirtyFlags[cell]) {
+      this->dirtyFlags[cell] = 1;
+      this->dirtyCells.push_back(cell);
+    }
+  }
+}
+
+/**
+ * @brief assign the var for all players
+ *
+ * @param varId the id from getVarId(), a negative id is ignored like a var
+ * missing from the payoff matrix is ignored by evalPayoffMatrix
+ * @param varValue
+ */
+void CompiledPayoffMatrix::setVar(int varId, double varValue) {
+  for (int player = 0; player < this->playerNum; player++) {
+    this->setVar(varId, player, varValue);
+  }
+}
+
+/**
+ * @brief assign the var only for the expressions of one player
+ *
+ * @param varId the id from getVarId(), a negative id is ignored
+ * @param player
+ * @param varValue
+ */
+void CompiledPayoffMatrix::setVar(int varId, int player, double varValue) {
+  if (varId < 0) {
+    return;
+  }
+  double& slot = this->varValues[player * this->varNum + varId];
+  if (slot == varValue) {
+    return;
+  }
+  slot = varValue;
+  this->markDirty(player, varId);
+}
+
+/**
+ * @brief re-evaluate the cells whose vars have changed since the last eval()
+ *
+ */
+void CompiledPayoffMatrix::eval() {
+  for (int cell : this->dirtyCells) {
+    this->payoff[cell] = this->parsers[cell]->Eval();
+    this->dirtyFlags[cell] = 0;
+  }
+  this->dirtyCells.clear();
+}
+
+/**
+ * @brief the evaluated payoffs in the layout of
+ * PayoffMatrix::getPayoffMatrix()
+ *
+ * @return std::vector<std::vector<std::vector<double>>>
+ */
+std::vector<std::vector<std::vector<double>>>
+CompiledPayoffMatrix::getPayoffMatrix() const {
+  std::vector<std::vector<std::vector<double>>> res(
+      this->rowNum, std::vector<std::vector<double>>(
+                        this->colNum, std::vector<double>(this->playerNum)));
+  for (int row = 0; row < this->rowNum; row++) {
+    for (int col = 0; col < this->colNum; col++) {
+      for (int player = 0; player < this->playerNum; player++) {
+        res[row][col][player] = this->getPayoff(row, col, player);
+      }
+    }
+  }
+  return res;
+}
@@ -0,0 +1,113 @@
+#include "Composition.hpp"
+
+#include <iostream>
+
+Composition::Composition() : trackMembers(false) {}
+
+/**
+ * @brief Construct a new Composition object without any individual
+ *
+ * @param classNum the number of classes, class ids are [0, classNum)
+ * @param population the number of individuals, individual ids are [0,
+ * population)
+ * @param trackMembers whether to keep the individual ids of each class
+ */
+Composition::Composition(int classNum, int population, bool trackMembers)
+    : counts(classNum, 0), trackMembers(trackMembers) {
+  if (trackMembers) {
+    this->members = std::vector<std::vector<int>>(classNum);
+    this->memberPos = std::vector<int>(population, -1);
+  }
+}
+
+Composition::~Composition() {}
+
+void Composition::insertMember(int individualId, int classId) {
+  std::vector<int>& classMembers = this->members[classId];
+  this->memberPos[individualId] = classMembers.size();
+  classMembers.push_back(individualId);
+}
+
+/**
+ * @brief swap the last member into the position of the removed one
+ *
+ * @param individualId
+ * @param classId
+ */
+void Composition::eraseMember(int individualId, int classId) {
+  std::vector<int>& classMembers = this->members[classId];
+  int pos = this->memberPos[individualId];
+  if (pos < 0 || pos >= classMembers.size() ||
+      classMembers[pos] != individualId) {
+    std::cerr << "individual " << individualId << " not in class " << classId
+              << std::endl;
+    throw "individual not in class";
+  }
+  int last = classMembers.back();
+  classMembers[pos] = last;
+  this->memberPos[last] = pos;
+  classMembers.pop_back();
+  this->memberPos[individualId] = -1;
+}
+
+void Composition::add(int individualId, int classId) {
+  this->counts[classId]++;
+  if (this->trackMembers) {
+    this->insertMember(individualId, classId);
+  }
+}
+
+void Composition::remove(int individualId, int classId) {
+  if (this->trackMembers) {
+    this->eraseMember(individualId, classId);
+  }
+  this->counts[classId]--;
+}
+
+/**
+ * @brief the individual changes its class
+ *
+ * @param individualId
+ * @param fromClassId
+ * @param toClassId
+ */
+void Composition::move(int individualId, int fromClassId, int toClassId) {
+  if (fromClassId == toClassId) {
+    return;
+  }
+  if (this->trackMembers) {
+    this->eraseMember(individualId, fromClassId);
+    this->insertMember(individualId, toClassId);
+  }
+  this->counts[fromClassId]--;
+  this->counts[toClassId]++;
+}
+
+/**
+ * @brief add count (negative to remove) individuals to a class without their
+ * ids, only if the members are not tracked
+ *
+ * @param classId
+ * @param count
+ */
+void Composition::addCount(int classId, int count) {
+  if (this->trackMembers) {
+    std::cerr << "composition tracks members" << std::endl;
+    throw "composition tracks members";
+  }
+  this->counts[classId] += count;
+}
+
+/**
+ * @brief the individual ids of the class, in no particular order
+ *
+ * @param classId
+ * @return const std::vector<int>&
+ */
+const std::vector<int>& Composition::getMembers(int classId) const {
+  if (!this->trackMembers) {
+    std::cerr << "composition does not track members" << std::endl;
+    throw "composition does not track members";
+  }
+  return this->members[classId];
+}
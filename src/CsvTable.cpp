@@ -0,0 +1,50 @@
+#include "CsvTable.hpp"
+
+// the files are a few hundred bytes, a reader thread per file only costs
+#define CSV_IO_NO_THREAD
+#include <csv.h>
+
+#include <iostream>
+#include <sstream>
+
+/**
+ * @brief split a line on the delimiter like std::getline, so an empty line
+ * has no cells and a trailing delimiter adds no empty cell
+ *
+ * @param line
+ * @param delimiter
+ * @return std::vector<std::string>
+ */
+std::vector<std::string> splitCsvLine(std::string const& line,
+                                      char delimiter) {
+  std::vector<std::string> cells;
+  std::stringstream ss(line);
+  std::string cell;
+  while (std::getline(ss, cell, delimiter)) {
+    cells.push_back(cell);
+  }
+  return cells;
+}
+
+/**
+ * @brief read all lines of the csv file, the "\r" of the windows line breaks
+ * are removed
+ *
+ * @param path
+ * @param delimiter
+ * @return CsvTable
+ */
+CsvTable readCsvTable(std::string const& path, char delimiter) {
+  CsvTable table;
+  try {
+    io::LineReader reader(path);
+    while (char* line = reader.next_line()) {
+      table.push_back(splitCsvLine(line, delimiter));
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to read file: " << path << ", " << e.what()
+              << std::endl;
+    throw "Failed to read file";
+  }
+  return table;
+}
@@ -0,0 +1,1627 @@
+#include "Evolution.hpp"
+
+#include <fmt/core.h>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <variant>
+
+#include "GameKernel.hpp"
+#include "GameSpec.hpp"
+
+/**
+ * @brief fermi function, which is used to calculate the probability of transition of strategy
+ *
+ * @param payoff_current the payoff of the current strategy
+ * @param payoff_new the payoff of the new strategy
+ * @param s the sensitivity of the fermi function if s is large, the probability of transition is small
+ * @return double
+ */
+double fermi(double payoff_current, double payoff_new, double s) {
+  double res = 1 / (1 + exp((payoff_current - payoff_new) * s));
+  return res;
+}
+
+/**
+ * @brief Get the Coop Rate object,
+ * we randomly select two people from the population to play the game. Because
+ * there are identity differences between the two people, it is ordered, and
+ * there are A_n^2 = n * (n - 1) possible
+ *
+ * Among all these possible extractions, the number of times both the donor
+ * and the recipient cooperate is used as the numerator
+ *
+ * so the cooperation rate is possibleCoopNum / (n * (n - 1))
+ *
+ * Whether a game is cooperative only depends on the donor strategy of the
+ * donor and the (recipient strategy, reputation) of the recipient, so
+ * possibleCoopNum is counted exactly from the triple counts of
+ * Population::getStatistics(): all the (donor, recipient) combinations minus
+ * the individuals meeting themselves. It costs O(#strategies * #reputations).
+ *
+ * @param individuals
+ * @param coop_action_id
+ * @return double
+ */
+double getCoopRate(const Population& individuals, int coop_action_id) {
+  const Statistics& statistics = individuals.getStatistics();
+  const Composition& donorComposition = individuals.getDonorComposition();
+  const double n = individuals.getSize();
+  double possible_coop_num = 0;
+  for (int r = 0; r < statistics.getRecipientStrategyNum(); r++) {
+    // the recipient only cooperates if it rewards the donor's cooperation
+    if (individuals.getRecipientAction(r, coop_action_id) != coop_action_id) {
+      continue;
+    }
+    for (int rep = 0; rep < statistics.getReputationNum(); rep++) {
+      for (int d = 0; d < statistics.getDonorStrategyNum(); d++) {
+        if (individuals.getDonorAction(d, rep) != coop_action_id) {
+          continue;
+        }
+        int recipient_num = 0;
+        for (int d_r = 0; d_r < statistics.getDonorStrategyNum(); d_r++) {
+          recipient_num += statistics.getTripleCount(d_r, r, rep);
+        }
+        possible_coop_num +=
+            static_cast<double>(donorComposition.getCount(d)) * recipient_num -
+            statistics.getTripleCount(d, r, rep);
+      }
+    }
+  }
+  double res = possible_coop_num / (n * (n - 1));
+  assert(res >= 0 && res <= 1);
+  return res;
+}
+
+/**
+ * @brief the sampled estimator of getCoopRate, play the game for game_times
+ * times between random ordered pairs, and count the number of times both the
+ * donor and the recipient cooperate
+ *
+ * @param individuals
+ * @param coop_action_id
+ * @param game_times
+ * @param gen the random number generator of the run
+ * @return double
+ */
+double getSampledCoopRate(const Population& individuals, int coop_action_id,
+                          int game_times, RandomStream& gen) {
+  const int n = individuals.getSize();
+  int coop_times = 0;
+  for (int i = 0; i < game_times; i++) {
+    int donor_id = gen.nextInt(n);
+    // uniform over the others of the donor
+    int recipient_id = gen.nextInt(n - 1);
+    if (recipient_id >= donor_id) {
+      recipient_id++;
+    }
+    int donor_action_id = individuals.donate(donor_id, recipient_id);
+    int recipient_action_id =
+        individuals.reward(recipient_id, donor_action_id);
+    if (recipient_action_id == coop_action_id &&
+        donor_action_id == coop_action_id) {
+      coop_times++;
+    }
+  }
+  double res = static_cast<double>(coop_times) / game_times;
+  return res;
+}
+
+/**
+ * @brief the average payoff of an individual of (donorStrategy,
+ * recipientStrategy) against the rest of a well-mixed population, over all
+ * the strategies of the payoff matrix. It is the reference of PayoffCache and
+ * takes the dynamic GameKernel, which returns the bits of every unrolled one
+ *
+ * @param donorStrategy
+ * @param recipientStrategy
+ * @param payoff_matrix
+ * @param donorComposition the number of donors of each strategy id
+ * @param recipientComposition the number of recipients of each strategy id
+ * @param population
+ * @return double
+ */
+double getAvgPayoff(
+    const Strategy& donorStrategy, const Strategy& recipientStrategy,
+    const CompiledPayoffMatrix& payoffMatrix,
+    const Composition& donorComposition,
+    const Composition& recipientComposition, int population) {
+  const int donor_strategy_num = payoffMatrix.getRowNum();
+  const int recipient_strategy_num = payoffMatrix.getColNum();
+  return GameKernel<DYNAMIC_STRATEGY_NUM, DYNAMIC_STRATEGY_NUM>::getAvgPayoff(
+      payoffMatrix.getPayoffData(), donorComposition.getCounts().data(),
+      recipientComposition.getCounts().data(), donorStrategy.getId(),
+      recipientStrategy.getId(), donor_strategy_num, recipient_strategy_num,
+      population);
+}
+
+/**
+ * @brief Counting the number of people in each policy pair can generate log rows:
+ * statistics: C-NR, C-SR, C-AR, C-UR, DISC-NR, DISC-SR, DISC-AR, DISC-UR,
+ * step, C-NR, C-SR, C-AR, C-UR, DISC-NR, DISC-SR, DISC-AR, DISC-UR, ADISC-NR,
+ * ADISC-SR, ADISC-AR, ADISC-UR, D-NR, D-SR, D-AR, D-UR, C, DISC, ADISC, D, NR,
+ * SR, AR, UR, cr
+ *
+ * The counts come from the incrementally updated Population::getStatistics()
+ * and compositions, so a row costs O(#strategy pairs) instead of a scan of the
+ * population.
+ * 
+ * @param individuals 
+ * @param donorStrategies 
+ * @param recipientStrategies 
+ * @param population 
+ * @param step 
+ * @param print 
+ * @param coop_action_id 
+ * @param coop_rate_samples the number of sampled games of the cooperation
+ * rate, 0 means the exact getCoopRate
+ * @param gen the random number generator of the sampled cooperation rate
+ * @return std::string 
+ */
+std::string printStatistics(
+    const Population& individuals, const std::vector<Strategy>& donorStrategies,
+    const std::vector<Strategy>& recipientStrategies, int population, int step,
+    bool print, int coop_action_id, int coop_rate_samples, RandomStream& gen) {
+  const Composition& donorComposition = individuals.getDonorComposition();
+  const Composition& recipientComposition =
+      individuals.getRecipientComposition();
+  const Statistics& statistics = individuals.getStatistics();
+  double population_double = static_cast<double>(population);
+#ifndef NDEBUG
+  int reputation_count = 0;
+  for (int rep = 0; rep < statistics.getReputationNum(); rep++) {
+    reputation_count += statistics.getReputationCount(rep);
+  }
+  assert(reputation_count == population);
+#endif
+
+  std::string logLine = std::to_string(step);
+
+  if (print) {
+    for (const Strategy& donorS : donorStrategies) {
+      for (const Strategy& recipientS : recipientStrategies) {
+        fmt::print("{0}-{1}: {2}, ", donorS.getName(), recipientS.getName(),
+                   statistics.getPairCount(donorS.getId(), recipientS.getId()) /
+                       population_double);
+      }
+    }
+    fmt::print("\n");
+    for (const Strategy& donorS : donorStrategies) {
+      fmt::print("{0}: {1}, ", donorS.getName(),
+                 donorComposition.getCount(donorS.getId()) / population_double);
+    }
+    fmt::print("\n");
+    for (const Strategy& recipientS : recipientStrategies) {
+      fmt::print(
+          "{0}: {1}, ", recipientS.getName(),
+          recipientComposition.getCount(recipientS.getId()) / population_double);
+    }
+  } else {
+    for (const Strategy& donorS : donorStrategies) {
+      for (const Strategy& recipientS : recipientStrategies) {
+        logLine += "," + std::to_string(statistics.getPairCount(donorS.getId(),
+                                                           recipientS.getId()) /
+                                   population_double);
+      }
+    }
+    for (const Strategy& donorS : donorStrategies) {
+      logLine += "," + std::to_string(donorComposition.getCount(donorS.getId()) /
+                                 population_double);
+    }
+    for (const Strategy& recipientS : recipientStrategies) {
+      logLine +=
+          "," + std::to_string(recipientComposition.getCount(recipientS.getId()) /
+                          population_double);
+    }
+
+    logLine += "," + std::to_string(individuals.getGoodReputationNum() /
+                               population_double);
+    double coop_rate =
+        coop_rate_samples > 0
+            ? getSampledCoopRate(individuals, coop_action_id,
+                                 coop_rate_samples, gen)
+            : getCoopRate(individuals, coop_action_id);
+    logLine += "," + std::to_string(coop_rate);
+  }
+  return logLine;
+}
+
+/**
+ * @brief the row of the binary log, it has the same columns as the line of
+ * printStatistics, but keeps the frequencies as counts and the cooperation
+ * rate as float32
+ *
+ * @param individuals
+ * @param donorStrategies
+ * @param recipientStrategies
+ * @param step
+ * @param coop_action_id
+ * @param coop_rate_samples
+ * @param gen
+ * @param row the output, one value per column of the log header
+ */
+void fillStatisticsRow(const Population& individuals,
+                       const std::vector<Strategy>& donorStrategies,
+                       const std::vector<Strategy>& recipientStrategies, int step,
+                       int coop_action_id, int coop_rate_samples,
+                       RandomStream& gen, std::vector<uint32_t>& row) {
+  const Composition& donorComposition = individuals.getDonorComposition();
+  const Composition& recipientComposition =
+      individuals.getRecipientComposition();
+  const Statistics& statistics = individuals.getStatistics();
+
+  int col = 0;
+  row[col++] = step;
+  for (const Strategy& donorS : donorStrategies) {
+    for (const Strategy& recipientS : recipientStrategies) {
+      row[col++] = statistics.getPairCount(donorS.getId(), recipientS.getId());
+    }
+  }
+  for (const Strategy& donorS : donorStrategies) {
+    row[col++] = donorComposition.getCount(donorS.getId());
+  }
+  for (const Strategy& recipientS : recipientStrategies) {
+    row[col++] = recipientComposition.getCount(recipientS.getId());
+  }
+  row[col++] = individuals.getGoodReputationNum();
+  double coop_rate =
+      coop_rate_samples > 0
+          ? getSampledCoopRate(individuals, coop_action_id, coop_rate_samples,
+                               gen)
+          : getCoopRate(individuals, coop_action_id);
+  row[col++] = BinaryLogWriter::encodeFloat(static_cast<float>(coop_rate));
+}
+
+/**
+ * @brief the line of the log of the modes without individuals
+ * (ReplicatorDynamics, RareMutation), the same columns and format as
+ * printStatistics
+ *
+ * @param pairFrequencies the frequency of the strategy pair donor id *
+ * #recipient strategies + recipient id
+ * @param donorStrategies
+ * @param recipientStrategies
+ * @param step
+ * @param goodReputationFrequency
+ * @param coopRate
+ * @return std::string
+ */
+std::string printFrequencyStatistics(
+    const std::vector<double>& pairFrequencies,
+    const std::vector<Strategy>& donorStrategies,
+    const std::vector<Strategy>& recipientStrategies, int step,
+    double goodReputationFrequency, double coopRate) {
+  const int recipient_strategy_num = recipientStrategies.size();
+  std::string logLine = std::to_string(step);
+  for (const Strategy& donorS : donorStrategies) {
+    for (const Strategy& recipientS : recipientStrategies) {
+      logLine += "," + std::to_string(pairFrequencies[donorS.getId() *
+                                                          recipient_strategy_num +
+                                                      recipientS.getId()]);
+    }
+  }
+  for (const Strategy& donorS : donorStrategies) {
+    double freq = 0;
+    for (const Strategy& recipientS : recipientStrategies) {
+      freq += pairFrequencies[donorS.getId() * recipient_strategy_num +
+                              recipientS.getId()];
+    }
+    logLine += "," + std::to_string(freq);
+  }
+  for (const Strategy& recipientS : recipientStrategies) {
+    double freq = 0;
+    for (const Strategy& donorS : donorStrategies) {
+      freq += pairFrequencies[donorS.getId() * recipient_strategy_num +
+                              recipientS.getId()];
+    }
+    logLine += "," + std::to_string(freq);
+  }
+  logLine += "," + std::to_string(goodReputationFrequency);
+  logLine += "," + std::to_string(coopRate);
+  return logLine;
+}
+
+/**
+ * @brief the row of the binary log of the modes without individuals, the
+ * frequencies are stored as the counts of a population of the given size
+ * (rounded), like fillStatisticsRow
+ *
+ * @param pairFrequencies
+ * @param donorStrategies
+ * @param recipientStrategies
+ * @param step
+ * @param population
+ * @param goodReputationFrequency
+ * @param coopRate
+ * @param row the output, one value per column of the log header
+ */
+void fillFrequencyStatisticsRow(
+    const std::vector<double>& pairFrequencies,
+    const std::vector<Strategy>& donorStrategies,
+    const std::vector<Strategy>& recipientStrategies, int step, int population,
+    double goodReputationFrequency, double coopRate,
+    std::vector<uint32_t>& row) {
+  const int recipient_strategy_num = recipientStrategies.size();
+  auto toCount = [&](double freq) {
+    return static_cast<uint32_t>(std::lround(std::max(0.0, freq) * population));
+  };
+  int col = 0;
+  row[col++] = step;
+  for (const Strategy& donorS : donorStrategies) {
+    for (const Strategy& recipientS : recipientStrategies) {
+      row[col++] = toCount(pairFrequencies[donorS.getId() *
+                                               recipient_strategy_num +
+                                           recipientS.getId()]);
+    }
+  }
+  for (const Strategy& donorS : donorStrategies) {
+    double freq = 0;
+    for (const Strategy& recipientS : recipientStrategies) {
+      freq += pairFrequencies[donorS.getId() * recipient_strategy_num +
+                              recipientS.getId()];
+    }
+    row[col++] = toCount(freq);
+  }
+  for (const Strategy& recipientS : recipientStrategies) {
+    double freq = 0;
+    for (const Strategy& donorS : donorStrategies) {
+      freq += pairFrequencies[donorS.getId() * recipient_strategy_num +
+                              recipientS.getId()];
+    }
+    row[col++] = toCount(freq);
+  }
+  row[col++] = toCount(goodReputationFrequency);
+  row[col++] = BinaryLogWriter::encodeFloat(static_cast<float>(coopRate));
+}
+
+/**
+ * @brief the payoff matrix of the norm in the GameSpec of the process with the
+ * vars assigned, the evolution only reassigns "p" by its id
+ */
+CompiledPayoffMatrix Evolution::loadPayoffMatrix(
+    std::string const& payoffMatrixConfigName, int normId, double b,
+    double beta, double c, double gamma, double p0) {
+  PayoffMatrix payoff_matrix =
+      GameSpec::getDefault()->getPayoffMatrix(payoffMatrixConfigName, normId);
+  payoff_matrix.updateVar("b", b);
+  payoff_matrix.updateVar("beta", beta);
+  payoff_matrix.updateVar("c", c);
+  payoff_matrix.updateVar("gamma", gamma);
+  payoff_matrix.updateVar("p", p0);
+  return payoff_matrix.compile();
+}
+
+/**
+ * @brief the norm in the GameSpec of the process
+ */
+Norm Evolution::loadNorm(int normId, std::vector<Action> const& donorActions,
+                         std::vector<Action> const& recipientActions) {
+  return GameSpec::getDefault()->getNorm(normId, donorActions,
+                                         recipientActions);
+}
+
+/**
+ * @brief the template of the individuals of one role, its strategy table is
+ * shared by the whole population
+ */
+Player Evolution::loadPlayer(std::string const& name,
+                             std::vector<Action> const& actions,
+                             std::vector<Strategy> const& strategies) {
+  return GameSpec::getDefault()->getPlayer(name, actions, strategies);
+}
+
+/**
+ * @brief Construct a new Evolution object, each strategy pair has the same
+ * number of individuals (up to one) and a fraction p0 of them has good
+ * reputation, both are shuffled
+ *
+ * @param population at least 2
+ * @param s
+ * @param b
+ * @param beta
+ * @param c
+ * @param gamma
+ * @param mu
+ * @param normId
+ * @param p0
+ * @param payoffMatrixConfigName "payoffMatrix_shortterm" or
+ * "payoffMatrix_longterm_no_norm_error"
+ * @param seed the global seed, the random streams are derived from (seed,
+ * normId, replica), see RandomStream.hpp
+ * @param replica
+ * @param graph the interaction graph of population nodes, nullptr if
+ * well-mixed, it must outlive the evolution
+ */
+Evolution::Evolution(int population, double s, double b, double beta,
+                     double c, double gamma, double mu, int normId, double p0,
+                     std::string const& payoffMatrixConfigName, uint64_t seed,
+                     int replica, const InteractionGraph* graph)
+    : population(population),
+      s(s),
+      mu(mu),
+      normId(normId),
+      isShortterm(false),
+      donorActions{Action("C", 0), Action("D", 1)},
+      recipientActions{Action("C", 0), Action("D", 1)},
+      payoffMatrix(loadPayoffMatrix(payoffMatrixConfigName, normId, b, beta, c,
+                                    gamma, p0)),
+      pVarId(payoffMatrix.getVarId("p")),
+      norm(loadNorm(normId, donorActions, recipientActions)),
+      individuals(population,
+                  loadPlayer("donor", donorActions,
+                             payoffMatrix.getRowStrategies()),
+                  loadPlayer("recipient", recipientActions,
+                             payoffMatrix.getColStrategies()),
+                  norm),
+      graph(graph),
+      coopActionId(donorActions[0].getId()),  // "C"
+      genInit(RandomStream::derive(seed, normId, replica, RandomPurpose::INIT)),
+      genSelection(
+          RandomStream::derive(seed, normId, replica, RandomPurpose::SELECTION)),
+      genDecision(
+          RandomStream::derive(seed, normId, replica, RandomPurpose::DECISION)),
+      genCoopRate(RandomStream::derive(seed, normId, replica,
+                                       RandomPurpose::COOP_RATE)),
+      genSync(RandomStream::derive(seed, normId, replica, RandomPurpose::SYNC)),
+      generation(0),
+      payoffCacheGoodNum(-1),
+      classWordNum((population + 63) / 64) {
+  // in shortterm, the donor's p follows the current good reputation
+  // distribution, in longterm it stays p0
+  if (payoffMatrixConfigName == "payoffMatrix_shortterm") {
+    this->isShortterm = true;
+  } else if (payoffMatrixConfigName != "payoffMatrix_longterm_no_norm_error") {
+    std::cerr << "payoff_matrix_config_name error: " << payoffMatrixConfigName
+              << std::endl;
+    throw "payoff_matrix_config_name error";
+  }
+  if (population < 2) {
+    std::cerr << "population error: " << population << std::endl;
+    throw "population error";
+  }
+  if (graph != nullptr &&
+      (graph->getNodeNum() != population || graph->getMinDegree() < 1)) {
+    std::cerr << "graph error: " << graph->getSpec() << " has "
+              << graph->getNodeNum() << " nodes, min degree "
+              << graph->getMinDegree() << ", population " << population
+              << std::endl;
+    throw "graph error";
+  }
+  this->donorStrategies = this->payoffMatrix.getRowStrategies();
+  this->recipientStrategies = this->payoffMatrix.getColStrategies();
+  this->strategyPairNum =
+      this->donorStrategies.size() * this->recipientStrategies.size();
+  this->payoffCache =
+      PayoffCache(this->donorStrategies.size(),
+                  this->recipientStrategies.size(),
+                  this->norm.getReputationNum(), population);
+
+  initIndividuals(this->individuals, this->recipientStrategies.size(),
+                  this->strategyPairNum, p0, this->genInit);
+  this->payoffCache.setCounts(this->individuals.getDonorComposition(),
+                              this->individuals.getRecipientComposition());
+}
+
+Evolution::~Evolution() {}
+
+/**
+ * @brief the initial population of a replica: the strategy pairs have the
+ * same number of individuals up to one, population * p0 individuals have good
+ * reputation (the top level) and the others the bottom level, and both are
+ * shuffled by genInit
+ *
+ * @param individuals a population of the template players, not initialized
+ * @param recipientStrategyNum
+ * @param strategyPairNum
+ * @param p0
+ * @param genInit the INIT stream of the replica
+ */
+void Evolution::initIndividuals(Population& individuals,
+                                int recipientStrategyNum, int strategyPairNum,
+                                double p0, RandomStream& genInit) {
+  const int population = individuals.getSize();
+  // the first bad_rep_num individuals have bad reputation before shuffling
+  int good_rep_num = static_cast<int>(population * p0);
+  int bad_rep_num = population - good_rep_num;
+
+  // the strategy pairs have the same number of players up to one, individual
+  // i takes the (i * #pairs / population)-th strategy pair before shuffling
+  // (i / pair size when the population is a multiple of the pairs)
+  for (int i = 0; i < population; i++) {
+    int pair_id = static_cast<int64_t>(i) * strategyPairNum / population;
+    individuals.initIndividual(i, pair_id / recipientStrategyNum,
+                               pair_id % recipientStrategyNum,
+                               i < bad_rep_num
+                                   ? 0
+                                   : individuals.getReputationNum() - 1);
+  }
+  assert(individuals.getGoodReputationNum() == good_rep_num);
+
+  // shuffle the reputations and the strategy pairs in place (Fisher-Yates)
+  for (int i = population - 1; i > 0; i--) {
+    individuals.swapReputations(i, genInit.nextInt(i + 1));
+  }
+  for (int i = population - 1; i > 0; i--) {
+    individuals.swapStrategies(i, genInit.nextInt(i + 1));
+  }
+}
+
+/**
+ * @brief set the payoffs of payoffCache to the payoff matrix evaluated with
+ * the recipient's p of each reputation (and the donor's p of the current good
+ * reputation frequency in shortterm). The matrix only changes with the
+ * donor's p, so in longterm it is evaluated once, in shortterm when the good
+ * reputation number changed
+ */
+void Evolution::updatePayoffCache() {
+  const int donor_player = 0;
+  const int recipient_player = 1;
+  const int reputation_num = this->norm.getReputationNum();
+  const int good_num = this->individuals.getGoodReputationNum();
+  if (this->payoffCacheGoodNum >= 0 &&
+      (!this->isShortterm || this->payoffCacheGoodNum == good_num)) {
+    return;
+  }
+  this->payoffCacheGoodNum = good_num;
+  if (this->isShortterm) {
+    this->payoffMatrix.setVar(this->pVarId, donor_player,
+                              static_cast<double>(good_num) / this->population);
+  }
+  for (int rep = 0; rep < reputation_num; rep++) {
+    this->payoffMatrix.setVar(this->pVarId, recipient_player,
+                              this->norm.getReputationValue(rep));
+    this->payoffMatrix.eval();
+    this->payoffCache.setPayoffs(rep, this->payoffMatrix);
+  }
+}
+
+/**
+ * @brief switch the strategies of individual i, keeping the counts of
+ * payoffCache
+ *
+ * @param i
+ * @param donorStrategyId
+ * @param recipientStrategyId
+ */
+void Evolution::setStrategies(int i, int donorStrategyId,
+                              int recipientStrategyId) {
+  const int class_id = this->classBits.empty() ? 0 : this->getClassId(i);
+  this->payoffCache.moveDonor(this->individuals.getDonorStrategyId(i),
+                              donorStrategyId);
+  this->payoffCache.moveRecipient(this->individuals.getRecipientStrategyId(i),
+                                  recipientStrategyId);
+  this->individuals.setStrategies(i, donorStrategyId, recipientStrategyId);
+  if (!this->classBits.empty()) {
+    this->moveClass(i, class_id, this->getClassId(i));
+  }
+}
+
+/**
+ * @brief set the reputation of individual i, keeping its class of classBits
+ *
+ * @param i
+ * @param reputationId
+ */
+void Evolution::setReputationId(int i, int reputationId) {
+  if (!this->classBits.empty()) {
+    const int class_id = this->getClassId(i);
+    this->moveClass(i, class_id, (class_id & ~1) | reputationId);
+  }
+  this->individuals.setReputationId(i, reputationId);
+}
+
+/**
+ * @brief Population::playGame, keeping the class of the recipient of
+ * classBits
+ *
+ * @param donorI
+ * @param recipientJ
+ */
+void Evolution::playGame(int donorI, int recipientJ) {
+  if (this->classBits.empty()) {
+    this->individuals.playGame(donorI, recipientJ);
+    return;
+  }
+  const int class_id = this->getClassId(recipientJ);
+  this->individuals.playGame(donorI, recipientJ);
+  this->moveClass(recipientJ, class_id, this->getClassId(recipientJ));
+}
+
+/**
+ * @brief the average payoff of individual i over the games with its
+ * neighbors, as donor and as recipient with probability 1/2 each, like
+ * getAvgPayoff over the whole population. It costs O(degree), the payoffs of
+ * payoffCache must be set
+ *
+ * @param i
+ * @return double
+ */
+double Evolution::getLocalPayoff(int i) const {
+  const Population& individuals = this->individuals;
+  const int recipient_strategy_num = this->recipientStrategies.size();
+  const double* table =
+      this->payoffCache.getPayoffs(individuals.getReputationId(i));
+  const int donor_id = individuals.getDonorStrategyId(i);
+  const int recipient_id = individuals.getRecipientStrategyId(i);
+  const int degree = this->graph->getDegree(i);
+  double eval = 0;
+  for (int k = 0; k < degree; k++) {
+    int j = this->graph->getNeighbor(i, k);
+    eval += table[(donor_id * recipient_strategy_num +
+                   individuals.getRecipientStrategyId(j)) * 2] +
+            table[(individuals.getDonorStrategyId(j) * recipient_strategy_num +
+                   recipient_id) * 2 + 1];
+  }
+  return eval * 0.5 / degree;
+}
+
+/**
+ * @brief the average payoff of every class (strategy pair, reputation) of a
+ * well-mixed population into classPayoffs, the payoff of an individual only
+ * depends on its class. The payoffs of payoffCache must be set
+ */
+void Evolution::fillClassPayoffs() {
+  const int recipient_strategy_num = this->recipientStrategies.size();
+  const int reputation_num = this->norm.getReputationNum();
+  this->classPayoffs.resize(this->strategyPairNum * reputation_num);
+  std::visit(
+      [&](auto kernel) {
+        typedef decltype(kernel) Kernel;
+        for (int rep = 0; rep < reputation_num; rep++) {
+          for (int pair = 0; pair < this->strategyPairNum; pair++) {
+            this->classPayoffs[pair * reputation_num + rep] =
+                this->payoffCache.getAvgPayoff<Kernel>(
+                    rep, pair / recipient_strategy_num,
+                    pair % recipient_strategy_num);
+          }
+        }
+      },
+      this->payoffCache.getKernel());
+}
+
+/**
+ * @brief one step: the focal player imitates the role model (or mutates with
+ * probability mu), then plays the game with a random co-player using the new
+ * strategy
+ *
+ */
+void Evolution::step() { this->steps(1); }
+
+/**
+ * @brief stepNum steps of step(), the GameKernel of the game is picked once
+ * for all of them
+ *
+ * @param stepNum
+ */
+void Evolution::steps(int stepNum) {
+  std::visit(
+      [&](auto kernel) {
+        for (int t = 0; t < stepNum; t++) {
+          this->stepWith<decltype(kernel)>();
+        }
+      },
+      this->payoffCache.getKernel());
+}
+
+/**
+ * @brief the body of step() with the payoffs of Kernel
+ *
+ * @tparam Kernel the alternative of payoffCache.getKernel()
+ */
+template <class Kernel>
+void Evolution::stepWith() {
+  Population& individuals = this->individuals;
+  const int population = this->population;
+
+  // The random number of 0-population is extracted
+  int focal_i = this->genSelection.nextInt(population);
+  // to prevent the same person from being drawn, the role model is uniform
+  // over the others (over the neighbors in a structured population)
+  int rolemodel_i;
+  if (this->graph != nullptr) {
+    rolemodel_i = this->graph->sampleNeighbor(focal_i, this->genSelection);
+  } else {
+    rolemodel_i = this->genSelection.nextInt(population - 1);
+    if (rolemodel_i >= focal_i) {
+      rolemodel_i++;
+    }
+  }
+
+  // mutation probability to explore other strategies randomly
+  double p = this->genDecision.nextDouble();
+  assert(p >= 0 && p <= 1);
+  // there is a probability of mu to explore other strategies randomly
+  if (p < this->mu) {
+    // update the focul's strategy to one of the other strategy pairs
+    const int recipient_strategy_num = this->recipientStrategies.size();
+    int focal_pair_id =
+        individuals.getDonorStrategyId(focal_i) * recipient_strategy_num +
+        individuals.getRecipientStrategyId(focal_i);
+    int rand_pair_id = this->genDecision.nextInt(this->strategyPairNum - 1);
+    if (rand_pair_id >= focal_pair_id) {
+      rand_pair_id++;
+    }
+
+    this->setStrategies(focal_i, rand_pair_id / recipient_strategy_num,
+                        rand_pair_id % recipient_strategy_num);
+  } else {
+    const Strategy& rolemodel_donorStrategy =
+        this->donorStrategies[individuals.getDonorStrategyId(rolemodel_i)];
+    const Strategy& rolemodel_recipientStrategy =
+        this->recipientStrategies[individuals.getRecipientStrategyId(
+            rolemodel_i)];
+
+    const Strategy& focul_donorStrategy =
+        this->donorStrategies[individuals.getDonorStrategyId(focal_i)];
+    const Strategy& focul_recipientStrategy =
+        this->recipientStrategies[individuals.getRecipientStrategyId(focal_i)];
+    double rolemodel_payoff;
+    double focul_payoff;
+    // if payoff_matrix_config_name == "payoffMatrix_shortterm", the matrix
+    // follows the current reputation distribution
+    this->updatePayoffCache();
+    if (this->graph != nullptr) {
+      rolemodel_payoff = this->getLocalPayoff(rolemodel_i);
+      focul_payoff = this->getLocalPayoff(focal_i);
+    } else {
+      // the recipient's p is the player's own reputation
+      rolemodel_payoff = this->payoffCache.getAvgPayoff<Kernel>(
+          individuals.getReputationId(rolemodel_i),
+          rolemodel_donorStrategy.getId(), rolemodel_recipientStrategy.getId());
+      focul_payoff = this->payoffCache.getAvgPayoff<Kernel>(
+          individuals.getReputationId(focal_i), focul_donorStrategy.getId(),
+          focul_recipientStrategy.getId());
+    }
+
+    // fermi
+    if (this->genDecision.nextDouble() <
+        fermi(focul_payoff, rolemodel_payoff, this->s)) {
+      this->setStrategies(focal_i, rolemodel_donorStrategy.getId(),
+                          rolemodel_recipientStrategy.getId());
+    }
+  }
+
+  // focal player play the game with a random select neighbor k using the new
+  // strategy
+  int k;
+  if (this->graph != nullptr) {
+    k = this->graph->sampleNeighbor(focal_i, this->genSelection);
+  } else {
+    k = this->genSelection.nextInt(population - 1);
+    if (k >= focal_i) {
+      k++;
+    }
+  }
+
+  // The position in the game is randomly selected between focal_i and k
+  // 1. focal_i as donor and k as recipient
+  // 2. k as donor and focal_i as recipient
+  double random_p = this->genDecision.nextDouble();
+  assert(random_p >= 0 && random_p <= 1);
+  if (random_p > 0.5) {
+    this->playGame(focal_i, k);
+  } else {
+    this->playGame(k, focal_i);
+  }
+}
+
+/**
+ * @brief one generation of the synchronous update, population steps of
+ * step() at once: every individual imitates a role model (or mutates) and is
+ * the recipient of a game with a random donor (neighbors in a structured
+ * population), all against the frozen snapshot of the strategies and
+ * reputations at the start of the phase.
+ *
+ * The decisions are computed in parallel into the second buffers nextPairIds
+ * and nextReputationIds and committed afterwards, so no individual sees a
+ * change of the same phase. Individual i of phase phase of generation g draws
+ * from the SYNC_BLOCK_NUM Philox blocks starting at
+ * ((g * 2 + phase) * population + i) * SYNC_BLOCK_NUM of genSync (it needs at
+ * most 5 of the 16 numbers unless nextInt rejects), so the result does not
+ * depend on the number of threads or the partition of the range.
+ */
+void Evolution::stepGeneration() {
+  Population& individuals = this->individuals;
+  const int population = this->population;
+  const int recipient_strategy_num = this->recipientStrategies.size();
+  const int reputation_num = this->norm.getReputationNum();
+  const int grain_size = 1024;
+  this->nextPairIds.resize(population);
+  this->nextReputationIds.resize(population);
+
+  auto getPairId = [&](int i) {
+    return individuals.getDonorStrategyId(i) * recipient_strategy_num +
+           individuals.getRecipientStrategyId(i);
+  };
+  this->updatePayoffCache();
+  if (this->graph != nullptr) {
+    // the local payoff of every individual from its neighbors
+    this->individualPayoffs.resize(population);
+    tbb::parallel_for(tbb::blocked_range<int>(0, population, grain_size),
+                      [&](tbb::blocked_range<int> const& range) {
+                        for (int i = range.begin(); i != range.end(); i++) {
+                          this->individualPayoffs[i] = this->getLocalPayoff(i);
+                        }
+                      });
+  } else {
+    this->fillClassPayoffs();
+  }
+  auto getPayoff = [&](int i) {
+    if (this->graph != nullptr) {
+      return this->individualPayoffs[i];
+    }
+    return this->classPayoffs[getPairId(i) * reputation_num +
+                              individuals.getReputationId(i)];
+  };
+  auto sampleOther = [&](int i, RandomStream& gen) {
+    if (this->graph != nullptr) {
+      return this->graph->sampleNeighbor(i, gen);
+    }
+    int j = gen.nextInt(population - 1);
+    return j >= i ? j + 1 : j;
+  };
+  auto getFirstBlock = [&](int phase, int i) {
+    return ((this->generation * 2 + phase) * population + i) * SYNC_BLOCK_NUM;
+  };
+
+  // imitation and mutation
+  tbb::parallel_for(
+      tbb::blocked_range<int>(0, population, grain_size),
+      [&](tbb::blocked_range<int> const& range) {
+        RandomStream gen = this->genSync;
+        for (int focal_i = range.begin(); focal_i != range.end(); focal_i++) {
+          gen.seek(getFirstBlock(0, focal_i), SYNC_BLOCK_NUM);
+          int rolemodel_i = sampleOther(focal_i, gen);
+          const int focal_pair_id = getPairId(focal_i);
+          int next_pair_id = focal_pair_id;
+          if (gen.nextDouble() < this->mu) {
+            next_pair_id = gen.nextInt(this->strategyPairNum - 1);
+            if (next_pair_id >= focal_pair_id) {
+              next_pair_id++;
+            }
+          } else {
+            if (gen.nextDouble() <
+                fermi(getPayoff(focal_i), getPayoff(rolemodel_i), this->s)) {
+              next_pair_id = getPairId(rolemodel_i);
+            }
+          }
+          this->nextPairIds[focal_i] = next_pair_id;
+        }
+      });
+  for (int i = 0; i < population; i++) {
+    if (this->nextPairIds[i] != getPairId(i)) {
+      this->setStrategies(i, this->nextPairIds[i] / recipient_strategy_num,
+                          this->nextPairIds[i] % recipient_strategy_num);
+    }
+  }
+
+  // every individual is the recipient of a random donor using the new
+  // strategies
+  tbb::parallel_for(
+      tbb::blocked_range<int>(0, population, grain_size),
+      [&](tbb::blocked_range<int> const& range) {
+        RandomStream gen = this->genSync;
+        for (int recipient_i = range.begin(); recipient_i != range.end();
+             recipient_i++) {
+          gen.seek(getFirstBlock(1, recipient_i), SYNC_BLOCK_NUM);
+          int donor_i = sampleOther(recipient_i, gen);
+          int donor_action_id = individuals.donate(donor_i, recipient_i);
+          int recipient_action_id =
+              individuals.reward(recipient_i, donor_action_id);
+          this->nextReputationIds[recipient_i] =
+              individuals.assess(donor_action_id, recipient_action_id,
+                                 individuals.getReputationId(recipient_i));
+        }
+      });
+  for (int i = 0; i < population; i++) {
+    this->setReputationId(i, this->nextReputationIds[i]);
+  }
+  this->generation++;
+}
+
+/**
+ * @brief getBatchStepNum() steps of step() done concurrently by the threads,
+ * in a well-mixed population.
+ *
+ * Event j of the batch is a step of step(): its focal, role model and
+ * co-player are drawn first, from the SYNC_BLOCK_NUM Philox blocks starting
+ * at (g * getBatchStepNum() + j) * SYNC_BLOCK_NUM of genSync for batch g, and
+ * the rest of its numbers continue from the next block. The events are then
+ * done in rounds: every pending event claims its three individuals with an
+ * atomic minimum of its index, and the events that own all of them are done
+ * at once, the others wait for the next round. Two events of a round never share an individual,
+ * and an event is only done after the earlier events of the batch sharing
+ * one, so the strategies and reputations of every individual change in the
+ * order of step() and the result does not depend on the number of threads.
+ * The writes are Population::storeStrategies and storeReputationId, the
+ * changes of the counts are summed per thread and added at the end of the
+ * batch.
+ *
+ * The payoffs (and the good reputation number of the shortterm matrix) are
+ * those of the start of the batch, so an event sees counts at most
+ * getBatchStepNum() - 1 steps old: every step changes at most two classes by
+ * one, so the frequencies seen differ by at most
+ * 2 * (getBatchStepNum() - 1) / population < 2 / BATCH_DIVISOR from those of
+ * step(). The rounds are few while the batch is much smaller than the
+ * population, so the batch parallelizes for large populations (10^6 or more)
+ * where step() would be memory bound on one thread.
+ */
+void Evolution::stepBatch() {
+  Population& individuals = this->individuals;
+  const int population = this->population;
+  const int recipient_strategy_num = this->recipientStrategies.size();
+  const int reputation_num = this->norm.getReputationNum();
+  const int class_num = this->strategyPairNum * reputation_num;
+  const int batch_step_num = this->getBatchStepNum();
+  const int grain_size = 256;
+  if (this->graph != nullptr) {
+    std::cerr << "stepBatch needs a well-mixed population" << std::endl;
+    throw "stepBatch needs a well-mixed population";
+  }
+  // the classes only follow step(), skipSteps() fills them again
+  this->classBits.clear();
+  this->updatePayoffCache();
+  this->fillClassPayoffs();
+  this->batchIndividuals.resize(batch_step_num * 3);
+  this->batchPositions.resize(batch_step_num);
+  this->batchPendingIds.resize(batch_step_num);
+  this->batchDone.resize(batch_step_num);
+  // every round leaves the owners as INT_MAX
+  if (static_cast<int>(this->batchOwners.size()) != population) {
+    this->batchOwners = std::vector<std::atomic<int>>(population);
+    for (std::atomic<int>& owner : this->batchOwners) {
+      owner.store(INT_MAX, std::memory_order_relaxed);
+    }
+  }
+
+  auto getPairId = [&](int i) {
+    return individuals.getDonorStrategyId(i) * recipient_strategy_num +
+           individuals.getRecipientStrategyId(i);
+  };
+  auto getClassId = [&](int i) {
+    return getPairId(i) * reputation_num + individuals.getReputationId(i);
+  };
+
+  // the individuals of the events
+  tbb::parallel_for(
+      tbb::blocked_range<int>(0, batch_step_num, grain_size),
+      [&](tbb::blocked_range<int> const& range) {
+        RandomStream gen = this->genSync;
+        for (int j = range.begin(); j != range.end(); j++) {
+          gen.seek((this->generation * batch_step_num + j) * SYNC_BLOCK_NUM, 1);
+          int* event = &this->batchIndividuals[j * 3];
+          event[0] = gen.nextInt(population);
+          for (int k = 1; k < 3; k++) {
+            event[k] = gen.nextInt(population - 1);
+            if (event[k] >= event[0]) {
+              event[k]++;
+            }
+          }
+          // the rest of the event starts at the next block, no block is
+          // generated twice
+          this->batchPositions[j] = (gen.getPosition() + 3) / 4 * 4;
+          this->batchPendingIds[j] = j;
+        }
+      });
+
+  tbb::enumerable_thread_specific<std::vector<int>> class_deltas(
+      std::vector<int>(class_num, 0));
+  auto doEvent = [&](int j, RandomStream& gen, std::vector<int>& deltas) {
+    const int* event = &this->batchIndividuals[j * 3];
+    const int focal_i = event[0];
+    const int rolemodel_i = event[1];
+    const int k = event[2];
+    gen.seek(this->batchPositions[j] / 4, 1);
+    const int focal_class_id = getClassId(focal_i);
+    const int k_class_id = getClassId(k);
+
+    const int focal_pair_id = focal_class_id / reputation_num;
+    int next_pair_id = focal_pair_id;
+    if (gen.nextDouble() < this->mu) {
+      next_pair_id = gen.nextInt(this->strategyPairNum - 1);
+      if (next_pair_id >= focal_pair_id) {
+        next_pair_id++;
+      }
+    } else if (gen.nextDouble() <
+               fermi(this->classPayoffs[focal_class_id],
+                     this->classPayoffs[getClassId(rolemodel_i)], this->s)) {
+      next_pair_id = getPairId(rolemodel_i);
+    }
+    individuals.storeStrategies(focal_i, next_pair_id / recipient_strategy_num,
+                                next_pair_id % recipient_strategy_num);
+
+    int donor_i = focal_i;
+    int recipient_i = k;
+    if (!(gen.nextDouble() > 0.5)) {
+      std::swap(donor_i, recipient_i);
+    }
+    int donor_action_id = individuals.donate(donor_i, recipient_i);
+    int recipient_action_id = individuals.reward(recipient_i, donor_action_id);
+    individuals.storeReputationId(
+        recipient_i,
+        individuals.assess(donor_action_id, recipient_action_id,
+                           individuals.getReputationId(recipient_i)));
+
+    for (int i : {focal_i, k}) {
+      const int from_class_id = i == focal_i ? focal_class_id : k_class_id;
+      const int to_class_id = getClassId(i);
+      if (from_class_id != to_class_id) {
+        deltas[from_class_id]--;
+        deltas[to_class_id]++;
+      }
+    }
+  };
+
+  // on one thread the events are simply done in order, the same result
+  int pending_num = batch_step_num;
+  if (tbb::this_task_arena::max_concurrency() == 1) {
+    RandomStream gen = this->genSync;
+    std::vector<int>& deltas = class_deltas.local();
+    for (int j = 0; j < batch_step_num; j++) {
+      doEvent(j, gen, deltas);
+    }
+    pending_num = 0;
+  }
+  while (pending_num > 0) {
+    // claim the individuals: the first pending event of each owns it
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, pending_num, grain_size),
+        [&](tbb::blocked_range<int> const& range) {
+          for (int p = range.begin(); p != range.end(); p++) {
+            const int j = this->batchPendingIds[p];
+            for (int k = 0; k < 3; k++) {
+              std::atomic<int>& owner =
+                  this->batchOwners[this->batchIndividuals[j * 3 + k]];
+              int current = owner.load(std::memory_order_relaxed);
+              while (j < current &&
+                     !owner.compare_exchange_weak(current, j,
+                                                  std::memory_order_relaxed)) {
+              }
+            }
+          }
+        });
+    // the events owning their individuals
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, pending_num, grain_size),
+        [&](tbb::blocked_range<int> const& range) {
+          RandomStream gen = this->genSync;
+          std::vector<int>& deltas = class_deltas.local();
+          for (int p = range.begin(); p != range.end(); p++) {
+            const int j = this->batchPendingIds[p];
+            const int* event = &this->batchIndividuals[j * 3];
+            bool owns_all = true;
+            for (int k = 0; k < 3; k++) {
+              owns_all &= this->batchOwners[event[k]].load(
+                              std::memory_order_relaxed) == j;
+            }
+            this->batchDone[p] = owns_all;
+            if (this->batchDone[p]) {
+              doEvent(j, gen, deltas);
+            }
+          }
+        });
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, pending_num, grain_size),
+        [&](tbb::blocked_range<int> const& range) {
+          for (int p = range.begin(); p != range.end(); p++) {
+            const int j = this->batchPendingIds[p];
+            for (int k = 0; k < 3; k++) {
+              this->batchOwners[this->batchIndividuals[j * 3 + k]].store(
+                  INT_MAX, std::memory_order_relaxed);
+            }
+          }
+        });
+    int next_pending_num = 0;
+    for (int p = 0; p < pending_num; p++) {
+      if (!this->batchDone[p]) {
+        this->batchPendingIds[next_pending_num++] = this->batchPendingIds[p];
+      }
+    }
+    pending_num = next_pending_num;
+  }
+
+  std::vector<int> triple_deltas(class_num, 0);
+  for (const std::vector<int>& deltas : class_deltas) {
+    for (int c = 0; c < class_num; c++) {
+      triple_deltas[c] += deltas[c];
+    }
+  }
+  individuals.addTripleCounts(triple_deltas);
+  this->payoffCache.setCounts(individuals.getDonorComposition(),
+                              individuals.getRecipientComposition());
+  this->generation++;
+}
+
+/**
+ * @brief the steps of step() up to the next change of the state, without
+ * visiting the others (the rejection-free "n-fold way"), in a well-mixed
+ * population.
+ *
+ * A step only depends on the classes (strategy pair, reputation) of the
+ * focal, the role model and the co-player, so the probability that a step
+ * changes the state is a sum over the pairs of the classes with members: the
+ * focal switches its pair (mutation, or imitation of a role model of another
+ * pair), or it does not and the game flips a reputation. The steps without a
+ * change before the next one are geometric, then the changing step is drawn
+ * conditioned on the change and its members uniformly from the classes. The
+ * steps and the states at any step have the law of step(), not its random
+ * numbers.
+ *
+ * A rate computation costs O(#classes with members ^ 2), so while it would
+ * skip fewer steps than it costs (RATE_PAIRS_PER_STEP), the steps are done by
+ * step() instead. Nothing is kept between the calls but classBits, which only
+ * depends on the state, so a run resumed at a bound of a call is the same run.
+ *
+ * @param maxStepNum the steps before the next row of the log or checkpoint,
+ * at least 1
+ * @return int the steps done, at most maxStepNum
+ */
+int Evolution::skipSteps(int maxStepNum) {
+  Population& individuals = this->individuals;
+  const int population = this->population;
+  const int recipient_strategy_num = this->recipientStrategies.size();
+  const int class_num = this->strategyPairNum * 2;
+  if (this->graph != nullptr) {
+    std::cerr << "skipSteps needs a well-mixed population" << std::endl;
+    throw "skipSteps needs a well-mixed population";
+  }
+  if (this->norm.getReputationNum() != 2) {
+    std::cerr << "skipSteps needs a binary norm, norm " << this->normId
+              << " has " << this->norm.getReputationNum() << " levels"
+              << std::endl;
+    throw "skipSteps needs a binary norm";
+  }
+  if (this->classBits.empty()) {
+    this->fillClassBits();
+  }
+  this->updatePayoffCache();
+
+  // whether the game of a donor of class donor_class_id and a recipient of
+  // class recipient_class_id changes the reputation of the recipient
+  auto isFlipped = [&](int donor_class_id, int recipient_class_id) {
+    const int donor_id = (donor_class_id >> 1) / recipient_strategy_num;
+    const int recipient_id = (recipient_class_id >> 1) % recipient_strategy_num;
+    const int rep = recipient_class_id & 1;
+    const int donor_action_id = individuals.getDonorAction(donor_id, rep);
+    return individuals.assess(donor_action_id,
+                              individuals.getRecipientAction(
+                                  recipient_id, donor_action_id),
+                              rep) != rep;
+  };
+  // an index of eventWeights drawn proportionally to the weights
+  auto choose = [&](int num, double total, RandomStream& gen) {
+    double target = gen.nextDouble() * total;
+    int last = -1;
+    for (int k = 0; k < num; k++) {
+      if (this->eventWeights[k] > 0) {
+        last = k;
+        if (target < this->eventWeights[k]) {
+          return k;
+        }
+        target -= this->eventWeights[k];
+      }
+    }
+    return last;
+  };
+
+  // the probability of a change for a focal of each class
+  const std::vector<int>& counts = individuals.getStatistics().getTripleCounts();
+  this->eventClassIds.clear();
+  for (int class_id = 0; class_id < class_num; class_id++) {
+    if (counts[class_id] > 0) {
+      this->eventClassIds.push_back(class_id);
+    }
+  }
+  const int event_class_num = this->eventClassIds.size();
+  const double other_num = population - 1;
+  this->eventPayoffs.resize(event_class_num);
+  this->eventRates.resize(event_class_num);
+  this->eventWeights.resize(event_class_num * 2);
+  std::visit(
+      [&](auto kernel) {
+        for (int a = 0; a < event_class_num; a++) {
+          const int class_id = this->eventClassIds[a];
+          this->eventPayoffs[a] =
+              this->payoffCache.getAvgPayoff<decltype(kernel)>(
+                  class_id & 1, (class_id >> 1) / recipient_strategy_num,
+                  (class_id >> 1) % recipient_strategy_num);
+        }
+      },
+      this->payoffCache.getKernel());
+  double total_rate = 0;
+  for (int a = 0; a < event_class_num; a++) {
+    const int focal_class_id = this->eventClassIds[a];
+    double imitation_rate = 0;
+    double game_rate = 0;
+    for (int c = 0; c < event_class_num; c++) {
+      const int class_id = this->eventClassIds[c];
+      const double other_count = counts[class_id] - (c == a ? 1 : 0);
+      if ((class_id >> 1) != (focal_class_id >> 1)) {
+        imitation_rate += other_count * fermi(this->eventPayoffs[a],
+                                              this->eventPayoffs[c], this->s);
+      }
+      game_rate += other_count * (isFlipped(focal_class_id, class_id) +
+                                  isFlipped(class_id, focal_class_id));
+    }
+    const double strategy_rate =
+        this->mu + (1 - this->mu) * imitation_rate / other_num;
+    this->eventRates[a] =
+        strategy_rate + (1 - strategy_rate) * game_rate * 0.5 / other_num;
+    total_rate += counts[focal_class_id] * this->eventRates[a];
+  }
+  const double change_p = total_rate / population;
+  if (static_cast<double>(event_class_num) * event_class_num * change_p >
+      RATE_PAIRS_PER_STEP) {
+    const int step_num = std::min(population, maxStepNum);
+    for (int t = 0; t < step_num; t++) {
+      this->step();
+    }
+    return step_num;
+  }
+  if (change_p <= 0) {
+    return maxStepNum;
+  }
+  const double skipped_num =
+      change_p >= 1 ? 0
+                    : std::floor(std::log1p(-this->genDecision.nextDouble()) /
+                                 std::log1p(-change_p));
+  if (skipped_num >= maxStepNum) {
+    return maxStepNum;
+  }
+
+  // the focal, drawn by the members of its class times its rate
+  for (int a = 0; a < event_class_num; a++) {
+    this->eventWeights[a] = counts[this->eventClassIds[a]] * this->eventRates[a];
+  }
+  const int a = choose(event_class_num, total_rate, this->genDecision);
+  const int focal_class_id = this->eventClassIds[a];
+  const int focal_rank = this->genSelection.nextInt(counts[focal_class_id]);
+  const int focal_i = this->getClassMember(focal_class_id, focal_rank);
+  const int focal_pair_id = focal_class_id >> 1;
+  double imitation_rate = 0;
+  for (int c = 0; c < event_class_num; c++) {
+    const int class_id = this->eventClassIds[c];
+    this->eventWeights[c] =
+        (class_id >> 1) != focal_pair_id
+            ? counts[class_id] * fermi(this->eventPayoffs[a],
+                                       this->eventPayoffs[c], this->s)
+            : 0;
+    imitation_rate += this->eventWeights[c];
+  }
+  const double strategy_rate =
+      this->mu + (1 - this->mu) * imitation_rate / other_num;
+  if (this->genDecision.nextDouble() * this->eventRates[a] < strategy_rate) {
+    // the focal switches its pair and plays with a random co-player as in
+    // step()
+    int next_pair_id;
+    if (this->genDecision.nextDouble() * strategy_rate < this->mu) {
+      next_pair_id = this->genDecision.nextInt(this->strategyPairNum - 1);
+      if (next_pair_id >= focal_pair_id) {
+        next_pair_id++;
+      }
+    } else {
+      next_pair_id = this->eventClassIds[choose(
+                         event_class_num, imitation_rate, this->genDecision)] >>
+                     1;
+    }
+    this->setStrategies(focal_i, next_pair_id / recipient_strategy_num,
+                        next_pair_id % recipient_strategy_num);
+    int k = this->genSelection.nextInt(population - 1);
+    if (k >= focal_i) {
+      k++;
+    }
+    if (this->genDecision.nextDouble() > 0.5) {
+      this->playGame(focal_i, k);
+    } else {
+      this->playGame(k, focal_i);
+    }
+  } else {
+    // the focal keeps its pair and the game flips a reputation: 2 * c for
+    // the focal as the donor of class c, 2 * c + 1 as its recipient
+    double game_rate = 0;
+    for (int c = 0; c < event_class_num; c++) {
+      const int class_id = this->eventClassIds[c];
+      const double other_count = counts[class_id] - (c == a ? 1 : 0);
+      this->eventWeights[2 * c] =
+          other_count * isFlipped(focal_class_id, class_id);
+      this->eventWeights[2 * c + 1] =
+          other_count * isFlipped(class_id, focal_class_id);
+      game_rate += this->eventWeights[2 * c] + this->eventWeights[2 * c + 1];
+    }
+    const int event = choose(event_class_num * 2, game_rate, this->genDecision);
+    const int c = event / 2;
+    const int class_id = this->eventClassIds[c];
+    int rank;
+    if (c == a) {
+      rank = this->genSelection.nextInt(counts[class_id] - 1);
+      if (rank >= focal_rank) {
+        rank++;
+      }
+    } else {
+      rank = this->genSelection.nextInt(counts[class_id]);
+    }
+    const int k = this->getClassMember(class_id, rank);
+    if (event % 2 == 0) {
+      this->playGame(focal_i, k);
+    } else {
+      this->playGame(k, focal_i);
+    }
+  }
+  return static_cast<int>(skipped_num) + 1;
+}
+
+/**
+ * @brief set classBits and classBlockCounts from the population
+ *
+ */
+void Evolution::fillClassBits() {
+  const int class_num = this->strategyPairNum * 2;
+  const int block_num =
+      (this->classWordNum + CLASS_BLOCK_WORDS - 1) / CLASS_BLOCK_WORDS;
+  this->classBits.assign(class_num * this->classWordNum, 0);
+  this->classBlockCounts.assign(class_num * block_num, 0);
+  for (int i = 0; i < this->population; i++) {
+    const int class_id = this->getClassId(i);
+    this->classBits[class_id * this->classWordNum + (i >> 6)] |= uint64_t(1)
+                                                                 << (i & 63);
+    this->classBlockCounts[class_id * block_num +
+                           (i >> 6) / CLASS_BLOCK_WORDS]++;
+  }
+}
+
+/**
+ * @brief move individual i between two classes of classBits
+ *
+ * @param i
+ * @param fromClassId
+ * @param toClassId
+ */
+void Evolution::moveClass(int i, int fromClassId, int toClassId) {
+  if (fromClassId == toClassId) {
+    return;
+  }
+  const int block_num =
+      (this->classWordNum + CLASS_BLOCK_WORDS - 1) / CLASS_BLOCK_WORDS;
+  const int block = (i >> 6) / CLASS_BLOCK_WORDS;
+  this->classBits[fromClassId * this->classWordNum + (i >> 6)] ^=
+      uint64_t(1) << (i & 63);
+  this->classBits[toClassId * this->classWordNum + (i >> 6)] ^= uint64_t(1)
+                                                                << (i & 63);
+  this->classBlockCounts[fromClassId * block_num + block]--;
+  this->classBlockCounts[toClassId * block_num + block]++;
+}
+
+/**
+ * @brief the member of a class of the given rank in the order of the
+ * individual ids, O(#blocks + CLASS_BLOCK_WORDS)
+ *
+ * @param classId
+ * @param rank less than the members of the class
+ * @return int the individual id
+ */
+int Evolution::getClassMember(int classId, int rank) const {
+  const int block_num =
+      (this->classWordNum + CLASS_BLOCK_WORDS - 1) / CLASS_BLOCK_WORDS;
+  const uint64_t* bits = this->classBits.data() + classId * this->classWordNum;
+  const int* block_counts =
+      this->classBlockCounts.data() + classId * block_num;
+  int block = 0;
+  while (rank >= block_counts[block]) {
+    rank -= block_counts[block];
+    block++;
+  }
+  int word = block * CLASS_BLOCK_WORDS;
+  while (rank >= __builtin_popcountll(bits[word])) {
+    rank -= __builtin_popcountll(bits[word]);
+    word++;
+  }
+  uint64_t value = bits[word];
+  for (; rank > 0; rank--) {
+    value &= value - 1;
+  }
+  return word * 64 + __builtin_ctzll(value);
+}
+
+/**
+ * @brief save the population, the generation and the positions of the
+ * random streams into the checkpoint, the caller fills the step and the log
+ *
+ * @param checkpoint
+ */
+void Evolution::saveCheckpoint(Checkpoint& checkpoint) const {
+  const Population& individuals = this->individuals;
+  const int population = this->population;
+  checkpoint.generation = this->generation;
+  checkpoint.population = population;
+  checkpoint.donorStrategyIds.resize(population);
+  checkpoint.recipientStrategyIds.resize(population);
+  const int bit_num = individuals.getReputationBitNum();
+  checkpoint.reputationBitNum = bit_num;
+  checkpoint.reputationBits.assign(
+      (static_cast<uint64_t>(population) * bit_num + 63) / 64, 0);
+  for (int i = 0; i < population; i++) {
+    const uint64_t bit = static_cast<uint64_t>(i) * bit_num;
+    checkpoint.donorStrategyIds[i] = individuals.getDonorStrategyId(i);
+    checkpoint.recipientStrategyIds[i] = individuals.getRecipientStrategyId(i);
+    checkpoint.reputationBits[bit >> 6] |=
+        static_cast<uint64_t>(individuals.getReputationId(i)) << (bit & 63);
+  }
+  checkpoint.donorCounts = individuals.getDonorComposition().getCounts();
+  checkpoint.recipientCounts = individuals.getRecipientComposition().getCounts();
+  checkpoint.goodReputationNum = individuals.getGoodReputationNum();
+  checkpoint.streams.clear();
+  for (const RandomStream* gen : {&this->genInit, &this->genSelection,
+                                  &this->genDecision, &this->genCoopRate,
+                                  &this->genSync}) {
+    checkpoint.streams.push_back({gen->getStreamId(), gen->getPosition()});
+  }
+}
+
+/**
+ * @brief continue from a checkpoint of saveCheckpoint(), the evolution must
+ * be constructed with the same parameters, seed and replica
+ *
+ * @param checkpoint
+ */
+void Evolution::loadCheckpoint(Checkpoint const& checkpoint) {
+  Population& individuals = this->individuals;
+  RandomStream* streams[] = {&this->genInit, &this->genSelection,
+                             &this->genDecision, &this->genCoopRate,
+                             &this->genSync};
+  const int stream_num = sizeof(streams) / sizeof(streams[0]);
+  const int bit_num = individuals.getReputationBitNum();
+  bool match = checkpoint.population == this->population &&
+               checkpoint.reputationBitNum == bit_num &&
+               static_cast<int>(checkpoint.streams.size()) == stream_num;
+  for (int k = 0; match && k < stream_num; k++) {
+    match = checkpoint.streams[k].streamId == streams[k]->getStreamId();
+  }
+  if (!match) {
+    std::cerr << "checkpoint does not match the run of norm " << this->normId
+              << std::endl;
+    throw "checkpoint does not match the run";
+  }
+  bool is_broken = false;
+  for (int i = 0; i < this->population; i++) {
+    const uint64_t bit = static_cast<uint64_t>(i) * bit_num;
+    const int reputation_id = (checkpoint.reputationBits[bit >> 6] >>
+                               (bit & 63)) & ((uint64_t(1) << bit_num) - 1);
+    if (reputation_id >= individuals.getReputationNum()) {
+      is_broken = true;
+      break;
+    }
+    individuals.setStrategies(i, checkpoint.donorStrategyIds[i],
+                              checkpoint.recipientStrategyIds[i]);
+    individuals.setReputationId(i, reputation_id);
+  }
+  if (is_broken ||
+      individuals.getDonorComposition().getCounts() != checkpoint.donorCounts ||
+      individuals.getRecipientComposition().getCounts() !=
+          checkpoint.recipientCounts ||
+      individuals.getGoodReputationNum() != checkpoint.goodReputationNum) {
+    std::cerr << "broken checkpoint of norm " << this->normId << std::endl;
+    throw "broken checkpoint";
+  }
+  for (int k = 0; k < stream_num; k++) {
+    streams[k]->setPosition(checkpoint.streams[k].position);
+  }
+  this->generation = checkpoint.generation;
+  this->payoffCache.setCounts(individuals.getDonorComposition(),
+                              individuals.getRecipientComposition());
+  this->payoffCacheGoodNum = -1;
+  this->classBits.clear();
+}
+
+/**
+ * @brief whether the run can no longer change: without mutation, all
+ * individuals use one strategy pair (so imitation copies the same pair) and
+ * the norm assesses every reputation present in the population to itself
+ * (the game of a recipient only depends on its own reputation)
+ *
+ * @return true if the rest of the log would repeat the current row
+ */
+bool Evolution::isAbsorbed() const {
+  const Population& individuals = this->individuals;
+  if (this->mu > 0) {
+    return false;
+  }
+  const int donor_id = individuals.getDonorStrategyId(0);
+  const int recipient_id = individuals.getRecipientStrategyId(0);
+  if (individuals.getStatistics().getPairCount(donor_id, recipient_id) !=
+      this->population) {
+    return false;
+  }
+  for (int rep = 0; rep < individuals.getReputationNum(); rep++) {
+    if (individuals.getStatistics().getReputationCount(rep) == 0) {
+      continue;
+    }
+    int donor_action_id = individuals.getDonorAction(donor_id, rep);
+    int recipient_action_id =
+        individuals.getRecipientAction(recipient_id, donor_action_id);
+    if (individuals.assess(donor_action_id, recipient_action_id, rep) != rep) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief the observables of the stationarity test: the frequencies of the
+ * strategy pairs, the good reputation frequency and the cooperation rate
+ *
+ * @param values resized to strategyPairNum + 2
+ */
+void Evolution::getObservables(std::vector<double>& values) const {
+  const Population& individuals = this->individuals;
+  const Statistics& statistics = individuals.getStatistics();
+  values.resize(this->strategyPairNum + 2);
+  int k = 0;
+  for (const Strategy& donorS : this->donorStrategies) {
+    for (const Strategy& recipientS : this->recipientStrategies) {
+      values[k++] = static_cast<double>(statistics.getPairCount(
+                        donorS.getId(), recipientS.getId())) /
+                    this->population;
+    }
+  }
+  values[k++] =
+      static_cast<double>(individuals.getGoodReputationNum()) / this->population;
+  values[k++] = getCoopRate(individuals, this->coopActionId);
+}
+
+/**
+ * @brief the header of the log: step, the strategy pairs, the donor
+ * strategies, the recipient strategies, good_rep and cr
+ *
+ * @param donorStrategies
+ * @param recipientStrategies
+ * @return std::vector<std::string>
+ */
+std::vector<std::string> getLogColumnNames(
+    const std::vector<Strategy>& donorStrategies,
+    const std::vector<Strategy>& recipientStrategies) {
+  std::vector<std::string> column_names = {"step"};
+  for (const Strategy& donor_s : donorStrategies) {
+    for (const Strategy& recipient_s : recipientStrategies) {
+      column_names.push_back(donor_s.getName() + "-" + recipient_s.getName());
+    }
+  }
+  for (const Strategy& donor_s : donorStrategies) {
+    column_names.push_back(donor_s.getName());
+  }
+  for (const Strategy& recipient_s : recipientStrategies) {
+    column_names.push_back(recipient_s.getName());
+  }
+  column_names.push_back("good_rep");
+  column_names.push_back("cr");
+  return column_names;
+}
+
+/**
+ * @brief the column types of the binary log, in the order of
+ * getLogColumnNames()
+ *
+ * @param columnNum
+ * @return std::vector<BinaryLogColumnType>
+ */
+std::vector<BinaryLogColumnType> getLogColumnTypes(int columnNum) {
+  std::vector<BinaryLogColumnType> column_types(columnNum,
+                                                BinaryLogColumnType::COUNT);
+  column_types.front() = BinaryLogColumnType::UINT32;
+  column_types.back() = BinaryLogColumnType::FLOAT32;
+  return column_types;
+}
+
+std::vector<std::string> Evolution::getLogColumnNames() const {
+  return ::getLogColumnNames(this->donorStrategies, this->recipientStrategies);
+}
+
+std::vector<BinaryLogColumnType> Evolution::getLogColumnTypes() const {
+  return ::getLogColumnTypes(this->getLogColumnNames().size());
+}
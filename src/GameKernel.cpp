@@ -0,0 +1,44 @@
+#include "GameKernel.hpp"
+
+namespace {
+template <int DONOR_NUM>
+GameKernelVariant getFixedDonorKernel(int recipientStrategyNum) {
+  switch (recipientStrategyNum) {
+    case 1:
+      return GameKernel<DONOR_NUM, 1>();
+    case 2:
+      return GameKernel<DONOR_NUM, 2>();
+    case 3:
+      return GameKernel<DONOR_NUM, 3>();
+    case 4:
+      return GameKernel<DONOR_NUM, 4>();
+    default:
+      return GameKernel<DYNAMIC_STRATEGY_NUM, DYNAMIC_STRATEGY_NUM>();
+  }
+}
+}  // namespace
+
+/**
+ * @brief the GameKernel of the game, unrolled for up to 4 donor and 4
+ * recipient strategies (the 4x4 game of the payoff matrices and its
+ * subgames), the dynamic one otherwise
+ *
+ * @param donorStrategyNum the rows of the payoff matrix
+ * @param recipientStrategyNum the columns of the payoff matrix
+ * @return GameKernelVariant
+ */
+GameKernelVariant getGameKernel(int donorStrategyNum,
+                                int recipientStrategyNum) {
+  switch (donorStrategyNum) {
+    case 1:
+      return getFixedDonorKernel<1>(recipientStrategyNum);
+    case 2:
+      return getFixedDonorKernel<2>(recipientStrategyNum);
+    case 3:
+      return getFixedDonorKernel<3>(recipientStrategyNum);
+    case 4:
+      return getFixedDonorKernel<4>(recipientStrategyNum);
+    default:
+      return GameKernel<DYNAMIC_STRATEGY_NUM, DYNAMIC_STRATEGY_NUM>();
+  }
+}
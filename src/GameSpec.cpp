@@ -0,0 +1,407 @@
+#include "GameSpec.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <regex>
+
+#include "CompiledPayoffMatrix.hpp"
+
+namespace {
+const char HEADER_MAGIC[8] = {'R', 'E', 'P', 'G', 'A', 'M', 'E', '1'};
+const char END_MAGIC[8] = {'R', 'E', 'P', 'G', 'M', 'E', 'N', 'D'};
+const uint32_t VERSION = 1;
+
+std::mutex default_mutex;
+std::shared_ptr<const GameSpec> default_spec;
+
+template <typename T>
+void writeValue(std::ofstream& file, T value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void writeString(std::ofstream& file, std::string const& value) {
+  writeValue<uint32_t>(file, value.size());
+  file.write(value.data(), value.size());
+}
+
+template <typename T>
+void readValue(std::ifstream& file, T& value) {
+  file.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+/**
+ * @brief whether size more bytes are left in the file of fileSize bytes, so a
+ * broken cache is not trusted with a huge resize
+ */
+bool hasBytes(std::ifstream& file, uint64_t fileSize, uint64_t size) {
+  const std::streamoff pos = file.tellg();
+  return file && pos >= 0 && size <= fileSize - static_cast<uint64_t>(pos);
+}
+
+bool readString(std::ifstream& file, uint64_t fileSize, std::string& value) {
+  uint32_t size = 0;
+  readValue(file, size);
+  if (!hasBytes(file, fileSize, size)) {
+    return false;
+  }
+  value.resize(size);
+  file.read(&value[0], size);
+  return static_cast<bool>(file);
+}
+
+/**
+ * @brief the files of dir (relative to root) whose names match the pattern,
+ * sorted by name
+ */
+void addFiles(std::filesystem::path const& root, std::string const& dir,
+              std::regex const& pattern, std::vector<GameFile>& files) {
+  std::vector<std::string> names;
+  if (!std::filesystem::is_directory(root / dir)) {
+    return;
+  }
+  for (auto const& entry : std::filesystem::directory_iterator(root / dir)) {
+    std::string name = entry.path().filename().string();
+    if (entry.is_regular_file() && std::regex_match(name, pattern)) {
+      names.push_back(name);
+    }
+  }
+  std::sort(names.begin(), names.end());
+  for (std::string const& name : names) {
+    GameFile file;
+    file.path = dir + "/" + name;
+    file.size = std::filesystem::file_size(root / file.path);
+    file.modifiedTime = std::filesystem::last_write_time(root / file.path)
+                            .time_since_epoch()
+                            .count();
+    files.push_back(file);
+  }
+}
+
+/**
+ * @brief the sorted subdirectories of dir (relative to root)
+ */
+std::vector<std::string> listDirs(std::filesystem::path const& root,
+                                  std::string const& dir) {
+  std::vector<std::string> dirs;
+  if (!std::filesystem::is_directory(root / dir)) {
+    return dirs;
+  }
+  for (auto const& entry : std::filesystem::directory_iterator(root / dir)) {
+    if (entry.is_directory()) {
+      dirs.push_back(dir + "/" + entry.path().filename().string());
+    }
+  }
+  std::sort(dirs.begin(), dirs.end());
+  return dirs;
+}
+}  // namespace
+
+/**
+ * @brief the game files of the root sorted by path, without their cells
+ *
+ * @param root
+ * @return std::vector<GameFile>
+ */
+std::vector<GameFile> GameSpec::listFiles(std::string const& root) {
+  std::vector<GameFile> files;
+  const std::filesystem::path rootPath(root);
+  for (std::string const& dir : listDirs(rootPath, "payoffMatrix")) {
+    addFiles(rootPath, dir, std::regex("PayoffMatrix[0-9]+\\.csv"), files);
+  }
+  addFiles(rootPath, "norm", std::regex("norm[0-9]+\\.csv"), files);
+  for (std::string const& dir : listDirs(rootPath, "strategy")) {
+    addFiles(rootPath, dir, std::regex(".+\\.csv"), files);
+  }
+  // the order of the cache
+  std::sort(files.begin(), files.end(),
+            [](GameFile const& a, GameFile const& b) { return a.path < b.path; });
+  return files;
+}
+
+/**
+ * @brief read the cells of the cache if its files are the listed files of
+ * the same sizes and modification times
+ *
+ * @param cachePath
+ * @param files the listed files, their cells are filled on success
+ * @return true if the cache is up to date
+ */
+bool GameSpec::readCache(std::string const& cachePath,
+                         std::vector<GameFile>& files) {
+  std::ifstream file(cachePath, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+  const std::streamoff file_size = file.tellg();
+  if (file_size < 0) {
+    return false;
+  }
+  file.seekg(0);
+  char magic[8] = {};
+  uint32_t version = 0;
+  uint32_t fileNum = 0;
+  file.read(magic, sizeof(magic));
+  readValue(file, version);
+  readValue(file, fileNum);
+  if (!file || std::memcmp(magic, HEADER_MAGIC, sizeof(magic)) != 0 ||
+      version != VERSION || fileNum != files.size()) {
+    return false;
+  }
+  std::vector<CsvTable> tables(fileNum);
+  for (uint32_t i = 0; i < fileNum; i++) {
+    std::string path;
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+    uint32_t rowNum = 0;
+    if (!readString(file, file_size, path)) {
+      return false;
+    }
+    readValue(file, size);
+    readValue(file, modifiedTime);
+    readValue(file, rowNum);
+    // each row takes at least its cell number, each cell its string size
+    if (!file || path != files[i].path || size != files[i].size ||
+        modifiedTime != files[i].modifiedTime ||
+        !hasBytes(file, file_size, uint64_t(rowNum) * sizeof(uint32_t))) {
+      return false;
+    }
+    tables[i].resize(rowNum);
+    for (uint32_t row = 0; row < rowNum; row++) {
+      uint32_t cellNum = 0;
+      readValue(file, cellNum);
+      if (!hasBytes(file, file_size, uint64_t(cellNum) * sizeof(uint32_t))) {
+        return false;
+      }
+      tables[i][row].resize(cellNum);
+      for (uint32_t cell = 0; cell < cellNum; cell++) {
+        if (!readString(file, file_size, tables[i][row][cell])) {
+          return false;
+        }
+      }
+    }
+  }
+  file.read(magic, sizeof(magic));
+  if (!file || std::memcmp(magic, END_MAGIC, sizeof(magic)) != 0) {
+    return false;
+  }
+  for (uint32_t i = 0; i < fileNum; i++) {
+    files[i].table = std::move(tables[i]);
+  }
+  return true;
+}
+
+/**
+ * @brief write the cache atomically, to cachePath + ".tmp" first and then
+ * renamed to cachePath
+ *
+ * @param cachePath
+ * @param files
+ */
+void GameSpec::writeCache(std::string const& cachePath,
+                          std::map<std::string, GameFile> const& files) {
+  const std::string tmpPath = cachePath + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      std::cerr << "can not write the game cache: " << tmpPath << std::endl;
+      throw "can not write the game cache";
+    }
+    file.write(HEADER_MAGIC, sizeof(HEADER_MAGIC));
+    writeValue<uint32_t>(file, VERSION);
+    writeValue<uint32_t>(file, files.size());
+    for (auto const& [path, gameFile] : files) {
+      writeString(file, path);
+      writeValue<uint64_t>(file, gameFile.size);
+      writeValue<int64_t>(file, gameFile.modifiedTime);
+      writeValue<uint32_t>(file, gameFile.table.size());
+      for (std::vector<std::string> const& row : gameFile.table) {
+        writeValue<uint32_t>(file, row.size());
+        for (std::string const& cell : row) {
+          writeString(file, cell);
+        }
+      }
+    }
+    file.write(END_MAGIC, sizeof(END_MAGIC));
+    file.flush();
+    if (!file) {
+      std::cerr << "can not write the game cache: " << tmpPath << std::endl;
+      throw "can not write the game cache";
+    }
+  }
+  std::filesystem::rename(tmpPath, cachePath);
+}
+
+/**
+ * @brief Construct a new Game Spec, load and validate the game files of the
+ * root
+ *
+ * @param root the working directory of the game files
+ * @param cachePath the binary cache, empty for none
+ */
+GameSpec::GameSpec(std::string const& root, std::string const& cachePath)
+    : root(root) {
+  std::vector<GameFile> listed = listFiles(root);
+  const bool cached = !cachePath.empty() && readCache(cachePath, listed);
+  for (GameFile& file : listed) {
+    if (!cached) {
+      file.table = readCsvTable(
+          (std::filesystem::path(root) / file.path).string());
+    }
+    this->files[file.path] = std::move(file);
+  }
+  this->validate();
+  if (!cachePath.empty() && !cached) {
+    writeCache(cachePath, this->files);
+  }
+}
+
+GameSpec::~GameSpec() {}
+
+/**
+ * @brief parse every payoff matrix and compile it with its players, and
+ * every norm with the actions C and D of Evolution
+ *
+ */
+void GameSpec::validate() {
+  const std::vector<Action> actions{Action("C", 0), Action("D", 1)};
+  const std::regex normPattern("norm/norm([0-9]+)\\.csv");
+  // a root without strategies only checks the payoff matrices and the norms
+  const bool hasStrategies =
+      std::any_of(this->files.begin(), this->files.end(), [](auto const& file) {
+        return file.first.rfind("strategy/", 0) == 0;
+      });
+  for (auto const& [path, file] : this->files) {
+    try {
+      std::smatch match;
+      if (path.rfind("payoffMatrix/", 0) == 0) {
+        PayoffMatrix payoffMatrix(file.table);
+        payoffMatrix.compile();
+        if (hasStrategies) {
+          this->getPlayer("donor", actions, payoffMatrix.getRowStrategies());
+          this->getPlayer("recipient", actions,
+                          payoffMatrix.getColStrategies());
+        }
+        this->payoffMatrices[path] = payoffMatrix;
+      } else if (std::regex_match(path, match, normPattern)) {
+        this->getNorm(std::stoi(match[1]), actions, actions);
+      }
+    } catch (...) {
+      std::cerr << "invalid game file: " << this->root << "/" << path
+                << std::endl;
+      throw "invalid game file";
+    }
+  }
+}
+
+/**
+ * @brief the cells of a file
+ *
+ * @param path relative to the root
+ * @return const CsvTable&
+ */
+const CsvTable& GameSpec::getTable(std::string const& path) const {
+  auto file = this->files.find(path);
+  if (file == this->files.end()) {
+    std::cerr << "game file not found: " << this->root << "/" << path
+              << std::endl;
+    throw "game file not found";
+  }
+  return file->second.table;
+}
+
+std::string GameSpec::getPayoffMatrixPath(std::string const& configName,
+                                          int normId) {
+  return "payoffMatrix/" + configName + "/PayoffMatrix" +
+         std::to_string(normId) + ".csv";
+}
+
+std::string GameSpec::getNormPath(int normId) {
+  return "norm/norm" + std::to_string(normId) + ".csv";
+}
+
+/**
+ * @brief a copy of the parsed payoff matrix, the vars are to be assigned
+ *
+ * @param configName the directory in payoffMatrix, such as
+ * "payoffMatrix_shortterm"
+ * @param normId
+ * @return PayoffMatrix
+ */
+PayoffMatrix GameSpec::getPayoffMatrix(std::string const& configName,
+                                       int normId) const {
+  const std::string path = getPayoffMatrixPath(configName, normId);
+  auto payoffMatrix = this->payoffMatrices.find(path);
+  if (payoffMatrix == this->payoffMatrices.end()) {
+    std::cerr << "game file not found: " << this->root << "/" << path
+              << std::endl;
+    throw "game file not found";
+  }
+  return payoffMatrix->second;
+}
+
+/**
+ * @brief the norm of normId, with the dense table of the actions
+ *
+ * @param normId
+ * @param donorActions
+ * @param recipientActions
+ * @return Norm
+ */
+Norm GameSpec::getNorm(int normId, std::vector<Action> const& donorActions,
+                       std::vector<Action> const& recipientActions) const {
+  return Norm(this->getTable(getNormPath(normId)), donorActions,
+              recipientActions);
+}
+
+/**
+ * @brief the template player of a role with the strategy tables of
+ * strategy/<role>/, the first strategy is set
+ *
+ * @param role "donor" or "recipient"
+ * @param actions
+ * @param strategies
+ * @return Player
+ */
+Player GameSpec::getPlayer(std::string const& role,
+                           std::vector<Action> const& actions,
+                           std::vector<Strategy> const& strategies) const {
+  std::map<std::string, CsvTable> tables;
+  for (Strategy const& strategy : strategies) {
+    tables[strategy.getName()] =
+        this->getTable("strategy/" + role + "/" + strategy.getName() + ".csv");
+  }
+  Player player(role, 0, actions);
+  player.setStrategies(strategies);
+  player.loadStrategyTables(tables);
+  player.setStrategy(strategies[0].getName());
+  return player;
+}
+
+/**
+ * @brief the game of the process, loaded from the working directory without
+ * a cache on the first call unless setDefault() was called
+ *
+ * @return std::shared_ptr<const GameSpec>
+ */
+std::shared_ptr<const GameSpec> GameSpec::getDefault() {
+  std::lock_guard<std::mutex> lock(default_mutex);
+  if (!default_spec) {
+    default_spec = std::make_shared<const GameSpec>(".");
+  }
+  return default_spec;
+}
+
+/**
+ * @brief replace the game of the process, the runs started before keep the
+ * old one
+ *
+ * @param spec
+ */
+void GameSpec::setDefault(std::shared_ptr<const GameSpec> spec) {
+  std::lock_guard<std::mutex> lock(default_mutex);
+  default_spec = spec;
+}
@@ -0,0 +1,294 @@
+#include "InteractionGraph.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief build the compressed sparse rows of an undirected graph, the
+ * self-loops and repeated edges are dropped
+ *
+ * @param spec the name of the graph, e.g. "regular:4"
+ * @param nodeNum
+ * @param edges every edge once, in either direction
+ */
+InteractionGraph::InteractionGraph(std::string const& spec, int nodeNum,
+                                   std::vector<Edge> edges)
+    : spec(spec), nodeNum(nodeNum), offsets(nodeNum + 1, 0) {
+  for (const Edge& edge : edges) {
+    if (edge.first < 0 || edge.first >= nodeNum || edge.second < 0 ||
+        edge.second >= nodeNum) {
+      std::cerr << "graph edge error: " << edge.first << " " << edge.second
+                << " of " << nodeNum << " nodes" << std::endl;
+      throw "graph edge error";
+    }
+    if (edge.first != edge.second) {
+      this->offsets[edge.first + 1]++;
+      this->offsets[edge.second + 1]++;
+    }
+  }
+  for (int i = 0; i < nodeNum; i++) {
+    this->offsets[i + 1] += this->offsets[i];
+  }
+  this->neighbors.resize(this->offsets[nodeNum]);
+  std::vector<int64_t> next(this->offsets.begin(), this->offsets.end() - 1);
+  for (const Edge& edge : edges) {
+    if (edge.first != edge.second) {
+      this->neighbors[next[edge.first]++] = edge.second;
+      this->neighbors[next[edge.second]++] = edge.first;
+    }
+  }
+  edges = std::vector<Edge>();
+
+  // sort the rows and compact them without the repeated neighbors
+  int64_t size = 0;
+  for (int i = 0; i < nodeNum; i++) {
+    auto begin = this->neighbors.begin() + this->offsets[i];
+    auto end = this->neighbors.begin() + this->offsets[i + 1];
+    std::sort(begin, end);
+    end = std::unique(begin, end);
+    this->offsets[i] = size;
+    for (auto it = begin; it != end; it++) {
+      this->neighbors[size++] = *it;
+    }
+  }
+  this->offsets[nodeNum] = size;
+  this->neighbors.resize(size);
+  this->neighbors.shrink_to_fit();
+}
+
+InteractionGraph::~InteractionGraph() {}
+
+/**
+ * @brief generate or load the graph of the spec, see InteractionGraph.hpp
+ *
+ * @param spec
+ * @param nodeNum
+ * @param gen the random numbers of the random graphs
+ * @return InteractionGraph
+ */
+InteractionGraph InteractionGraph::create(std::string const& spec, int nodeNum,
+                                          RandomStream& gen) {
+  if (spec.compare(0, 5, "file:") == 0) {
+    return fromEdgeList(spec.substr(5), nodeNum);
+  }
+  std::vector<std::string> fields;
+  std::stringstream ss(spec);
+  std::string field;
+  while (std::getline(ss, field, ':')) {
+    fields.push_back(field);
+  }
+  try {
+    if (fields.size() == 1 && fields[0] == "lattice") {
+      return lattice(nodeNum);
+    } else if (fields.size() == 2 && fields[0] == "regular") {
+      return randomRegular(nodeNum, std::stoi(fields[1]), gen);
+    } else if (fields.size() == 3 && fields[0] == "smallworld") {
+      return smallWorld(nodeNum, std::stoi(fields[1]), std::stod(fields[2]),
+                        gen);
+    } else if (fields.size() == 2 && fields[0] == "scalefree") {
+      return scaleFree(nodeNum, std::stoi(fields[1]), gen);
+    }
+  } catch (const std::logic_error&) {
+    // the number is malformed, reported below
+  }
+  std::cerr << "graph spec error: " << spec << std::endl;
+  throw "graph spec error";
+}
+
+/**
+ * @brief the periodic square lattice, every node has the 4 nodes up, down,
+ * left and right as neighbors
+ *
+ * @param nodeNum must be the square of a side >= 3
+ * @return InteractionGraph
+ */
+InteractionGraph InteractionGraph::lattice(int nodeNum) {
+  int side = static_cast<int>(std::lround(std::sqrt(nodeNum)));
+  if (side * side != nodeNum || side < 3) {
+    std::cerr << "lattice node number must be a square: " << nodeNum
+              << std::endl;
+    throw "lattice node number error";
+  }
+  std::vector<Edge> edges;
+  edges.reserve(static_cast<size_t>(nodeNum) * 2);
+  for (int row = 0; row < side; row++) {
+    for (int col = 0; col < side; col++) {
+      int i = row * side + col;
+      edges.emplace_back(i, row * side + (col + 1) % side);
+      edges.emplace_back(i, ((row + 1) % side) * side + col);
+    }
+  }
+  return InteractionGraph("lattice", nodeNum, std::move(edges));
+}
+
+/**
+ * @brief the random regular graph of the configuration model: the degree
+ * stubs of all nodes are shuffled and paired. The expected number of
+ * self-loops and multi-edges is O(degree^2) whatever the node number, they
+ * are dropped so a few nodes have a smaller degree
+ *
+ * @param nodeNum
+ * @param degree nodeNum * degree must be even
+ * @param gen
+ * @return InteractionGraph
+ */
+InteractionGraph InteractionGraph::randomRegular(int nodeNum, int degree,
+                                                 RandomStream& gen) {
+  if (degree < 1 || degree >= nodeNum ||
+      (static_cast<int64_t>(nodeNum) * degree) % 2 != 0) {
+    std::cerr << "regular graph degree error: " << degree << " of " << nodeNum
+              << " nodes" << std::endl;
+    throw "regular graph degree error";
+  }
+  std::vector<int32_t> stubs(static_cast<size_t>(nodeNum) * degree);
+  for (size_t i = 0; i < stubs.size(); i++) {
+    stubs[i] = i / degree;
+  }
+  for (size_t i = stubs.size() - 1; i > 0; i--) {
+    std::swap(stubs[i], stubs[gen.nextInt(i + 1)]);
+  }
+  std::vector<Edge> edges;
+  edges.reserve(stubs.size() / 2);
+  for (size_t i = 0; i < stubs.size(); i += 2) {
+    edges.emplace_back(stubs[i], stubs[i + 1]);
+  }
+  stubs = std::vector<int32_t>();
+  return InteractionGraph("regular:" + std::to_string(degree), nodeNum,
+                          std::move(edges));
+}
+
+/**
+ * @brief the Watts-Strogatz small world: every node is linked to the degree /
+ * 2 next nodes of a ring, and the far end of each of these edges is moved to
+ * a random node with probability beta (the repeated edges are dropped)
+ *
+ * @param nodeNum
+ * @param degree even, in [2, nodeNum)
+ * @param beta in [0, 1]
+ * @param gen
+ * @return InteractionGraph
+ */
+InteractionGraph InteractionGraph::smallWorld(int nodeNum, int degree,
+                                              double beta, RandomStream& gen) {
+  if (degree < 2 || degree >= nodeNum || degree % 2 != 0 || beta < 0 ||
+      beta > 1) {
+    std::cerr << "small world graph error: degree " << degree << ", beta "
+              << beta << " of " << nodeNum << " nodes" << std::endl;
+    throw "small world graph error";
+  }
+  std::vector<Edge> edges;
+  edges.reserve(static_cast<size_t>(nodeNum) * degree / 2);
+  for (int i = 0; i < nodeNum; i++) {
+    for (int j = 1; j <= degree / 2; j++) {
+      int target = (i + j) % nodeNum;
+      if (gen.nextDouble() < beta) {
+        target = gen.nextInt(nodeNum - 1);
+        if (target >= i) {
+          target++;
+        }
+      }
+      edges.emplace_back(i, target);
+    }
+  }
+  std::ostringstream spec;
+  spec << "smallworld:" << degree << ":" << beta;
+  return InteractionGraph(spec.str(), nodeNum, std::move(edges));
+}
+
+/**
+ * @brief the Barabasi-Albert graph: starting from a clique of m + 1 nodes,
+ * every new node is linked to m different nodes chosen with probability
+ * proportional to their degree (uniform over the ends of the edges so far)
+ *
+ * @param nodeNum
+ * @param m in [1, nodeNum)
+ * @param gen
+ * @return InteractionGraph
+ */
+InteractionGraph InteractionGraph::scaleFree(int nodeNum, int m,
+                                             RandomStream& gen) {
+  if (m < 1 || m >= nodeNum) {
+    std::cerr << "scale free graph error: m " << m << " of " << nodeNum
+              << " nodes" << std::endl;
+    throw "scale free graph error";
+  }
+  std::vector<Edge> edges;
+  edges.reserve(static_cast<size_t>(nodeNum) * m);
+  std::vector<int32_t> ends;  //< every node appears once per edge
+  ends.reserve(static_cast<size_t>(nodeNum) * m * 2);
+  for (int i = 0; i <= m; i++) {
+    for (int j = i + 1; j <= m; j++) {
+      edges.emplace_back(i, j);
+      ends.push_back(i);
+      ends.push_back(j);
+    }
+  }
+  std::vector<int32_t> targets;
+  for (int i = m + 1; i < nodeNum; i++) {
+    targets.clear();
+    while (static_cast<int>(targets.size()) < m) {
+      int32_t target = ends[gen.nextInt(ends.size())];
+      if (std::find(targets.begin(), targets.end(), target) == targets.end()) {
+        targets.push_back(target);
+      }
+    }
+    for (int32_t target : targets) {
+      edges.emplace_back(i, target);
+      ends.push_back(i);
+      ends.push_back(target);
+    }
+  }
+  ends = std::vector<int32_t>();
+  return InteractionGraph("scalefree:" + std::to_string(m), nodeNum,
+                          std::move(edges));
+}
+
+/**
+ * @brief load the edge list of a file, one edge "u v" per line, the empty
+ * lines and the lines starting with # are skipped
+ *
+ * @param path
+ * @param nodeNum the nodes are 0 to nodeNum - 1
+ * @return InteractionGraph
+ */
+InteractionGraph InteractionGraph::fromEdgeList(std::string const& path,
+                                                int nodeNum) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    throw "Failed to open file";
+  }
+  std::vector<Edge> edges;
+  std::string line;
+  while (std::getline(file, line)) {
+    size_t pos = line.find_first_not_of(" \t\r");
+    if (pos == std::string::npos || line[pos] == '#') {
+      continue;
+    }
+    std::istringstream ss(line);
+    int64_t u, v;
+    if (!(ss >> u >> v)) {
+      std::cerr << "edge list line error: " << line << std::endl;
+      throw "edge list line error";
+    }
+    if (u < 0 || u >= nodeNum || v < 0 || v >= nodeNum) {
+      std::cerr << "edge list node error: " << line << " of " << nodeNum
+                << " nodes" << std::endl;
+      throw "edge list node error";
+    }
+    edges.emplace_back(u, v);
+  }
+  return InteractionGraph("file:" + path, nodeNum, std::move(edges));
+}
+
+int InteractionGraph::getMinDegree() const {
+  int res = this->nodeNum > 0 ? this->getDegree(0) : 0;
+  for (int i = 1; i < this->nodeNum; i++) {
+    res = std::min(res, this->getDegree(i));
+  }
+  return res;
+}
@@ -92,12 +92,14 @@ void pretty_print(std::ostream& os, boost::json::value const& jv,
  * 
  * @param json_dir_path  the path of json file
  * @param jv  the json value
+ * @param log_file_ext  the extension of the log file, ".csv" or ".rlog" (binary log)
  * 
  * @return std::string  the log file path
  * 
  */
   // judge if the path exists, if not, create it
-std::string logJson(std::string const& json_dir_path, boost::json::value const& jv) {
+std::string logJson(std::string const& json_dir_path, boost::json::value const& jv,
+                    std::string const& log_file_ext) {
   if (!std::filesystem::exists(json_dir_path)) {
     std::filesystem::create_directory(json_dir_path);
   }
@@ -109,7 +111,7 @@ std::string logJson(std::string const& json_dir_path, boost::json::value const&
   std::string time_str = genTimeStr();
   std::string file_name = time_str +"_"+ uuid_str;
   std::string json_file_name = file_name + ".json";
-  std::string log_file_name = file_name + ".csv";
+  std::string log_file_name = file_name + log_file_ext;
   // generate a json file path
   std::string json_file_path = json_dir_path + "/" + json_file_name;
   std::string log_file_path = json_dir_path + "/" + log_file_name;
@@ -122,6 +124,26 @@ std::string logJson(std::string const& json_dir_path, boost::json::value const&
   return log_file_path;
 }
 
+/**
+ * @brief rewrite the json file of a log written by logJson, e.g. to record
+ * how the run ended
+ *
+ * @param log_file_path  the log file path returned by logJson
+ * @param jv  the json value, "data" is set to the log file path again
+ * @param log_file_ext  the extension given to logJson
+ */
+void updateLogJson(std::string const& log_file_path, boost::json::value const& jv,
+                   std::string const& log_file_ext) {
+  std::string json_file_path =
+      log_file_path.substr(0, log_file_path.size() - log_file_ext.size()) + ".json";
+  boost::json::object obj = jv.get_object();
+  obj["data"] = log_file_path;
+  std::ofstream ofs(json_file_path + ".tmp");
+  pretty_print(ofs, obj);
+  ofs.close();
+  std::filesystem::rename(json_file_path + ".tmp", json_file_path);
+}
+
 /**
  * @brief generate a time string as the format of "YYYYMMDDHHMMSS"
  * 
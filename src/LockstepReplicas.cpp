@@ -0,0 +1,953 @@
+#include "LockstepReplicas.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "Action.hpp"
+#include "Evolution.hpp"
+
+#ifdef LOCKSTEP_REPLICAS_AVX2
+#include <immintrin.h>
+
+// the AVX2 functions are compiled for AVX2 whatever the flags of the build,
+// and only called if the CPU has it
+#define LOCKSTEP_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+namespace {
+/** @brief the |x| below which expPolynomial is within 1e-12 of exp */
+const double EXP_POLYNOMIAL_BOUND = 700;
+
+/**
+ * @brief exp(x) for |x| < EXP_POLYNOMIAL_BOUND with a relative error below
+ * 1e-12: 2^n of the exponent bits times a Taylor polynomial of the rest
+ * (|f| <= ln2 / 2). It has no call and no branch, so a loop of it is
+ * vectorized, unlike std::exp
+ *
+ * @param x
+ * @return double
+ */
+inline double expPolynomial(double x) {
+  // 1.5 * 2^52: t - shifter is x / ln2 rounded to an integer n, and the low
+  // bits of t are n
+  const double shifter = 6755399441055744.0;
+  const double y = std::min(std::max(x * 1.4426950408889634, -1010.0), 1010.0);
+  const double t = y + shifter;
+  const double n = t - shifter;
+  const double f = (y - n) * 0.6931471805599453;
+  const double polynomial =
+      1 + f * (1 + f * (1.0 / 2 + f * (1.0 / 6 + f * (1.0 / 24 + f * (
+              1.0 / 120 + f * (1.0 / 720 + f * (1.0 / 5040 + f * (
+              1.0 / 40320 + f * (1.0 / 362880 + f * (1.0 / 3628800))))))))));
+  int64_t t_bits;
+  int64_t shifter_bits;
+  std::memcpy(&t_bits, &t, sizeof(t));
+  std::memcpy(&shifter_bits, &shifter, sizeof(shifter));
+  const int64_t scale_bits = (t_bits - shifter_bits + 1023) << 52;
+  double scale;
+  std::memcpy(&scale, &scale_bits, sizeof(scale));
+  return polynomial * scale;
+}
+
+/**
+ * @brief the unit double of the 64 bits high:low, as RandomStream::nextDouble
+ *
+ * @param high
+ * @param low
+ * @return double
+ */
+inline double toUnitDouble(uint32_t high, uint32_t low) {
+  const uint64_t bits = (static_cast<uint64_t>(high) << 32) | low;
+  return (bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+#ifdef LOCKSTEP_REPLICAS_AVX2
+static_assert(LockstepReplicas::LANE_NUM == 8,
+              "the AVX2 stages hold the 8 lanes in a register");
+
+LOCKSTEP_AVX2_TARGET inline __m256i loadLanes(const void* lanes) {
+  return _mm256_loadu_si256(static_cast<const __m256i*>(lanes));
+}
+
+LOCKSTEP_AVX2_TARGET inline void storeLanes(void* lanes, __m256i values) {
+  _mm256_storeu_si256(static_cast<__m256i*>(lanes), values);
+}
+
+/** @brief the lanes 4 * h to 4 * h + 3 */
+LOCKSTEP_AVX2_TARGET inline __m128i halfOf(__m256i values, int h) {
+  return h == 0 ? _mm256_castsi256_si128(values)
+                : _mm256_extracti128_si256(values, 1);
+}
+
+/**
+ * @brief the doubles at base[index] of 4 lanes, _mm256_i32gather_pd with a
+ * zero source, which spares the warning of its undefined one
+ */
+LOCKSTEP_AVX2_TARGET inline __m256d gatherDoubles(const double* base,
+                                                  __m128i index) {
+  const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+  return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, index, all, 8);
+}
+
+/** @brief the lanes whose bit is set in bits, as all ones */
+LOCKSTEP_AVX2_TARGET inline __m256i maskOfBits(int bits) {
+  const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  return _mm256_cmpeq_epi32(
+      _mm256_and_si256(_mm256_set1_epi32(bits), lane_bits), lane_bits);
+}
+
+/**
+ * @brief the low and high words of the 64-bit products of the unsigned lanes
+ * of a and b, _mm256_mul_epu32 of the even and of the odd lanes
+ */
+LOCKSTEP_AVX2_TARGET inline void multiplyAvx2(__m256i a, __m256i b,
+                                              __m256i& low, __m256i& high) {
+  const __m256i even = _mm256_mul_epu32(a, b);
+  const __m256i odd =
+      _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+  low = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xaa);
+  high = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+}
+
+/** @brief Philox4x32::generateLanes of 8 lanes, a word of the lanes in a register */
+LOCKSTEP_AVX2_TARGET void generateLanesAvx2(uint32_t (&counters)[4][8],
+                                            Philox4x32::Key key) {
+  const __m256i m0 = _mm256_set1_epi32(Philox4x32::M0);
+  const __m256i m1 = _mm256_set1_epi32(Philox4x32::M1);
+  __m256i c0 = loadLanes(counters[0]);
+  __m256i c1 = loadLanes(counters[1]);
+  __m256i c2 = loadLanes(counters[2]);
+  __m256i c3 = loadLanes(counters[3]);
+  for (int round = 0; round < 10; round++) {
+    __m256i low0;
+    __m256i high0;
+    __m256i low1;
+    __m256i high1;
+    multiplyAvx2(c0, m0, low0, high0);
+    multiplyAvx2(c2, m1, low1, high1);
+    c0 = _mm256_xor_si256(_mm256_xor_si256(high1, c1),
+                          _mm256_set1_epi32(key[0]));
+    c2 = _mm256_xor_si256(_mm256_xor_si256(high0, c3),
+                          _mm256_set1_epi32(key[1]));
+    c1 = low1;
+    c3 = low0;
+    key[0] += Philox4x32::W0;
+    key[1] += Philox4x32::W1;
+  }
+  storeLanes(counters[0], c0);
+  storeLanes(counters[1], c1);
+  storeLanes(counters[2], c2);
+  storeLanes(counters[3], c3);
+}
+
+/**
+ * @brief toUnitDouble of 4 lanes: high * 2^21 + (low >> 11) is exact, and an
+ * unsigned word is converted as a signed one plus 2^31
+ */
+LOCKSTEP_AVX2_TARGET inline __m256d unitDoublesAvx2(const uint32_t* high,
+                                                    const uint32_t* low) {
+  const __m128i sign = _mm_set1_epi32(INT32_MIN);
+  const __m256d offset = _mm256_set1_pd(2147483648.0);
+  const __m256d high_pd = _mm256_add_pd(
+      _mm256_cvtepi32_pd(_mm_xor_si128(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(high)), sign)),
+      offset);
+  const __m256d low_pd = _mm256_cvtepi32_pd(_mm_srli_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(low)), 11));
+  return _mm256_mul_pd(
+      _mm256_add_pd(_mm256_mul_pd(high_pd, _mm256_set1_pd(2097152.0)), low_pd),
+      _mm256_set1_pd(1.0 / 9007199254740992.0));
+}
+
+/** @brief expPolynomial of 4 lanes, the same operations in the same order */
+LOCKSTEP_AVX2_TARGET inline __m256d expPolynomialAvx2(__m256d x) {
+  const double shifter = 6755399441055744.0;
+  const __m256d y = _mm256_min_pd(
+      _mm256_max_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634)),
+                    _mm256_set1_pd(-1010.0)),
+      _mm256_set1_pd(1010.0));
+  const __m256d t = _mm256_add_pd(y, _mm256_set1_pd(shifter));
+  const __m256d n = _mm256_sub_pd(t, _mm256_set1_pd(shifter));
+  const __m256d f =
+      _mm256_mul_pd(_mm256_sub_pd(y, n), _mm256_set1_pd(0.6931471805599453));
+  // 1 / k! from k = 10 down to 0
+  const double coefficients[11] = {
+      1.0 / 3628800, 1.0 / 362880, 1.0 / 40320, 1.0 / 5040, 1.0 / 720, 1.0 / 120,
+      1.0 / 24,      1.0 / 6,      1.0 / 2,     1,          1};
+  __m256d polynomial = _mm256_set1_pd(coefficients[0]);
+  for (int k = 1; k < 11; k++) {
+    polynomial = _mm256_add_pd(_mm256_set1_pd(coefficients[k]),
+                               _mm256_mul_pd(f, polynomial));
+  }
+  int64_t shifter_bits;
+  std::memcpy(&shifter_bits, &shifter, sizeof(shifter));
+  const __m256i scale_bits = _mm256_slli_epi64(
+      _mm256_add_epi64(_mm256_sub_epi64(_mm256_castpd_si256(t),
+                                        _mm256_set1_epi64x(shifter_bits)),
+                       _mm256_set1_epi64x(1023)),
+      52);
+  return _mm256_mul_pd(polynomial, _mm256_castsi256_pd(scale_bits));
+}
+#endif
+}  // namespace
+
+/**
+ * @brief Construct LANE_NUM replicas, lane l starts from the initial
+ * population of Evolution with the same arguments and replica
+ * firstReplica + l (Evolution::initIndividuals)
+ *
+ * @param population
+ * @param s
+ * @param b
+ * @param beta
+ * @param c
+ * @param gamma
+ * @param mu
+ * @param normId
+ * @param p0
+ * @param payoffMatrixConfigName "payoffMatrix_shortterm" or
+ * "payoffMatrix_longterm_no_norm_error"
+ * @param seed the global seed
+ * @param firstReplica the replica of lane 0, the replicas of the lanes must
+ * be below 2^16
+ */
+LockstepReplicas::LockstepReplicas(int population, double s, double b,
+                                   double beta, double c, double gamma,
+                                   double mu, int normId, double p0,
+                                   std::string const& payoffMatrixConfigName,
+                                   uint64_t seed, int firstReplica)
+    : population(population),
+      s(s),
+      mu(mu),
+      normId(normId),
+      firstReplica(firstReplica),
+      isShortterm(payoffMatrixConfigName == "payoffMatrix_shortterm"),
+      payoffMatrix(Evolution::loadPayoffMatrix(payoffMatrixConfigName, normId,
+                                               b, beta, c, gamma, p0)),
+      pVarId(payoffMatrix.getVarId("p")),
+      norm(Evolution::loadNorm(
+          normId, std::vector<Action>{Action("C", 0), Action("D", 1)},
+          std::vector<Action>{Action("C", 0), Action("D", 1)})),
+      key(RandomStream(seed, 0).getKey()),
+      stepNum(0),
+      simd(hasSimd()) {
+  if (!this->isShortterm &&
+      payoffMatrixConfigName != "payoffMatrix_longterm_no_norm_error") {
+    std::cerr << "payoff_matrix_config_name error: " << payoffMatrixConfigName
+              << std::endl;
+    throw "payoff_matrix_config_name error";
+  }
+  if (population < 2) {
+    std::cerr << "population error: " << population << std::endl;
+    throw "population error";
+  }
+  if (this->norm.getReputationNum() != 2) {
+    std::cerr << "lockstep needs a binary norm, norm " << normId << " has "
+              << this->norm.getReputationNum() << " levels" << std::endl;
+    throw "lockstep needs a binary norm";
+  }
+  if (firstReplica < 0 || firstReplica + LANE_NUM > 0x10000) {
+    std::cerr << "replicas out of range: " << firstReplica << std::endl;
+    throw "replicas out of range";
+  }
+  this->donorStrategies = this->payoffMatrix.getRowStrategies();
+  this->recipientStrategies = this->payoffMatrix.getColStrategies();
+  const int donor_strategy_num = this->donorStrategies.size();
+  const int recipient_strategy_num = this->recipientStrategies.size();
+  this->strategyPairNum = donor_strategy_num * recipient_strategy_num;
+  this->classNum = this->strategyPairNum * 2;
+  this->tableSize = this->classNum * 2;
+  if (this->classNum > 256) {
+    std::cerr << "too many strategy pairs: " << this->strategyPairNum
+              << std::endl;
+    throw "too many strategy pairs";
+  }
+
+  // 3 bytes of padding for the 32-bit gathers of the classes
+  this->classIds.resize(static_cast<size_t>(population) * LANE_NUM + 3);
+  this->classCounts.assign(this->classNum * LANE_NUM, 0);
+  this->donorCounts.assign(donor_strategy_num * LANE_NUM, 0);
+  for (int pair_id = 0; pair_id < this->strategyPairNum; pair_id++) {
+    this->pairDonorIds.push_back(pair_id / recipient_strategy_num);
+    this->pairRecipientIds.push_back(pair_id % recipient_strategy_num);
+  }
+  this->recipientCounts.assign(recipient_strategy_num * LANE_NUM, 0);
+  this->goodNums.assign(LANE_NUM, 0);
+  // the lanes are copies of one population of the template players, only
+  // their individuals differ
+  const std::vector<Action> actions{Action("C", 0), Action("D", 1)};
+  const Population individuals(
+      population,
+      Evolution::loadPlayer("donor", actions, this->donorStrategies),
+      Evolution::loadPlayer("recipient", actions, this->recipientStrategies),
+      this->norm);
+  this->lanes.assign(LANE_NUM, individuals);
+  for (int l = 0; l < LANE_NUM; l++) {
+    const int replica = firstReplica + l;
+    RandomStream gen_init =
+        RandomStream::derive(seed, normId, replica, RandomPurpose::INIT);
+    Evolution::initIndividuals(this->lanes[l], recipient_strategy_num,
+                               this->strategyPairNum, p0, gen_init);
+    const Population& lane = this->lanes[l];
+    for (int i = 0; i < population; i++) {
+      const int d = lane.getDonorStrategyId(i);
+      const int r = lane.getRecipientStrategyId(i);
+      const int class_id =
+          (d * recipient_strategy_num + r) * 2 + lane.getReputationId(i);
+      this->classIds[i * LANE_NUM + l] = class_id;
+      this->classCounts[class_id * LANE_NUM + l]++;
+      this->donorCounts[d * LANE_NUM + l]++;
+      this->recipientCounts[r * LANE_NUM + l]++;
+    }
+    this->goodNums[l] = lane.getGoodReputationNum();
+    const uint64_t stream_id =
+        RandomStream::getStreamId(normId, replica, RandomPurpose::LOCKSTEP);
+    this->streamIds[0][l] = static_cast<uint32_t>(stream_id);
+    this->streamIds[1][l] = static_cast<uint32_t>(stream_id >> 32);
+    this->genRejections.push_back(
+        RandomStream::derive(seed, normId, replica, RandomPurpose::SELECTION));
+  }
+
+  // the game only depends on the donor's pair and the recipient's class
+  this->gameTable.resize(this->strategyPairNum * this->classNum);
+  for (int donor_pair = 0; donor_pair < this->strategyPairNum; donor_pair++) {
+    for (int class_id = 0; class_id < this->classNum; class_id++) {
+      const int donor_action_id = individuals.getDonorAction(
+          donor_pair / recipient_strategy_num, class_id & 1);
+      const int recipient_action_id = individuals.getRecipientAction(
+          (class_id >> 1) % recipient_strategy_num, donor_action_id);
+      this->gameTable[donor_pair * this->classNum + class_id] =
+          (class_id & ~1) |
+          individuals.assess(donor_action_id, recipient_action_id, class_id & 1);
+    }
+  }
+  const int slot_num =
+      this->isShortterm ? std::min(population + 1, PAYOFF_TABLE_NUM) : 1;
+  this->payoffTables.resize((slot_num + LANE_NUM) * this->tableSize);
+  this->payoffTableGoodNums.assign(slot_num, -1);
+}
+
+LockstepReplicas::~LockstepReplicas() {}
+
+/**
+ * @brief whether the stages of step() have AVX2 versions in this build and
+ * the CPU has AVX2
+ *
+ * @return bool
+ */
+bool LockstepReplicas::hasSimd() {
+#ifdef LOCKSTEP_REPLICAS_AVX2
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief take the AVX2 stages (the default if hasSimd()) or the scalar
+ * loops, which give the same steps
+ *
+ * @param simd ignored without hasSimd()
+ */
+void LockstepReplicas::setSimd(bool simd) {
+  this->simd = simd && hasSimd();
+}
+
+/**
+ * @brief evaluate the matrix of both reputations of goodNum good individuals
+ *
+ * @param goodNum
+ * @param table the tableSize doubles of the matrix
+ */
+void LockstepReplicas::evalPayoffTable(int goodNum, double* table) {
+  const int donor_player = 0;
+  const int recipient_player = 1;
+  if (this->isShortterm) {
+    this->payoffMatrix.setVar(this->pVarId, donor_player,
+                              static_cast<double>(goodNum) / this->population);
+  }
+  const int donor_strategy_num = this->donorStrategies.size();
+  const int recipient_strategy_num = this->recipientStrategies.size();
+  for (int rep = 0; rep < 2; rep++) {
+    this->payoffMatrix.setVar(this->pVarId, recipient_player,
+                              this->norm.getReputationValue(rep));
+    this->payoffMatrix.eval();
+    for (int d = 0; d < donor_strategy_num; d++) {
+      for (int r = 0; r < recipient_strategy_num; r++) {
+        for (int player = 0; player < 2; player++) {
+          table[((rep * donor_strategy_num + d) * recipient_strategy_num + r) *
+                    2 + player] = this->payoffMatrix.getPayoff(d, r, player);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief the offset in payoffTables of the evaluated matrix of goodNum good
+ * individuals for a lane. The matrix of g is kept in slot g % #slots, so a
+ * population of at most PAYOFF_TABLE_NUM - 1 evaluates each matrix once, and
+ * the good numbers of a lane, which move by one at a time, rarely evict each
+ * other in a larger one. A lane whose slot already holds another matrix for
+ * an earlier lane of the step takes its own slot after them
+ *
+ * @param goodNum
+ * @param lane
+ * @param laneOffsets the offsets of the lanes before lane in the step
+ * @return int
+ */
+int LockstepReplicas::getPayoffTableOffset(int goodNum, int lane,
+                                           const int* laneOffsets) {
+  const int g = this->isShortterm ? goodNum : 0;
+  const int slot_num = this->payoffTableGoodNums.size();
+  const int slot = g % slot_num;
+  int offset = slot * this->tableSize;
+  if (this->payoffTableGoodNums[slot] == g) {
+    return offset;
+  }
+  for (int l = 0; l < lane; l++) {
+    if (laneOffsets[l] == offset) {
+      offset = (slot_num + lane) * this->tableSize;
+      this->evalPayoffTable(goodNum, this->payoffTables.data() + offset);
+      return offset;
+    }
+  }
+  this->evalPayoffTable(goodNum, this->payoffTables.data() + offset);
+  this->payoffTableGoodNums[slot] = g;
+  return offset;
+}
+
+/**
+ * @brief Philox4x32::generate() of the counters of both blocks of the step,
+ * then the focal, the role model and the co-player of every lane and their
+ * classes
+ *
+ * @param lanes
+ */
+void LockstepReplicas::drawIndividuals(LaneStep& lanes) {
+  for (int block = 0; block < 2; block++) {
+    Philox4x32::generateLanes<LANE_NUM>(lanes.words[block], this->key);
+  }
+  // Lemire's multiply-shift, the lanes whose low word may be rejected are
+  // checked afterwards
+  const uint32_t bounds[3] = {static_cast<uint32_t>(this->population),
+                              static_cast<uint32_t>(this->population - 1),
+                              static_cast<uint32_t>(this->population - 1)};
+  int drawn[3][LANE_NUM];
+  int maybe_rejected = 0;
+  for (int k = 0; k < 3; k++) {
+    for (int l = 0; l < LANE_NUM; l++) {
+      uint64_t m = static_cast<uint64_t>(lanes.words[0][k][l]) * bounds[k];
+      drawn[k][l] = static_cast<int>(m >> 32);
+      maybe_rejected |= static_cast<uint32_t>(m) < bounds[k];
+    }
+  }
+  if (maybe_rejected) {
+    this->redrawRejected(lanes, drawn);
+  }
+  const uint8_t* class_ids = this->classIds.data();
+  for (int l = 0; l < LANE_NUM; l++) {
+    lanes.focal[l] = drawn[0][l];
+    lanes.rolemodel[l] = drawn[1][l] + (drawn[1][l] >= drawn[0][l]);
+    lanes.coplayer[l] = drawn[2][l] + (drawn[2][l] >= drawn[0][l]);
+    lanes.focalClass[l] = class_ids[lanes.focal[l] * LANE_NUM + l];
+    lanes.rolemodelClass[l] = class_ids[lanes.rolemodel[l] * LANE_NUM + l];
+  }
+}
+
+/**
+ * @brief draw again from the SELECTION stream the individuals of the lanes
+ * whose multiply-shift is rejected
+ *
+ * @param lanes
+ * @param drawn the focal, the role model and the co-player before the shift
+ * past the focal
+ */
+void LockstepReplicas::redrawRejected(const LaneStep& lanes,
+                                      int (&drawn)[3][LANE_NUM]) {
+  const uint32_t bounds[3] = {static_cast<uint32_t>(this->population),
+                              static_cast<uint32_t>(this->population - 1),
+                              static_cast<uint32_t>(this->population - 1)};
+  for (int k = 0; k < 3; k++) {
+    const uint32_t threshold = (0u - bounds[k]) % bounds[k];
+    for (int l = 0; l < LANE_NUM; l++) {
+      uint64_t m = static_cast<uint64_t>(lanes.words[0][k][l]) * bounds[k];
+      if (static_cast<uint32_t>(m) < threshold) {
+        drawn[k][l] = this->genRejections[l].nextInt(bounds[k]);
+      }
+    }
+  }
+}
+
+/**
+ * @brief the offsets of the evaluated matrices of the lanes, evaluating the
+ * missing ones
+ *
+ * @param lanes
+ */
+void LockstepReplicas::setTableOffsets(LaneStep& lanes) {
+  for (int l = 0; l < LANE_NUM; l++) {
+    lanes.tableOffsets[l] =
+        this->getPayoffTableOffset(this->goodNums[l], l, lanes.tableOffsets);
+  }
+}
+
+/**
+ * @brief the average payoffs of the focal and the role model as
+ * getAvgPayoff. The sums over the strategies are the outer loops, so the
+ * lanes are the inner loop of every sum (gathers of the tables)
+ *
+ * @param lanes
+ */
+void LockstepReplicas::evalPayoffs(LaneStep& lanes) {
+  const int donor_strategy_num = this->donorStrategies.size();
+  const int recipient_strategy_num = this->recipientStrategies.size();
+  const double normalizer = 1.0 / (this->population - 1);
+  const int* donor_counts = this->donorCounts.data();
+  const int* recipient_counts = this->recipientCounts.data();
+  const double* payoff_tables = this->payoffTables.data();
+  const int rep_size = donor_strategy_num * recipient_strategy_num * 2;
+  for (int who = 0; who < 2; who++) {
+    const int* classes = who == 0 ? lanes.focalClass : lanes.rolemodelClass;
+    int donor_rows[LANE_NUM];      //< (rep, d, 0, donor) in payoffTables
+    int recipient_cols[LANE_NUM];  //< (rep, 0, r, recipient) in payoffTables
+    double eval_donor[LANE_NUM];
+    double eval_recipient[LANE_NUM];
+    double eval_same[LANE_NUM];
+    for (int l = 0; l < LANE_NUM; l++) {
+      const int rep_offset =
+          lanes.tableOffsets[l] + (classes[l] & 1) * rep_size;
+      const int d = this->pairDonorIds[classes[l] >> 1];
+      const int r = this->pairRecipientIds[classes[l] >> 1];
+      donor_rows[l] = rep_offset + d * recipient_strategy_num * 2;
+      recipient_cols[l] = rep_offset + r * 2 + 1;
+      const int same = donor_rows[l] + r * 2;
+      eval_same[l] = (payoff_tables[same] + payoff_tables[same + 1]) / 2;
+      eval_donor[l] = 0;
+      eval_recipient[l] = 0;
+    }
+    for (int j = 0; j < recipient_strategy_num; j++) {
+      for (int l = 0; l < LANE_NUM; l++) {
+        eval_donor[l] += payoff_tables[donor_rows[l] + j * 2] *
+                         recipient_counts[j * LANE_NUM + l] * 0.5;
+      }
+    }
+    for (int j = 0; j < donor_strategy_num; j++) {
+      for (int l = 0; l < LANE_NUM; l++) {
+        eval_recipient[l] +=
+            payoff_tables[recipient_cols[l] + j * recipient_strategy_num * 2] *
+            donor_counts[j * LANE_NUM + l] * 0.5;
+      }
+    }
+    for (int l = 0; l < LANE_NUM; l++) {
+      lanes.payoffs[who][l] =
+          normalizer * (eval_donor[l] + eval_recipient[l] - eval_same[l]);
+    }
+  }
+}
+
+/**
+ * @brief the class of the focal after the update: a mutant pair with
+ * probability mu, otherwise the pair of the role model if the focal
+ * imitates it. u < fermi() is decided by expPolynomial in a loop over the
+ * lanes, fermi() itself only for the lanes too close to tell
+ *
+ * @param lanes
+ */
+void LockstepReplicas::chooseNextClasses(LaneStep& lanes) {
+  int imitates[LANE_NUM];
+  int any_undecided = 0;
+  for (int l = 0; l < LANE_NUM; l++) {
+    const double u = toUnitDouble(lanes.words[1][1][l], lanes.words[1][2][l]);
+    const double x = (lanes.payoffs[0][l] - lanes.payoffs[1][l]) * this->s;
+    const double probability = 1 / (1 + expPolynomial(x));
+    imitates[l] = u < probability;
+    const int undecided = (std::abs(x) >= EXP_POLYNOMIAL_BOUND) |
+                          (std::abs(u - probability) <= 1e-9 * probability);
+    any_undecided |= undecided << l;
+  }
+  for (int l = 0; l < LANE_NUM; l++) {
+    if (any_undecided >> l & 1) {
+      imitates[l] = this->imitatesExactly(lanes, l);
+    }
+  }
+  int maybe_rejected_pair = 0;
+  const uint32_t pair_bound = this->strategyPairNum - 1;
+  for (int l = 0; l < LANE_NUM; l++) {
+    const double p = toUnitDouble(lanes.words[0][3][l], lanes.words[1][0][l]);
+    const int focal_pair = lanes.focalClass[l] >> 1;
+    // the mutant pair takes the high word of the imitation draw
+    uint64_t m = static_cast<uint64_t>(lanes.words[1][1][l]) * pair_bound;
+    maybe_rejected_pair |= static_cast<uint32_t>(m) < pair_bound;
+    int mutant_pair = static_cast<int>(m >> 32);
+    mutant_pair += mutant_pair >= focal_pair;
+    int next_pair = focal_pair;
+    if (p < this->mu) {
+      next_pair = mutant_pair;
+    } else if (imitates[l]) {
+      next_pair = lanes.rolemodelClass[l] >> 1;
+    }
+    lanes.nextClass[l] = next_pair * 2 + (lanes.focalClass[l] & 1);
+  }
+  if (maybe_rejected_pair) {
+    this->redrawRejectedMutants(lanes);
+  }
+}
+
+/**
+ * @brief u < fermi() of a lane by fermi() itself
+ *
+ * @param lanes
+ * @param lane
+ * @return true if the focal of the lane imitates the role model
+ */
+bool LockstepReplicas::imitatesExactly(const LaneStep& lanes, int lane) const {
+  const double u =
+      toUnitDouble(lanes.words[1][1][lane], lanes.words[1][2][lane]);
+  return u < fermi(lanes.payoffs[0][lane], lanes.payoffs[1][lane], this->s);
+}
+
+/**
+ * @brief draw again from the SELECTION stream the mutant pairs of the
+ * mutating lanes whose multiply-shift is rejected
+ *
+ * @param lanes
+ */
+void LockstepReplicas::redrawRejectedMutants(LaneStep& lanes) {
+  const uint32_t pair_bound = this->strategyPairNum - 1;
+  const uint32_t threshold = (0u - pair_bound) % pair_bound;
+  for (int l = 0; l < LANE_NUM; l++) {
+    const double p = toUnitDouble(lanes.words[0][3][l], lanes.words[1][0][l]);
+    uint64_t m = static_cast<uint64_t>(lanes.words[1][1][l]) * pair_bound;
+    if (p < this->mu && static_cast<uint32_t>(m) < threshold) {
+      const int focal_pair = lanes.focalClass[l] >> 1;
+      int mutant_pair = this->genRejections[l].nextInt(pair_bound);
+      mutant_pair += mutant_pair >= focal_pair;
+      lanes.nextClass[l] = mutant_pair * 2 + (lanes.focalClass[l] & 1);
+    }
+  }
+}
+
+/**
+ * @brief move the focals to their next classes, then the game of the focal
+ * with the co-player, the focal is the donor with probability 1/2. These are
+ * scatters to one element per lane, done one lane at a time
+ *
+ * @param lanes
+ */
+void LockstepReplicas::updateLanes(const LaneStep& lanes) {
+  const int class_num = this->classNum;
+  uint8_t* class_ids = this->classIds.data();
+  int* class_counts = this->classCounts.data();
+  int* donor_counts = this->donorCounts.data();
+  int* recipient_counts = this->recipientCounts.data();
+  const int* pair_donor_ids = this->pairDonorIds.data();
+  const int* pair_recipient_ids = this->pairRecipientIds.data();
+  for (int l = 0; l < LANE_NUM; l++) {
+    const int focal_class = lanes.focalClass[l];
+    const int next_class = lanes.nextClass[l];
+    class_ids[lanes.focal[l] * LANE_NUM + l] = next_class;
+    class_counts[focal_class * LANE_NUM + l]--;
+    class_counts[next_class * LANE_NUM + l]++;
+    const int from_pair = focal_class >> 1;
+    const int to_pair = next_class >> 1;
+    donor_counts[pair_donor_ids[from_pair] * LANE_NUM + l]--;
+    donor_counts[pair_donor_ids[to_pair] * LANE_NUM + l]++;
+    recipient_counts[pair_recipient_ids[from_pair] * LANE_NUM + l]--;
+    recipient_counts[pair_recipient_ids[to_pair] * LANE_NUM + l]++;
+  }
+  for (int l = 0; l < LANE_NUM; l++) {
+    const int coplayer_class = class_ids[lanes.coplayer[l] * LANE_NUM + l];
+    const bool focal_donates = lanes.words[1][3][l] >> 31;
+    const int donor_class =
+        focal_donates ? lanes.nextClass[l] : coplayer_class;
+    const int recipient_class =
+        focal_donates ? coplayer_class : lanes.nextClass[l];
+    const int recipient = focal_donates ? lanes.coplayer[l] : lanes.focal[l];
+    const int assessed_class =
+        this->gameTable[(donor_class >> 1) * class_num + recipient_class];
+    class_ids[recipient * LANE_NUM + l] = assessed_class;
+    class_counts[recipient_class * LANE_NUM + l]--;
+    class_counts[assessed_class * LANE_NUM + l]++;
+    this->goodNums[l] += (assessed_class & 1) - (recipient_class & 1);
+  }
+}
+
+#ifdef LOCKSTEP_REPLICAS_AVX2
+/**
+ * @brief drawIndividuals() with AVX2: the Philox rounds, the multiply-shifts
+ * and the gathers of the classes of the 8 lanes are each a few instructions
+ *
+ * @param lanes
+ */
+LOCKSTEP_AVX2_TARGET void LockstepReplicas::drawIndividualsAvx2(
+    LaneStep& lanes) {
+  for (int block = 0; block < 2; block++) {
+    generateLanesAvx2(lanes.words[block], this->key);
+  }
+  const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+  const uint32_t bounds[3] = {static_cast<uint32_t>(this->population),
+                              static_cast<uint32_t>(this->population - 1),
+                              static_cast<uint32_t>(this->population - 1)};
+  __m256i drawn[3];
+  int maybe_rejected = 0;
+  for (int k = 0; k < 3; k++) {
+    const __m256i bound = _mm256_set1_epi32(bounds[k]);
+    __m256i low;
+    multiplyAvx2(loadLanes(lanes.words[0][k]), bound, low, drawn[k]);
+    // low < bound as unsigned
+    maybe_rejected |= _mm256_movemask_epi8(_mm256_cmpgt_epi32(
+        _mm256_xor_si256(bound, sign), _mm256_xor_si256(low, sign)));
+  }
+  if (maybe_rejected) {
+    int drawn_lanes[3][LANE_NUM];
+    for (int k = 0; k < 3; k++) {
+      storeLanes(drawn_lanes[k], drawn[k]);
+    }
+    this->redrawRejected(lanes, drawn_lanes);
+    for (int k = 0; k < 3; k++) {
+      drawn[k] = loadLanes(drawn_lanes[k]);
+    }
+  }
+  // d + (d >= focal) is d + 1 + (focal > d ? -1 : 0)
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i focal = drawn[0];
+  const __m256i rolemodel = _mm256_add_epi32(
+      _mm256_add_epi32(drawn[1], one), _mm256_cmpgt_epi32(focal, drawn[1]));
+  const __m256i coplayer = _mm256_add_epi32(
+      _mm256_add_epi32(drawn[2], one), _mm256_cmpgt_epi32(focal, drawn[2]));
+  storeLanes(lanes.focal, focal);
+  storeLanes(lanes.rolemodel, rolemodel);
+  storeLanes(lanes.coplayer, coplayer);
+  // the 32-bit gathers read the 3 bytes after the class, classIds is padded
+  const __m256i lane_ids = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i byte_mask = _mm256_set1_epi32(0xff);
+  const int* class_words = reinterpret_cast<const int*>(this->classIds.data());
+  const __m256i focal_class = _mm256_and_si256(
+      _mm256_i32gather_epi32(
+          class_words, _mm256_add_epi32(_mm256_slli_epi32(focal, 3), lane_ids),
+          1),
+      byte_mask);
+  const __m256i rolemodel_class = _mm256_and_si256(
+      _mm256_i32gather_epi32(
+          class_words,
+          _mm256_add_epi32(_mm256_slli_epi32(rolemodel, 3), lane_ids), 1),
+      byte_mask);
+  storeLanes(lanes.focalClass, focal_class);
+  storeLanes(lanes.rolemodelClass, rolemodel_class);
+}
+
+/**
+ * @brief evalPayoffs() with AVX2: the indices of the 8 lanes are computed at
+ * once, and the payoffs of 4 lanes are gathered and summed in each half
+ *
+ * @param lanes
+ */
+LOCKSTEP_AVX2_TARGET void LockstepReplicas::evalPayoffsAvx2(LaneStep& lanes) {
+  const int donor_strategy_num = this->donorStrategies.size();
+  const int recipient_strategy_num = this->recipientStrategies.size();
+  const __m256d normalizer = _mm256_set1_pd(1.0 / (this->population - 1));
+  const __m256d half = _mm256_set1_pd(0.5);
+  const __m256d two = _mm256_set1_pd(2);
+  const int* donor_counts = this->donorCounts.data();
+  const int* recipient_counts = this->recipientCounts.data();
+  const double* payoff_tables = this->payoffTables.data();
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i rep_size =
+      _mm256_set1_epi32(donor_strategy_num * recipient_strategy_num * 2);
+  const __m256i row_size = _mm256_set1_epi32(recipient_strategy_num * 2);
+  const __m256i table_offsets = loadLanes(lanes.tableOffsets);
+  for (int who = 0; who < 2; who++) {
+    const __m256i classes =
+        loadLanes(who == 0 ? lanes.focalClass : lanes.rolemodelClass);
+    const __m256i pairs = _mm256_srli_epi32(classes, 1);
+    const __m256i d = _mm256_i32gather_epi32(this->pairDonorIds.data(), pairs, 4);
+    const __m256i r =
+        _mm256_i32gather_epi32(this->pairRecipientIds.data(), pairs, 4);
+    const __m256i rep_offset = _mm256_add_epi32(
+        table_offsets,
+        _mm256_mullo_epi32(_mm256_and_si256(classes, one), rep_size));
+    // (rep, d, 0, donor), (rep, 0, r, recipient) and (rep, d, r, donor)
+    const __m256i donor_rows =
+        _mm256_add_epi32(rep_offset, _mm256_mullo_epi32(d, row_size));
+    const __m256i r_offsets = _mm256_slli_epi32(r, 1);
+    const __m256i recipient_cols =
+        _mm256_add_epi32(_mm256_add_epi32(rep_offset, r_offsets), one);
+    const __m256i same = _mm256_add_epi32(donor_rows, r_offsets);
+    for (int h = 0; h < 2; h++) {
+      const __m128i same_h = halfOf(same, h);
+      const __m256d eval_same = _mm256_div_pd(
+          _mm256_add_pd(gatherDoubles(payoff_tables, same_h),
+                        gatherDoubles(payoff_tables + 1, same_h)),
+          two);
+      const __m128i donor_rows_h = halfOf(donor_rows, h);
+      __m256d eval_donor = _mm256_setzero_pd();
+      for (int j = 0; j < recipient_strategy_num; j++) {
+        const __m256d payoff = gatherDoubles(
+            payoff_tables, _mm_add_epi32(donor_rows_h, _mm_set1_epi32(j * 2)));
+        const __m256d count = _mm256_cvtepi32_pd(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(recipient_counts + j * LANE_NUM +
+                                             h * 4)));
+        eval_donor = _mm256_add_pd(
+            eval_donor, _mm256_mul_pd(_mm256_mul_pd(payoff, count), half));
+      }
+      const __m128i recipient_cols_h = halfOf(recipient_cols, h);
+      __m256d eval_recipient = _mm256_setzero_pd();
+      for (int j = 0; j < donor_strategy_num; j++) {
+        const __m256d payoff = gatherDoubles(
+            payoff_tables,
+            _mm_add_epi32(recipient_cols_h,
+                          _mm_set1_epi32(j * recipient_strategy_num * 2)));
+        const __m256d count = _mm256_cvtepi32_pd(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(donor_counts + j * LANE_NUM +
+                                             h * 4)));
+        eval_recipient = _mm256_add_pd(
+            eval_recipient, _mm256_mul_pd(_mm256_mul_pd(payoff, count), half));
+      }
+      _mm256_storeu_pd(
+          lanes.payoffs[who] + h * 4,
+          _mm256_mul_pd(normalizer,
+                        _mm256_sub_pd(_mm256_add_pd(eval_donor, eval_recipient),
+                                      eval_same)));
+    }
+  }
+}
+
+/**
+ * @brief chooseNextClasses() with AVX2: the exp, the comparisons with the
+ * unit doubles and the choice of the next pair are computed for all the
+ * lanes, the undecided imitations and the rejected mutants take the scalar
+ * path
+ *
+ * @param lanes
+ */
+LOCKSTEP_AVX2_TARGET void LockstepReplicas::chooseNextClassesAvx2(
+    LaneStep& lanes) {
+  const __m256d s = _mm256_set1_pd(this->s);
+  const __m256d mu = _mm256_set1_pd(this->mu);
+  const __m256d one_pd = _mm256_set1_pd(1);
+  const __m256d abs_mask =
+      _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffff));
+  const __m256d bound = _mm256_set1_pd(EXP_POLYNOMIAL_BOUND);
+  const __m256d tolerance = _mm256_set1_pd(1e-9);
+  int imitates = 0;
+  int undecided = 0;
+  int mutates = 0;
+  for (int h = 0; h < 2; h++) {
+    const __m256d u = unitDoublesAvx2(lanes.words[1][1] + h * 4,
+                                      lanes.words[1][2] + h * 4);
+    const __m256d x =
+        _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(lanes.payoffs[0] + h * 4),
+                                    _mm256_loadu_pd(lanes.payoffs[1] + h * 4)),
+                      s);
+    const __m256d probability =
+        _mm256_div_pd(one_pd, _mm256_add_pd(one_pd, expPolynomialAvx2(x)));
+    imitates |= _mm256_movemask_pd(_mm256_cmp_pd(u, probability, _CMP_LT_OQ))
+                << (h * 4);
+    const __m256d far = _mm256_cmp_pd(_mm256_and_pd(x, abs_mask), bound,
+                                      _CMP_GE_OQ);
+    const __m256d close = _mm256_cmp_pd(
+        _mm256_and_pd(_mm256_sub_pd(u, probability), abs_mask),
+        _mm256_mul_pd(tolerance, probability), _CMP_LE_OQ);
+    undecided |= _mm256_movemask_pd(_mm256_or_pd(far, close)) << (h * 4);
+    const __m256d p = unitDoublesAvx2(lanes.words[0][3] + h * 4,
+                                      lanes.words[1][0] + h * 4);
+    mutates |= _mm256_movemask_pd(_mm256_cmp_pd(p, mu, _CMP_LT_OQ)) << (h * 4);
+  }
+  for (int l = 0; l < LANE_NUM; l++) {
+    if (undecided >> l & 1) {
+      imitates = (imitates & ~(1 << l)) |
+                 (static_cast<int>(this->imitatesExactly(lanes, l)) << l);
+    }
+  }
+
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+  const __m256i pair_bound = _mm256_set1_epi32(this->strategyPairNum - 1);
+  const __m256i focal_class = loadLanes(lanes.focalClass);
+  const __m256i focal_pair = _mm256_srli_epi32(focal_class, 1);
+  const __m256i rolemodel_pair =
+      _mm256_srli_epi32(loadLanes(lanes.rolemodelClass), 1);
+  // the mutant pair takes the high word of the imitation draw
+  __m256i low;
+  __m256i mutant_pair;
+  multiplyAvx2(loadLanes(lanes.words[1][1]), pair_bound, low, mutant_pair);
+  const int maybe_rejected_pair = _mm256_movemask_epi8(_mm256_cmpgt_epi32(
+      _mm256_xor_si256(pair_bound, sign), _mm256_xor_si256(low, sign)));
+  mutant_pair = _mm256_add_epi32(_mm256_add_epi32(mutant_pair, one),
+                                 _mm256_cmpgt_epi32(focal_pair, mutant_pair));
+  const __m256i next_pair = _mm256_blendv_epi8(
+      _mm256_blendv_epi8(focal_pair, rolemodel_pair, maskOfBits(imitates)),
+      mutant_pair, maskOfBits(mutates));
+  storeLanes(lanes.nextClass,
+             _mm256_add_epi32(_mm256_slli_epi32(next_pair, 1),
+                              _mm256_and_si256(focal_class, one)));
+  if (maybe_rejected_pair) {
+    this->redrawRejectedMutants(lanes);
+  }
+}
+#endif
+
+/**
+ * @brief one step of Evolution::step() in every lane: the focal imitates the
+ * role model (or mutates with probability mu), then plays the game with a
+ * random co-player using the new strategy. Each stage is a loop over the
+ * lanes, or its AVX2 version if isSimd()
+ */
+void LockstepReplicas::step() {
+  LaneStep lanes;
+  for (int block = 0; block < 2; block++) {
+    const uint64_t block_id = this->stepNum * 2 + block;
+    for (int l = 0; l < LANE_NUM; l++) {
+      lanes.words[block][0][l] = static_cast<uint32_t>(block_id);
+      lanes.words[block][1][l] = static_cast<uint32_t>(block_id >> 32);
+      lanes.words[block][2][l] = this->streamIds[0][l];
+      lanes.words[block][3][l] = this->streamIds[1][l];
+    }
+  }
+#ifdef LOCKSTEP_REPLICAS_AVX2
+  if (this->simd) {
+    this->drawIndividualsAvx2(lanes);
+    this->setTableOffsets(lanes);
+    this->evalPayoffsAvx2(lanes);
+    this->chooseNextClassesAvx2(lanes);
+    this->updateLanes(lanes);
+    this->stepNum++;
+    return;
+  }
+#endif
+  this->drawIndividuals(lanes);
+  this->setTableOffsets(lanes);
+  this->evalPayoffs(lanes);
+  this->chooseNextClasses(lanes);
+  this->updateLanes(lanes);
+  this->stepNum++;
+}
+
+/**
+ * @brief the population of a lane, e.g. for fillStatisticsRow, brought up to
+ * date with the lane. It costs O(population)
+ *
+ * @param lane
+ * @return const Population&
+ */
+const Population& LockstepReplicas::syncLane(int lane) {
+  Population& individuals = this->lanes[lane];
+  const int recipient_strategy_num = this->recipientStrategies.size();
+  for (int i = 0; i < this->population; i++) {
+    const int pair_id = this->getStrategyPairId(lane, i);
+    const int donor_id = pair_id / recipient_strategy_num;
+    const int recipient_id = pair_id % recipient_strategy_num;
+    if (individuals.getDonorStrategyId(i) != donor_id ||
+        individuals.getRecipientStrategyId(i) != recipient_id) {
+      individuals.setStrategies(i, donor_id, recipient_id);
+    }
+    const int reputation_id = this->getReputationId(lane, i);
+    if (individuals.getReputationId(i) != reputation_id) {
+      individuals.setReputationId(i, reputation_id);
+    }
+  }
+  return individuals;
+}
@@ -0,0 +1,330 @@
+#include "LogReducer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "JsonFile.hpp"
+
+namespace {
+template <typename T>
+void appendValue(std::string& state, T value) {
+  state.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void appendArray(std::string& state, std::vector<T> const& values) {
+  appendValue<uint64_t>(state, values.size());
+  state.append(reinterpret_cast<const char*>(values.data()),
+               values.size() * sizeof(T));
+}
+
+template <typename T>
+void readValue(std::string const& state, size_t& pos, T& value) {
+  if (pos + sizeof(T) > state.size()) {
+    std::cerr << "broken log reducer state" << std::endl;
+    throw "broken log reducer state";
+  }
+  std::memcpy(&value, state.data() + pos, sizeof(T));
+  pos += sizeof(T);
+}
+
+template <typename T>
+void readArray(std::string const& state, size_t& pos, std::vector<T>& values) {
+  uint64_t size = 0;
+  readValue(state, pos, size);
+  if (pos + size * sizeof(T) > state.size()) {
+    std::cerr << "broken log reducer state" << std::endl;
+    throw "broken log reducer state";
+  }
+  values.resize(size);
+  std::memcpy(values.data(), state.data() + pos, size * sizeof(T));
+  pos += size * sizeof(T);
+}
+}  // namespace
+
+/**
+ * @brief Construct a new Log Reducer
+ *
+ * @param columnNames the columns of the log, the step first
+ * @param columnTypes the types of addRow()
+ * @param population the denominator of the COUNT columns
+ * @param tailFrom the first step of the tail window
+ * @param logPointsPerDecade the log-spaced rows per decade, 0 for none
+ * @param bucketWidth the steps of a min/max bucket, 0 for none
+ */
+LogReducer::LogReducer(std::vector<std::string> const& columnNames,
+                       std::vector<BinaryLogColumnType> const& columnTypes,
+                       double population, uint64_t tailFrom,
+                       int logPointsPerDecade, uint64_t bucketWidth)
+    : columnNames(columnNames),
+      columnTypes(columnTypes),
+      population(population),
+      valueNum(static_cast<int>(columnNames.size()) - 1),
+      tailFrom(tailFrom),
+      logPointsPerDecade(logPointsPerDecade),
+      bucketWidth(bucketWidth),
+      values(columnNames.size()),
+      rowNum(0),
+      lastStep(0),
+      tailRowNum(0),
+      tailMeans(columnNames.size() - 1, 0),
+      tailM2s(columnNames.size() - 1, 0),
+      sampleIndex(-1),
+      nextSampleStep(0) {
+  if (columnNames.size() < 2 || columnTypes.size() != columnNames.size() ||
+      logPointsPerDecade < 0) {
+    std::cerr << "log reducer error: " << columnNames.size() << " columns, "
+              << columnTypes.size() << " types, " << logPointsPerDecade
+              << " points per decade" << std::endl;
+    throw "log reducer error";
+  }
+}
+
+LogReducer::~LogReducer() {}
+
+/**
+ * @brief the next sample step after the row of step lastStep was sampled
+ */
+void LogReducer::advanceSampleStep() {
+  do {
+    this->sampleIndex++;
+    this->nextSampleStep = static_cast<uint64_t>(std::ceil(
+        std::pow(10.0, static_cast<double>(this->sampleIndex) /
+                           this->logPointsPerDecade) -
+        1e-9));
+  } while (this->nextSampleStep <= this->lastStep);
+}
+
+/**
+ * @brief reduce one row of the log, the rows come in step order
+ *
+ * @param row the step and the valueNum values
+ */
+void LogReducer::add(const double* row) {
+  const uint64_t step = static_cast<uint64_t>(row[0]);
+  const double* rowValues = row + 1;
+  this->rowNum++;
+  this->lastStep = step;
+
+  if (step >= this->tailFrom) {
+    this->tailRowNum++;
+    for (int k = 0; k < this->valueNum; k++) {
+      double delta = rowValues[k] - this->tailMeans[k];
+      this->tailMeans[k] += delta / this->tailRowNum;
+      this->tailM2s[k] += delta * (rowValues[k] - this->tailMeans[k]);
+    }
+  }
+
+  if (this->logPointsPerDecade > 0 && step >= this->nextSampleStep) {
+    this->sampledRows.insert(this->sampledRows.end(), row,
+                             row + this->valueNum + 1);
+    this->advanceSampleStep();
+  }
+
+  if (this->bucketWidth > 0) {
+    const uint64_t first_step = step / this->bucketWidth * this->bucketWidth;
+    if (this->bucketFirstSteps.empty() ||
+        this->bucketFirstSteps.back() != first_step) {
+      this->bucketFirstSteps.push_back(first_step);
+      this->bucketMins.insert(this->bucketMins.end(), rowValues,
+                              rowValues + this->valueNum);
+      this->bucketMaxs.insert(this->bucketMaxs.end(), rowValues,
+                              rowValues + this->valueNum);
+    } else {
+      double* mins = &this->bucketMins[this->bucketMins.size() - this->valueNum];
+      double* maxs = &this->bucketMaxs[this->bucketMaxs.size() - this->valueNum];
+      for (int k = 0; k < this->valueNum; k++) {
+        mins[k] = std::min(mins[k], rowValues[k]);
+        maxs[k] = std::max(maxs[k], rowValues[k]);
+      }
+    }
+  }
+}
+
+/**
+ * @brief reduce a row of the binary log
+ *
+ * @param row the 4-byte values of BinaryLogWriter::writeRow()
+ */
+void LogReducer::addRow(const uint32_t* row) {
+  for (size_t col = 0; col < this->columnTypes.size(); col++) {
+    switch (this->columnTypes[col]) {
+      case BinaryLogColumnType::UINT32:
+        this->values[col] = row[col];
+        break;
+      case BinaryLogColumnType::COUNT:
+        this->values[col] = row[col] / this->population;
+        break;
+      case BinaryLogColumnType::FLOAT32:
+        this->values[col] = BinaryLogWriter::decodeFloat(row[col]);
+        break;
+    }
+  }
+  this->add(this->values.data());
+}
+
+/**
+ * @brief reduce a line of the csv log
+ *
+ * @param line the numbers of the columns separated by ","
+ */
+void LogReducer::addCsvLine(std::string const& line) {
+  const char* begin = line.c_str();
+  for (size_t col = 0; col < this->values.size(); col++) {
+    char* end = nullptr;
+    this->values[col] = std::strtod(begin, &end);
+    if (end == begin || (*end != ',' && *end != '\0')) {
+      std::cerr << "log line error: " << line << std::endl;
+      throw "log line error";
+    }
+    begin = end + 1;
+  }
+  this->add(this->values.data());
+}
+
+/**
+ * @brief the sample variance of the tail window
+ *
+ * @param column the index of the value, 0 is the column after the step
+ * @return double 0 if the tail has less than 2 rows
+ */
+double LogReducer::getTailVariance(int column) const {
+  return this->tailRowNum > 1 ? this->tailM2s[column] / (this->tailRowNum - 1)
+                              : 0;
+}
+
+/**
+ * @brief the summary, see LogReducer.hpp
+ *
+ * @return boost::json::value
+ */
+boost::json::value LogReducer::toJson() const {
+  const int stride = this->valueNum + 1;
+  boost::json::object summary;
+  summary["rowNum"] = this->rowNum;
+  summary["lastStep"] = this->lastStep;
+
+  boost::json::object tail;
+  boost::json::object means;
+  boost::json::object variances;
+  for (int k = 0; k < this->valueNum; k++) {
+    means[this->columnNames[k + 1]] = this->tailMeans[k];
+    variances[this->columnNames[k + 1]] = this->getTailVariance(k);
+  }
+  tail["fromStep"] = this->tailFrom;
+  tail["rowNum"] = this->tailRowNum;
+  tail["mean"] = means;
+  tail["variance"] = variances;
+  summary["tail"] = tail;
+
+  if (this->logPointsPerDecade > 0) {
+    boost::json::object sampled;
+    for (int col = 0; col < stride; col++) {
+      boost::json::array column;
+      for (size_t i = col; i < this->sampledRows.size(); i += stride) {
+        column.push_back(this->sampledRows[i]);
+      }
+      sampled[this->columnNames[col]] = column;
+    }
+    summary["logSampled"] = sampled;
+  }
+
+  if (this->bucketWidth > 0) {
+    boost::json::object buckets;
+    boost::json::array steps;
+    for (uint64_t step : this->bucketFirstSteps) {
+      steps.push_back(step);
+    }
+    buckets["width"] = this->bucketWidth;
+    buckets["step"] = steps;
+    for (const char* name : {"min", "max"}) {
+      const std::vector<double>& bucketValues =
+          std::strcmp(name, "min") == 0 ? this->bucketMins : this->bucketMaxs;
+      boost::json::object columns;
+      for (int k = 0; k < this->valueNum; k++) {
+        boost::json::array column;
+        for (size_t i = k; i < bucketValues.size(); i += this->valueNum) {
+          column.push_back(bucketValues[i]);
+        }
+        columns[this->columnNames[k + 1]] = column;
+      }
+      buckets[name] = columns;
+    }
+    summary["buckets"] = buckets;
+  }
+  return summary;
+}
+
+/**
+ * @brief write the summary to path + ".tmp" and rename it to path
+ *
+ * @param path
+ */
+void LogReducer::write(std::string const& path) const {
+  const std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream file(tmpPath);
+    if (!file) {
+      std::cerr << "can not write the summary: " << tmpPath << std::endl;
+      throw "can not write the summary";
+    }
+    pretty_print(file, this->toJson());
+  }
+  std::filesystem::rename(tmpPath, path);
+}
+
+/**
+ * @brief the state of the reducers for a Checkpoint, the configuration is not
+ * saved
+ *
+ * @param state
+ */
+void LogReducer::saveState(std::string& state) const {
+  state.clear();
+  appendValue<uint64_t>(state, this->rowNum);
+  appendValue<uint64_t>(state, this->lastStep);
+  appendValue<uint64_t>(state, this->tailRowNum);
+  appendArray(state, this->tailMeans);
+  appendArray(state, this->tailM2s);
+  appendValue<int32_t>(state, this->sampleIndex);
+  appendValue<uint64_t>(state, this->nextSampleStep);
+  appendArray(state, this->sampledRows);
+  appendArray(state, this->bucketFirstSteps);
+  appendArray(state, this->bucketMins);
+  appendArray(state, this->bucketMaxs);
+}
+
+/**
+ * @brief restore the state of saveState() into a reducer of the same columns
+ * and configuration
+ *
+ * @param state
+ */
+void LogReducer::loadState(std::string const& state) {
+  size_t pos = 0;
+  int32_t sampleIndex = 0;
+  readValue(state, pos, this->rowNum);
+  readValue(state, pos, this->lastStep);
+  readValue(state, pos, this->tailRowNum);
+  readArray(state, pos, this->tailMeans);
+  readArray(state, pos, this->tailM2s);
+  readValue(state, pos, sampleIndex);
+  this->sampleIndex = sampleIndex;
+  readValue(state, pos, this->nextSampleStep);
+  readArray(state, pos, this->sampledRows);
+  readArray(state, pos, this->bucketFirstSteps);
+  readArray(state, pos, this->bucketMins);
+  readArray(state, pos, this->bucketMaxs);
+  if (pos != state.size() ||
+      this->tailMeans.size() != static_cast<size_t>(this->valueNum) ||
+      this->bucketMins.size() !=
+          this->bucketFirstSteps.size() * this->valueNum) {
+    std::cerr << "log reducer state error" << std::endl;
+    throw "log reducer state error";
+  }
+}
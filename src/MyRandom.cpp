@@ -1,5 +1,5 @@
 #include "MyRandom.hpp"
 
 double MyRandom::getProbability() {
-    return this->prob_dis(this->gen);
+    return this->gen.nextDouble();
 }
\ No newline at end of file
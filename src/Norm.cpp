@@ -1,16 +1,53 @@
 #include "Norm.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
-#include <chrono>
+
+#include "CsvTable.hpp"
 
 Norm::Norm() {}
 
 Norm::Norm(std::string csvPath) {
   this->loadNormFunc(csvPath);
-  unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-  this->gen = std::mt19937(seed);  //< generate random numbers with time-based seed
+  // every object has its own stream, replace it by setRandomStream() for a
+  // reproducible run
+  this->gen = RandomStream::newDefaultStream(RandomPurpose::NORM);
+}
+
+/**
+ * @brief Construct a new Norm object which also generates the dense normTable
+ * for getReputationId
+ *
+ * @param csvPath
+ * @param donorActions the actions whose names appear in the donor row
+ * @param recipientActions the actions whose names appear in the recipient row
+ */
+Norm::Norm(std::string csvPath, std::vector<Action> const& donorActions,
+           std::vector<Action> const& recipientActions)
+    : donorActions(donorActions), recipientActions(recipientActions) {
+  this->loadNormFunc(csvPath);
+  // every object has its own stream, replace it by setRandomStream() for a
+  // reproducible run
+  this->gen = RandomStream::newDefaultStream(RandomPurpose::NORM);
+}
+
+/**
+ * @brief Construct a new Norm object from the cells of its csv file, see
+ * Norm(csvPath, donorActions, recipientActions)
+ *
+ * @param table
+ * @param donorActions
+ * @param recipientActions
+ */
+Norm::Norm(CsvTable const& table, std::vector<Action> const& donorActions,
+           std::vector<Action> const& recipientActions)
+    : donorActions(donorActions), recipientActions(recipientActions) {
+  this->loadNormTable(table);
+  // every object has its own stream, replace it by setRandomStream() for a
+  // reproducible run
+  this->gen = RandomStream::newDefaultStream(RandomPurpose::NORM);
 }
 
 double Norm::getProbability() {
@@ -22,77 +59,179 @@ double Norm::getProbability() {
 Norm::~Norm() {}
 
 void Norm::loadNormFunc(std::string csvPath) {
-  try {
-    // std::cout << "normcsvPath: " << csvPath << std::endl;
-    std::ifstream csvFile(csvPath);
-    if (!csvFile.is_open()) {
-      std::cerr << "Failed to open file: " << csvPath << std::endl;
-      throw "strategy file not found";
-    }
+  this->loadNormTable(readCsvTable(csvPath));
+}
 
-    std::string line;
-    while (std::getline(csvFile, line)) {
-      // remove the line in the end "r"
-      std::string target = "\r";
-      int pos = line.find(target);
-      int n = line.size();
-      if (pos != std::string::npos) {
-        line.erase(pos, target.size());
-      }
-      std::vector<std::string> normTableRow;
-      std::stringstream ss(line);
-      std::string cell;
-      while (std::getline(ss, cell, ',')) {
-        normTableRow.push_back(cell);
+/**
+ * @brief load the cells of a norm csv file, the last row is the new
+ * reputation and the other rows are the inputs (the donor action, the
+ * recipient action of a second-order norm, and the recipient's current
+ * reputation of a third-order norm). The reputation levels are 0, 1 and every
+ * value of the reputation rows, e.g. 0, 0.5, 1, all in [0, 1]
+ *
+ * @param table
+ */
+void Norm::loadNormTable(CsvTable const& table) {
+  if (table.empty()) {
+    std::cerr << "empty norm table" << std::endl;
+    throw "empty norm table";
+  }
+  this->normTableStr = table;
+  this->inputRowNum = table.size() - 1;
+  if (this->inputRowNum < 1 || this->inputRowNum > 3) {
+    std::cerr << "norm table needs one to three input rows, got "
+              << this->inputRowNum << std::endl;
+    throw "norm table needs one to three input rows";
+  }
+
+  // the rows of reputations: the new one, and the recipient's of third order
+  std::vector<int> reputationRows{this->inputRowNum};
+  if (this->inputRowNum == 3) {
+    reputationRows.push_back(2);
+  }
+  this->reputationValues = {0.0, 1.0};
+  for (int row : reputationRows) {
+    for (std::string const& cell : table[row]) {
+      double reputation = std::stod(cell);
+      if (!(reputation >= 0 && reputation <= 1)) {
+        std::cerr << "wrong reputation value: " << cell << std::endl;
+        throw "wrong reputation value";
       }
-      this->normTableStr.push_back(normTableRow);
+      this->reputationValues.push_back(reputation);
     }
+  }
+  std::sort(this->reputationValues.begin(), this->reputationValues.end());
+  this->reputationValues.erase(
+      std::unique(this->reputationValues.begin(), this->reputationValues.end()),
+      this->reputationValues.end());
+  if (this->reputationValues.size() >= UINT8_MAX) {
+    std::cerr << "too many reputation levels: "
+              << this->reputationValues.size() << std::endl;
+    throw "too many reputation levels";
+  }
 
-    csvFile.close();
-
-  } catch (const std::exception& e) {
-    std::cerr << e.what() << '\n';
+  if (!this->donorActions.empty() && !this->recipientActions.empty()) {
+    this->generateNormTable();
   }
+}
+
+/**
+ * @brief generate normTable from normTableStr, the dense table of
+ * getReputationId and getReputation. An input row missing from a lower-order
+ * norm matches every value: a first-order norm gives the same reputation for
+ * every recipient action, a first or second-order norm for every reputation
+ * of the recipient.
+ *
+ */
+void Norm::generateNormTable() {
+  const uint8_t noReputation = UINT8_MAX;
+  auto findActionId = [](std::vector<Action> const& actions,
+                         std::string const& name) {
+    for (Action const& action : actions) {
+      if (action.getName() == name) {
+        return action.getId();
+      }
+    }
+    std::cerr << "action not found: " << name << std::endl;
+    throw "action not found";
+  };
 
-  // generated strategyFunc, which is used to speed up the look-up table
-  std::string key = "";
-  // according to iterate over all strategyTable list
+  const int recipientActionNum = this->recipientActions.size();
+  const int reputationNum = this->reputationValues.size();
+  this->normTable = std::vector<uint8_t>(
+      this->donorActions.size() * recipientActionNum * reputationNum,
+      noReputation);
   for (int col = 0; col < this->normTableStr[0].size(); col++) {
-    // by strategyTable traveled through all
-    for (int row = 0; row < this->normTableStr.size(); row++) {
-    // if the last line is for the output
-      if (row == this->normTableStr.size() - 1) {
-        this->normFunc[key] = std::stod(this->normTableStr[row][col]);
-        // restore the key value of the initial value
-        key = "";
-      } else {
-        // if it wasn't the last line, for the input
-        key += "!" + this->normTableStr[row][col];
+    int donorActionId =
+        findActionId(this->donorActions, this->normTableStr[0][col]);
+    int reputationId = this->getReputationId(
+        std::stod(this->normTableStr[this->inputRowNum][col]));
+    int recipientActionBegin = 0;
+    int recipientActionEnd = recipientActionNum;
+    if (this->inputRowNum >= 2) {
+      recipientActionBegin =
+          findActionId(this->recipientActions, this->normTableStr[1][col]);
+      recipientActionEnd = recipientActionBegin + 1;
+    }
+    int recipientReputationBegin = 0;
+    int recipientReputationEnd = reputationNum;
+    if (this->inputRowNum == 3) {
+      recipientReputationBegin =
+          this->getReputationId(std::stod(this->normTableStr[2][col]));
+      recipientReputationEnd = recipientReputationBegin + 1;
+    }
+    for (int recipientActionId = recipientActionBegin;
+         recipientActionId < recipientActionEnd; recipientActionId++) {
+      for (int recipientReputationId = recipientReputationBegin;
+           recipientReputationId < recipientReputationEnd;
+           recipientReputationId++) {
+        this->normTable[(donorActionId * recipientActionNum +
+                         recipientActionId) *
+                            reputationNum +
+                        recipientReputationId] = reputationId;
       }
     }
   }
+  for (uint8_t reputationId : this->normTable) {
+    if (reputationId == noReputation) {
+      std::cerr << "norm table not complete" << std::endl;
+      throw "norm table not complete";
+    }
+  }
 }
 
+/**
+ * @brief the reputation id of the reputation value
+ *
+ * @param reputation
+ * @return int
+ */
+int Norm::getReputationId(double reputation) const {
+  for (int reputationId = 0; reputationId < this->reputationValues.size();
+       reputationId++) {
+    if (this->reputationValues[reputationId] == reputation) {
+      return reputationId;
+    }
+  }
+  std::cerr << "wrong reputation value: " << reputation << std::endl;
+  throw "wrong reputation value";
+}
+
+/**
+ * @brief the reputation value given by the norm to a recipient of
+ * recipientReputationId after the actions, a look-up of the dense normTable.
+ * With probability reputation_error_p the assessment is wrong and gives one
+ * of the other levels, uniformly, e.g. 0 or 0.5 instead of 1. Only available
+ * if the actions are given to the constructor
+ *
+ * @param donorAction
+ * @param recipientAction
+ * @param recipientReputationId the current reputation id of the recipient,
+ * only read by a third-order norm
+ * @param reputation_error_p
+ * @return double
+ */
 double Norm::getReputation(Action const& donorAction,
                            Action const& recipientAction,
+                           int recipientReputationId,
                            double const reputation_error_p) {
-  std::string key =
-      "!" + donorAction.getName() + "!" + recipientAction.getName();
-  double res = this->normFunc.at(key);
-  
+  if (this->normTable.empty()) {
+    std::cerr << "norm table not generated, the norm needs the actions"
+              << std::endl;
+    throw "norm table not generated";
+  }
+  int reputationId = this->getReputationId(
+      donorAction.getId(), recipientAction.getId(), recipientReputationId);
   if (reputation_error_p == 0.0) {
-    return res;
+    return this->reputationValues[reputationId];
   }
   if (this->getProbability() < reputation_error_p) {
-    if (res == 1.0) {
-      res = 0.0;
-    } else if (res == 0.0) {
-      res = 1.0;
-    } else {
-      std::cerr << "wrong reputation value: " << res << std::endl;
-      throw "wrong reputation value: " + std::to_string(res);
+    int wrongReputationId =
+        this->gen.nextInt(this->reputationValues.size() - 1);
+    if (wrongReputationId >= reputationId) {
+      wrongReputationId++;
     }
+    reputationId = wrongReputationId;
   }
-
-  return res;
+  return this->reputationValues[reputationId];
 }
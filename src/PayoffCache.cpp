@@ -0,0 +1,103 @@
+#include "PayoffCache.hpp"
+
+#include <algorithm>
+
+PayoffCache::PayoffCache()
+    : donorStrategyNum(0),
+      recipientStrategyNum(0),
+      reputationNum(0),
+      population(0),
+      kernel(getGameKernel(0, 0)) {}
+
+/**
+ * @brief Construct a new Payoff Cache, the payoffs of every reputation and
+ * the counts are to be set
+ *
+ * @param donorStrategyNum
+ * @param recipientStrategyNum
+ * @param reputationNum
+ * @param population
+ */
+PayoffCache::PayoffCache(int donorStrategyNum, int recipientStrategyNum,
+                         int reputationNum, int population)
+    : donorStrategyNum(donorStrategyNum),
+      recipientStrategyNum(recipientStrategyNum),
+      reputationNum(reputationNum),
+      population(population),
+      kernel(getGameKernel(donorStrategyNum, recipientStrategyNum)),
+      payoffs(reputationNum * donorStrategyNum * recipientStrategyNum * 2),
+      donorCounts(donorStrategyNum),
+      recipientCounts(recipientStrategyNum),
+      donorTerms(reputationNum * donorStrategyNum),
+      recipientTerms(reputationNum * recipientStrategyNum),
+      donorStale(reputationNum * donorStrategyNum, 1),
+      recipientStale(reputationNum * recipientStrategyNum, 1) {}
+
+PayoffCache::~PayoffCache() {}
+
+/**
+ * @brief copy the payoffs of the evaluated matrix as the payoffs of a
+ * reputation, its terms become stale
+ *
+ * @param rep
+ * @param payoffMatrix evaluated with the p of the reputation
+ */
+void PayoffCache::setPayoffs(int rep, const CompiledPayoffMatrix& payoffMatrix) {
+  for (int d = 0; d < this->donorStrategyNum; d++) {
+    for (int r = 0; r < this->recipientStrategyNum; r++) {
+      for (int player = 0; player < 2; player++) {
+        this->payoffs[((rep * this->donorStrategyNum + d) *
+                           this->recipientStrategyNum + r) * 2 + player] =
+            payoffMatrix.getPayoff(d, r, player);
+      }
+    }
+  }
+  std::fill_n(this->donorStale.begin() + rep * this->donorStrategyNum,
+              this->donorStrategyNum, 1);
+  std::fill_n(this->recipientStale.begin() + rep * this->recipientStrategyNum,
+              this->recipientStrategyNum, 1);
+}
+
+/**
+ * @brief replace all counts, every term becomes stale
+ *
+ * @param donorComposition
+ * @param recipientComposition
+ */
+void PayoffCache::setCounts(const Composition& donorComposition,
+                            const Composition& recipientComposition) {
+  this->donorCounts = donorComposition.getCounts();
+  this->recipientCounts = recipientComposition.getCounts();
+  std::fill(this->donorStale.begin(), this->donorStale.end(), 1);
+  std::fill(this->recipientStale.begin(), this->recipientStale.end(), 1);
+}
+
+/**
+ * @brief one donor switches its strategy, the recipient terms become stale
+ *
+ * @param fromId
+ * @param toId
+ */
+void PayoffCache::moveDonor(int fromId, int toId) {
+  if (fromId == toId) {
+    return;
+  }
+  this->donorCounts[fromId]--;
+  this->donorCounts[toId]++;
+  std::fill(this->recipientStale.begin(), this->recipientStale.end(), 1);
+}
+
+/**
+ * @brief one recipient switches its strategy, the donor terms become stale
+ *
+ * @param fromId
+ * @param toId
+ */
+void PayoffCache::moveRecipient(int fromId, int toId) {
+  if (fromId == toId) {
+    return;
+  }
+  this->recipientCounts[fromId]--;
+  this->recipientCounts[toId]++;
+  std::fill(this->donorStale.begin(), this->donorStale.end(), 1);
+}
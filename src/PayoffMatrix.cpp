@@ -9,6 +9,8 @@
 #include <sstream>
 #include <string>
 
+#include "CompiledPayoffMatrix.hpp"
+#include "CsvTable.hpp"
 #include "Strategy.hpp"
 
 PayoffMatrix::PayoffMatrix() {}
@@ -18,33 +20,30 @@ PayoffMatrix::PayoffMatrix() {}
  *
  * @param csvPath
  */
-PayoffMatrix::PayoffMatrix(std::string csvPath) {
-  char delimiter = ',';
+PayoffMatrix::PayoffMatrix(std::string csvPath)
+    : PayoffMatrix(readCsvTable(csvPath)) {}
 
+/**
+ * @brief Construct a new Payoff Matrix from the cells of its csv file, the
+ * first row is "<players>:<vars>" and the column strategies, every other row
+ * is a row strategy and the cells "<payoff of player 0>:<payoff of player
+ * 1>..."
+ *
+ * @param table
+ */
+PayoffMatrix::PayoffMatrix(CsvTable const& table) {
   int rowNum = 0;
   int colNum = 0;
   int playerNum = 0;
 
-  std::ifstream csvFile(csvPath);
-
   int isRowOne = 1;
-  std::string line;
-  while (std::getline(csvFile, line)) {
-    std::string target = "\r";
-    int pos = line.find(target);
-    int n = line.size();
-    if (pos != std::string::npos) {
-      line.erase(pos, target.size());
-    }
-
+  for (const std::vector<std::string>& cells : table) {
     std::vector<std::vector<std::string>> payoffMatrixRow;
-    std::stringstream ss(line);
-    std::string cell;
     if (isRowOne == 1) {
       isRowOne = 0;
       int strategyId = 0;
       int isColOne = 1;
-      while (std::getline(ss, cell, delimiter)) {
+      for (const std::string& cell : cells) {
         if (isColOne == 1) {
           isColOne = 0;
           std::stringstream cell_ss(cell);
@@ -54,7 +53,6 @@ PayoffMatrix::PayoffMatrix(std::string csvPath) {
           std::stringstream players_ss(players);
           std::string playerName;
           while (getline(players_ss, playerName, ' ')) {
-            // std::cout << playerName << std::endl;
             playerNum++;
           }
           while (getline(cell_ss, valName, ' ')) {
@@ -67,29 +65,23 @@ PayoffMatrix::PayoffMatrix(std::string csvPath) {
       colNum = this->colStrategies.size();
     } else {
       rowNum++;
-      int temp_colNum = 0;
-      std::getline(ss, cell, delimiter);
-      // the cell is the rowStrategy name
-      this->rowStrategies.push_back(Strategy(cell, rowNum - 1));
-      while (std::getline(ss, cell, delimiter)) {
-        temp_colNum++;
-        std::stringstream cell_ss(cell);
-        std::string payoffForOnePlayer_str;
-        std::vector<std::string> payoffList;
-        int temp_playerNum = 0;
-        while (std::getline(cell_ss, payoffForOnePlayer_str,
-                            ':')) {
-          temp_playerNum++;
-          payoffList.push_back(payoffForOnePlayer_str);
-        }
-        if (temp_playerNum != playerNum) {
+      if (cells.empty()) {
+        std::cerr << "empty row of the payoff matrix" << std::endl;
+        throw "empty row of the payoff matrix";
+      }
+      // the first cell is the rowStrategy name
+      this->rowStrategies.push_back(Strategy(cells[0], rowNum - 1));
+      for (size_t col = 1; col < cells.size(); col++) {
+        std::vector<std::string> payoffList =
+            splitCsvLine(cells[col], ':');
+        if (payoffList.size() != playerNum) {
           std::cerr << "not every cell has the same number of players's payoff"
                     << std::endl;
           throw "not every cell has the same number of players's payoff";
         }
         payoffMatrixRow.push_back(payoffList);
       }
-      if (temp_colNum != colNum) {
+      if (payoffMatrixRow.size() != colNum) {
         // is not have the same number of elements in a row
         std::cerr << "not every row has the same number of elements"
                   << std::endl;
@@ -102,9 +94,6 @@ PayoffMatrix::PayoffMatrix(std::string csvPath) {
   this->colNum = colNum;
   this->rowNum = rowNum;
   this->playerNum = playerNum;
-
-  // release the file
-  csvFile.close();
 }
 
 PayoffMatrix::~PayoffMatrix() {}
@@ -227,3 +216,14 @@ std::vector<std::vector<std::vector<double>>> PayoffMatrix::evalPayoffMatrix(
 
   return this->payoffMatrix;
 }
+
+/**
+ * @brief parse payoffMatrixStr once into a reusable evaluator, the vars are
+ * then assigned by id with CompiledPayoffMatrix::setVar and only the cells
+ * depending on the changed vars are re-evaluated
+ *
+ * @return CompiledPayoffMatrix
+ */
+CompiledPayoffMatrix PayoffMatrix::compile() const {
+  return CompiledPayoffMatrix(*this);
+}
@@ -1,11 +1,13 @@
 #include "Player.hpp"
 
-#include <chrono>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <random>
 #include <sstream>
 
+#include "CsvTable.hpp"
+
 // init static member commonInfo
 std::map<std::string, double> Player::commonInfo =
     std::map<std::string, double>();
@@ -18,11 +20,14 @@ Player::Player(const Player& other)
       actionPossibility(other.actionPossibility),
       strategyTables(other.strategyTables),
       strategyFunc(other.strategyFunc),
+      inputNames(other.inputNames),
+      actionTable(other.actionTable),
       strategy(other.strategy),
       strategies(other.strategies),
       vars(other.vars) {
-  unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-  this->gen = std::mt19937(seed);  //< generate random numbers with time-based seed
+  // every object has its own stream, replace it by setRandomStream() for a
+  // reproducible run
+  this->gen = RandomStream::newDefaultStream(RandomPurpose::PLAYER);
 }
 
 Player::Player(std::string name, int score, std::vector<Action> actions) {
@@ -30,8 +35,9 @@ Player::Player(std::string name, int score, std::vector<Action> actions) {
   this->score = score;
   this->actions = actions;
   this->actionPossibility = std::vector<double>(actions.size(), 0);
-  unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-  this->gen = std::mt19937(seed);  //< generate random numbers with time-based seed
+  // every object has its own stream, replace it by setRandomStream() for a
+  // reproducible run
+  this->gen = RandomStream::newDefaultStream(RandomPurpose::PLAYER);
 }
 
 Player::~Player() {}
@@ -122,42 +128,33 @@ void Player::setStrategy(const std::string& strategyName) {
  * @param strategyPath
  */
 void Player::loadStrategy(const std::string& strategyPath) {
+  std::map<std::string, CsvTable> tables;
   for (auto strategy : this->strategies) {
     std::string strategyName = strategy.getName();
     std::string strategyCSVPath =
         strategyPath + "/" + this->name + "/" + strategyName + ".csv";
+    tables[strategyName] = readCsvTable(strategyCSVPath);
+  }
+  this->loadStrategyTables(tables);
+}
 
-    try {
-      // std::cout << "strategyCSVPath: " << strategyCSVPath << std::endl;
-      std::ifstream csvFile(strategyCSVPath);
-      if (!csvFile.is_open()) {
-        std::cerr << "Failed to open file: " << strategyCSVPath << std::endl;
-        throw "strategy file not found";
-      }
-
-      std::string line;
-      while (std::getline(csvFile, line)) {
-        // 清除line中的"\r"
-        std::string target = "\r";
-        int pos = line.find(target);
-        int n = line.size();
-        if (pos != std::string::npos) {
-          line.erase(pos, target.size());
-        }
-        std::vector<std::string> strategyTableRow;
-        std::stringstream ss(line);
-        std::string cell;
-        while (std::getline(ss, cell, ',')) {
-          strategyTableRow.push_back(cell);
-        }
-        this->strategyTables[strategyName].push_back(strategyTableRow);
-      }
-
-      csvFile.close();
-
-    } catch (const std::exception& e) {
-      std::cerr << e.what() << '\n';
+/**
+ * @brief load the strategy tables of this->strategies, the cells of the
+ * strategy csv files (the last row is the output, the other rows are the
+ * inputs), and generate strategyFunc and actionTable
+ *
+ * @param tables strategy name -> table, may hold more strategies
+ */
+void Player::loadStrategyTables(const std::map<std::string, CsvTable>& tables) {
+  for (auto strategy : this->strategies) {
+    std::string strategyName = strategy.getName();
+    auto table = tables.find(strategyName);
+    if (table == tables.end() || table->second.empty()) {
+      std::cerr << "strategy table not found: " << this->name << "/"
+                << strategyName << std::endl;
+      throw "strategy table not found";
     }
+    this->strategyTables[strategyName] = table->second;
 
     // generate strategyFunc, which is used to speed up the look-up table
     std::string key = strategyName;
@@ -195,6 +192,80 @@ void Player::loadStrategy(const std::string& strategyPath) {
       }
     }
   }
+
+  this->generateActionTable();
+}
+
+/**
+ * @brief generate actionTable from strategyTables, which is the dense version
+ * of strategyFunc used by the allocation-free donate / reward. Only the
+ * strategies with one input row are supported.
+ *
+ */
+void Player::generateActionTable() {
+  const uint8_t noAction = UINT8_MAX;
+  int strategyNum = 0;
+  this->inputNames.clear();
+  for (auto strategy : this->strategies) {
+    strategyNum = std::max(strategyNum, strategy.getId() + 1);
+    const std::vector<std::vector<std::string>>& strategyTable =
+        this->strategyTables[strategy.getName()];
+    if (strategyTable.size() != 2) {
+      std::cerr << "action table needs one input row: " << strategy.getName()
+                << std::endl;
+      throw "action table needs one input row";
+    }
+    for (const std::string& input : strategyTable[0]) {
+      if (std::find(this->inputNames.begin(), this->inputNames.end(), input) ==
+          this->inputNames.end()) {
+        this->inputNames.push_back(input);
+      }
+    }
+  }
+
+  this->actionTable =
+      std::vector<uint8_t>(strategyNum * this->inputNames.size(), noAction);
+  for (auto strategy : this->strategies) {
+    const std::vector<std::vector<std::string>>& strategyTable =
+        this->strategyTables[strategy.getName()];
+    for (int col = 0; col < strategyTable[0].size(); col++) {
+      int inputId = this->getInputId(strategyTable[0][col]);
+      const Action& action =
+          this->strategyFunc.at(strategy.getName() + "!" + strategyTable[0][col]);
+      if (action.getId() < 0 || action.getId() >= noAction) {
+        std::cerr << "action id out of range: " << action.getId() << std::endl;
+        throw "action id out of range";
+      }
+      this->actionTable[strategy.getId() * this->inputNames.size() + inputId] =
+          action.getId();
+    }
+    for (int inputId = 0; inputId < this->inputNames.size(); inputId++) {
+      if (this->actionTable[strategy.getId() * this->inputNames.size() +
+                            inputId] == noAction) {
+        std::cerr << "strategy " << strategy.getName()
+                  << " has no action for input " << this->inputNames[inputId]
+                  << std::endl;
+        throw "strategy table not complete";
+      }
+    }
+  }
+}
+
+/**
+ * @brief the input id used by the allocation-free donate / reward
+ *
+ * @param input the input value in the strategy table, such as "1" for the
+ * reputation of the recipient or "C" for the action of the donor
+ * @return int
+ */
+int Player::getInputId(const std::string& input) const {
+  for (int inputId = 0; inputId < this->inputNames.size(); inputId++) {
+    if (this->inputNames[inputId] == input) {
+      return inputId;
+    }
+  }
+  std::cerr << "input not found: " << input << std::endl;
+  throw "input not found";
 }
 
 /** @brief using the built-in random number generator to generate a random strategy (equal probability)
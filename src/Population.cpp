@@ -0,0 +1,241 @@
+#include "Population.hpp"
+
+#include <iostream>
+#include <string>
+
+Population::Population()
+    : size(0),
+      reputationNum(2),
+      reputationBitShift(0),
+      reputationMask(1),
+      donorInputNum(0),
+      recipientInputNum(0),
+      recipientActionNum(0) {}
+
+/**
+ * @brief Construct a new Population object, every individual is uninitialized
+ * until initIndividual
+ *
+ * @param size the number of individuals
+ * @param donorTemplate the donor player whose strategies have been loaded
+ * @param recipientTemplate the recipient player whose strategies have been
+ * loaded
+ * @param norm the norm constructed with the actions
+ */
+Population::Population(int size, const Player& donorTemplate,
+                       const Player& recipientTemplate, const Norm& norm)
+    : size(size),
+      donorStrategyIds(size, 0),
+      recipientStrategyIds(size, 0),
+      reputationNum(norm.getReputationNum()),
+      reputationBitShift(0),
+      donorActionTable(donorTemplate.getActionTable()),
+      donorInputNum(donorTemplate.getInputNames().size()),
+      recipientActionTable(recipientTemplate.getActionTable()),
+      recipientInputNum(recipientTemplate.getInputNames().size()),
+      normTable(norm.getNormTable()),
+      recipientActionNum(recipientTemplate.getActions().size()),
+      donorComposition(donorTemplate.getStrategies().size(), size),
+      recipientComposition(recipientTemplate.getStrategies().size(), size),
+      statistics(donorTemplate.getStrategies().size(),
+                 recipientTemplate.getStrategies().size(),
+                 norm.getReputationNum()) {
+  // the smallest power of 2 bits holding every reputation id, at most 8 as
+  // the norm has fewer than UINT8_MAX levels
+  while ((1 << (1 << this->reputationBitShift)) < this->reputationNum) {
+    this->reputationBitShift++;
+  }
+  this->reputationMask = (uint64_t(1) << this->getReputationBitNum()) - 1;
+  // value-initialized words are 0
+  this->reputationBits = std::vector<std::atomic<uint64_t>>(
+      ((static_cast<uint64_t>(size) << this->reputationBitShift) + 63) / 64);
+  for (int reputationId = 0; reputationId < this->reputationNum;
+       reputationId++) {
+    const bool isGood = norm.getReputationValue(reputationId) >= 0.5;
+    this->donorInputOfReputation.push_back(
+        donorTemplate.getInputId(isGood ? "1" : "0"));
+  }
+  this->recipientInputOfAction =
+      std::vector<int>(donorTemplate.getActions().size());
+  for (const Action& action : donorTemplate.getActions()) {
+    this->recipientInputOfAction[action.getId()] =
+        recipientTemplate.getInputId(action.getName());
+  }
+}
+
+/**
+ * @brief copy the population, the reputation bits word by word as
+ * std::atomic is not copyable
+ *
+ * @param other
+ */
+Population::Population(const Population& other)
+    : size(other.size),
+      donorStrategyIds(other.donorStrategyIds),
+      recipientStrategyIds(other.recipientStrategyIds),
+      reputationNum(other.reputationNum),
+      reputationBitShift(other.reputationBitShift),
+      reputationMask(other.reputationMask),
+      reputationBits(other.reputationBits.size()),
+      donorActionTable(other.donorActionTable),
+      donorInputNum(other.donorInputNum),
+      recipientActionTable(other.recipientActionTable),
+      recipientInputNum(other.recipientInputNum),
+      normTable(other.normTable),
+      recipientActionNum(other.recipientActionNum),
+      donorInputOfReputation(other.donorInputOfReputation),
+      recipientInputOfAction(other.recipientInputOfAction),
+      donorComposition(other.donorComposition),
+      recipientComposition(other.recipientComposition),
+      statistics(other.statistics) {
+  for (size_t w = 0; w < this->reputationBits.size(); w++) {
+    this->reputationBits[w].store(
+        other.reputationBits[w].load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+}
+
+Population& Population::operator=(const Population& other) {
+  if (this != &other) {
+    *this = Population(other);
+  }
+  return *this;
+}
+
+Population::~Population() {}
+
+/**
+ * @brief assign the strategies and reputation of an uninitialized individual
+ *
+ * @param i
+ * @param donorStrategyId
+ * @param recipientStrategyId
+ * @param reputationId
+ */
+void Population::initIndividual(int i, int donorStrategyId,
+                                int recipientStrategyId, int reputationId) {
+  this->donorStrategyIds[i] = donorStrategyId;
+  this->recipientStrategyIds[i] = recipientStrategyId;
+  this->donorComposition.add(i, donorStrategyId);
+  this->recipientComposition.add(i, recipientStrategyId);
+  const uint64_t bit = static_cast<uint64_t>(i) << this->reputationBitShift;
+  std::atomic<uint64_t>& word = this->reputationBits[bit >> 6];
+  word.store(word.load(std::memory_order_relaxed) |
+                 (static_cast<uint64_t>(reputationId) << (bit & 63)),
+             std::memory_order_relaxed);
+  this->statistics.add(donorStrategyId, recipientStrategyId, reputationId);
+}
+
+/**
+ * @brief exchange the strategy pairs of two individuals, the composition is
+ * unchanged
+ *
+ * @param i
+ * @param j
+ */
+void Population::swapStrategies(int i, int j) {
+  int reputationI = this->getReputationId(i);
+  int reputationJ = this->getReputationId(j);
+  if (reputationI != reputationJ) {
+    this->statistics.move(this->donorStrategyIds[i],
+                          this->recipientStrategyIds[i], reputationI,
+                          this->donorStrategyIds[j],
+                          this->recipientStrategyIds[j], reputationI);
+    this->statistics.move(this->donorStrategyIds[j],
+                          this->recipientStrategyIds[j], reputationJ,
+                          this->donorStrategyIds[i],
+                          this->recipientStrategyIds[i], reputationJ);
+  }
+  std::swap(this->donorStrategyIds[i], this->donorStrategyIds[j]);
+  std::swap(this->recipientStrategyIds[i], this->recipientStrategyIds[j]);
+}
+
+/**
+ * @brief exchange the reputations of two individuals, the number of good
+ * reputation is unchanged
+ *
+ * @param i
+ * @param j
+ */
+void Population::swapReputations(int i, int j) {
+  int reputationI = this->getReputationId(i);
+  int reputationJ = this->getReputationId(j);
+  if (reputationI != reputationJ) {
+    this->statistics.move(this->donorStrategyIds[i],
+                          this->recipientStrategyIds[i], reputationI,
+                          this->donorStrategyIds[i],
+                          this->recipientStrategyIds[i], reputationJ);
+    this->statistics.move(this->donorStrategyIds[j],
+                          this->recipientStrategyIds[j], reputationJ,
+                          this->donorStrategyIds[j],
+                          this->recipientStrategyIds[j], reputationI);
+    this->flipReputationBits(i, reputationI ^ reputationJ);
+    this->flipReputationBits(j, reputationI ^ reputationJ);
+  }
+}
+
+void Population::setStrategies(int i, int donorStrategyId,
+                               int recipientStrategyId) {
+  this->statistics.move(this->donorStrategyIds[i],
+                        this->recipientStrategyIds[i], this->getReputationId(i),
+                        donorStrategyId, recipientStrategyId,
+                        this->getReputationId(i));
+  this->donorComposition.move(i, this->donorStrategyIds[i], donorStrategyId);
+  this->donorStrategyIds[i] = donorStrategyId;
+  this->recipientComposition.move(i, this->recipientStrategyIds[i],
+                                  recipientStrategyId);
+  this->recipientStrategyIds[i] = recipientStrategyId;
+}
+
+void Population::setReputationId(int i, int reputationId) {
+  int oldReputationId = this->getReputationId(i);
+  if (oldReputationId == reputationId) {
+    return;
+  }
+  this->flipReputationBits(i, oldReputationId ^ reputationId);
+  this->statistics.move(this->donorStrategyIds[i],
+                        this->recipientStrategyIds[i], oldReputationId,
+                        this->donorStrategyIds[i],
+                        this->recipientStrategyIds[i], reputationId);
+}
+
+/**
+ * @brief add the changes of the counts after storeStrategies and
+ * storeReputationId
+ *
+ * @param counts (pair * #reputations + reputation id) -> the individuals
+ * added to the triple, negative if removed, like Statistics::getTripleCounts
+ */
+void Population::addTripleCounts(const std::vector<int>& counts) {
+  const int recipient_strategy_num = this->statistics.getRecipientStrategyNum();
+  const int reputation_num = this->statistics.getReputationNum();
+  for (int k = 0; k < static_cast<int>(counts.size()); k++) {
+    if (counts[k] == 0) {
+      continue;
+    }
+    const int pair_id = k / reputation_num;
+    const int donor_id = pair_id / recipient_strategy_num;
+    const int recipient_id = pair_id % recipient_strategy_num;
+    this->statistics.addCount(donor_id, recipient_id, k % reputation_num,
+                              counts[k]);
+    this->donorComposition.addCount(donor_id, counts[k]);
+    this->recipientComposition.addCount(recipient_id, counts[k]);
+  }
+}
+
+/**
+ * @brief donor i donates to recipient j, j rewards, and the norm updates the
+ * reputation of j
+ *
+ * @param donorI
+ * @param recipientJ
+ * @return int the new reputation id of recipient j
+ */
+int Population::playGame(int donorI, int recipientJ) {
+  int donorActionId = this->donate(donorI, recipientJ);
+  int recipientActionId = this->reward(recipientJ, donorActionId);
+  int newReputationId = this->assess(donorActionId, recipientActionId,
+                                     this->getReputationId(recipientJ));
+  this->setReputationId(recipientJ, newReputationId);
+  return newReputationId;
+}
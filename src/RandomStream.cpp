@@ -0,0 +1,131 @@
+#include "RandomStream.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+
+namespace {
+std::atomic<uint64_t> defaultSeed{static_cast<uint64_t>(
+    std::chrono::system_clock::now().time_since_epoch().count())};
+std::atomic<uint32_t> defaultStreamNum{0};
+}  // namespace
+
+Philox4x32::Counter Philox4x32::generate(Counter counter, Key key) {
+  for (int round = 0; round < 10; round++) {
+    uint64_t product0 = static_cast<uint64_t>(M0) * counter[0];
+    uint64_t product1 = static_cast<uint64_t>(M1) * counter[2];
+    uint32_t hi0 = static_cast<uint32_t>(product0 >> 32);
+    uint32_t lo0 = static_cast<uint32_t>(product0);
+    uint32_t hi1 = static_cast<uint32_t>(product1 >> 32);
+    uint32_t lo1 = static_cast<uint32_t>(product1);
+    counter = {hi1 ^ counter[1] ^ key[0], lo1, hi0 ^ counter[3] ^ key[1], lo0};
+    key[0] += W0;
+    key[1] += W1;
+  }
+  return counter;
+}
+
+RandomStream::RandomStream() : RandomStream(getDefaultSeed(), 0) {}
+
+/**
+ * @brief Construct a new Random Stream object
+ *
+ * @param seed the Philox key
+ * @param streamId the high 64 bits of the counter, different streams never
+ * overlap
+ */
+RandomStream::RandomStream(uint64_t seed, uint64_t streamId)
+    : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+      streamId(streamId),
+      blockId(0),
+      bufferPos(BLOCK_NUM * 4),
+      bufferEnd(BLOCK_NUM * 4) {}
+
+/**
+ * @brief the stream of one purpose in one replica of one run
+ *
+ * @param seed the global seed
+ * @param runId e.g. the norm id or the job id of a sweep
+ * @param replica
+ * @param purpose
+ * @return RandomStream
+ */
+RandomStream RandomStream::derive(uint64_t seed, uint32_t runId,
+                                  uint16_t replica, RandomPurpose purpose) {
+  return RandomStream(seed, getStreamId(runId, replica, purpose));
+}
+
+uint64_t RandomStream::getStreamId(uint32_t runId, uint16_t replica,
+                                   RandomPurpose purpose) {
+  return (static_cast<uint64_t>(runId) << 32) |
+         (static_cast<uint64_t>(replica) << 16) |
+         static_cast<uint64_t>(purpose);
+}
+
+void RandomStream::refill() {
+  for (int block = 0; block < this->bufferEnd / 4; block++) {
+    Philox4x32::Counter counter = {
+        static_cast<uint32_t>(this->blockId),
+        static_cast<uint32_t>(this->blockId >> 32),
+        static_cast<uint32_t>(this->streamId),
+        static_cast<uint32_t>(this->streamId >> 32)};
+    Philox4x32::Counter res = Philox4x32::generate(counter, this->key);
+    for (int i = 0; i < 4; i++) {
+      this->buffer[block * 4 + i] = res[i];
+    }
+    this->blockId++;
+  }
+  this->bufferPos = 0;
+}
+
+/**
+ * @brief jump to a block of the stream, the next number is the first one of
+ * the block. The numbers do not depend on blockNum, it only sets how many
+ * blocks are generated at a time, e.g. 1 for the short runs of numbers that
+ * start at a computed block
+ *
+ * @param blockId
+ * @param blockNum in [1, BLOCK_NUM]
+ */
+void RandomStream::seek(uint64_t blockId, int blockNum) {
+  assert(blockNum >= 1 && blockNum <= BLOCK_NUM);
+  this->blockId = blockId;
+  this->bufferEnd = blockNum * 4;
+  this->bufferPos = this->bufferEnd;
+}
+
+/**
+ * @brief continue the stream at a position of getPosition(), e.g. of a
+ * checkpoint, the next numbers are the same as those of the saved stream
+ *
+ * @param position
+ */
+void RandomStream::setPosition(uint64_t position) {
+  this->seek(position / 4);
+  for (uint64_t i = 0; i < position % 4; i++) {
+    this->nextUInt32();
+  }
+}
+
+/**
+ * @brief the seed of the objects which are not given an explicit stream, it
+ * is time-based until setDefaultSeed() is called
+ *
+ * @return uint64_t
+ */
+uint64_t RandomStream::getDefaultSeed() { return defaultSeed.load(); }
+
+void RandomStream::setDefaultSeed(uint64_t seed) { defaultSeed.store(seed); }
+
+/**
+ * @brief a new stream of the default seed, every call returns a different
+ * stream, e.g. for the copies of Player. The replica 0xffff is reserved for
+ * them so they never overlap the streams of derive() in a run
+ *
+ * @param purpose
+ * @return RandomStream
+ */
+RandomStream RandomStream::newDefaultStream(RandomPurpose purpose) {
+  return derive(getDefaultSeed(), defaultStreamNum.fetch_add(1), 0xffff,
+                purpose);
+}
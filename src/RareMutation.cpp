@@ -0,0 +1,432 @@
+#include "RareMutation.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+#include "Evolution.hpp"
+
+namespace {
+/**
+ * @brief log(fermi(payoff_current, payoff_new, s)) = -log(1 + exp(x)) with x
+ * = (payoff_current - payoff_new) * s, without the underflow of fermi() to 0
+ * for a large x
+ */
+double logFermi(double payoff_current, double payoff_new, double s) {
+  double x = (payoff_current - payoff_new) * s;
+  return x > 0 ? -x - std::log1p(std::exp(-x)) : -std::log1p(std::exp(x));
+}
+}  // namespace
+
+/**
+ * @brief load the payoff matrix, strategies and norm like Evolution and solve
+ * the embedded chain
+ */
+RareMutation::RareMutation(int population, double s, double b, double beta,
+                           double c, double gamma, int normId, double p0,
+                           std::string const& payoffMatrixConfigName)
+    : population(population),
+      s(s),
+      p0(p0),
+      normId(normId),
+      isShortterm(false),
+      donorActions{Action("C", 0), Action("D", 1)},
+      recipientActions{Action("C", 0), Action("D", 1)},
+      norm(Evolution::loadNorm(normId, donorActions, recipientActions)),
+      coopActionId(donorActions[0].getId()) {  // "C"
+  if (payoffMatrixConfigName == "payoffMatrix_shortterm") {
+    this->isShortterm = true;
+  } else if (payoffMatrixConfigName != "payoffMatrix_longterm_no_norm_error") {
+    std::cerr << "payoff_matrix_config_name error: " << payoffMatrixConfigName
+              << std::endl;
+    throw "payoff_matrix_config_name error";
+  }
+  if (population < 2) {
+    std::cerr << "population must be >= 2: " << population << std::endl;
+    throw "population must be >= 2";
+  }
+  // the good reputation probabilities are of the 2 levels
+  if (this->norm.getReputationNum() != 2) {
+    std::cerr << "rare mutation needs a binary norm, norm " << normId
+              << " has " << this->norm.getReputationNum() << " levels"
+              << std::endl;
+    throw "rare mutation needs a binary norm";
+  }
+  // the recipient's p is fixed per matrix, so the longterm payoffs are never
+  // evaluated again
+  const int recipient_player = 1;
+  for (int rep = 0; rep < this->norm.getReputationNum(); rep++) {
+    this->payoffMatrices.push_back(Evolution::loadPayoffMatrix(
+        payoffMatrixConfigName, normId, b, beta, c, gamma, p0));
+    this->payoffMatrices[rep].setVar(this->payoffMatrices[rep].getVarId("p"),
+                                     recipient_player,
+                                     this->norm.getReputationValue(rep));
+    this->payoffMatrices[rep].eval();
+  }
+  this->pVarId = this->payoffMatrices[0].getVarId("p");
+  this->donorStrategies = this->payoffMatrices[0].getRowStrategies();
+  this->recipientStrategies = this->payoffMatrices[0].getColStrategies();
+  this->tables = Population(
+      0,
+      Evolution::loadPlayer("donor", this->donorActions,
+                            this->donorStrategies),
+      Evolution::loadPlayer("recipient", this->recipientActions,
+                            this->recipientStrategies),
+      this->norm);
+  this->donorStrategyNum = this->donorStrategies.size();
+  this->recipientStrategyNum = this->recipientStrategies.size();
+  this->strategyPairNum = this->donorStrategyNum * this->recipientStrategyNum;
+  const int pair_num = this->strategyPairNum;
+
+  // the good reputation of the homogeneous populations, NAN if it never
+  // changes
+  std::vector<int> frozen_pairs;
+  this->homogeneousGoodReputation.assign(pair_num, 0);
+  for (int pair = 0; pair < pair_num; pair++) {
+    Composition donorComposition(this->donorStrategyNum, population);
+    for (int i = 0; i < population; i++) {
+      donorComposition.add(i, pair / this->recipientStrategyNum);
+    }
+    this->homogeneousGoodReputation[pair] =
+        this->getGoodReputationProbability(pair, donorComposition, NAN);
+    if (std::isnan(this->homogeneousGoodReputation[pair])) {
+      frozen_pairs.push_back(pair);
+      this->homogeneousGoodReputation[pair] = p0;
+    }
+  }
+
+  // the frozen reputations depend on the time of the mutants, which depends
+  // on the payoffs and so on the reputations, iterate to the fixed point
+  this->fixationProbabilities.assign(pair_num * pair_num, 0);
+  const int max_iteration = 100;
+  for (int iteration = 0; iteration < max_iteration; iteration++) {
+    double max_change = 0;
+    for (int resident : frozen_pairs) {
+      const int r = resident % this->recipientStrategyNum;
+      double to_good_sum = 0;
+      double change_sum = 0;
+      for (int mutant = 0; mutant < pair_num; mutant++) {
+        if (mutant == resident) {
+          continue;
+        }
+        double to_good = 0;
+        double to_bad = 0;
+        this->getReputationRates(mutant / this->recipientStrategyNum, r,
+                                 to_good, to_bad);
+        if (to_good + to_bad == 0) {
+          continue;
+        }
+        double mutant_time = 0;
+        this->computeFixation(resident, mutant, mutant_time);
+        to_good_sum += mutant_time * to_good;
+        change_sum += mutant_time * (to_good + to_bad);
+      }
+      double good = change_sum > 0 ? to_good_sum / change_sum : p0;
+      max_change = std::max(
+          max_change, std::fabs(good - this->homogeneousGoodReputation[resident]));
+      this->homogeneousGoodReputation[resident] = good;
+    }
+    if (max_change < 1e-9) {
+      break;
+    }
+  }
+
+  for (int resident = 0; resident < pair_num; resident++) {
+    for (int mutant = 0; mutant < pair_num; mutant++) {
+      if (mutant != resident) {
+        double mutant_time = 0;
+        this->fixationProbabilities[resident * pair_num + mutant] =
+            this->computeFixation(resident, mutant, mutant_time);
+      }
+    }
+  }
+  this->solveStationaryDistribution();
+}
+
+RareMutation::~RareMutation() {}
+
+/**
+ * @brief the probabilities that one game with the donor strategy makes the
+ * recipient of the recipient strategy good from bad and bad from good
+ *
+ * @param donorStrategyId
+ * @param recipientStrategyId
+ * @param toGood
+ * @param toBad
+ */
+void RareMutation::getReputationRates(int donorStrategyId,
+                                      int recipientStrategyId, double& toGood,
+                                      double& toBad) const {
+  const int bad = 0;
+  const int good = 1;
+  int donor_action_id = this->tables.getDonorAction(donorStrategyId, bad);
+  toGood = this->tables.assess(donor_action_id,
+                               this->tables.getRecipientAction(
+                                   recipientStrategyId, donor_action_id),
+                               bad) == good;
+  donor_action_id = this->tables.getDonorAction(donorStrategyId, good);
+  toBad = this->tables.assess(donor_action_id,
+                              this->tables.getRecipientAction(
+                                  recipientStrategyId, donor_action_id),
+                              good) == bad;
+}
+
+/**
+ * @brief the stationary probability of good reputation of an individual of
+ * the pair, whose games are played as the recipient of a random other donor
+ *
+ * @param pair
+ * @param donorComposition including the individual itself
+ * @param inherited the probability if the reputation never changes
+ * @return double
+ */
+double RareMutation::getGoodReputationProbability(
+    int pair, const Composition& donorComposition, double inherited) const {
+  const int own_donor_strategy = pair / this->recipientStrategyNum;
+  const int r = pair % this->recipientStrategyNum;
+  double to_good_sum = 0;
+  double to_bad_sum = 0;
+  for (int d = 0; d < this->donorStrategyNum; d++) {
+    int donor_num =
+        donorComposition.getCount(d) - (d == own_donor_strategy ? 1 : 0);
+    if (donor_num <= 0) {
+      continue;
+    }
+    double to_good = 0;
+    double to_bad = 0;
+    this->getReputationRates(d, r, to_good, to_bad);
+    to_good_sum += donor_num * to_good;
+    to_bad_sum += donor_num * to_bad;
+  }
+  if (to_good_sum + to_bad_sum == 0) {
+    return inherited;
+  }
+  return to_good_sum / (to_good_sum + to_bad_sum);
+}
+
+/**
+ * @brief the probability that one mutant takes over the resident population
+ * under the fermi process of Evolution:
+ *
+ *   rho = 1 / (1 + sum_{k=1}^{N-1} prod_{j=1}^{k} T-(j) / T+(j))
+ *
+ * with T-(j) / T+(j) = exp(s * (pi_R(j) - pi_M(j))) at j mutants, and the
+ * expected time of the mutants before the fixation or extinction
+ *
+ *   sum_j j * t(j), t(j) = rho / T+(j) * sum_{k=j}^{N-1} prod_{m=j+1}^{k} T-(m) / T+(m)
+ *
+ * The products are accumulated in log space so large s does not overflow.
+ * The mutants are former residents, so a frozen reputation of the mutants is
+ * the one of the residents.
+ *
+ * @param resident the resident strategy pair
+ * @param mutant the mutant strategy pair
+ * @param mutantTime the expected sum of the number of mutants over the steps
+ * @return double
+ */
+double RareMutation::computeFixation(int resident, int mutant,
+                                     double& mutantTime) {
+  const int n = this->population;
+  const int donor_player = 0;
+  const int resident_d = resident / this->recipientStrategyNum;
+  const int resident_r = resident % this->recipientStrategyNum;
+  const int mutant_d = mutant / this->recipientStrategyNum;
+  const int mutant_r = mutant % this->recipientStrategyNum;
+  const double resident_inherited = this->homogeneousGoodReputation[resident];
+
+  // individual i < j is a mutant
+  Composition donorComposition(this->donorStrategyNum, n);
+  Composition recipientComposition(this->recipientStrategyNum, n);
+  for (int i = 0; i < n; i++) {
+    donorComposition.add(i, resident_d);
+    recipientComposition.add(i, resident_r);
+  }
+
+  // [j - 1] for j = 1, ..., N - 1 mutants
+  std::vector<double> log_products(n - 1);
+  std::vector<double> log_increases(n - 1);
+  double log_product = 0;
+  double max_log_product = 0;
+  for (int j = 1; j < n; j++) {
+    donorComposition.move(j - 1, resident_d, mutant_d);
+    recipientComposition.move(j - 1, resident_r, mutant_r);
+    double resident_good = this->getGoodReputationProbability(
+        resident, donorComposition, resident_inherited);
+    double mutant_good = this->getGoodReputationProbability(
+        mutant, donorComposition, resident_good);
+    if (this->isShortterm) {
+      double good_freq = ((n - j) * resident_good + j * mutant_good) / n;
+      for (CompiledPayoffMatrix& payoffMatrix : this->payoffMatrices) {
+        payoffMatrix.setVar(this->pVarId, donor_player, good_freq);
+        payoffMatrix.eval();
+      }
+    }
+    // the expectation over the own reputation
+    double resident_payoff = 0;
+    double mutant_payoff = 0;
+    for (int rep = 0; rep < this->norm.getReputationNum(); rep++) {
+      double resident_p = rep == 1 ? resident_good : 1 - resident_good;
+      double mutant_p = rep == 1 ? mutant_good : 1 - mutant_good;
+      resident_payoff +=
+          resident_p * getAvgPayoff(this->donorStrategies[resident_d],
+                                    this->recipientStrategies[resident_r],
+                                    this->payoffMatrices[rep], donorComposition,
+                                    recipientComposition, n);
+      mutant_payoff +=
+          mutant_p * getAvgPayoff(this->donorStrategies[mutant_d],
+                                  this->recipientStrategies[mutant_r],
+                                  this->payoffMatrices[rep], donorComposition,
+                                  recipientComposition, n);
+    }
+    log_product += this->s * (resident_payoff - mutant_payoff);
+    log_products[j - 1] = log_product;
+    max_log_product = std::max(max_log_product, log_product);
+    // T+(j), a resident focal imitates a mutant role model
+    log_increases[j - 1] =
+        std::log(static_cast<double>(n - j) / n * j / (n - 1)) +
+        logFermi(resident_payoff, mutant_payoff, this->s);
+  }
+
+  // everything is scaled by exp(-max_log_product)
+  double scaled_sum = std::exp(-max_log_product);
+  for (double term : log_products) {
+    scaled_sum += std::exp(term - max_log_product);
+  }
+  const double rho = std::exp(-max_log_product) / scaled_sum;
+
+  mutantTime = 0;
+  double scaled_suffix = 0;  //< sum_{k >= j} exp(log_products[k - 1] - max)
+  for (int j = n - 1; j >= 1; j--) {
+    scaled_suffix += std::exp(log_products[j - 1] - max_log_product);
+    double log_time = std::log(scaled_suffix) - log_products[j - 1] -
+                      log_increases[j - 1] - std::log(scaled_sum);
+    mutantTime += j * std::exp(log_time);
+  }
+  return rho;
+}
+
+/**
+ * @brief the stationary distribution of the embedded chain, a mutation moves
+ * the homogeneous state to one of the other pairs uniformly (like Evolution)
+ * and fixes with the fixation probability. Solve pi (T - I) = 0 with sum pi =
+ * 1 by gaussian elimination.
+ *
+ */
+void RareMutation::solveStationaryDistribution() {
+  const int k = this->strategyPairNum;
+  // a[i][j] = (T - I)^T, the last row is replaced by the normalization
+  std::vector<std::vector<double>> a(k, std::vector<double>(k + 1, 0));
+  for (int resident = 0; resident < k; resident++) {
+    for (int mutant = 0; mutant < k; mutant++) {
+      if (mutant == resident) {
+        continue;
+      }
+      double t = this->getFixationProbability(resident, mutant) / (k - 1);
+      a[mutant][resident] += t;
+      a[resident][resident] -= t;
+    }
+  }
+  for (int j = 0; j <= k; j++) {
+    a[k - 1][j] = 1;
+  }
+
+  for (int col = 0; col < k; col++) {
+    int pivot = col;
+    for (int row = col + 1; row < k; row++) {
+      if (std::fabs(a[row][col]) > std::fabs(a[pivot][col])) {
+        pivot = row;
+      }
+    }
+    if (a[pivot][col] == 0) {
+      std::cerr << "the embedded chain of norm " << this->normId
+                << " is reducible" << std::endl;
+      throw "the embedded chain is reducible";
+    }
+    std::swap(a[col], a[pivot]);
+    for (int row = 0; row < k; row++) {
+      if (row == col || a[row][col] == 0) {
+        continue;
+      }
+      double factor = a[row][col] / a[col][col];
+      for (int j = col; j <= k; j++) {
+        a[row][j] -= factor * a[col][j];
+      }
+    }
+  }
+  this->stationaryDistribution.assign(k, 0);
+  for (int i = 0; i < k; i++) {
+    this->stationaryDistribution[i] = a[i][k] / a[i][i];
+  }
+}
+
+/**
+ * @brief the long-run good reputation frequency
+ *
+ * @return double
+ */
+double RareMutation::getGoodReputationFrequency() const {
+  double res = 0;
+  for (int pair = 0; pair < this->strategyPairNum; pair++) {
+    res += this->stationaryDistribution[pair] *
+           this->homogeneousGoodReputation[pair];
+  }
+  return res;
+}
+
+/**
+ * @brief the long-run cooperation rate, getCoopRate() of the homogeneous
+ * populations weighted by the stationary distribution
+ *
+ * @return double
+ */
+double RareMutation::getCoopRate() const {
+  double res = 0;
+  for (int pair = 0; pair < this->strategyPairNum; pair++) {
+    const int d = pair / this->recipientStrategyNum;
+    const int r = pair % this->recipientStrategyNum;
+    if (this->tables.getRecipientAction(r, this->coopActionId) !=
+        this->coopActionId) {
+      continue;
+    }
+    const double good = this->homogeneousGoodReputation[pair];
+    double coop_rate = 0;
+    if (this->tables.getDonorAction(d, 1) == this->coopActionId) {
+      coop_rate += good;
+    }
+    if (this->tables.getDonorAction(d, 0) == this->coopActionId) {
+      coop_rate += 1 - good;
+    }
+    res += this->stationaryDistribution[pair] * coop_rate;
+  }
+  return res;
+}
+
+/**
+ * @brief the line of the csv log, the stationary distribution in the columns
+ * of printStatistics() of Evolution
+ *
+ * @param step
+ * @return std::string
+ */
+std::string RareMutation::printStatistics(int step) const {
+  return printFrequencyStatistics(
+      this->stationaryDistribution, this->donorStrategies,
+      this->recipientStrategies, step, this->getGoodReputationFrequency(),
+      this->getCoopRate());
+}
+
+/**
+ * @brief the row of the binary log, see fillFrequencyStatisticsRow()
+ *
+ * @param step
+ * @param row
+ */
+void RareMutation::fillStatisticsRow(int step,
+                                     std::vector<uint32_t>& row) const {
+  fillFrequencyStatisticsRow(this->stationaryDistribution,
+                             this->donorStrategies, this->recipientStrategies,
+                             step, this->population,
+                             this->getGoodReputationFrequency(),
+                             this->getCoopRate(), row);
+}
@@ -0,0 +1,424 @@
+#include "ReplicatorDynamics.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+#include "Evolution.hpp"
+
+namespace {
+// Dormand-Prince 5(4), the derivative is autonomous so the nodes c are not
+// needed, the 7th stage is the derivative at the new state (FSAL)
+const double A[7][6] = {
+    {0, 0, 0, 0, 0, 0},
+    {1.0 / 5, 0, 0, 0, 0, 0},
+    {3.0 / 40, 9.0 / 40, 0, 0, 0, 0},
+    {44.0 / 45, -56.0 / 15, 32.0 / 9, 0, 0, 0},
+    {19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729, 0, 0},
+    {9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656,
+     0},
+    {35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84}};
+// the 5th order solution minus the embedded 4th order solution
+const double E[7] = {71.0 / 57600,      0,           -71.0 / 16695,
+                     71.0 / 1920,       -17253.0 / 339200, 22.0 / 525,
+                     -1.0 / 40};
+}  // namespace
+
+/**
+ * @brief load the payoff matrix, strategies and norm like Evolution, the
+ * initial state is the one of Evolution: every strategy pair has the same
+ * frequency and a fraction p0 of every pair has good reputation
+ */
+ReplicatorDynamics::ReplicatorDynamics(
+    double s, double b, double beta, double c, double gamma, double mu,
+    int normId, double p0, std::string const& payoffMatrixConfigName,
+    double rtol, double atol)
+    : s(s),
+      mu(mu),
+      normId(normId),
+      isShortterm(false),
+      donorActions{Action("C", 0), Action("D", 1)},
+      recipientActions{Action("C", 0), Action("D", 1)},
+      payoffMatrix(Evolution::loadPayoffMatrix(payoffMatrixConfigName, normId,
+                                               b, beta, c, gamma, p0)),
+      pVarId(payoffMatrix.getVarId("p")),
+      norm(Evolution::loadNorm(normId, donorActions, recipientActions)),
+      tables(0,
+             Evolution::loadPlayer("donor", donorActions,
+                                   payoffMatrix.getRowStrategies()),
+             Evolution::loadPlayer("recipient", recipientActions,
+                                   payoffMatrix.getColStrategies()),
+             norm),
+      coopActionId(donorActions[0].getId()),  // "C"
+      time(0),
+      prevTime(0),
+      stepSize(1e-2),
+      rtol(rtol),
+      atol(atol),
+      rkStepNum(0) {
+  if (payoffMatrixConfigName == "payoffMatrix_shortterm") {
+    this->isShortterm = true;
+  } else if (payoffMatrixConfigName != "payoffMatrix_longterm_no_norm_error") {
+    std::cerr << "payoff_matrix_config_name error: " << payoffMatrixConfigName
+              << std::endl;
+    throw "payoff_matrix_config_name error";
+  }
+  this->donorStrategies = this->payoffMatrix.getRowStrategies();
+  this->recipientStrategies = this->payoffMatrix.getColStrategies();
+  this->donorStrategyNum = this->donorStrategies.size();
+  this->recipientStrategyNum = this->recipientStrategies.size();
+  this->strategyPairNum = this->donorStrategyNum * this->recipientStrategyNum;
+  // good is id 1
+  this->reputationNum = this->norm.getReputationNum();
+  if (this->reputationNum != 2) {
+    std::cerr << "replicator dynamics needs a binary norm, norm " << normId
+              << " has " << this->reputationNum << " levels" << std::endl;
+    throw "replicator dynamics needs a binary norm";
+  }
+
+  const int dim = this->strategyPairNum * this->reputationNum;
+  this->state.assign(dim, 0);
+  for (int pair = 0; pair < this->strategyPairNum; pair++) {
+    this->state[pair * this->reputationNum + 0] =
+        (1 - p0) / this->strategyPairNum;
+    this->state[pair * this->reputationNum + 1] = p0 / this->strategyPairNum;
+  }
+  this->dydt.assign(dim, 0);
+  this->payoff.assign(dim, 0);
+  this->weight.assign(dim, 0);
+  this->donorFreq.assign(this->donorStrategyNum, 0);
+  this->recipientFreq.assign(this->recipientStrategyNum, 0);
+  for (std::vector<double>& stage : this->k) {
+    stage.assign(dim, 0);
+  }
+  this->trial.assign(dim, 0);
+  this->trialDydt.assign(dim, 0);
+  this->derivative(this->state, this->dydt);
+  this->prevState = this->state;
+  this->prevDydt = this->dydt;
+}
+
+ReplicatorDynamics::~ReplicatorDynamics() {}
+
+/**
+ * @brief the right-hand side of the mean-field equations, O((#pairs *
+ * #reputations)^2) for the imitation between all the classes
+ *
+ * @param y
+ * @param res dy/dt
+ */
+void ReplicatorDynamics::derivative(const std::vector<double>& y,
+                                    std::vector<double>& res) {
+  const int rep_num = this->reputationNum;
+  const int recipient_strategy_num = this->recipientStrategyNum;
+  const int dim = this->strategyPairNum * rep_num;
+  const int donor_player = 0;
+  const int recipient_player = 1;
+
+  // the marginals are normalized by the total, otherwise the total 1 is an
+  // unstable fixed point of the reputation terms and drifts by the round-off
+  double total = 0;
+  for (int i = 0; i < dim; i++) {
+    total += y[i];
+  }
+  std::fill(this->donorFreq.begin(), this->donorFreq.end(), 0);
+  std::fill(this->recipientFreq.begin(), this->recipientFreq.end(), 0);
+  for (int i = 0; i < dim; i++) {
+    int pair = i / rep_num;
+    this->donorFreq[pair / recipient_strategy_num] += y[i] / total;
+    this->recipientFreq[pair % recipient_strategy_num] += y[i] / total;
+  }
+
+  // the average payoff of Evolution (getAvgPayoff) as population -> infinity,
+  // the recipient's p is the individual's own reputation
+  if (this->isShortterm) {
+    this->payoffMatrix.setVar(this->pVarId, donor_player,
+                              this->getGoodReputationFrequency(y) / total);
+  }
+  for (int rep = 0; rep < rep_num; rep++) {
+    this->payoffMatrix.setVar(this->pVarId, recipient_player,
+                              this->norm.getReputationValue(rep));
+    this->payoffMatrix.eval();
+    for (int pair = 0; pair < this->strategyPairNum; pair++) {
+      const int d = pair / recipient_strategy_num;
+      const int r = pair % recipient_strategy_num;
+      double eval_donor = 0;
+      double eval_recipient = 0;
+      for (int j = 0; j < recipient_strategy_num; j++) {
+        eval_donor +=
+            this->payoffMatrix.getPayoff(d, j, donor_player) * this->recipientFreq[j];
+      }
+      for (int j = 0; j < this->donorStrategyNum; j++) {
+        eval_recipient += this->payoffMatrix.getPayoff(j, r, recipient_player) *
+                          this->donorFreq[j];
+      }
+      this->payoff[pair * rep_num + rep] = 0.5 * (eval_donor + eval_recipient);
+    }
+  }
+
+  std::fill(res.begin(), res.end(), 0);
+
+  // imitation: the focal i copies the pair of the role model j and keeps its
+  // own reputation. fermi(P_i, P_j) = w_j / (w_i + w_j) with w = exp(s * (P -
+  // max P)), so only one exp per class is needed, fermi() is the fallback
+  // when both weights underflow
+  double max_payoff = this->payoff[0];
+  for (int i = 1; i < dim; i++) {
+    max_payoff = std::max(max_payoff, this->payoff[i]);
+  }
+  for (int i = 0; i < dim; i++) {
+    this->weight[i] = std::exp(this->s * (this->payoff[i] - max_payoff));
+  }
+  for (int i = 0; i < dim; i++) {
+    const int focal_pair = i / rep_num;
+    const int focal_rep = i % rep_num;
+    for (int j = 0; j < dim; j++) {
+      const int rolemodel_pair = j / rep_num;
+      if (rolemodel_pair == focal_pair) {
+        continue;
+      }
+      double weight_sum = this->weight[i] + this->weight[j];
+      double p = weight_sum > 0
+                     ? this->weight[j] / weight_sum
+                     : fermi(this->payoff[i], this->payoff[j], this->s);
+      double flow = (1 - this->mu) * y[i] * y[j] * p;
+      res[i] -= flow;
+      res[rolemodel_pair * rep_num + focal_rep] += flow;
+    }
+  }
+
+  // mutation to one of the other pairs
+  for (int rep = 0; rep < rep_num; rep++) {
+    double rep_total = 0;
+    for (int pair = 0; pair < this->strategyPairNum; pair++) {
+      rep_total += y[pair * rep_num + rep];
+    }
+    for (int pair = 0; pair < this->strategyPairNum; pair++) {
+      const int i = pair * rep_num + rep;
+      res[i] +=
+          this->mu * ((rep_total - y[i]) / (this->strategyPairNum - 1) - y[i]);
+    }
+  }
+
+  // reputation: each individual is the recipient once per generation, the
+  // donor's action depends on the recipient's reputation
+  for (int pair = 0; pair < this->strategyPairNum; pair++) {
+    const int r = pair % recipient_strategy_num;
+    for (int rep = 0; rep < rep_num; rep++) {
+      const int i = pair * rep_num + rep;
+      res[i] -= y[i];
+      for (int d = 0; d < this->donorStrategyNum; d++) {
+        int donor_action_id = this->tables.getDonorAction(d, rep);
+        int recipient_action_id =
+            this->tables.getRecipientAction(r, donor_action_id);
+        int new_rep =
+            this->tables.assess(donor_action_id, recipient_action_id, rep);
+        res[pair * rep_num + new_rep] += y[i] * this->donorFreq[d];
+      }
+    }
+  }
+}
+
+/**
+ * @brief try one step of the integrator from the current state and adapt
+ * the step size
+ *
+ * @return true if the step is accepted
+ */
+bool ReplicatorDynamics::rkStep() {
+  const int dim = this->state.size();
+  const double h = this->stepSize;
+
+  this->k[0] = this->dydt;
+  for (int stage = 1; stage < 7; stage++) {
+    for (int i = 0; i < dim; i++) {
+      double sum = 0;
+      for (int j = 0; j < stage; j++) {
+        sum += A[stage][j] * this->k[j][i];
+      }
+      this->trial[i] = this->state[i] + h * sum;
+    }
+    this->derivative(this->trial, this->k[stage]);
+  }
+  // the last stage is evaluated at the 5th order solution
+  this->trialDydt = this->k[6];
+
+  double err = 0;
+  for (int i = 0; i < dim; i++) {
+    double sum = 0;
+    for (int j = 0; j < 7; j++) {
+      sum += E[j] * this->k[j][i];
+    }
+    double scale = this->atol + this->rtol * std::max(std::fabs(this->state[i]),
+                                                     std::fabs(this->trial[i]));
+    err += (h * sum / scale) * (h * sum / scale);
+  }
+  err = std::sqrt(err / dim);
+
+  // standard controller, the factor is kept in [0.2, 5]
+  double factor =
+      err == 0 ? 5 : std::min(5.0, std::max(0.2, 0.9 * std::pow(err, -0.2)));
+  if (err > 1) {
+    this->stepSize = h * std::min(1.0, factor);
+    return false;
+  }
+  this->prevState.swap(this->state);
+  this->prevDydt.swap(this->dydt);
+  this->state.swap(this->trial);
+  this->dydt.swap(this->trialDydt);
+  this->prevTime = this->time;
+  this->time += h;
+  this->rkStepNum++;
+  this->stepSize = h * factor;
+  return true;
+}
+
+/**
+ * @brief integrate until time >= t. The last step is not cut at t, so the
+ * step size only follows the error, and interpolate() gives the states of
+ * [previous time, time].
+ *
+ * @param t in generations
+ */
+void ReplicatorDynamics::advanceTo(double t) {
+  while (this->time < t) {
+    if (!this->rkStep() && this->stepSize < 1e-12) {
+      std::cerr << "replicator dynamics step size underflow at t = "
+                << this->time << std::endl;
+      throw "replicator dynamics step size underflow";
+    }
+  }
+}
+
+/**
+ * @brief the cubic Hermite interpolation of the last accepted step by the
+ * states and the derivatives at both ends
+ *
+ * @param t in [previous time, time]
+ * @param res the state at t
+ */
+void ReplicatorDynamics::interpolate(double t, std::vector<double>& res) const {
+  const int dim = this->state.size();
+  res.resize(dim);
+  const double h = this->time - this->prevTime;
+  if (h <= 0 || t >= this->time) {
+    res = this->state;
+    return;
+  }
+  assert(t >= this->prevTime);
+  const double theta = (t - this->prevTime) / h;
+  const double h00 = (1 + 2 * theta) * (1 - theta) * (1 - theta);
+  const double h10 = theta * (1 - theta) * (1 - theta);
+  const double h01 = theta * theta * (3 - 2 * theta);
+  const double h11 = theta * theta * (theta - 1);
+  for (int i = 0; i < dim; i++) {
+    res[i] = h00 * this->prevState[i] + h10 * h * this->prevDydt[i] +
+             h01 * this->state[i] + h11 * h * this->dydt[i];
+  }
+}
+
+/**
+ * @brief the frequency of the strategy pair summed over the reputations
+ */
+double ReplicatorDynamics::getPairFrequency(const std::vector<double>& y,
+                                            int donorStrategyId,
+                                            int recipientStrategyId) const {
+  const int pair = donorStrategyId * this->recipientStrategyNum +
+                   recipientStrategyId;
+  double res = 0;
+  for (int rep = 0; rep < this->reputationNum; rep++) {
+    res += y[pair * this->reputationNum + rep];
+  }
+  return res;
+}
+
+double ReplicatorDynamics::getGoodReputationFrequency(
+    const std::vector<double>& y) const {
+  double res = 0;
+  for (int pair = 0; pair < this->strategyPairNum; pair++) {
+    res += y[pair * this->reputationNum + 1];
+  }
+  return res;
+}
+
+/**
+ * @brief getCoopRate() of Evolution as population -> infinity, the
+ * probability that both the donor and the recipient of a random game
+ * cooperate
+ *
+ * @param y
+ * @return double
+ */
+double ReplicatorDynamics::getCoopRate(const std::vector<double>& y) const {
+  const int rep_num = this->reputationNum;
+  std::vector<double> donor_freq(this->donorStrategyNum, 0);
+  for (int i = 0; i < static_cast<int>(y.size()); i++) {
+    donor_freq[i / rep_num / this->recipientStrategyNum] += y[i];
+  }
+  double res = 0;
+  for (int pair = 0; pair < this->strategyPairNum; pair++) {
+    const int r = pair % this->recipientStrategyNum;
+    if (this->tables.getRecipientAction(r, this->coopActionId) !=
+        this->coopActionId) {
+      continue;
+    }
+    for (int rep = 0; rep < rep_num; rep++) {
+      for (int d = 0; d < this->donorStrategyNum; d++) {
+        if (this->tables.getDonorAction(d, rep) == this->coopActionId) {
+          res += donor_freq[d] * y[pair * rep_num + rep];
+        }
+      }
+    }
+  }
+  return res;
+}
+
+/**
+ * @brief the frequency of every strategy pair, indexed by donor strategy id *
+ * #recipient strategies + recipient strategy id
+ *
+ * @param y
+ * @return std::vector<double>
+ */
+std::vector<double> ReplicatorDynamics::getPairFrequencies(
+    const std::vector<double>& y) const {
+  std::vector<double> res(this->strategyPairNum, 0);
+  for (int i = 0; i < static_cast<int>(y.size()); i++) {
+    res[i / this->reputationNum] += y[i];
+  }
+  return res;
+}
+
+/**
+ * @brief the line of the csv log, the same columns and format as
+ * printStatistics() of Evolution
+ *
+ * @param y
+ * @param step
+ * @return std::string
+ */
+std::string ReplicatorDynamics::printStatistics(const std::vector<double>& y,
+                                                int step) const {
+  return printFrequencyStatistics(
+      this->getPairFrequencies(y), this->donorStrategies,
+      this->recipientStrategies, step, this->getGoodReputationFrequency(y),
+      this->getCoopRate(y));
+}
+
+/**
+ * @brief the row of the binary log, see fillFrequencyStatisticsRow()
+ *
+ * @param y
+ * @param step
+ * @param population
+ * @param row
+ */
+void ReplicatorDynamics::fillStatisticsRow(const std::vector<double>& y,
+                                           int step, int population,
+                                           std::vector<uint32_t>& row) const {
+  fillFrequencyStatisticsRow(
+      this->getPairFrequencies(y), this->donorStrategies,
+      this->recipientStrategies, step, population,
+      this->getGoodReputationFrequency(y), this->getCoopRate(y), row);
+}
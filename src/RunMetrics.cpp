@@ -0,0 +1,507 @@
+#include "RunMetrics.hpp"
+
+#include <arpa/inet.h>
+#include <fmt/core.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "JsonFile.hpp"
+
+namespace {
+const char* getStateName(RunState state) {
+  switch (state) {
+    case RunState::RUNNING:
+      return "running";
+    case RunState::DONE:
+      return "done";
+    case RunState::STOPPED:
+      return "stopped";
+    case RunState::FAILED:
+      return "failed";
+  }
+  return "unknown";
+}
+
+/** @brief a Prometheus label value, the backslashes and quotes escaped */
+std::string escapeLabel(std::string const& value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+}  // namespace
+
+/**
+ * @brief Construct a new Run Metrics object
+ *
+ * @param name the name of the log of the run
+ * @param normId
+ * @param replica
+ * @param stepNum the steps of the run
+ * @param startStep the steps already done, the step of the checkpoint of a
+ * resumed run
+ */
+RunMetrics::RunMetrics(std::string const& name, int normId, int replica,
+                       uint64_t stepNum, uint64_t startStep)
+    : name(name),
+      normId(normId),
+      replica(replica),
+      stepNum(stepNum),
+      startTime(std::chrono::steady_clock::now()),
+      startStep(startStep),
+      stepsDone(startStep),
+      logBytes(0),
+      coopRate(NAN),
+      state(static_cast<int>(RunState::RUNNING)),
+      released(false) {}
+
+RunMetrics::~RunMetrics() {}
+
+MetricsRegistry::MetricsRegistry() {}
+
+MetricsRegistry::~MetricsRegistry() {}
+
+/**
+ * @brief register a run, its metrics live as long as the registry
+ *
+ * @return RunMetrics* written only by the run
+ */
+RunMetrics* MetricsRegistry::add(std::string const& name, int normId,
+                                 int replica, uint64_t stepNum,
+                                 uint64_t startStep) {
+  std::unique_ptr<RunMetrics> metrics(
+      new RunMetrics(name, normId, replica, stepNum, startStep));
+  std::lock_guard<std::mutex> lock(this->mtx);
+  this->runs.push_back(std::move(metrics));
+  return this->runs.back().get();
+}
+
+/**
+ * @brief the values of all the registered runs, in the order of
+ * registration. stepsPerSec is the average since the start of the run.
+ * The released runs are dropped after this last sample of them
+ *
+ * @return std::vector<RunSample>
+ */
+std::vector<RunSample> MetricsRegistry::sample() {
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(this->mtx);
+  std::vector<RunSample> samples;
+  samples.reserve(this->runs.size());
+  for (std::unique_ptr<RunMetrics> const& run : this->runs) {
+    RunSample sample;
+    // read first: the values after a release are final
+    sample.isLast = run->isReleased();
+    sample.name = run->getName();
+    sample.normId = run->getNormId();
+    sample.replica = run->getReplica();
+    sample.stepNum = run->getStepNum();
+    sample.stepsDone = run->getStepsDone();
+    sample.logBytes = run->getLogBytes();
+    sample.coopRate = run->getCoopRate();
+    sample.state = run->getState();
+    const double elapsed =
+        std::chrono::duration<double>(now - run->getStartTime()).count();
+    sample.stepsPerSec =
+        elapsed > 0 ? (sample.stepsDone - run->getStartStep()) / elapsed : 0;
+    samples.push_back(sample);
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < this->runs.size(); i++) {
+    if (!samples[i].isLast) {
+      std::swap(this->runs[kept++], this->runs[i]);
+    }
+  }
+  this->runs.resize(kept);
+  return samples;
+}
+
+/**
+ * @brief the status of the runs, see RunMetrics.hpp
+ *
+ * @param samples
+ * @param droppedStateNums the runs no more in the samples, in the totals
+ * @return boost::json::value
+ */
+boost::json::value MetricsReporter::toJson(
+    std::vector<RunSample> const& samples,
+    RunStateNums const& droppedStateNums) {
+  boost::json::array runs;
+  RunStateNums stateNums = droppedStateNums;
+  double stepsPerSec = 0;
+  uint64_t logBytes = 0;
+  for (RunSample const& sample : samples) {
+    boost::json::object run;
+    run["name"] = sample.name;
+    run["normId"] = sample.normId;
+    run["replica"] = sample.replica;
+    run["state"] = getStateName(sample.state);
+    run["stepNum"] = sample.stepNum;
+    run["stepsDone"] = sample.stepsDone;
+    run["stepsPerSec"] = sample.stepsPerSec;
+    run["logBytes"] = sample.logBytes;
+    // null before the first row of the log
+    run["coopRate"] = std::isnan(sample.coopRate)
+                          ? boost::json::value()
+                          : boost::json::value(sample.coopRate);
+    runs.push_back(run);
+    stateNums[static_cast<int>(sample.state)]++;
+    stepsPerSec += sample.stepsPerSec;
+    logBytes += sample.logBytes;
+  }
+  boost::json::object totals;
+  totals["running"] = stateNums[static_cast<int>(RunState::RUNNING)];
+  totals["done"] = stateNums[static_cast<int>(RunState::DONE)];
+  totals["stopped"] = stateNums[static_cast<int>(RunState::STOPPED)];
+  totals["failed"] = stateNums[static_cast<int>(RunState::FAILED)];
+  totals["stepsPerSec"] = stepsPerSec;
+  totals["logBytes"] = logBytes;
+  boost::json::object status;
+  status["totals"] = totals;
+  status["runs"] = runs;
+  return status;
+}
+
+/**
+ * @brief the Prometheus text exposition of the runs, the run is the label
+ * "run" (with "norm" and "replica")
+ *
+ * @param samples
+ * @return std::string
+ */
+std::string MetricsReporter::toPrometheus(
+    std::vector<RunSample> const& samples) {
+  struct Metric {
+    const char* name;
+    const char* type;
+    const char* help;
+  };
+  const Metric metrics[] = {
+      {"reputation_run_steps_done", "counter", "the steps done by the run"},
+      {"reputation_run_step_num", "gauge", "the steps of the run"},
+      {"reputation_run_steps_per_second", "gauge",
+       "the steps per second of the run since the previous sample"},
+      {"reputation_run_log_bytes", "counter",
+       "the bytes written to the log of the run"},
+      {"reputation_run_coop_rate", "gauge",
+       "the cooperation rate of the last row of the log"},
+      {"reputation_run_running", "gauge", "1 if the run is running"},
+  };
+  std::string text;
+  for (int k = 0; k < 6; k++) {
+    text += fmt::format("# HELP {} {}\n# TYPE {} {}\n", metrics[k].name,
+                        metrics[k].help, metrics[k].name, metrics[k].type);
+    for (RunSample const& sample : samples) {
+      double value = 0;
+      switch (k) {
+        case 0:
+          value = sample.stepsDone;
+          break;
+        case 1:
+          value = sample.stepNum;
+          break;
+        case 2:
+          value = sample.stepsPerSec;
+          break;
+        case 3:
+          value = sample.logBytes;
+          break;
+        case 4:
+          value = sample.coopRate;
+          break;
+        case 5:
+          value = sample.state == RunState::RUNNING ? 1 : 0;
+          break;
+      }
+      if (std::isnan(value)) {
+        continue;
+      }
+      text += fmt::format("{}{{run=\"{}\",norm=\"{}\",replica=\"{}\"}} {}\n",
+                          metrics[k].name, escapeLabel(sample.name),
+                          sample.normId, sample.replica, value);
+    }
+  }
+  return text;
+}
+
+/**
+ * @brief Construct a new Metrics Reporter, see start()
+ *
+ * @param registry
+ * @param interval the seconds between two samples
+ * @param terminal whether to render to stdout
+ * @param jsonPath the json status file, empty for none
+ * @param port the port of the Prometheus endpoint on 127.0.0.1, 0 for none
+ */
+MetricsReporter::MetricsReporter(MetricsRegistry& registry, double interval,
+                                 bool terminal, std::string const& jsonPath,
+                                 int port)
+    : registry(registry),
+      interval(interval),
+      terminal(terminal),
+      jsonPath(jsonPath),
+      port(port),
+      isTty(isatty(fileno(stdout)) != 0),
+      listenFd(-1),
+      terminalLineNum(0),
+      lastTerminalTime(std::chrono::steady_clock::now()),
+      startTime(std::chrono::steady_clock::now()),
+      droppedStateNums{},
+      stopRequested(false) {
+  if (interval <= 0 || port < 0 || port > 65535) {
+    std::cerr << "metrics reporter error: interval " << interval << ", port "
+              << port << std::endl;
+    throw "metrics reporter error";
+  }
+}
+
+MetricsReporter::~MetricsReporter() { this->stop(); }
+
+/**
+ * @brief open the endpoint and start the thread
+ *
+ */
+void MetricsReporter::start() {
+  if (this->port > 0) {
+    this->listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(this->listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse,
+               sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(this->port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (this->listenFd < 0 ||
+        bind(this->listenFd, reinterpret_cast<sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+        listen(this->listenFd, 16) != 0) {
+      std::cerr << "can not listen on 127.0.0.1:" << this->port << std::endl;
+      if (this->listenFd >= 0) {
+        close(this->listenFd);
+        this->listenFd = -1;
+      }
+      throw "can not listen on the metrics port";
+    }
+  }
+  this->thread = std::thread(&MetricsReporter::run, this);
+}
+
+/**
+ * @brief stop the thread after a last sample, which is rendered in full
+ *
+ */
+void MetricsReporter::stop() {
+  if (!this->thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->stopRequested = true;
+  }
+  this->stopCondition.notify_all();
+  this->thread.join();
+  if (this->listenFd >= 0) {
+    close(this->listenFd);
+    this->listenFd = -1;
+  }
+}
+
+void MetricsReporter::run() {
+  const auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(this->interval));
+  auto next = std::chrono::steady_clock::now();
+  while (true) {
+    this->update();
+    if (this->terminal) {
+      this->renderTerminal(false);
+    }
+    this->writeJson();
+
+    // wait for the next sample, the endpoint is served meanwhile
+    next += period;
+    std::unique_lock<std::mutex> lock(this->mtx);
+    while (!this->stopRequested && std::chrono::steady_clock::now() < next) {
+      if (this->listenFd >= 0) {
+        lock.unlock();
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            next - std::chrono::steady_clock::now());
+        this->serve(std::max<int>(1, std::min<int>(100, left.count())));
+        lock.lock();
+      } else {
+        this->stopCondition.wait_until(lock, next);
+      }
+    }
+    if (this->stopRequested) {
+      break;
+    }
+  }
+  this->update();
+  if (this->terminal) {
+    this->renderTerminal(true);
+  }
+  this->writeJson();
+}
+
+/**
+ * @brief sample the registry, the steps/sec of a run already sampled is
+ * measured since its previous sample. The runs of the last sample of them,
+ * already rendered, are only counted from now on
+ *
+ */
+void MetricsReporter::update() {
+  const double now = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - this->startTime)
+                         .count();
+  for (RunSample const& sample : this->samples) {
+    if (sample.isLast) {
+      this->droppedStateNums[static_cast<int>(sample.state)]++;
+      this->previous.erase(sample.name);
+    }
+  }
+  this->samples = this->registry.sample();
+  for (RunSample& sample : this->samples) {
+    auto previous = this->previous.find(sample.name);
+    if (sample.state != RunState::RUNNING) {
+      sample.stepsPerSec = 0;
+    } else if (previous != this->previous.end() &&
+               now > previous->second.second) {
+      sample.stepsPerSec =
+          (sample.stepsDone - previous->second.first) /
+          (now - previous->second.second);
+    }
+    this->previous[sample.name] = {sample.stepsDone, now};
+  }
+}
+
+/**
+ * @brief on a TTY, the totals and a line per running run (at most 20) drawn
+ * over the previous ones, otherwise a line of the totals every
+ * NON_TTY_PERIOD seconds
+ *
+ * @param isFinal the last rendering, always drawn
+ */
+void MetricsReporter::renderTerminal(bool isFinal) {
+  const int maxRunLines = 20;
+  const auto now = std::chrono::steady_clock::now();
+  if (!this->isTty && !isFinal &&
+      now - this->lastTerminalTime < std::chrono::seconds(NON_TTY_PERIOD)) {
+    return;
+  }
+  this->lastTerminalTime = now;
+
+  RunStateNums stateNums = this->droppedStateNums;
+  double stepsPerSec = 0;
+  uint64_t logBytes = 0;
+  for (RunSample const& sample : this->samples) {
+    stateNums[static_cast<int>(sample.state)]++;
+    stepsPerSec += sample.stepsPerSec;
+    logBytes += sample.logBytes;
+  }
+  std::string text = fmt::format(
+      "runs: {} running, {} done, {} stopped, {} failed | {:.3g} steps/s | "
+      "{:.1f} MB log\n",
+      stateNums[0], stateNums[1], stateNums[2], stateNums[3], stepsPerSec,
+      logBytes / 1e6);
+  if (!this->isTty) {
+    std::cout << text << std::flush;
+    return;
+  }
+
+  int lineNum = 1;
+  for (RunSample const& sample : this->samples) {
+    if (sample.state != RunState::RUNNING) {
+      continue;
+    }
+    if (lineNum > maxRunLines) {
+      text += fmt::format("... {} more\n", stateNums[0] - maxRunLines);
+      lineNum++;
+      break;
+    }
+    const double progress =
+        sample.stepNum > 0 ? static_cast<double>(sample.stepsDone) / sample.stepNum
+                           : 0;
+    const int fill = std::min(20, static_cast<int>(progress * 20));
+    text += fmt::format(
+        "norm {:>2} #{:<3} [{}{}] {:5.1f}% {:9.3g} steps/s cr {:.3f}\n",
+        sample.normId, sample.replica, std::string(fill, '*'),
+        std::string(20 - fill, '-'), progress * 100, sample.stepsPerSec,
+        sample.coopRate);
+    lineNum++;
+  }
+  // back to the first line of the previous rendering and clear it
+  if (this->terminalLineNum > 0) {
+    std::cout << "\033[" << this->terminalLineNum << "F\033[J";
+  }
+  std::cout << text << std::flush;
+  this->terminalLineNum = isFinal ? 0 : lineNum;
+}
+
+/**
+ * @brief write the json status to jsonPath + ".tmp" and rename it, a failure
+ * is reported but does not stop the runs
+ *
+ */
+void MetricsReporter::writeJson() const {
+  if (this->jsonPath.empty()) {
+    return;
+  }
+  const std::string tmpPath = this->jsonPath + ".tmp";
+  std::ofstream file(tmpPath);
+  if (!file) {
+    std::cerr << "can not write the metrics: " << tmpPath << std::endl;
+    return;
+  }
+  pretty_print(file, toJson(this->samples, this->droppedStateNums));
+  file.close();
+  std::error_code error;
+  std::filesystem::rename(tmpPath, this->jsonPath, error);
+}
+
+/**
+ * @brief answer the requests to the endpoint that arrive within timeoutMs,
+ * the request is not parsed
+ *
+ * @param timeoutMs
+ */
+void MetricsReporter::serve(int timeoutMs) {
+  pollfd listenPoll{this->listenFd, POLLIN, 0};
+  if (poll(&listenPoll, 1, timeoutMs) <= 0) {
+    return;
+  }
+  const int fd = accept(this->listenFd, nullptr, nullptr);
+  if (fd < 0) {
+    return;
+  }
+  char request[1024];
+  pollfd requestPoll{fd, POLLIN, 0};
+  if (poll(&requestPoll, 1, 100) > 0) {
+    recv(fd, request, sizeof(request), 0);
+  }
+  const std::string body = toPrometheus(this->samples);
+  const std::string response = fmt::format(
+      "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+      "Content-Length: {}\r\nConnection: close\r\n\r\n{}",
+      body.size(), body);
+  size_t sent = 0;
+  while (sent < response.size()) {
+    ssize_t n = send(fd, response.data() + sent, response.size() - sent,
+                     MSG_NOSIGNAL);
+    if (n <= 0) {
+      break;
+    }
+    sent += n;
+  }
+  close(fd);
+}
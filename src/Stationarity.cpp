@@ -0,0 +1,170 @@
+#include "Stationarity.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/**
+ * @brief the truncation of MSER, the d in [0, n / 2] that minimizes
+ * sum_{i >= d} (x_i - mean_d)^2 / (n - d)^2, computed from the end in one
+ * pass. The larger d are not searched: a short constant end of the series
+ * would always win
+ *
+ * @param means the batch means x_0 to x_{n - 1}
+ * @return int d, n / 2 if the warm-up is not over in the first half
+ */
+int StationarityDetector::mserTruncation(const std::vector<double>& means) {
+  const int n = means.size();
+  int best = 0;
+  double best_statistic = INFINITY;
+  // the tail sums of x and x^2 from d to n - 1
+  double sum = 0;
+  double square_sum = 0;
+  for (int d = n - 1; d >= 0; d--) {
+    sum += means[d];
+    square_sum += means[d] * means[d];
+    const double m = n - d;
+    if (d > n / 2 || m < 2) {
+      continue;
+    }
+    const double statistic = std::max(0.0, square_sum - sum * sum / m) / (m * m);
+    // ties go to the smaller truncation
+    if (statistic <= best_statistic) {
+      best_statistic = statistic;
+      best = d;
+    }
+  }
+  return best;
+}
+
+/**
+ * @brief the 95% half width of the mean of means[from:], by TAIL_BATCH_NUM
+ * non-overlapping batch means (the first few means are dropped so that the
+ * batches are equal)
+ *
+ * @param means
+ * @param from
+ * @return double INFINITY if there are fewer means than batches
+ */
+double StationarityDetector::getHalfWidth(const std::vector<double>& means,
+                                          int from) {
+  // the 0.975 quantile of the t distribution of TAIL_BATCH_NUM - 1 = 9
+  // degrees of freedom
+  const double t_quantile = 2.262;
+  const int size = (static_cast<int>(means.size()) - from) / TAIL_BATCH_NUM;
+  if (size < 1) {
+    return INFINITY;
+  }
+  const int begin = means.size() - size * TAIL_BATCH_NUM;
+  double batch[TAIL_BATCH_NUM];
+  double mean = 0;
+  for (int k = 0; k < TAIL_BATCH_NUM; k++) {
+    batch[k] = 0;
+    for (int i = 0; i < size; i++) {
+      batch[k] += means[begin + k * size + i];
+    }
+    batch[k] /= size;
+    mean += batch[k];
+  }
+  mean /= TAIL_BATCH_NUM;
+  double variance = 0;
+  for (int k = 0; k < TAIL_BATCH_NUM; k++) {
+    variance += (batch[k] - mean) * (batch[k] - mean);
+  }
+  variance /= TAIL_BATCH_NUM - 1;
+  return t_quantile * std::sqrt(variance / TAIL_BATCH_NUM);
+}
+
+/**
+ * @brief Construct a new Stationarity Detector
+ *
+ * @param observableNum the values of one observation
+ * @param tolerance the largest 95% half width of the mean of the tail
+ * @param batchSize the observations of one batch of MSER
+ * @param minBatchNum the fewest batches after the truncation, at least
+ * TAIL_BATCH_NUM
+ */
+StationarityDetector::StationarityDetector(int observableNum, double tolerance,
+                                           int batchSize, int minBatchNum)
+    : observableNum(observableNum),
+      tolerance(tolerance),
+      batchSize(batchSize),
+      minBatchNum(std::max(minBatchNum, TAIL_BATCH_NUM)),
+      batchSums(observableNum, 0),
+      batchFill(0),
+      batchFirstStep(0),
+      batchMeans(observableNum),
+      nextTestBatchNum(2 * this->minBatchNum),
+      truncationBatch(-1) {
+  if (observableNum < 1 || tolerance <= 0 || batchSize < 1) {
+    std::cerr << "stationarity detector error: " << observableNum
+              << " observables, tolerance " << tolerance << ", batch size "
+              << batchSize << std::endl;
+    throw "stationarity detector error";
+  }
+}
+
+StationarityDetector::~StationarityDetector() {}
+
+/**
+ * @brief add the observation of a log row and test the stationarity when the
+ * batches have grown by 10% since the last test
+ *
+ * @param step the step of the observation
+ * @param values observableNum values
+ * @return true if the observations are stationary (from now on)
+ */
+bool StationarityDetector::add(uint64_t step, const double* values) {
+  if (this->isStationary()) {
+    return true;
+  }
+  if (this->batchFill == 0) {
+    this->batchFirstStep = step;
+  }
+  for (int k = 0; k < this->observableNum; k++) {
+    this->batchSums[k] += values[k];
+  }
+  if (++this->batchFill < this->batchSize) {
+    return false;
+  }
+  for (int k = 0; k < this->observableNum; k++) {
+    this->batchMeans[k].push_back(this->batchSums[k] / this->batchSize);
+    this->batchSums[k] = 0;
+  }
+  this->batchFirstSteps.push_back(this->batchFirstStep);
+  this->batchFill = 0;
+
+  const size_t batch_num = this->batchFirstSteps.size();
+  if (batch_num < this->nextTestBatchNum) {
+    return false;
+  }
+  this->nextTestBatchNum = std::max(batch_num + 1, batch_num * 11 / 10);
+
+  int truncation = 0;
+  for (int k = 0; k < this->observableNum; k++) {
+    const std::vector<double>& means = this->batchMeans[k];
+    const int d = mserTruncation(means);
+    if (d >= static_cast<int>(batch_num) / 2 ||
+        static_cast<int>(batch_num) - d < this->minBatchNum ||
+        getHalfWidth(means, d) >= this->tolerance) {
+      return false;
+    }
+    truncation = std::max(truncation, d);
+  }
+  this->truncationBatch = truncation;
+  return true;
+}
+
+/**
+ * @brief the step where the warm-up ends, the first step of the truncated
+ * tail of the slowest observable
+ *
+ * @return uint64_t
+ */
+uint64_t StationarityDetector::getTruncationStep() const {
+  if (!this->isStationary()) {
+    std::cerr << "the observations are not stationary" << std::endl;
+    throw "the observations are not stationary";
+  }
+  return this->batchFirstSteps[this->truncationBatch];
+}
@@ -0,0 +1,54 @@
+#include "Statistics.hpp"
+
+Statistics::Statistics()
+    : donorStrategyNum(0), recipientStrategyNum(0), reputationNum(0) {}
+
+/**
+ * @brief Construct a new Statistics object of an empty population
+ *
+ * @param donorStrategyNum
+ * @param recipientStrategyNum
+ * @param reputationNum
+ */
+Statistics::Statistics(int donorStrategyNum, int recipientStrategyNum,
+                       int reputationNum)
+    : donorStrategyNum(donorStrategyNum),
+      recipientStrategyNum(recipientStrategyNum),
+      reputationNum(reputationNum),
+      tripleCounts(donorStrategyNum * recipientStrategyNum * reputationNum, 0),
+      pairCounts(donorStrategyNum * recipientStrategyNum, 0),
+      reputationCounts(reputationNum, 0) {}
+
+Statistics::~Statistics() {}
+
+void Statistics::add(int donorStrategyId, int recipientStrategyId,
+                     int reputationId) {
+  int pairId = donorStrategyId * this->recipientStrategyNum + recipientStrategyId;
+  this->tripleCounts[pairId * this->reputationNum + reputationId]++;
+  this->pairCounts[pairId]++;
+  this->reputationCounts[reputationId]++;
+}
+
+void Statistics::remove(int donorStrategyId, int recipientStrategyId,
+                        int reputationId) {
+  int pairId = donorStrategyId * this->recipientStrategyNum + recipientStrategyId;
+  this->tripleCounts[pairId * this->reputationNum + reputationId]--;
+  this->pairCounts[pairId]--;
+  this->reputationCounts[reputationId]--;
+}
+
+/**
+ * @brief add count (negative to remove) individuals of a triple at once
+ *
+ * @param donorStrategyId
+ * @param recipientStrategyId
+ * @param reputationId
+ * @param count
+ */
+void Statistics::addCount(int donorStrategyId, int recipientStrategyId,
+                          int reputationId, int count) {
+  int pairId = donorStrategyId * this->recipientStrategyNum + recipientStrategyId;
+  this->tripleCounts[pairId * this->reputationNum + reputationId] += count;
+  this->pairCounts[pairId] += count;
+  this->reputationCounts[reputationId] += count;
+}
@@ -0,0 +1,289 @@
+#include "Sweep.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+#include "RandomStream.hpp"
+
+namespace {
+std::string trim(std::string const& str) {
+  size_t begin = str.find_first_not_of(" \t\r");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  size_t end = str.find_last_not_of(" \t\r");
+  return str.substr(begin, end - begin + 1);
+}
+
+std::vector<std::string> split(std::string const& str, char delimiter) {
+  std::vector<std::string> res;
+  std::stringstream ss(str);
+  std::string cell;
+  while (std::getline(ss, cell, delimiter)) {
+    res.push_back(trim(cell));
+  }
+  return res;
+}
+
+std::string formatNumber(double value) {
+  std::ostringstream ss;
+  ss << std::setprecision(12) << value;
+  return ss.str();
+}
+
+/**
+ * @brief "v1,v2,..." or the inclusive range "start:step:end"
+ */
+std::vector<std::string> expandValues(std::string const& name,
+                                      std::string const& values) {
+  if (values.find(':') == std::string::npos || name == "payoffMatrix") {
+    return split(values, ',');
+  }
+  std::vector<std::string> range = split(values, ':');
+  if (range.size() != 3) {
+    std::cerr << "sweep range error: " << name << " = " << values << std::endl;
+    throw "sweep range error";
+  }
+  double start = std::stod(range[0]);
+  double step = std::stod(range[1]);
+  double end = std::stod(range[2]);
+  if (step <= 0 || end < start) {
+    std::cerr << "sweep range error: " << name << " = " << values << std::endl;
+    throw "sweep range error";
+  }
+  std::vector<std::string> res;
+  // the tolerance keeps the end of ranges such as 0:0.1:1
+  long num = static_cast<long>(std::floor((end - start) / step + 1e-9)) + 1;
+  for (long i = 0; i < num; i++) {
+    res.push_back(formatNumber(start + i * step));
+  }
+  return res;
+}
+
+uint64_t fnv1a(std::string const& str) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char ch : str) {
+    hash ^= static_cast<unsigned char>(ch);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+}  // namespace
+
+/**
+ * @brief assign one param of the job by its name in the spec
+ *
+ * @param job
+ * @param name
+ * @param value
+ */
+void setSweepJobParam(SweepJob& job, std::string const& name,
+                      std::string const& value) {
+  try {
+    if (name == "normId") {
+      job.normId = std::stoi(value);
+    } else if (name == "stepNum") {
+      job.stepNum = std::stoi(value);
+    } else if (name == "population") {
+      job.population = std::stoi(value);
+    } else if (name == "s") {
+      job.s = std::stod(value);
+    } else if (name == "b") {
+      job.b = std::stod(value);
+    } else if (name == "beta") {
+      job.beta = std::stod(value);
+    } else if (name == "c") {
+      job.c = std::stod(value);
+    } else if (name == "gamma") {
+      job.gamma = std::stod(value);
+    } else if (name == "mu") {
+      job.mu = std::stod(value);
+    } else if (name == "p0") {
+      job.p0 = std::stod(value);
+    } else if (name == "payoffMatrix") {
+      job.payoffMatrix = value;
+    } else if (name == "replica") {
+      job.replica = std::stoi(value);
+    } else {
+      std::cerr << "unknown sweep param: " << name << std::endl;
+      throw "unknown sweep param";
+    }
+  } catch (std::logic_error const& e) {
+    std::cerr << "sweep value error: " << name << " = " << value << std::endl;
+    throw "sweep value error";
+  }
+}
+
+/**
+ * @brief the canonical text of a job, the same params give the same key
+ * whatever the order of the spec
+ *
+ * @param job
+ * @return std::string
+ */
+std::string getSweepJobKey(SweepJob const& job) {
+  return "normId=" + std::to_string(job.normId) +
+         ",stepNum=" + std::to_string(job.stepNum) +
+         ",population=" + std::to_string(job.population) +
+         ",s=" + formatNumber(job.s) + ",b=" + formatNumber(job.b) +
+         ",beta=" + formatNumber(job.beta) + ",c=" + formatNumber(job.c) +
+         ",gamma=" + formatNumber(job.gamma) + ",mu=" + formatNumber(job.mu) +
+         ",p0=" + formatNumber(job.p0) +
+         ",payoffMatrix=" + job.payoffMatrix +
+         ",replica=" + std::to_string(job.replica);
+}
+
+/**
+ * @brief the seed of a job, it only depends on the global seed and the key of
+ * the job
+ *
+ * @param job with its key
+ * @param seed the global seed
+ * @return uint64_t
+ */
+uint64_t getSweepJobSeed(SweepJob const& job, uint64_t seed) {
+  return RandomStream(seed, fnv1a(job.key)).nextUInt64();
+}
+
+/**
+ * @brief read the spec and generate the jobs, the seed of a job only depends
+ * on the global seed and its key, so it does not change when the spec is
+ * reordered or extended
+ *
+ * @param specPath grid spec, or list spec if it ends with ".csv"
+ * @param defaultJob the params missing from the spec
+ * @param seed the global seed
+ * @return std::vector<SweepJob>
+ */
+std::vector<SweepJob> expandSweepSpec(std::string const& specPath,
+                                      SweepJob const& defaultJob,
+                                      uint64_t seed) {
+  std::ifstream specFile(specPath);
+  if (!specFile.is_open()) {
+    std::cerr << "Failed to open file: " << specPath << std::endl;
+    throw "Failed to open file";
+  }
+  bool isList = specPath.size() >= 4 &&
+                specPath.compare(specPath.size() - 4, 4, ".csv") == 0;
+
+  std::vector<SweepJob> jobs;
+  std::string line;
+  if (isList) {
+    std::vector<std::string> names;
+    while (std::getline(specFile, line)) {
+      line = trim(line);
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      std::vector<std::string> cells = split(line, ',');
+      if (names.empty()) {
+        names = cells;
+        continue;
+      }
+      if (cells.size() != names.size()) {
+        std::cerr << "sweep list row error: " << line << std::endl;
+        throw "sweep list row error";
+      }
+      SweepJob job = defaultJob;
+      for (size_t i = 0; i < names.size(); i++) {
+        setSweepJobParam(job, names[i], cells[i]);
+      }
+      jobs.push_back(job);
+    }
+  } else {
+    std::vector<std::string> names;
+    std::vector<std::vector<std::string>> values;
+    while (std::getline(specFile, line)) {
+      line = trim(line);
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      size_t pos = line.find('=');
+      if (pos == std::string::npos) {
+        std::cerr << "sweep grid line error: " << line << std::endl;
+        throw "sweep grid line error";
+      }
+      std::string name = trim(line.substr(0, pos));
+      names.push_back(name);
+      values.push_back(expandValues(name, trim(line.substr(pos + 1))));
+    }
+    // cartesian product, the last name changes fastest
+    std::vector<size_t> digits(names.size(), 0);
+    bool finished = false;
+    while (!finished) {
+      SweepJob job = defaultJob;
+      for (size_t i = 0; i < names.size(); i++) {
+        if (values[i].empty()) {
+          std::cerr << "sweep param without value: " << names[i] << std::endl;
+          throw "sweep param without value";
+        }
+        setSweepJobParam(job, names[i], values[i][digits[i]]);
+      }
+      jobs.push_back(job);
+      finished = true;
+      for (int i = static_cast<int>(names.size()) - 1; i >= 0; i--) {
+        if (++digits[i] < values[i].size()) {
+          finished = false;
+          break;
+        }
+        digits[i] = 0;
+      }
+    }
+  }
+
+  for (SweepJob& job : jobs) {
+    job.key = getSweepJobKey(job);
+    job.seed = getSweepJobSeed(job, seed);
+    // the time of a step hardly depends on the other params
+    job.cost = static_cast<double>(job.stepNum);
+  }
+  return jobs;
+}
+
+/**
+ * @brief the job ids in the order to start them, the longest first
+ *
+ * @param jobs
+ * @return std::vector<int>
+ */
+std::vector<int> getSweepOrder(std::vector<SweepJob> const& jobs) {
+  std::vector<int> order(jobs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return jobs[a].cost > jobs[b].cost;
+  });
+  return order;
+}
+
+/**
+ * @brief load the keys of the jobs completed by the previous runs
+ *
+ * @param path
+ */
+SweepManifest::SweepManifest(std::string const& path) : path(path) {
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty()) {
+      this->doneKeys.insert(line);
+    }
+  }
+}
+
+/**
+ * @brief append the key of a completed job, thread safe
+ *
+ * @param key
+ */
+void SweepManifest::markDone(std::string const& key) {
+  std::lock_guard<std::mutex> lock(this->mtx);
+  this->doneKeys.insert(key);
+  std::ofstream file(this->path, std::ios::app);
+  file << key << "\n";
+  file.flush();
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BinaryLog.hpp"
+
+// step, count, cr; an unclosed writer is returned to the caller
+std::unique_ptr<BinaryLogWriter> writeLog(std::string const& path, int rowNum) {
+    auto writer = std::make_unique<BinaryLogWriter>(
+        path, std::vector<std::string>{"step", "C-NR", "cr"},
+        std::vector<BinaryLogColumnType>{BinaryLogColumnType::UINT32, BinaryLogColumnType::COUNT,
+                                         BinaryLogColumnType::FLOAT32},
+        16, 4);
+    for (int i = 0; i < rowNum; ++i) {
+        uint32_t row[3] = {static_cast<uint32_t>(i * 10), static_cast<uint32_t>(i % 17),
+                           BinaryLogWriter::encodeFloat(i / 100.0f)};
+        writer->writeRow(i * 10, row);
+    }
+    return writer;
+}
+
+TEST(BinaryLogTest, TestReadRange) {
+    writeLog("BinaryLogTest.rlog", 10);
+    BinaryLogReader reader("BinaryLogTest.rlog");
+    EXPECT_EQ(reader.formatCsvHeader(), "step,C-NR,cr");
+    EXPECT_EQ(reader.getIndex().size(), 3);
+
+    std::vector<std::string> lines;
+    reader.readRows(35, 61, [&](uint64_t step, const uint32_t* row) {
+        lines.push_back(reader.formatCsvRow(step, row));
+    });
+    ASSERT_EQ(lines.size(), 3);
+    EXPECT_EQ(lines[0], "40," + std::to_string(4 / 16.0) + "," +
+                            std::to_string(static_cast<double>(4 / 100.0f)));
+    EXPECT_EQ(lines[2].substr(0, 3), "60,");
+    std::remove("BinaryLogTest.rlog");
+}
+
+TEST(BinaryLogTest, TestUnclosedLog) {
+    // the writer is not closed, the full chunks are still readable
+    std::unique_ptr<BinaryLogWriter> writer = writeLog("BinaryLogTest_unclosed.rlog", 10);
+    BinaryLogReader reader("BinaryLogTest_unclosed.rlog");
+    EXPECT_EQ(reader.getIndex().size(), 2);
+    int rowNum = 0;
+    reader.readRows(0, 1000, [&](uint64_t, const uint32_t*) { rowNum++; });
+    EXPECT_EQ(rowNum, 8);
+    std::remove("BinaryLogTest_unclosed.rlog");
+}
+
+TEST(BinaryLogTest, TestResume) {
+    // the rows after the checkpoint offset are dropped and written again
+    const std::vector<std::string> names = {"step", "cr"};
+    const std::vector<BinaryLogColumnType> types = {BinaryLogColumnType::UINT32,
+                                                    BinaryLogColumnType::FLOAT32};
+    uint64_t offset = 0;
+    {
+        BinaryLogWriter writer("BinaryLogTest_resume.rlog", names, types, 16, 4);
+        for (int i = 0; i < 14; ++i) {
+            uint32_t row[2] = {static_cast<uint32_t>(i), BinaryLogWriter::encodeFloat(i)};
+            writer.writeRow(i, row);
+            if (i == 5) {
+                writer.flush();
+                offset = writer.getOffset();
+            }
+        }
+    }
+    {
+        BinaryLogWriter writer("BinaryLogTest_resume.rlog", offset);
+        for (int i = 6; i < 10; ++i) {
+            uint32_t row[2] = {static_cast<uint32_t>(i), BinaryLogWriter::encodeFloat(i)};
+            writer.writeRow(i, row);
+        }
+    }
+
+    BinaryLogReader reader("BinaryLogTest_resume.rlog");
+    std::vector<uint64_t> steps;
+    reader.readRows(0, 1000, [&](uint64_t step, const uint32_t*) { steps.push_back(step); });
+    ASSERT_EQ(steps.size(), 10);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(steps[i], i);
+    }
+    std::remove("BinaryLogTest_resume.rlog");
+}
+
+TEST(BinaryLogTest, TestLongRun) {
+    // the steps past 2^32 do not wrap, neither in the range nor in the csv
+    const uint64_t first = (uint64_t(1) << 32) - 2;
+    {
+        BinaryLogWriter writer("BinaryLogTest_long.rlog", {"step", "cr"},
+                               {BinaryLogColumnType::UINT32, BinaryLogColumnType::FLOAT32}, 16, 4);
+        for (uint64_t step = first; step < first + 6; ++step) {
+            uint32_t row[2] = {static_cast<uint32_t>(step), BinaryLogWriter::encodeFloat(0.5f)};
+            writer.writeRow(step, row);
+        }
+    }
+    BinaryLogReader reader("BinaryLogTest_long.rlog");
+    std::vector<std::string> lines;
+    reader.readRows(first + 1, first + 4, [&](uint64_t step, const uint32_t* row) {
+        lines.push_back(reader.formatCsvRow(step, row));
+    });
+    ASSERT_EQ(lines.size(), 3);
+    EXPECT_EQ(lines[0], std::to_string(first + 1) + "," + std::to_string(0.5));
+    EXPECT_EQ(lines[2], std::to_string(first + 3) + "," + std::to_string(0.5));
+    std::remove("BinaryLogTest_long.rlog");
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
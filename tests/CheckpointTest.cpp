@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "Checkpoint.hpp"
+
+TEST(CheckpointTest, TestRoundTrip) {
+    Checkpoint checkpoint;
+    checkpoint.step = 123456;
+    checkpoint.generation = 7;
+    checkpoint.params = "normId=10\nseed=42\n";
+    checkpoint.logPath = "./log/run.rlog";
+    checkpoint.logOffset = 4096;
+    checkpoint.population = 70;
+    checkpoint.donorStrategyIds.assign(70, 2);
+    checkpoint.recipientStrategyIds.assign(70, 1);
+    // 2 bits of the reputation ids of a norm of 3 levels
+    checkpoint.reputationBitNum = 2;
+    checkpoint.reputationBits = {0xaaaaaaaaaaaaaaaaULL, 0xaaaaaaaaaaaaaaaaULL, 0xaaaULL};
+    checkpoint.donorCounts = {0, 0, 70, 0};
+    checkpoint.recipientCounts = {0, 70, 0, 0};
+    checkpoint.goodReputationNum = 70;
+    checkpoint.streams = {{1, 100}, {5, 3}};
+    checkpoint.reducerState = std::string("a\0b", 3);
+    writeCheckpoint("CheckpointTest.ckpt", checkpoint);
+
+    Checkpoint read = readCheckpoint("CheckpointTest.ckpt");
+    EXPECT_EQ(read.step, checkpoint.step);
+    EXPECT_EQ(read.generation, checkpoint.generation);
+    EXPECT_EQ(read.params, checkpoint.params);
+    EXPECT_EQ(read.logPath, checkpoint.logPath);
+    EXPECT_EQ(read.logOffset, checkpoint.logOffset);
+    EXPECT_EQ(read.population, 70);
+    EXPECT_EQ(read.donorStrategyIds, checkpoint.donorStrategyIds);
+    EXPECT_EQ(read.recipientStrategyIds, checkpoint.recipientStrategyIds);
+    EXPECT_EQ(read.reputationBitNum, 2);
+    EXPECT_EQ(read.reputationBits, checkpoint.reputationBits);
+    EXPECT_EQ(read.donorCounts, checkpoint.donorCounts);
+    EXPECT_EQ(read.recipientCounts, checkpoint.recipientCounts);
+    EXPECT_EQ(read.goodReputationNum, 70);
+    ASSERT_EQ(read.streams.size(), 2);
+    EXPECT_EQ(read.streams[1].streamId, 5);
+    EXPECT_EQ(read.streams[1].position, 3);
+    EXPECT_EQ(read.reducerState, checkpoint.reducerState);
+    std::remove("CheckpointTest.ckpt");
+}
+
+TEST(CheckpointTest, TestTruncated) {
+    {
+        std::ofstream file("CheckpointTest_broken.ckpt", std::ios::binary);
+        file << "REPCKPT1";
+    }
+    EXPECT_ANY_THROW(readCheckpoint("CheckpointTest_broken.ckpt"));
+    std::remove("CheckpointTest_broken.ckpt");
+}
+
+TEST(CheckpointTest, TestWrongSize) {
+    // a population larger than the file fails before its arrays are allocated
+    Checkpoint checkpoint;
+    checkpoint.params = "normId=10\n";
+    checkpoint.population = 2;
+    checkpoint.donorStrategyIds.assign(2, 0);
+    checkpoint.recipientStrategyIds.assign(2, 0);
+    checkpoint.reputationBits = {0};
+    writeCheckpoint("CheckpointTest_size.ckpt", checkpoint);
+    {
+        std::fstream file("CheckpointTest_size.ckpt", std::ios::binary | std::ios::in | std::ios::out);
+        // magic, version, step, generation, params, logPath, logOffset
+        file.seekp(8 + 4 + 8 + 8 + 4 + checkpoint.params.size() + 4 + 8);
+        const uint32_t population = 0xffffffff;
+        file.write(reinterpret_cast<const char*>(&population), sizeof(population));
+    }
+    EXPECT_THROW(readCheckpoint("CheckpointTest_size.ckpt"), const char*);
+    std::remove("CheckpointTest_size.ckpt");
+}
+
+TEST(CheckpointTest, TestOtherVersion) {
+    // a checkpoint of another format version is rejected
+    Checkpoint checkpoint;
+    checkpoint.population = 2;
+    checkpoint.donorStrategyIds.assign(2, 0);
+    checkpoint.recipientStrategyIds.assign(2, 0);
+    checkpoint.reputationBits = {0};
+    writeCheckpoint("CheckpointTest_version.ckpt", checkpoint);
+    {
+        std::fstream file("CheckpointTest_version.ckpt", std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(8);
+        const uint32_t version = 2;
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+    EXPECT_THROW(readCheckpoint("CheckpointTest_version.ckpt"), const char*);
+    std::remove("CheckpointTest_version.ckpt");
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include "Composition.hpp"
+
+TEST(CompositionTest, TestCounts) {
+    Composition composition(4, 8);
+    for (int i = 0; i < 8; ++i) {
+        composition.add(i, i % 4);
+    }
+    composition.move(0, 0, 3);
+    composition.move(1, 1, 1);
+    EXPECT_EQ(composition.getCount(0), 1);
+    EXPECT_EQ(composition.getCount(1), 2);
+    EXPECT_EQ(composition.getCount(3), 3);
+    EXPECT_THROW(composition.getMembers(0), const char*);
+}
+
+TEST(CompositionTest, TestSwapRemoveMembers) {
+    Composition composition(2, 6, true);
+    for (int i = 0; i < 6; ++i) {
+        composition.add(i, 0);
+    }
+    composition.move(2, 0, 1);
+    composition.move(0, 0, 1);
+    composition.remove(5, 0);
+
+    std::vector<int> members0 = composition.getMembers(0);
+    std::sort(members0.begin(), members0.end());
+    EXPECT_EQ(members0, (std::vector<int>{1, 3, 4}));
+    std::vector<int> members1 = composition.getMembers(1);
+    std::sort(members1.begin(), members1.end());
+    EXPECT_EQ(members1, (std::vector<int>{0, 2}));
+    EXPECT_EQ(composition.getCount(0), 3);
+    EXPECT_THROW(composition.move(2, 0, 1), const char*);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
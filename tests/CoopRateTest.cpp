@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+#include "Action.hpp"
+#include "Evolution.hpp"
+#include "GameSpec.hpp"
+#include "PayoffMatrix.hpp"
+#include "Population.hpp"
+#include "RandomStream.hpp"
+
+// the exact cooperation rate from the triple counts is the one of all the
+// ordered pairs of a small population
+TEST(CoopRateTest, TestSameAsAllPairs) {
+    std::vector<Action> actions = {Action("C", 0), Action("D", 1)};
+    const int coop_action_id = 0;
+    GameSpec spec("..");
+    RandomStream gen(1, 0);
+    for (int normId : {0, 6, 9, 12}) {
+        PayoffMatrix payoffMatrix = spec.getPayoffMatrix("payoffMatrix_shortterm", normId);
+        const int donor_num = payoffMatrix.getRowStrategies().size();
+        const int recipient_num = payoffMatrix.getColStrategies().size();
+        const int size = 37;
+        Population population(size, spec.getPlayer("donor", actions, payoffMatrix.getRowStrategies()),
+                              spec.getPlayer("recipient", actions, payoffMatrix.getColStrategies()),
+                              spec.getNorm(normId, actions, actions));
+        for (int i = 0; i < size; i++) {
+            population.initIndividual(i, gen.nextInt(donor_num), gen.nextInt(recipient_num), gen.nextInt(2));
+        }
+        int coop_num = 0;
+        for (int i = 0; i < size; i++) {
+            for (int j = 0; j < size; j++) {
+                if (i == j) {
+                    continue;
+                }
+                const int donor_action_id = population.donate(i, j);
+                coop_num += donor_action_id == coop_action_id &&
+                            population.reward(j, donor_action_id) == coop_action_id;
+            }
+        }
+        const double expected = static_cast<double>(coop_num) / (size * (size - 1));
+        EXPECT_DOUBLE_EQ(getCoopRate(population, coop_action_id), expected) << normId;
+
+        // the sampled estimate is unbiased
+        const int samples = 200000;
+        const double sampled = getSampledCoopRate(population, coop_action_id, samples, gen);
+        EXPECT_NEAR(sampled, expected, 5 * std::sqrt(expected * (1 - expected) / samples) + 1e-9) << normId;
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <variant>
+#include <vector>
+#include "Evolution.hpp"
+#include "GameKernel.hpp"
+#include "RandomStream.hpp"
+#include "TestEnvironment.hpp"
+
+// the unrolled kernels must return the bits of the dynamic one, and the
+// average payoff the mean over the other individuals
+TEST(GameKernelTest, TestSameAsDynamic) {
+    RandomStream gen(1, 0);
+    for (int donor_num = 1; donor_num <= 5; donor_num++) {
+        for (int recipient_num = 1; recipient_num <= 5; recipient_num++) {
+            std::vector<double> payoffs(donor_num * recipient_num * 2);
+            for (double& payoff : payoffs) {
+                payoff = gen.nextDouble() * 10 - 5;
+            }
+            std::vector<int> donor_ids;
+            std::vector<int> recipient_ids;
+            std::vector<int> donor_counts(donor_num);
+            std::vector<int> recipient_counts(recipient_num);
+            const int population = 7 + donor_num * recipient_num;
+            for (int i = 0; i < population; i++) {
+                donor_ids.push_back(gen.nextInt(donor_num));
+                recipient_ids.push_back(gen.nextInt(recipient_num));
+                donor_counts[donor_ids[i]]++;
+                recipient_counts[recipient_ids[i]]++;
+            }
+            const GameKernelVariant kernel = getGameKernel(donor_num, recipient_num);
+            // the dynamic one is the last alternative
+            EXPECT_EQ(kernel.index() == std::variant_size_v<GameKernelVariant> - 1,
+                      donor_num > 4 || recipient_num > 4);
+            for (int i = 0; i < population; i++) {
+                const int d = donor_ids[i];
+                const int r = recipient_ids[i];
+                double payoff = std::visit(
+                    [&](auto k) {
+                        return decltype(k)::getAvgPayoff(
+                            payoffs.data(), donor_counts.data(), recipient_counts.data(),
+                            d, r, donor_num, recipient_num, population);
+                    },
+                    kernel);
+                EXPECT_EQ(payoff,
+                          (GameKernel<DYNAMIC_STRATEGY_NUM, DYNAMIC_STRATEGY_NUM>::getAvgPayoff(
+                              payoffs.data(), donor_counts.data(), recipient_counts.data(),
+                              d, r, donor_num, recipient_num, population)));
+                // i is the donor and the recipient of every other once
+                double sum = 0;
+                for (int j = 0; j < population; j++) {
+                    if (j != i) {
+                        sum += payoffs[(d * recipient_num + recipient_ids[j]) * 2] +
+                               payoffs[(donor_ids[j] * recipient_num + r) * 2 + 1];
+                    }
+                }
+                EXPECT_NEAR(payoff, sum / 2 / (population - 1), 1e-12);
+            }
+        }
+    }
+}
+
+// a population that is not a multiple of the strategy pairs starts with
+// pairs of the same size up to one
+TEST(GameKernelTest, TestAnyPopulation) {
+    Evolution evolution = makeEvolution(21, 1, 0.01);
+    const Population& individuals = evolution.getIndividuals();
+    std::vector<int> counts;
+    for (int d = 0; d < 4; d++) {
+        for (int r = 0; r < 4; r++) {
+            counts.push_back(individuals.getStatistics().getPairCount(d, r));
+        }
+    }
+    EXPECT_EQ(*std::min_element(counts.begin(), counts.end()), 1);
+    EXPECT_EQ(*std::max_element(counts.begin(), counts.end()), 2);
+    for (int t = 0; t < 1000; t++) {
+        evolution.step();
+    }
+    EXPECT_EQ(individuals.getStatistics().getReputationCount(0) +
+                  individuals.getStatistics().getReputationCount(1),
+              21);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    testing::AddGlobalTestEnvironment(new GameSpecEnvironment);
+    return RUN_ALL_TESTS();
+}
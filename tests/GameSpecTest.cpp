@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Action.hpp"
+#include "GameSpec.hpp"
+#include "Norm.hpp"
+#include "PayoffMatrix.hpp"
+#include "Player.hpp"
+
+TEST(GameSpecTest, TestSameAsFiles) {
+    GameSpec spec("..");
+    EXPECT_TRUE(spec.hasFile("norm/norm10.csv"));
+    EXPECT_TRUE(spec.hasFile("strategy/donor/DISC.csv"));
+    EXPECT_FALSE(spec.hasFile("payoffMatrix/PayoffMatrix10_example.csv"));
+
+    PayoffMatrix payoffMatrix = spec.getPayoffMatrix("payoffMatrix_shortterm", 10);
+    PayoffMatrix expected("../payoffMatrix/payoffMatrix_shortterm/PayoffMatrix10.csv");
+    EXPECT_EQ(payoffMatrix.getPayoffMatrixStr(), expected.getPayoffMatrixStr());
+    EXPECT_EQ(payoffMatrix.getVars(), expected.getVars());
+
+    std::vector<Action> actions = {Action("C", 0), Action("D", 1)};
+    Norm norm = spec.getNorm(10, actions, actions);
+    EXPECT_EQ(norm.getNormTable(), Norm("../norm/norm10.csv", actions, actions).getNormTable());
+
+    Player player = spec.getPlayer("donor", actions, payoffMatrix.getRowStrategies());
+    Player expectedPlayer("donor", 0, actions);
+    expectedPlayer.setStrategies(payoffMatrix.getRowStrategies());
+    expectedPlayer.loadStrategy("../strategy");
+    EXPECT_EQ(player.getActionTable(), expectedPlayer.getActionTable());
+
+    EXPECT_ANY_THROW(spec.getPayoffMatrix("payoffMatrix_shortterm", 16));
+    EXPECT_ANY_THROW(spec.getNorm(16, actions, actions));
+}
+
+TEST(GameSpecTest, TestCache) {
+    namespace fs = std::filesystem;
+    const fs::path root = "GameSpecTest_root";
+    fs::remove_all(root);
+    fs::create_directories(root / "norm");
+    fs::copy_file("../norm/norm10.csv", root / "norm/norm10.csv");
+    const std::string cachePath = "GameSpecTest.cache";
+    fs::remove(cachePath);
+
+    std::vector<Action> actions = {Action("C", 0), Action("D", 1)};
+    GameSpec spec(root.string(), cachePath);
+    ASSERT_TRUE(fs::exists(cachePath));
+    const std::vector<uint8_t> normTable = spec.getNorm(10, actions, actions).getNormTable();
+
+    // the same size and modification time: the cache is used
+    const fs::path normPath = root / "norm/norm10.csv";
+    const auto modifiedTime = fs::last_write_time(normPath);
+    std::string content;
+    {
+        std::ifstream file(normPath);
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    std::string changed = content;
+    for (char& cell : changed) {
+        if (cell == '0') {
+            cell = '1';
+        } else if (cell == '1') {
+            cell = '0';
+        }
+    }
+    {
+        std::ofstream file(normPath, std::ios::binary | std::ios::trunc);
+        file << changed;
+    }
+    fs::last_write_time(normPath, modifiedTime);
+    EXPECT_EQ(GameSpec(root.string(), cachePath).getNorm(10, actions, actions).getNormTable(), normTable);
+
+    // a changed file: the cache is rewritten
+    fs::last_write_time(normPath, modifiedTime + std::chrono::seconds(1));
+    EXPECT_NE(GameSpec(root.string(), cachePath).getNorm(10, actions, actions).getNormTable(), normTable);
+    EXPECT_NE(GameSpec(root.string()).getNorm(10, actions, actions).getNormTable(), normTable);
+
+    // a huge row number in the cache: the files are parsed again
+    {
+        const std::string path = "norm/norm10.csv";
+        std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(8 + 4 + 4 + 4 + path.size() + 8 + 8);
+        const uint32_t rowNum = 0xffffffff;
+        file.write(reinterpret_cast<const char*>(&rowNum), sizeof(rowNum));
+    }
+    EXPECT_EQ(GameSpec(root.string(), cachePath).getNorm(10, actions, actions).getNormTable(),
+              GameSpec(root.string()).getNorm(10, actions, actions).getNormTable());
+
+    // a broken file stops the loading
+    {
+        std::ofstream file(root / "norm/norm11.csv");
+        file << "C,D\n1,2\n";
+    }
+    EXPECT_ANY_THROW(GameSpec(root.string(), cachePath));
+
+    fs::remove_all(root);
+    fs::remove(cachePath);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
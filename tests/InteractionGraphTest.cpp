@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "InteractionGraph.hpp"
+
+// every edge is stored in both rows
+void expectSymmetric(const InteractionGraph& graph) {
+    for (int i = 0; i < graph.getNodeNum(); ++i) {
+        for (int k = 0; k < graph.getDegree(i); ++k) {
+            int j = graph.getNeighbor(i, k);
+            EXPECT_NE(i, j);
+            bool found = false;
+            for (int l = 0; l < graph.getDegree(j); ++l) {
+                found = found || graph.getNeighbor(j, l) == i;
+            }
+            EXPECT_TRUE(found);
+        }
+    }
+}
+
+TEST(InteractionGraphTest, TestLattice) {
+    InteractionGraph graph = InteractionGraph::lattice(25);
+    EXPECT_EQ(graph.getEdgeNum(), 50);
+    for (int i = 0; i < 25; ++i) {
+        EXPECT_EQ(graph.getDegree(i), 4);
+    }
+    // node 0 wraps around to the end of its row and column
+    EXPECT_EQ(graph.getNeighbor(0, 0), 1);
+    EXPECT_EQ(graph.getNeighbor(0, 1), 4);
+    EXPECT_EQ(graph.getNeighbor(0, 2), 5);
+    EXPECT_EQ(graph.getNeighbor(0, 3), 20);
+    expectSymmetric(graph);
+}
+
+TEST(InteractionGraphTest, TestRandomGraphs) {
+    RandomStream gen(42, 0);
+    InteractionGraph regular = InteractionGraph::create("regular:4", 1000, gen);
+    EXPECT_GE(regular.getEdgeNum(), 1990);
+    EXPECT_LE(regular.getEdgeNum(), 2000);
+    expectSymmetric(regular);
+
+    InteractionGraph smallWorld = InteractionGraph::create("smallworld:4:0.1", 1000, gen);
+    EXPECT_GE(smallWorld.getEdgeNum(), 1990);
+    EXPECT_GE(smallWorld.getMinDegree(), 1);
+    expectSymmetric(smallWorld);
+
+    InteractionGraph scaleFree = InteractionGraph::create("scalefree:2", 1000, gen);
+    EXPECT_EQ(scaleFree.getEdgeNum(), 3 + 997 * 2);
+    EXPECT_GE(scaleFree.getMinDegree(), 2);
+    expectSymmetric(scaleFree);
+}
+
+TEST(InteractionGraphTest, TestEdgeList) {
+    const char* path = "InteractionGraphTest_edges.txt";
+    {
+        std::ofstream file(path);
+        file << "# a triangle, a repeated edge and a self-loop\n0 1\n1 2\n\n2 0\n1 0\n3 3\n";
+    }
+    InteractionGraph graph = InteractionGraph::fromEdgeList(path, 4);
+    std::remove(path);
+    EXPECT_EQ(graph.getEdgeNum(), 3);
+    EXPECT_EQ(graph.getDegree(1), 2);
+    EXPECT_EQ(graph.getDegree(3), 0);
+    EXPECT_EQ(graph.getMinDegree(), 0);
+    expectSymmetric(graph);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
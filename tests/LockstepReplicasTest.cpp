@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "Evolution.hpp"
+#include "LockstepReplicas.hpp"
+#include "RandomStream.hpp"
+#include "TestEnvironment.hpp"
+
+namespace {
+const char* CONFIG = "payoffMatrix_shortterm";
+const int LANE_NUM = LockstepReplicas::LANE_NUM;
+}  // namespace
+
+// the lanes of generateLanes are the blocks of RandomStream
+TEST(LockstepReplicasTest, TestPhiloxLanes) {
+    uint32_t counters[4][LANE_NUM];
+    std::vector<RandomStream> streams;
+    for (int l = 0; l < LANE_NUM; l++) {
+        streams.push_back(RandomStream::derive(42, 9, l, RandomPurpose::LOCKSTEP));
+        streams.back().seek(12345);
+        uint64_t stream_id = streams.back().getStreamId();
+        counters[0][l] = 12345;
+        counters[1][l] = 0;
+        counters[2][l] = static_cast<uint32_t>(stream_id);
+        counters[3][l] = static_cast<uint32_t>(stream_id >> 32);
+    }
+    Philox4x32::generateLanes<LANE_NUM>(counters, streams[0].getKey());
+    for (int l = 0; l < LANE_NUM; l++) {
+        for (int w = 0; w < 4; w++) {
+            EXPECT_EQ(counters[w][l], streams[l].nextUInt32());
+        }
+    }
+}
+
+// a lane only depends on its replica, not on the other lanes of the block
+TEST(LockstepReplicasTest, TestLanesIndependent) {
+    const int shift = 3;
+    LockstepReplicas block(32, 1, 4, 3, 1, 1, 0.02, 9, 0.5, CONFIG, 2);
+    LockstepReplicas shifted(32, 1, 4, 3, 1, 1, 0.02, 9, 0.5, CONFIG, 2, shift);
+    for (int t = 0; t < 5000; t++) {
+        block.step();
+        shifted.step();
+    }
+    for (int l = 0; l + shift < LANE_NUM; l++) {
+        EXPECT_EQ(block.getGoodReputationNum(l + shift), shifted.getGoodReputationNum(l));
+        for (int i = 0; i < 32; i++) {
+            EXPECT_EQ(block.getStrategyPairId(l + shift, i), shifted.getStrategyPairId(l, i));
+            EXPECT_EQ(block.getReputationId(l + shift, i), shifted.getReputationId(l, i));
+        }
+    }
+}
+
+// the lanes start from the populations of the scalar replicas
+TEST(LockstepReplicasTest, TestInitialPopulations) {
+    LockstepReplicas replicas(50, 1, 4, 3, 1, 1, 0.01, 8, 0.3, CONFIG, 4, 8);
+    for (int l = 0; l < LANE_NUM; l++) {
+        Evolution evolution(50, 1, 4, 3, 1, 1, 0.01, 8, 0.3, CONFIG, 4, 8 + l);
+        const Population& expected = evolution.getIndividuals();
+        const Population& individuals = replicas.syncLane(l);
+        EXPECT_EQ(replicas.getGoodReputationNum(l), expected.getGoodReputationNum());
+        for (int i = 0; i < 50; i++) {
+            EXPECT_EQ(individuals.getDonorStrategyId(i), expected.getDonorStrategyId(i));
+            EXPECT_EQ(individuals.getRecipientStrategyId(i), expected.getRecipientStrategyId(i));
+            EXPECT_EQ(individuals.getReputationId(i), expected.getReputationId(i));
+        }
+    }
+}
+
+// the counts of the lanes follow their individuals
+TEST(LockstepReplicasTest, TestCounts) {
+    LockstepReplicas replicas(160, 1, 4, 3, 1, 1, 0.01, 8, 0.5, CONFIG, 3);
+    for (int t = 0; t < 20000; t++) {
+        replicas.step();
+    }
+    EXPECT_EQ(replicas.getStepNum(), 20000);
+    for (int l = 0; l < LANE_NUM; l++) {
+        const Population& individuals = replicas.syncLane(l);
+        const Statistics& statistics = individuals.getStatistics();
+        EXPECT_EQ(individuals.getGoodReputationNum(), replicas.getGoodReputationNum(l));
+        for (int pair = 0; pair < 16; pair++) {
+            for (int rep = 0; rep < 2; rep++) {
+                EXPECT_EQ(statistics.getTripleCount(pair / 4, pair % 4, rep),
+                          replicas.getClassCount(l, pair, rep));
+            }
+        }
+    }
+}
+
+// the AVX2 stages give the steps of the scalar loops
+TEST(LockstepReplicasTest, TestSimdSameAsScalar) {
+    if (!LockstepReplicas::hasSimd()) {
+        GTEST_SKIP() << "no AVX2";
+    }
+    for (const char* config : {CONFIG, "payoffMatrix_longterm_no_norm_error"}) {
+        LockstepReplicas simd(100, 1, 4, 3, 1, 1, 0.05, 9, 0.5, config, 6);
+        LockstepReplicas scalar(100, 1, 4, 3, 1, 1, 0.05, 9, 0.5, config, 6);
+        scalar.setSimd(false);
+        ASSERT_TRUE(simd.isSimd());
+        ASSERT_FALSE(scalar.isSimd());
+        for (int t = 0; t < 20000; t++) {
+            simd.step();
+            scalar.step();
+        }
+        for (int l = 0; l < LANE_NUM; l++) {
+            EXPECT_EQ(simd.getGoodReputationNum(l), scalar.getGoodReputationNum(l));
+            for (int i = 0; i < 100; i++) {
+                EXPECT_EQ(simd.getStrategyPairId(l, i), scalar.getStrategyPairId(l, i));
+                EXPECT_EQ(simd.getReputationId(l, i), scalar.getReputationId(l, i));
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    testing::AddGlobalTestEnvironment(new GameSpecEnvironment);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "LogReducer.hpp"
+
+std::vector<std::string> names = {"step", "C-NR", "cr"};
+std::vector<BinaryLogColumnType> types = {BinaryLogColumnType::UINT32, BinaryLogColumnType::COUNT,
+                                          BinaryLogColumnType::FLOAT32};
+
+TEST(LogReducerTest, TestTailAndSamples) {
+    // rows at the steps 0 to 999, tail from 500, 10 samples per decade,
+    // buckets of 100 steps
+    LogReducer reducer(names, types, 100, 500, 10, 100);
+    for (int step = 0; step < 1000; ++step) {
+        double row[3] = {static_cast<double>(step), (step % 10) / 10.0, step / 1000.0};
+        reducer.add(row);
+    }
+    EXPECT_EQ(reducer.getRowNum(), 1000);
+    EXPECT_EQ(reducer.getTailRowNum(), 500);
+    EXPECT_NEAR(reducer.getTailMean(0), 0.45, 1e-12);
+    EXPECT_NEAR(reducer.getTailVariance(0), 0.0825 * 500 / 499, 1e-12);
+    EXPECT_NEAR(reducer.getTailMean(1), 0.7495, 1e-12);
+
+    boost::json::value summary = reducer.toJson();
+    const boost::json::object& sampled = summary.get_object().at("logSampled").get_object();
+    const boost::json::array& steps = sampled.at("step").get_array();
+    // step 0 and the distinct steps ceil(10^(j / 10)) for j < 30: 1, 2, 3, 4,
+    // 6, 7, 8, 10, 13, ..., 795
+    EXPECT_EQ(steps.size(), 28);
+    EXPECT_EQ(steps[0].as_double(), 0);
+    EXPECT_EQ(steps[1].as_double(), 1);
+    const boost::json::object& buckets = summary.get_object().at("buckets").get_object();
+    EXPECT_EQ(buckets.at("step").get_array().size(), 10);
+    EXPECT_EQ(buckets.at("max").get_object().at("C-NR").get_array()[3].as_double(), 0.9);
+}
+
+TEST(LogReducerTest, TestRowsAndState) {
+    LogReducer reducer(names, types, 100, 0, 0, 0);
+    uint32_t row[3] = {10, 25, BinaryLogWriter::encodeFloat(0.5f)};
+    reducer.addRow(row);
+    reducer.addCsvLine("20,0.750000,0.250000");
+    EXPECT_NEAR(reducer.getTailMean(0), 0.5, 1e-12);
+    EXPECT_NEAR(reducer.getTailMean(1), 0.375, 1e-12);
+    EXPECT_ANY_THROW(reducer.addCsvLine("30,0.5"));
+
+    // the state continues in another reducer
+    std::string state;
+    reducer.saveState(state);
+    LogReducer resumed(names, types, 100, 0, 0, 0);
+    resumed.loadState(state);
+    reducer.addCsvLine("30,1,1");
+    resumed.addCsvLine("30,1,1");
+    EXPECT_EQ(resumed.getRowNum(), 3);
+    EXPECT_EQ(resumed.getTailMean(0), reducer.getTailMean(0));
+    EXPECT_EQ(resumed.getTailVariance(1), reducer.getTailVariance(1));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
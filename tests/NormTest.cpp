@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
+#include <vector>
 #include "Norm.hpp"
 #include "Action.hpp"
+#include "RandomStream.hpp"
 
 TEST(NormTest, TestGetProbability) {
     Norm norm;
@@ -10,18 +12,81 @@ TEST(NormTest, TestGetProbability) {
 }
 
 TEST(NormTest, TestGetReputation) {
-    Norm norm("../norm/norm10.csv");
-    Action donorAction("C", 0);
-    Action recipientAction("D", 1);
-    double reputation = norm.getReputation(donorAction, recipientAction, 0.0);
+    std::vector<Action> actions = {Action("C", 0), Action("D", 1)};
+    Norm norm("../norm/norm10.csv", actions, actions);
+    double reputation = norm.getReputation(actions[0], actions[1], 0, 0.0);
     EXPECT_EQ(reputation, 0.0);
-
-    donorAction.setName("D");
-    donorAction.setId(1);
-    recipientAction.setName("C");
-    recipientAction.setId(0);
-    reputation = norm.getReputation(donorAction, recipientAction, 0.0);
+    reputation = norm.getReputation(actions[1], actions[0], 0, 0.0);
     EXPECT_EQ(reputation, 1.0);
+    // an error always gives the other level of a binary norm
+    reputation = norm.getReputation(actions[1], actions[0], 0, 1.0);
+    EXPECT_EQ(reputation, 0.0);
+
+    // the look-up needs the actions
+    Norm norm_without_actions("../norm/norm10.csv");
+    EXPECT_THROW(norm_without_actions.getReputation(actions[0], actions[1], 0), const char*);
+}
+
+TEST(NormTest, TestGetReputationId) {
+    std::vector<Action> actions = {Action("C", 0), Action("D", 1)};
+    Norm norm("../norm/norm10.csv", actions, actions);
+    for (const Action& donorAction : actions) {
+        for (const Action& recipientAction : actions) {
+            for (int recipientReputationId = 0; recipientReputationId < 2; recipientReputationId++) {
+                int reputationId = norm.getReputationId(donorAction.getId(), recipientAction.getId(),
+                                                        recipientReputationId);
+                EXPECT_EQ(norm.getReputationValue(reputationId),
+                          norm.getReputation(donorAction, recipientAction, recipientReputationId));
+            }
+        }
+    }
+    EXPECT_EQ(norm.getReputationId(1.0), 1);
+    EXPECT_THROW(norm.getReputationId(0.5), const char*);
+}
+
+// a third-order norm also reads the recipient's reputation, with the levels
+// of the table
+TEST(NormTest, TestThirdOrderLevels) {
+    std::vector<Action> actions = {Action("C", 0), Action("D", 1)};
+    // cooperating is good with a good recipient and neutral otherwise,
+    // defecting is bad
+    CsvTable table = {{"C", "C", "C", "C", "C", "C", "D", "D", "D", "D", "D", "D"},
+                      {"C", "C", "C", "D", "D", "D", "C", "C", "C", "D", "D", "D"},
+                      {"0", "0.5", "1", "0", "0.5", "1", "0", "0.5", "1", "0", "0.5", "1"},
+                      {"0.5", "0.5", "1", "0.5", "0.5", "1", "0", "0", "0", "0", "0", "0"}};
+    Norm norm(table, actions, actions);
+    EXPECT_EQ(norm.getOrder(), 3);
+    ASSERT_EQ(norm.getReputationNum(), 3);
+    EXPECT_EQ(norm.getReputationValue(1), 0.5);
+    const int bad = norm.getReputationId(0.0);
+    const int neutral = norm.getReputationId(0.5);
+    const int good = norm.getReputationId(1.0);
+    EXPECT_EQ(norm.getReputationId(0, 1, good), good);
+    EXPECT_EQ(norm.getReputationId(0, 0, bad), neutral);
+    EXPECT_EQ(norm.getReputationId(0, 0, neutral), neutral);
+    EXPECT_EQ(norm.getReputationId(1, 0, good), bad);
+    EXPECT_EQ(norm.getReputation(actions[0], actions[0], good), 1.0);
+    EXPECT_EQ(norm.getReputation(actions[0], actions[1], neutral), 0.5);
+
+    // an error gives one of the two other levels, each about half the time
+    norm.setRandomStream(RandomStream(1, 0));
+    const int trial_num = 2000;
+    int neutral_num = 0;
+    for (int t = 0; t < trial_num; t++) {
+        const double reputation = norm.getReputation(actions[0], actions[0], good, 1.0);
+        ASSERT_TRUE(reputation == 0.0 || reputation == 0.5) << reputation;
+        neutral_num += reputation == 0.5;
+    }
+    EXPECT_NEAR(static_cast<double>(neutral_num) / trial_num, 0.5, 0.05);
+    for (int t = 0; t < trial_num; t++) {
+        EXPECT_NE(norm.getReputation(actions[0], actions[1], bad, 1.0), 0.5);
+    }
+
+    // every level of the recipient must be assessed
+    for (CsvTable::value_type& row : table) {
+        row.pop_back();
+    }
+    EXPECT_THROW(Norm(table, actions, actions), const char*);
 }
 
 int main(int argc, char **argv) {
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <variant>
+#include <vector>
+#include "CompiledPayoffMatrix.hpp"
+#include "Composition.hpp"
+#include "Evolution.hpp"
+#include "PayoffCache.hpp"
+#include "PayoffMatrix.hpp"
+#include "RandomStream.hpp"
+#include "Strategy.hpp"
+
+// the cached average payoffs must stay bit-identical to getAvgPayoff while
+// individuals switch strategies
+TEST(PayoffCacheTest, TestSameAsGetAvgPayoff) {
+    PayoffMatrix payoffMatrix("../payoffMatrix/payoffMatrix_shortterm/PayoffMatrix10.csv");
+    payoffMatrix.updateVar("b", 4);
+    payoffMatrix.updateVar("beta", 3);
+    payoffMatrix.updateVar("c", 1);
+    payoffMatrix.updateVar("gamma", 1);
+    payoffMatrix.updateVar("p", 0.3);
+    CompiledPayoffMatrix compiled = payoffMatrix.compile();
+    const int pId = compiled.getVarId("p");
+    const std::vector<Strategy> donorStrategies = payoffMatrix.getRowStrategies();
+    const std::vector<Strategy> recipientStrategies = payoffMatrix.getColStrategies();
+    const int donorNum = donorStrategies.size();
+    const int recipientNum = recipientStrategies.size();
+    const double reputationValues[] = {0.0, 1.0};
+
+    const int population = 64;
+    Composition donorComposition(donorNum, population);
+    Composition recipientComposition(recipientNum, population);
+    std::vector<int> donorIds(population);
+    std::vector<int> recipientIds(population);
+    for (int i = 0; i < population; i++) {
+        donorIds[i] = i % donorNum;
+        recipientIds[i] = (i / donorNum) % recipientNum;
+        donorComposition.add(i, donorIds[i]);
+        recipientComposition.add(i, recipientIds[i]);
+    }
+    PayoffCache cache(donorNum, recipientNum, 2, population);
+    auto setPayoffs = [&](double donorP) {
+        compiled.setVar(pId, 0, donorP);
+        for (int rep = 0; rep < 2; rep++) {
+            compiled.setVar(pId, 1, reputationValues[rep]);
+            compiled.eval();
+            cache.setPayoffs(rep, compiled);
+        }
+    };
+    setPayoffs(0.3);
+    cache.setCounts(donorComposition, recipientComposition);
+    // the reads by the unrolled kernel of the cache
+    auto readAvgPayoff = [&](int rep, int d, int r) {
+        return std::visit(
+            [&](auto kernel) { return cache.getAvgPayoff<decltype(kernel)>(rep, d, r); },
+            cache.getKernel());
+    };
+
+    RandomStream gen(1, 0);
+    for (int t = 0; t < 200; t++) {
+        int i = gen.nextInt(population);
+        int d = gen.nextInt(donorNum);
+        int r = gen.nextInt(recipientNum);
+        cache.moveDonor(donorIds[i], d);
+        cache.moveRecipient(recipientIds[i], r);
+        donorComposition.move(i, donorIds[i], d);
+        recipientComposition.move(i, recipientIds[i], r);
+        donorIds[i] = d;
+        recipientIds[i] = r;
+        if (t % 50 == 49) {
+            setPayoffs(static_cast<double>(t) / 200);
+        }
+        for (int rep = 0; rep < 2; rep++) {
+            compiled.setVar(pId, 1, reputationValues[rep]);
+            compiled.eval();
+            // a read of one class only refreshes its own terms
+            int readD = gen.nextInt(donorNum);
+            int readR = gen.nextInt(recipientNum);
+            EXPECT_EQ(readAvgPayoff(rep, readD, readR),
+                      getAvgPayoff(donorStrategies[readD], recipientStrategies[readR], compiled,
+                                   donorComposition, recipientComposition, population));
+        }
+    }
+    for (int rep = 0; rep < 2; rep++) {
+        compiled.setVar(pId, 1, reputationValues[rep]);
+        compiled.eval();
+        for (int d = 0; d < donorNum; d++) {
+            for (int r = 0; r < recipientNum; r++) {
+                EXPECT_EQ(readAvgPayoff(rep, d, r),
+                          getAvgPayoff(donorStrategies[d], recipientStrategies[r], compiled,
+                                       donorComposition, recipientComposition, population));
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+#include "PayoffMatrix.hpp"
+#include "CompiledPayoffMatrix.hpp"
+
+// the compiled evaluator must give the same payoffs as evalPayoffMatrix
+TEST(PayoffMatrixTest, TestCompileSameAsEval) {
+    PayoffMatrix payoffMatrix("../payoffMatrix/payoffMatrix_shortterm/PayoffMatrix10.csv");
+    payoffMatrix.updateVar("b", 4);
+    payoffMatrix.updateVar("beta", 3);
+    payoffMatrix.updateVar("c", 1);
+    payoffMatrix.updateVar("gamma", 1);
+    payoffMatrix.updateVar("p", 0.3);
+
+    CompiledPayoffMatrix compiled = payoffMatrix.compile();
+    int pId = compiled.getVarId("p");
+    ASSERT_GE(pId, 0);
+    EXPECT_EQ(compiled.getVarId("not_a_var"), -1);
+
+    for (double recipientP : {1.0, 0.0, 1.0}) {
+        compiled.setVar(pId, 1, recipientP);
+        compiled.eval();
+        auto expected = payoffMatrix.evalPayoffMatrix({}, {{"p", recipientP}});
+        for (int row = 0; row < payoffMatrix.getRowNum(); row++) {
+            for (int col = 0; col < payoffMatrix.getColNum(); col++) {
+                EXPECT_DOUBLE_EQ(compiled.getPayoff(row, col, 0), expected[row][col][0]);
+                EXPECT_DOUBLE_EQ(compiled.getPayoff(row, col, 1), expected[row][col][1]);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "Action.hpp"
+#include "CsvTable.hpp"
+#include "GameSpec.hpp"
+#include "Norm.hpp"
+#include "PayoffMatrix.hpp"
+#include "Player.hpp"
+#include "Population.hpp"
+#include "RandomStream.hpp"
+
+namespace {
+struct Game {
+    std::vector<Action> actions = {Action("C", 0), Action("D", 1)};
+    GameSpec spec{".."};
+    PayoffMatrix payoffMatrix = spec.getPayoffMatrix("payoffMatrix_shortterm", 9);
+    Player donor = spec.getPlayer("donor", actions, payoffMatrix.getRowStrategies());
+    Player recipient = spec.getPlayer("recipient", actions, payoffMatrix.getColStrategies());
+    Norm norm = spec.getNorm(9, actions, actions);
+};
+
+/** @brief recount the compositions and statistics of the population */
+void expectCounts(const Population& population) {
+    const Statistics& statistics = population.getStatistics();
+    std::vector<int> donor_counts(statistics.getDonorStrategyNum());
+    std::vector<int> recipient_counts(statistics.getRecipientStrategyNum());
+    std::vector<int> triple_counts(statistics.getTripleCounts().size());
+    int good_num = 0;
+    for (int i = 0; i < population.getSize(); i++) {
+        const int d = population.getDonorStrategyId(i);
+        const int r = population.getRecipientStrategyId(i);
+        const int rep = population.getReputationId(i);
+        donor_counts[d]++;
+        recipient_counts[r]++;
+        triple_counts[(d * statistics.getRecipientStrategyNum() + r) * population.getReputationNum() +
+                      rep]++;
+        good_num += rep == population.getReputationNum() - 1;
+    }
+    EXPECT_EQ(population.getDonorComposition().getCounts(), donor_counts);
+    EXPECT_EQ(population.getRecipientComposition().getCounts(), recipient_counts);
+    EXPECT_EQ(statistics.getTripleCounts(), triple_counts);
+    EXPECT_EQ(population.getGoodReputationNum(), good_num);
+}
+}  // namespace
+
+// the reputation bits of the individuals around the bounds of the 64-bit
+// words are independent of each other
+TEST(PopulationTest, TestReputationBits) {
+    Game game;
+    const int size = 200;
+    Population population(size, game.donor, game.recipient, game.norm);
+    for (int i = 0; i < size; i++) {
+        population.initIndividual(i, 0, 0, 0);
+    }
+    std::vector<int> expected(size, 0);
+    for (int i : {0, 62, 63, 64, 65, 127, 128, 191, 192, 199}) {
+        population.setReputationId(i, 1);
+        expected[i] = 1;
+    }
+    population.setReputationId(63, 0);
+    expected[63] = 0;
+    population.storeReputationId(64, 0);
+    population.storeReputationId(191, 1);
+    population.storeReputationId(190, 1);
+    expected[64] = 0;
+    expected[190] = 1;
+    population.swapReputations(127, 126);
+    std::swap(expected[127], expected[126]);
+    for (int i = 0; i < size; i++) {
+        EXPECT_EQ(population.getReputationId(i), expected[i]) << i;
+    }
+}
+
+// random moves keep the incremental counts equal to a recount
+TEST(PopulationTest, TestCountsAfterMoves) {
+    Game game;
+    const int size = 130;
+    const int donor_num = game.payoffMatrix.getRowStrategies().size();
+    const int recipient_num = game.payoffMatrix.getColStrategies().size();
+    Population population(size, game.donor, game.recipient, game.norm);
+    RandomStream gen(1, 0);
+    for (int i = 0; i < size; i++) {
+        population.initIndividual(i, gen.nextInt(donor_num), gen.nextInt(recipient_num),
+                                  gen.nextInt(2));
+    }
+    expectCounts(population);
+    for (int t = 0; t < 2000; t++) {
+        const int i = gen.nextInt(size);
+        const int j = gen.nextInt(size);
+        switch (gen.nextInt(5)) {
+            case 0:
+                population.setStrategies(i, gen.nextInt(donor_num), gen.nextInt(recipient_num));
+                break;
+            case 1:
+                population.setReputationId(i, gen.nextInt(2));
+                break;
+            case 2:
+                population.swapStrategies(i, j);
+                break;
+            case 3:
+                population.swapReputations(i, j);
+                break;
+            default:
+                if (i != j) {
+                    population.playGame(i, j);
+                }
+        }
+    }
+    expectCounts(population);
+}
+
+// the id-based donate/reward are the actions of the template players
+TEST(PopulationTest, TestDonateReward) {
+    Game game;
+    const std::vector<Strategy> donor_strategies = game.payoffMatrix.getRowStrategies();
+    const std::vector<Strategy> recipient_strategies = game.payoffMatrix.getColStrategies();
+    Population population(2, game.donor, game.recipient, game.norm);
+    population.initIndividual(0, 0, 0, 0);
+    population.initIndividual(1, 0, 0, 0);
+    for (const Strategy& donor_s : donor_strategies) {
+        for (const Strategy& recipient_s : recipient_strategies) {
+            for (int rep = 0; rep < 2; rep++) {
+                population.setStrategies(0, donor_s.getId(), 0);
+                population.setStrategies(1, 0, recipient_s.getId());
+                population.setReputationId(1, rep);
+                game.donor.setStrategy(donor_s);
+                game.recipient.setStrategy(recipient_s);
+                Action donor_action = game.donor.donate(std::to_string(rep));
+                Action recipient_action = game.recipient.reward(donor_action.getName());
+                EXPECT_EQ(population.donate(0, 1), donor_action.getId());
+                EXPECT_EQ(population.reward(1, donor_action.getId()), recipient_action.getId());
+                EXPECT_EQ(population.playGame(0, 1),
+                          game.norm.getReputationId(game.norm.getReputation(donor_action, recipient_action, rep)));
+            }
+        }
+    }
+}
+
+// the reputation ids of a norm of 3 levels take 2 bits, the donors read the
+// level 0.5 as good and the good reputations are the top level
+TEST(PopulationTest, TestReputationLevels) {
+    Game game;
+    // cooperating is good with a good recipient and neutral otherwise,
+    // defecting is bad
+    CsvTable table = {{"C", "C", "C", "C", "C", "C", "D", "D", "D", "D", "D", "D"},
+                      {"C", "C", "C", "D", "D", "D", "C", "C", "C", "D", "D", "D"},
+                      {"0", "0.5", "1", "0", "0.5", "1", "0", "0.5", "1", "0", "0.5", "1"},
+                      {"0.5", "0.5", "1", "0.5", "0.5", "1", "0", "0", "0", "0", "0", "0"}};
+    Norm norm(table, game.actions, game.actions);
+    const int size = 100;
+    Population population(size, game.donor, game.recipient, norm);
+    ASSERT_EQ(population.getReputationNum(), 3);
+    EXPECT_EQ(population.getReputationBitNum(), 2);
+    RandomStream gen(2, 0);
+    std::vector<int> expected(size);
+    for (int i = 0; i < size; i++) {
+        expected[i] = gen.nextInt(3);
+        population.initIndividual(i, i % 4, (i / 4) % 4, expected[i]);
+    }
+    for (int t = 0; t < 500; t++) {
+        const int i = gen.nextInt(size);
+        const int j = gen.nextInt(size);
+        if (gen.nextInt(2) == 0) {
+            const int rep = gen.nextInt(3);
+            population.setReputationId(i, rep);
+            expected[i] = rep;
+        } else {
+            population.swapReputations(i, j);
+            std::swap(expected[i], expected[j]);
+        }
+    }
+    for (int i = 0; i < size; i++) {
+        ASSERT_EQ(population.getReputationId(i), expected[i]) << i;
+    }
+    // the good reputations are the individuals of the top level
+    expectCounts(population);
+    // the ids around the bounds of the 64-bit words
+    for (int i : {30, 31, 32, 33, 63, 64}) {
+        expected[i] = (expected[i] + 1) % 3;
+        population.storeReputationId(i, expected[i]);
+    }
+    for (int i = 0; i < size; i++) {
+        EXPECT_EQ(population.getReputationId(i), expected[i]) << i;
+    }
+
+    // the neutral level is the input "1" of the donor, the games follow the
+    // third-order norm
+    const int bad = norm.getReputationId(0.0);
+    const int neutral = norm.getReputationId(0.5);
+    const int good = norm.getReputationId(1.0);
+    for (int d = 0; d < 4; d++) {
+        game.donor.setStrategy(game.payoffMatrix.getRowStrategies()[d]);
+        EXPECT_EQ(population.getDonorAction(d, bad), game.donor.donate("0").getId());
+        EXPECT_EQ(population.getDonorAction(d, neutral), game.donor.donate("1").getId());
+        EXPECT_EQ(population.getDonorAction(d, good), game.donor.donate("1").getId());
+    }
+    for (int rep : {bad, neutral, good}) {
+        EXPECT_EQ(population.assess(0, 0, rep), norm.getReputationId(0, 0, rep));
+        EXPECT_EQ(population.assess(1, 0, rep), bad);
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "RandomStream.hpp"
+
+// known answers of Random123 (kat_vectors, philox4x32_10)
+TEST(RandomStreamTest, TestPhiloxKnownAnswer) {
+    Philox4x32::Counter res = Philox4x32::generate({0, 0, 0, 0}, {0, 0});
+    EXPECT_EQ(res, (Philox4x32::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    res = Philox4x32::generate({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                               {0xffffffff, 0xffffffff});
+    EXPECT_EQ(res, (Philox4x32::Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+}
+
+TEST(RandomStreamTest, TestReproducibleStreams) {
+    RandomStream a = RandomStream::derive(42, 10, 0, RandomPurpose::SELECTION);
+    RandomStream b = RandomStream::derive(42, 10, 0, RandomPurpose::SELECTION);
+    RandomStream c = RandomStream::derive(42, 10, 0, RandomPurpose::DECISION);
+    int sameNum = 0;
+    for (int i = 0; i < 1000; ++i) {
+        uint32_t x = a.nextUInt32();
+        EXPECT_EQ(x, b.nextUInt32());
+        if (x == c.nextUInt32()) {
+            sameNum++;
+        }
+    }
+    EXPECT_LT(sameNum, 2);
+    EXPECT_EQ(a.getPosition(), 1000);
+}
+
+TEST(RandomStreamTest, TestSeek) {
+    RandomStream a(42, 3);
+    std::vector<uint32_t> xs;
+    for (int i = 0; i < 200; ++i) {
+        xs.push_back(a.nextUInt32());
+    }
+    // the numbers only depend on the block, not on how many are generated at a time
+    RandomStream b(42, 3);
+    b.seek(5, 1);
+    for (int i = 20; i < 200; ++i) {
+        EXPECT_EQ(xs[i], b.nextUInt32());
+    }
+    EXPECT_EQ(b.getPosition(), 200);
+}
+
+TEST(RandomStreamTest, TestNextInt) {
+    RandomStream gen(7, 0);
+    std::vector<int> counts(6, 0);
+    for (int i = 0; i < 60000; ++i) {
+        double p = gen.nextDouble();
+        EXPECT_GE(p, 0.0);
+        EXPECT_LT(p, 1.0);
+        counts[gen.nextInt(6)]++;
+    }
+    for (int count : counts) {
+        EXPECT_NEAR(count, 10000, 500);
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
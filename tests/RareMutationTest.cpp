@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "RareMutation.hpp"
+#include "TestEnvironment.hpp"
+
+TEST(RareMutationTest, TestNeutral) {
+    // without selection every mutant fixes with 1 / N
+    RareMutation rare(32, 0, 4, 3, 1, 1, 10, 1, "payoffMatrix_longterm_no_norm_error");
+    for (int resident = 0; resident < 16; resident++) {
+        for (int mutant = 0; mutant < 16; mutant++) {
+            if (mutant != resident) {
+                EXPECT_NEAR(rare.getFixationProbability(resident, mutant), 1.0 / 32, 1e-12);
+            }
+        }
+        EXPECT_NEAR(rare.getStationaryDistribution()[resident], 1.0 / 16, 1e-12);
+    }
+}
+
+TEST(RareMutationTest, TestStationaryDistribution) {
+    RareMutation rare(160, 1, 4, 3, 1, 1, 10, 1, "payoffMatrix_shortterm");
+    double sum = 0;
+    for (double freq : rare.getStationaryDistribution()) {
+        EXPECT_GE(freq, 0);
+        sum += freq;
+    }
+    EXPECT_NEAR(sum, 1, 1e-12);
+    EXPECT_GE(rare.getCoopRate(), 0);
+    EXPECT_LE(rare.getCoopRate(), 1);
+}
+
+TEST(RareMutationTest, TestStrongSelection) {
+    // the fermi probabilities of the mutants underflow to 0, the frozen
+    // reputations of norm 8 still come from finite times of the mutants
+    RareMutation rare(160, 1000, 4, 3, 1, 1, 8, 0.5, "payoffMatrix_shortterm");
+    for (double good : rare.getHomogeneousGoodReputation()) {
+        EXPECT_GE(good, 0);
+        EXPECT_LE(good, 1);
+    }
+    double sum = 0;
+    for (double freq : rare.getStationaryDistribution()) {
+        EXPECT_GE(freq, 0);
+        sum += freq;
+    }
+    EXPECT_NEAR(sum, 1, 1e-12);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    testing::AddGlobalTestEnvironment(new GameSpecEnvironment);
+    return RUN_ALL_TESTS();
+}
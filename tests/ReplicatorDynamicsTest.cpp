@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "ReplicatorDynamics.hpp"
+#include "TestEnvironment.hpp"
+
+TEST(ReplicatorDynamicsTest, TestConservation) {
+    ReplicatorDynamics replicator(1, 4, 3, 1, 1, 0.0001, 10, 1, "payoffMatrix_longterm_no_norm_error");
+    replicator.advanceTo(100.5);
+    // advanceTo() does not stop exactly at the time, the log interpolates
+    std::vector<double> y;
+    replicator.interpolate(100.5, y);
+    for (const std::vector<double>& state : {replicator.getState(), y}) {
+        double sum = 0;
+        for (double freq : state) {
+            EXPECT_GT(freq, -1e-9);
+            sum += freq;
+        }
+        EXPECT_NEAR(sum, 1, 1e-9);
+        EXPECT_GE(replicator.getCoopRate(state), 0);
+        EXPECT_LE(replicator.getCoopRate(state), 1);
+    }
+}
+
+TEST(ReplicatorDynamicsTest, TestNeutralDrift) {
+    // without selection and mutation the imitation flows between two pairs
+    // cancel, only the reputations change
+    ReplicatorDynamics replicator(0, 4, 3, 1, 1, 0, 10, 1, "payoffMatrix_shortterm");
+    replicator.advanceTo(20);
+    const std::vector<double>& y = replicator.getState();
+    for (int d = 0; d < 4; d++) {
+        for (int r = 0; r < 4; r++) {
+            EXPECT_NEAR(replicator.getPairFrequency(y, d, r), 1.0 / 16, 1e-9);
+        }
+    }
+    EXPECT_LT(replicator.getGoodReputationFrequency(y), 1);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    testing::AddGlobalTestEnvironment(new GameSpecEnvironment);
+    return RUN_ALL_TESTS();
+}
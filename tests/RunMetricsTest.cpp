@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include "RunMetrics.hpp"
+
+TEST(RunMetricsTest, TestSample) {
+    MetricsRegistry registry;
+    RunMetrics* first = registry.add("run0", 8, 0, 1000);
+    RunMetrics* second = registry.add("run1", 9, 2, 1000, 400);
+    first->setStepsDone(250);
+    first->addLogBytes(100);
+    first->addLogBytes(20);
+    first->setCoopRate(0.5);
+    second->setState(RunState::DONE);
+
+    std::vector<RunSample> samples = registry.sample();
+    ASSERT_EQ(samples.size(), 2);
+    EXPECT_EQ(samples[0].name, "run0");
+    EXPECT_EQ(samples[0].stepsDone, 250);
+    EXPECT_EQ(samples[0].logBytes, 120);
+    EXPECT_EQ(samples[0].coopRate, 0.5);
+    EXPECT_EQ(samples[0].state, RunState::RUNNING);
+    // a resumed run starts at the step of its checkpoint
+    EXPECT_EQ(samples[1].stepsDone, 400);
+    EXPECT_TRUE(std::isnan(samples[1].coopRate));
+    EXPECT_EQ(samples[1].state, RunState::DONE);
+
+    std::string text = MetricsReporter::toPrometheus(samples);
+    EXPECT_NE(text.find("# TYPE reputation_run_steps_done counter\n"), std::string::npos);
+    EXPECT_NE(text.find("reputation_run_steps_done{run=\"run0\",norm=\"8\",replica=\"0\"} 250\n"), std::string::npos);
+    EXPECT_NE(text.find("reputation_run_coop_rate{run=\"run0\",norm=\"8\",replica=\"0\"} 0.5\n"), std::string::npos);
+    // no cooperation rate before the first row of the log
+    EXPECT_EQ(text.find("reputation_run_coop_rate{run=\"run1\""), std::string::npos);
+    EXPECT_NE(text.find("reputation_run_running{run=\"run1\",norm=\"9\",replica=\"2\"} 0\n"), std::string::npos);
+}
+
+// a run that throws is FAILED, and a released run is in one more sample only
+TEST(RunMetricsTest, TestGuard) {
+    MetricsRegistry registry;
+    RunMetrics* done = registry.add("run0", 8, 0, 1000);
+    RunMetrics* failed = registry.add("run1", 8, 1, 1000);
+    registry.add("run2", 8, 2, 1000);
+    {
+        RunMetricsGuard guard(done);
+        done->setState(RunState::DONE);
+    }
+    EXPECT_THROW({
+        RunMetricsGuard guard(failed);
+        failed->setStepsDone(10);
+        throw "run error";
+    }, const char*);
+
+    std::vector<RunSample> samples = registry.sample();
+    ASSERT_EQ(samples.size(), 3);
+    EXPECT_EQ(samples[0].state, RunState::DONE);
+    EXPECT_TRUE(samples[0].isLast);
+    EXPECT_EQ(samples[1].state, RunState::FAILED);
+    EXPECT_EQ(samples[1].stepsDone, 10);
+    EXPECT_TRUE(samples[1].isLast);
+    EXPECT_EQ(samples[2].state, RunState::RUNNING);
+    EXPECT_FALSE(samples[2].isLast);
+
+    samples = registry.sample();
+    ASSERT_EQ(samples.size(), 1);
+    EXPECT_EQ(samples[0].name, "run2");
+
+    RunStateNums dropped{};
+    dropped[static_cast<int>(RunState::DONE)] = 1;
+    dropped[static_cast<int>(RunState::FAILED)] = 1;
+    boost::json::object totals = MetricsReporter::toJson(samples, dropped).as_object()["totals"].as_object();
+    EXPECT_EQ(totals["running"].as_int64(), 1);
+    EXPECT_EQ(totals["done"].as_int64(), 1);
+    EXPECT_EQ(totals["failed"].as_int64(), 1);
+}
+
+TEST(RunMetricsTest, TestReporterJson) {
+    const std::string path = "RunMetricsTest.json";
+    std::remove(path.c_str());
+    MetricsRegistry registry;
+    RunMetrics* run = registry.add("run0", 8, 0, 1000);
+    {
+        MetricsReporter reporter(registry, 0.01, false, path);
+        reporter.start();
+        for (int step = 1; step <= 1000; step++) {
+            run->setStepsDone(step);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        run->setState(RunState::DONE);
+        reporter.stop();
+    }
+    ASSERT_TRUE(std::filesystem::exists(path));
+    EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+    EXPECT_ANY_THROW(MetricsReporter(registry, 0, false));
+    std::remove(path.c_str());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Checkpoint.hpp"
+#include "Evolution.hpp"
+#include "TestEnvironment.hpp"
+
+namespace {
+const int POPULATION = 16;
+
+/** @brief skipSteps() until stepNum steps, in calls of at most maxStepNum */
+void skip(Evolution& evolution, int stepNum, int maxStepNum) {
+    for (int step = 0; step < stepNum;) {
+        int done = evolution.skipSteps(std::min(maxStepNum, stepNum - step));
+        ASSERT_GE(done, 1);
+        ASSERT_LE(done, std::min(maxStepNum, stepNum - step));
+        step += done;
+    }
+}
+}  // namespace
+
+// from a homogeneous state that the games do not change, only a mutation
+// can: the call changes the pair of one individual, and it changes nothing
+// within maxStepNum steps with the probability (1 - mu) ^ maxStepNum
+TEST(SkipStepsTest, TestMutationOnly) {
+    const double mu = 0.001;
+    const int max_step_num = 1000;
+    // a pair and a reputation whose games keep the reputation
+    Evolution absorbed = makeEvolution(POPULATION, 1, 0);
+    Checkpoint checkpoint;
+    absorbed.saveCheckpoint(checkpoint);
+    bool found = false;
+    for (int pair = 0; pair < 16 && !found; pair++) {
+        for (int rep = 0; rep < 2 && !found; rep++) {
+            checkpoint.donorStrategyIds.assign(POPULATION, pair / 4);
+            checkpoint.recipientStrategyIds.assign(POPULATION, pair % 4);
+            checkpoint.reputationBits.assign(1, rep ? (uint64_t(1) << POPULATION) - 1 : 0);
+            checkpoint.donorCounts.assign(4, 0);
+            checkpoint.donorCounts[pair / 4] = POPULATION;
+            checkpoint.recipientCounts.assign(4, 0);
+            checkpoint.recipientCounts[pair % 4] = POPULATION;
+            checkpoint.goodReputationNum = rep * POPULATION;
+            absorbed.loadCheckpoint(checkpoint);
+            found = absorbed.isAbsorbed();
+        }
+    }
+    ASSERT_TRUE(found);
+
+    const int replica_num = 2000;
+    int unchanged_num = 0;
+    for (int r = 0; r < replica_num; r++) {
+        Evolution evolution = makeEvolution(POPULATION, 2 + r, mu);
+        // the homogeneous state with the random streams of the replica
+        Checkpoint own;
+        evolution.saveCheckpoint(own);
+        Checkpoint start = checkpoint;
+        start.streams = own.streams;
+        evolution.loadCheckpoint(start);
+
+        const int done = evolution.skipSteps(max_step_num);
+        int mutant_num = 0;
+        for (int i = 0; i < POPULATION; i++) {
+            mutant_num += evolution.getIndividuals().getDonorStrategyId(i) != start.donorStrategyIds[i] ||
+                          evolution.getIndividuals().getRecipientStrategyId(i) != start.recipientStrategyIds[i];
+        }
+        ASSERT_LE(mutant_num, 1);
+        if (done < max_step_num) {
+            ASSERT_EQ(mutant_num, 1);
+        }
+        unchanged_num += mutant_num == 0;
+    }
+    const double p = std::pow(1 - mu, max_step_num);
+    EXPECT_LT(std::abs(unchanged_num - replica_num * p), 4 * std::sqrt(replica_num * p * (1 - p)));
+}
+
+// a checkpoint at a bound of the calls continues the same run
+TEST(SkipStepsTest, TestResume) {
+    Evolution evolution = makeEvolution(POPULATION, 3, 0.001);
+    skip(evolution, 5000, 1000);
+    Checkpoint checkpoint;
+    evolution.saveCheckpoint(checkpoint);
+    skip(evolution, 5000, 1000);
+
+    Evolution resumed = makeEvolution(POPULATION, 3, 0.001);
+    resumed.loadCheckpoint(checkpoint);
+    skip(resumed, 5000, 1000);
+    EXPECT_EQ(resumed.getIndividuals().getStatistics().getTripleCounts(),
+              evolution.getIndividuals().getStatistics().getTripleCounts());
+    for (int i = 0; i < POPULATION; i++) {
+        EXPECT_EQ(resumed.getIndividuals().getReputationId(i), evolution.getIndividuals().getReputationId(i));
+    }
+}
+
+// nothing can change without mutation once absorbed
+TEST(SkipStepsTest, TestAbsorbed) {
+    Evolution evolution = makeEvolution(POPULATION, 5, 0);
+    skip(evolution, 1000000, 1000000);
+    ASSERT_TRUE(evolution.isAbsorbed());
+    EXPECT_EQ(evolution.skipSteps(1000000), 1000000);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    testing::AddGlobalTestEnvironment(new GameSpecEnvironment);
+    return RUN_ALL_TESTS();
+}
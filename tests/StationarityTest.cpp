@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "RandomStream.hpp"
+#include "Stationarity.hpp"
+
+TEST(StationarityTest, TestMserTruncation) {
+    // a decaying warm-up of 20 means, then noise around 0
+    RandomStream gen(42, 0);
+    std::vector<double> means;
+    for (int i = 0; i < 200; ++i) {
+        double warmup = i < 20 ? (20 - i) * 0.5 : 0;
+        means.push_back(warmup + gen.nextDouble() - 0.5);
+    }
+    int d = StationarityDetector::mserTruncation(means);
+    EXPECT_GE(d, 15);
+    EXPECT_LE(d, 30);
+
+    // a constant series needs no truncation
+    EXPECT_EQ(StationarityDetector::mserTruncation(std::vector<double>(100, 0.25)), 0);
+    EXPECT_EQ(StationarityDetector::getHalfWidth(std::vector<double>(100, 0.25), 0), 0);
+}
+
+TEST(StationarityTest, TestDetector) {
+    RandomStream gen(42, 1);
+    StationarityDetector noise(2, 0.01);
+    uint64_t step = 0;
+    for (; step < 100000 && !noise.isStationary(); ++step) {
+        double values[2] = {step < 500 ? 1.0 : 0.5, gen.nextDouble()};
+        noise.add(step, values);
+    }
+    EXPECT_TRUE(noise.isStationary());
+    EXPECT_LT(step, 100000);
+    EXPECT_GE(noise.getTruncationStep(), 500);
+
+    // a trend is never stationary
+    StationarityDetector trend(1, 0.01);
+    for (step = 0; step < 100000; ++step) {
+        double value = step * 1e-5;
+        EXPECT_FALSE(trend.add(step, &value));
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
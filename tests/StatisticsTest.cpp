@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "RandomStream.hpp"
+#include "Statistics.hpp"
+
+namespace {
+struct Individual {
+    int donorStrategyId;
+    int recipientStrategyId;
+    int reputationId;
+};
+
+/** @brief the counts and frequencies of the statistics against a recount */
+void expectRecount(const Statistics& statistics, const std::vector<Individual>& individuals) {
+    const int donor_num = statistics.getDonorStrategyNum();
+    const int recipient_num = statistics.getRecipientStrategyNum();
+    const int reputation_num = statistics.getReputationNum();
+    const double size = individuals.size();
+    for (int d = 0; d < donor_num; d++) {
+        for (int r = 0; r < recipient_num; r++) {
+            int pair_count = 0;
+            for (int rep = 0; rep < reputation_num; rep++) {
+                int count = 0;
+                for (const Individual& individual : individuals) {
+                    count += individual.donorStrategyId == d && individual.recipientStrategyId == r &&
+                             individual.reputationId == rep;
+                }
+                EXPECT_EQ(statistics.getTripleCount(d, r, rep), count);
+                pair_count += count;
+            }
+            EXPECT_EQ(statistics.getPairCount(d, r), pair_count);
+            EXPECT_DOUBLE_EQ(statistics.getPairCount(d, r) / size, pair_count / size);
+        }
+    }
+    for (int rep = 0; rep < reputation_num; rep++) {
+        int count = 0;
+        for (const Individual& individual : individuals) {
+            count += individual.reputationId == rep;
+        }
+        EXPECT_EQ(statistics.getReputationCount(rep), count);
+    }
+}
+}  // namespace
+
+// the counts updated on every change equal a recount of the individuals
+TEST(StatisticsTest, TestSameAsRecount) {
+    const int donor_num = 3;
+    const int recipient_num = 2;
+    const int reputation_num = 3;
+    RandomStream gen(1, 0);
+    auto randomIndividual = [&]() {
+        return Individual{static_cast<int>(gen.nextInt(donor_num)), static_cast<int>(gen.nextInt(recipient_num)),
+                          static_cast<int>(gen.nextInt(reputation_num))};
+    };
+    Statistics statistics(donor_num, recipient_num, reputation_num);
+    std::vector<Individual> individuals;
+    for (int i = 0; i < 50; i++) {
+        individuals.push_back(randomIndividual());
+        statistics.add(individuals[i].donorStrategyId, individuals[i].recipientStrategyId,
+                       individuals[i].reputationId);
+    }
+    expectRecount(statistics, individuals);
+
+    for (int t = 0; t < 1000; t++) {
+        Individual& individual = individuals[gen.nextInt(individuals.size())];
+        Individual next = randomIndividual();
+        if (t % 3 == 0) {
+            statistics.move(individual.donorStrategyId, individual.recipientStrategyId,
+                            individual.reputationId, next.donorStrategyId, next.recipientStrategyId,
+                            next.reputationId);
+        } else {
+            // the batched updates of addCount
+            statistics.addCount(individual.donorStrategyId, individual.recipientStrategyId,
+                                individual.reputationId, -1);
+            statistics.addCount(next.donorStrategyId, next.recipientStrategyId, next.reputationId, 1);
+        }
+        individual = next;
+        if (t % 100 == 99) {
+            expectRecount(statistics, individuals);
+        }
+    }
+    statistics.remove(individuals.back().donorStrategyId, individuals.back().recipientStrategyId,
+                      individuals.back().reputationId);
+    individuals.pop_back();
+    expectRecount(statistics, individuals);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
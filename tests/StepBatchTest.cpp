@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <tbb/task_arena.h>
+#include <vector>
+#include "Checkpoint.hpp"
+#include "Evolution.hpp"
+#include "TestEnvironment.hpp"
+
+namespace {
+const int POPULATION = 4096;
+const double MU = 0.01;
+
+void expectSameIndividuals(const Population& a, const Population& b) {
+    for (int i = 0; i < POPULATION; i++) {
+        ASSERT_EQ(a.getDonorStrategyId(i), b.getDonorStrategyId(i));
+        ASSERT_EQ(a.getRecipientStrategyId(i), b.getRecipientStrategyId(i));
+        ASSERT_EQ(a.getReputationId(i), b.getReputationId(i));
+    }
+}
+}  // namespace
+
+// the batches are the same on one thread (in order) and on many (in rounds)
+TEST(StepBatchTest, TestSameForAnyThreads) {
+    Evolution one = makeEvolution(POPULATION, 1, MU);
+    Evolution many = makeEvolution(POPULATION, 1, MU);
+    ASSERT_EQ(one.getBatchStepNum(), POPULATION / Evolution::BATCH_DIVISOR);
+    tbb::task_arena(1).execute([&] {
+        for (int t = 0; t < 300; t++) {
+            one.stepBatch();
+        }
+    });
+    tbb::task_arena(4).execute([&] {
+        for (int t = 0; t < 300; t++) {
+            many.stepBatch();
+        }
+    });
+    EXPECT_EQ(one.getGeneration(), 300);
+    EXPECT_EQ(one.getIndividuals().getStatistics().getTripleCounts(),
+              many.getIndividuals().getStatistics().getTripleCounts());
+    expectSameIndividuals(one.getIndividuals(), many.getIndividuals());
+}
+
+// the counts added at the end of a batch are those of the individuals
+TEST(StepBatchTest, TestCounts) {
+    Evolution evolution = makeEvolution(POPULATION, 2, MU);
+    for (int t = 0; t < 300; t++) {
+        evolution.stepBatch();
+    }
+    const Population& individuals = evolution.getIndividuals();
+    const Statistics& statistics = individuals.getStatistics();
+    std::vector<int> triple_counts(statistics.getTripleCounts().size(), 0);
+    for (int i = 0; i < POPULATION; i++) {
+        int pair_id = individuals.getDonorStrategyId(i) * statistics.getRecipientStrategyNum() +
+                      individuals.getRecipientStrategyId(i);
+        triple_counts[pair_id * statistics.getReputationNum() + individuals.getReputationId(i)]++;
+    }
+    EXPECT_EQ(statistics.getTripleCounts(), triple_counts);
+}
+
+// a checkpoint between the batches continues the same run
+TEST(StepBatchTest, TestResume) {
+    Evolution evolution = makeEvolution(POPULATION, 3, MU);
+    for (int t = 0; t < 100; t++) {
+        evolution.stepBatch();
+    }
+    Checkpoint checkpoint;
+    evolution.saveCheckpoint(checkpoint);
+    for (int t = 0; t < 100; t++) {
+        evolution.stepBatch();
+    }
+
+    Evolution resumed = makeEvolution(POPULATION, 3, MU);
+    resumed.loadCheckpoint(checkpoint);
+    for (int t = 0; t < 100; t++) {
+        resumed.stepBatch();
+    }
+    expectSameIndividuals(resumed.getIndividuals(), evolution.getIndividuals());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    testing::AddGlobalTestEnvironment(new GameSpecEnvironment);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include "Sweep.hpp"
+
+TEST(SweepTest, TestExpandGrid) {
+    std::ofstream spec("SweepTest_grid.txt");
+    spec << "# comment\nnormId = 10,11\np0 = 0:0.25:1\nstepNum = 100\n";
+    spec.close();
+    SweepJob defaultJob;
+    defaultJob.b = 4;
+    std::vector<SweepJob> jobs = expandSweepSpec("SweepTest_grid.txt", defaultJob, 1);
+    ASSERT_EQ(jobs.size(), 10);
+    EXPECT_EQ(jobs[0].normId, 10);
+    EXPECT_DOUBLE_EQ(jobs[4].p0, 1.0);
+    EXPECT_EQ(jobs[5].normId, 11);
+    EXPECT_DOUBLE_EQ(jobs[9].b, 4);
+    EXPECT_NE(jobs[0].seed, jobs[1].seed);
+    std::remove("SweepTest_grid.txt");
+}
+
+TEST(SweepTest, TestListOrderAndManifest) {
+    std::ofstream spec("SweepTest_list.csv");
+    spec << "normId,stepNum,replica\n1,10,0\n2,30,0\n2,30,1\n";
+    spec.close();
+    std::vector<SweepJob> jobs = expandSweepSpec("SweepTest_list.csv", SweepJob(), 1);
+    ASSERT_EQ(jobs.size(), 3);
+    EXPECT_EQ(getSweepOrder(jobs), (std::vector<int>{1, 2, 0}));
+
+    // the same key gives the same seed whatever the position in the spec
+    std::ofstream reordered("SweepTest_reordered.csv");
+    reordered << "replica,stepNum,normId\n1,30,2\n0,10,1\n";
+    reordered.close();
+    std::vector<SweepJob> reorderedJobs = expandSweepSpec("SweepTest_reordered.csv", SweepJob(), 1);
+    EXPECT_EQ(reorderedJobs[0].key, jobs[2].key);
+    EXPECT_EQ(reorderedJobs[0].seed, jobs[2].seed);
+    EXPECT_EQ(reorderedJobs[1].seed, jobs[0].seed);
+
+    std::remove("SweepTest_list.csv.done");
+    {
+        SweepManifest manifest("SweepTest_list.csv.done");
+        manifest.markDone(jobs[1].key);
+    }
+    SweepManifest manifest("SweepTest_list.csv.done");
+    EXPECT_TRUE(manifest.isDone(jobs[1].key));
+    EXPECT_FALSE(manifest.isDone(jobs[2].key));
+    std::remove("SweepTest_list.csv");
+    std::remove("SweepTest_reordered.csv");
+    std::remove("SweepTest_list.csv.done");
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
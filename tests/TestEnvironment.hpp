@@ -0,0 +1,29 @@
+/**
+ * @file TestEnvironment.hpp
+ * @brief the setup shared by the tests that load the game files
+ *
+ * A test binary registers GameSpecEnvironment in its main() with
+ * testing::AddGlobalTestEnvironment.
+ */
+
+#ifndef TEST_ENVIRONMENT_HPP
+#define TEST_ENVIRONMENT_HPP
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+#include "Evolution.hpp"
+#include "GameSpec.hpp"
+
+/** @brief the payoff matrices, strategies and norms of the project root as the default GameSpec */
+class GameSpecEnvironment : public testing::Environment {
+public:
+    void SetUp() override { GameSpec::setDefault(std::make_shared<const GameSpec>("..")); }
+};
+
+/** @brief an Evolution of norm 9 with the short term payoff matrix (s = 1, b = 4, beta = 3, c = 1, gamma = 1, p0 = 0.5) */
+inline Evolution makeEvolution(int population, uint64_t seed, double mu) {
+    return Evolution(population, 1, 4, 3, 1, 1, mu, 9, 0.5, "payoffMatrix_shortterm", seed);
+}
+
+#endif
@@ -0,0 +1,54 @@
+/**
+ * @file reputation_effects_dump.cpp
+ * @brief convert the binary log (--logFormat binary) back to the csv log
+ *
+ * usage: reputation_effects_dump --input log/xxx.rlog [--output xxx.csv]
+ * [--from step] [--to step]
+ *
+ */
+
+#include <fmt/os.h>
+#include <gflags/gflags.h>
+
+#include <climits>
+#include <iostream>
+#include <string>
+
+#include "BinaryLog.hpp"
+
+DEFINE_string(input, "", "the binary log file");
+DEFINE_string(output, "", "the csv file, stdout if empty");
+DEFINE_uint64(from, 0, "the first step to dump");
+DEFINE_uint64(to, ULLONG_MAX, "the step after the last step to dump");
+
+int main(int argc, char** argv) {
+  gflags::SetUsageMessage(
+      "convert the binary log of reputation_effects to the csv log");
+  gflags::SetVersionString("0.1");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_input.empty()) {
+    std::cerr << "--input is required" << std::endl;
+    return 1;
+  }
+
+  try {
+    BinaryLogReader reader(FLAGS_input);
+    if (FLAGS_output.empty()) {
+      std::cout << reader.formatCsvHeader() << "\n";
+      reader.readRows(FLAGS_from, FLAGS_to, [&](uint64_t step, const uint32_t* row) {
+        std::cout << reader.formatCsvRow(step, row) << "\n";
+      });
+    } else {
+      auto out = fmt::output_file(FLAGS_output);
+      out.print("{}\n", reader.formatCsvHeader());
+      reader.readRows(FLAGS_from, FLAGS_to, [&](uint64_t step, const uint32_t* row) {
+        out.print("{}\n", reader.formatCsvRow(step, row));
+      });
+    }
+  } catch (const char* e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return 0;
+}